@@ -0,0 +1,73 @@
+/*
+ * Times how long the hashlife backend takes to run an R-pentomino and a small
+ * soup out to very large generation counts.
+ *
+ * Usage: bench_hashlife [max power of ten]
+ */
+
+#include "CellularAutomaton.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static double
+elapsed_seconds (const struct timespec *start, const struct timespec *end)
+{
+  return (end->tv_sec - start->tv_sec) + (end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static Automaton *
+r_pentomino ()
+{
+  Automaton *automaton = automaton_create_backend(game_of_life, 64, 64,
+                                                  hashlife_backend);
+  automaton_set_state(automaton, -1, 0, 1);
+  automaton_set_state(automaton, -1, 1, 1);
+  automaton_set_state(automaton, 0, -1, 1);
+  automaton_set_state(automaton, 0, 0, 1);
+  automaton_set_state(automaton, 1, 0, 1);
+  return automaton;
+}
+
+static Automaton *
+soup ()
+{
+  Automaton *automaton = automaton_create_backend(game_of_life, 64, 64,
+                                                  hashlife_backend);
+  srand(1);
+  automaton_random_state(automaton);
+  return automaton;
+}
+
+int
+main (int argc, char **argv)
+{
+  int max_power = argc > 1 ? atoi(argv[1]) : 9;
+  struct { const char *name; Automaton *(*create)(); } patterns[] = {
+    { "r_pentomino", r_pentomino },
+    { "soup_64", soup }
+  };
+
+  printf("%-12s %14s %10s\n", "pattern", "generations", "seconds");
+  for (size_t i = 0; i < sizeof(patterns) / sizeof(patterns[0]); i++)
+    {
+      long generations = 1;
+      for (int power = 0; power <= max_power; power += 3)
+        {
+          struct timespec start, end;
+          Automaton *automaton = patterns[i].create();
+
+          clock_gettime(CLOCK_MONOTONIC, &start);
+          if (!automaton_step_n(automaton, generations))
+            fprintf(stderr, "step failed\n");
+          clock_gettime(CLOCK_MONOTONIC, &end);
+
+          printf("%-12s %14ld %10.4f\n", patterns[i].name, generations,
+                 elapsed_seconds(&start, &end));
+          automaton_destroy(automaton);
+          generations *= 1000;
+        }
+    }
+
+  return 0;
+}
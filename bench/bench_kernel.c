@@ -0,0 +1,58 @@
+/*
+ * Compares how fast each instruction set the rule kernel was built for can
+ * update a random Life soup on the dense grid backend.
+ *
+ * Usage: bench_kernel [size] [generations]
+ */
+
+#include "CellularAutomaton.h"
+#include "LifeKernel.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static double
+elapsed_seconds (const struct timespec *start, const struct timespec *end)
+{
+  return (end->tv_sec - start->tv_sec) + (end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+int
+main (int argc, char **argv)
+{
+  int size        = argc > 1 ? atoi(argv[1]) : 2048;
+  int generations = argc > 2 ? atoi(argv[2]) : 200;
+  double baseline = 0;
+
+  printf("%-8s %8s %12s %14s %10s\n", "kernel", "size", "gens/sec",
+         "cells/sec", "speedup");
+  for (Life_Kernel_Isa isa = life_kernel_scalar; isa <= life_kernel_avx2; isa++)
+    {
+      struct timespec start, end;
+      if (!life_kernel_select(isa))
+        continue;
+
+      Automaton *automaton = automaton_create_backend(game_of_life, size, size,
+                                                      dense_grid_backend);
+      if (!automaton)
+        {
+          fprintf(stderr, "failed to create automaton\n");
+          return EXIT_FAILURE;
+        }
+      srand(1);
+      automaton_random_state(automaton);
+
+      clock_gettime(CLOCK_MONOTONIC, &start);
+      automaton_step_n(automaton, generations);
+      clock_gettime(CLOCK_MONOTONIC, &end);
+      automaton_destroy(automaton);
+
+      double rate = generations / elapsed_seconds(&start, &end);
+      if (isa == life_kernel_scalar)
+        baseline = rate;
+      printf("%-8s %8d %12.1f %14.3e %9.2fx\n", life_kernel_isa_name(isa),
+             size, rate, rate * size * size, rate / baseline);
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,199 @@
+/*
+ * Times the basic operations of whichever Point_Set the tree was built
+ * with: inserting points in sorted, reverse sorted and random order,
+ * searching for points that are and aren't in the set, churning the set
+ * with deletes and inserts, and destroying it.  Points are keyed the way the
+ * automaton keys its cells, row by row, so sorted order is the order
+ * next_board_state inserts in, which is the worst case for rebalancing a
+ * red-black tree.
+ *
+ * Usage: bench_point_set [points]
+ */
+
+#include "PointSet.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* A point as the automaton inserts it, y first */
+struct POINT
+{
+  int y;
+  int x;
+};
+
+static double
+elapsed_seconds (const struct timespec *start, const struct timespec *end)
+{
+  return (end->tv_sec - start->tv_sec) + (end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static uint64_t
+next_random (uint64_t *seed)
+{
+  *seed ^= *seed << 13;
+  *seed ^= *seed >> 7;
+  *seed ^= *seed << 17;
+  return *seed;
+}
+
+static void
+shuffle (struct POINT *points, size_t count, uint64_t seed)
+{
+  for (size_t i = count - 1; i > 0; i--)
+    {
+      size_t j = next_random(&seed) % (i + 1);
+      struct POINT swap = points[i];
+      points[i] = points[j];
+      points[j] = swap;
+    }
+}
+
+/*
+ * Fills points with the cells of a square board in row order, every other
+ * column so the columns between are misses inside the set's range.
+ */
+static void
+board_points (struct POINT *points, size_t count, int side)
+{
+  for (size_t i = 0; i < count; i++)
+    {
+      points[i].y = (int) (i / side) - side / 2;
+      points[i].x = (int) (i % side) * 2 - side;
+    }
+}
+
+static void
+print_row (const char *operation, const char *order, size_t count,
+           double seconds, double bytes_per_point)
+{
+  printf("%-10s %-10s %10zu %10.1f", operation, order, count,
+         seconds * 1e9 / count);
+  if (bytes_per_point > 0)
+    printf(" %12.1f\n", bytes_per_point);
+  else
+    printf(" %12s\n", "-");
+}
+
+// Times inserting every point in the given order into a new set
+static Point_Set *
+time_insert (const struct POINT *points, size_t count, const char *order)
+{
+  struct timespec start, end;
+  Point_Set_Stats stats;
+  int data = 1;
+  Point_Set *set = point_set_create(sizeof(int), NULL);
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (size_t i = 0; i < count; i++)
+    point_set_insert(set, points[i].y, points[i].x, &data);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  point_set_get_stats(set, &stats);
+  print_row("insert", order, count, elapsed_seconds(&start, &end),
+            (double) stats.bytes_reserved / stats.points);
+  return set;
+}
+
+static void
+time_search (Point_Set *set, const struct POINT *points, size_t count,
+             int offset, const char *order)
+{
+  struct timespec start, end;
+  size_t found = 0;
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (size_t i = 0; i < count; i++)
+    found += point_set_search(set, points[i].y, points[i].x + offset) != NULL;
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  print_row(offset ? "miss" : "hit", order, count,
+            elapsed_seconds(&start, &end), 0);
+  if (found != (offset ? 0 : count))
+    fprintf(stderr, "search found %zu of %zu points\n", found, count);
+}
+
+/*
+ * Deletes a random point and inserts one that isn't in the set, over and
+ * over, so the set keeps its size while its nodes are recycled.
+ */
+static void
+time_churn (Point_Set *set, struct POINT *points, size_t count)
+{
+  struct timespec start, end;
+  uint64_t seed = 99;
+  int data = 1;
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (size_t i = 0; i < count; i++)
+    {
+      struct POINT *point = &points[next_random(&seed) % count];
+      point_set_delete(set, point->y, point->x);
+      point->x ^= 1;   // move it to one of the missing columns
+      point_set_insert(set, point->y, point->x, &data);
+    }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  print_row("churn", "random", count, elapsed_seconds(&start, &end), 0);
+}
+
+static void
+time_destroy (Point_Set *set, const char *order)
+{
+  struct timespec start, end;
+  size_t count = point_set_size(set);
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  point_set_destroy(set);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  print_row("destroy", order, count, elapsed_seconds(&start, &end), 0);
+}
+
+int
+main (int argc, char **argv)
+{
+  size_t count = argc > 1 ? strtoul(argv[1], NULL, 10) : 1 << 20;
+  int side     = 1;
+  while ((size_t) side * side < count)
+    side++;
+
+  struct POINT *sorted   = malloc(sizeof(struct POINT) * count);
+  struct POINT *reversed = malloc(sizeof(struct POINT) * count);
+  struct POINT *random   = malloc(sizeof(struct POINT) * count);
+  if (!sorted || !reversed || !random)
+    {
+      fprintf(stderr, "failed to allocate the points\n");
+      return EXIT_FAILURE;
+    }
+
+  board_points(sorted, count, side);
+  for (size_t i = 0; i < count; i++)
+    {
+      reversed[i] = sorted[count - 1 - i];
+      random[i]   = sorted[i];
+    }
+  shuffle(random, count, 7);
+
+  printf("%-10s %-10s %10s %10s %12s\n", "operation", "order", "points",
+         "ns/op", "bytes/point");
+
+  time_destroy(time_insert(reversed, count, "reversed"), "reversed");
+
+  Point_Set *set = time_insert(sorted, count, "sorted");
+  time_search(set, sorted, count, 0, "sorted");
+  time_search(set, sorted, count, 1, "sorted");
+  time_destroy(set, "sorted");
+
+  set = time_insert(random, count, "random");
+  time_search(set, random, count, 0, "random");
+  time_search(set, random, count, 1, "random");
+  time_churn(set, random, count);
+  time_destroy(set, "churned");
+
+  free(sorted);
+  free(reversed);
+  free(random);
+  return 0;
+}
@@ -0,0 +1,61 @@
+/*
+ * Times a random Game of Life soup on the dense grid backend advanced one
+ * automaton_update_state call at a time against the same soup advanced by
+ * automaton_step_n, which runs it in temporally blocked chunks.
+ *
+ * Usage: bench_step [size] [generations]
+ */
+
+#include "CellularAutomaton.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static double
+elapsed_seconds (const struct timespec *start, const struct timespec *end)
+{
+  return (end->tv_sec - start->tv_sec) + (end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static Automaton *
+soup (int size)
+{
+  Automaton *automaton = automaton_create_backend(game_of_life, size, size,
+                                                  dense_grid_backend);
+  srand(1);
+  automaton_random_state(automaton);
+  return automaton;
+}
+
+int
+main (int argc, char **argv)
+{
+  int size        = argc > 1 ? atoi(argv[1]) : 4096;
+  long generations = argc > 2 ? atol(argv[2]) : 100;
+  const char *modes[] = { "update_state", "step_n" };
+
+  printf("%-14s %8s %12s %12s %12s\n", "mode", "size", "generations",
+         "gens/sec", "population");
+  for (int mode = 0; mode < 2; mode++)
+    {
+      struct timespec start, end;
+      Automaton *automaton = soup(size);
+
+      clock_gettime(CLOCK_MONOTONIC, &start);
+      if (mode == 0)
+        {
+          for (long gen = 0; gen < generations; gen++)
+            automaton_update_state(automaton);
+        }
+      else if (!automaton_step_n(automaton, generations))
+        fprintf(stderr, "step failed\n");
+      clock_gettime(CLOCK_MONOTONIC, &end);
+
+      printf("%-14s %8d %12ld %12.1f %12ld\n", modes[mode], size, generations,
+             generations / elapsed_seconds(&start, &end),
+             automaton_get_population(automaton));
+      automaton_destroy(automaton);
+    }
+
+  return 0;
+}
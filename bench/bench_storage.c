@@ -0,0 +1,96 @@
+/*
+ * Compares how long the storage backends take to update a random soup.
+ *
+ * Usage: bench_storage [size] [generations]
+ */
+
+#include "CellularAutomaton.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static const char *backend_names[] = {
+  "point_set",
+  "dense_grid",
+  "sparse"
+};
+
+static double
+elapsed_seconds (const struct timespec *start, const struct timespec *end)
+{
+  return (end->tv_sec - start->tv_sec) + (end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/*
+ * Returns the number of seconds the backend took to run either a random soup
+ * or a single glider on an otherwise empty board.
+ */
+static double
+time_backend (Automaton_Backend backend, Automaton_Type type, int size,
+              int generations, bool soup)
+{
+  struct timespec start, end;
+  Automaton *automaton = automaton_create_backend(type, size, size, backend);
+  if (!automaton)
+    {
+      fprintf(stderr, "failed to create automaton\n");
+      exit(EXIT_FAILURE);
+    }
+
+  srand(1);
+  if (soup)
+    automaton_random_state(automaton);
+  else
+    {
+      automaton_set_state(automaton, -1, 0, 1);
+      automaton_set_state(automaton, 0, 1, 1);
+      automaton_set_state(automaton, 1, -1, 1);
+      automaton_set_state(automaton, 1, 0, 1);
+      automaton_set_state(automaton, 1, 1, 1);
+    }
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (int gen = 0; gen < generations; gen++)
+    automaton_update_state(automaton);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  automaton_destroy(automaton);
+  return elapsed_seconds(&start, &end);
+}
+
+int
+main (int argc, char **argv)
+{
+  int size        = argc > 1 ? atoi(argv[1]) : 512;
+  int generations = argc > 2 ? atoi(argv[2]) : 10;
+  Automaton_Type types[] = { game_of_life, brians_brain };
+
+  printf("%-12s %-8s %-12s %8s %12s %10s\n", "type", "board", "backend",
+         "size", "gens/sec", "speedup");
+  for (int soup = 1; soup >= 0; soup--)
+    {
+      for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); i++)
+        {
+          // a lone glider only makes sense for Life
+          if (!soup && types[i] != game_of_life)
+            continue;
+
+          double baseline = 0;
+          for (Automaton_Backend backend = point_set_backend;
+               backend <= sparse_backend; backend++)
+            {
+              double seconds = time_backend(backend, types[i], size,
+                                            generations, soup);
+              if (backend == point_set_backend)
+                baseline = seconds;
+              printf("%-12s %-8s %-12s %8d %12.2f %9.1fx\n",
+                     types[i] == game_of_life ? "life" : "brians_brain",
+                     soup ? "soup" : "glider", backend_names[backend], size,
+                     generations / seconds, baseline / seconds);
+            }
+        }
+    }
+
+  return 0;
+}
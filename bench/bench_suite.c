@@ -0,0 +1,281 @@
+/*
+ * Times automaton_update_state over a fixed grid of cases: every preset
+ * type on every backend that runs it, on soups of several sizes and
+ * densities drawn from fixed seeds, and on the patterns in patterns/.  Each
+ * case runs in a child process of its own so its peak RSS is its own.
+ *
+ * One line of tab separated values is printed per case, after a header
+ * naming the columns, so runs can be diffed or loaded into a spreadsheet to
+ * track regressions and compare backends:
+ *
+ *   gens_per_sec     generations per second
+ *   cells_per_sec    cells of the board updated per second
+ *   peak_rss_kb      peak resident set size of the case's process
+ *   allocs_per_gen   calls to malloc, calloc and realloc per generation
+ *
+ * Usage: bench_suite [seconds per case] [patterns directory]
+ */
+
+#define _GNU_SOURCE
+#include "CellularAutomaton.h"
+#include "Pattern.h"
+#include <dirent.h>
+#include <limits.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_GENERATIONS 100000
+#define PATTERN_BOARD 256
+#define DIRECTORY_LENGTH 1024
+
+/*
+ * ALLOCATION COUNTING
+ *
+ * Defining malloc and friends here overrides the C library's for the whole
+ * process, including the automaton, so every allocation can be counted.
+ */
+
+void *__libc_malloc (size_t size);
+void *__libc_calloc (size_t count, size_t size);
+void *__libc_realloc (void *ptr, size_t size);
+void *__libc_memalign (size_t alignment, size_t size);
+
+static atomic_long allocations;
+
+void *
+malloc (size_t size)
+{
+  atomic_fetch_add_explicit(&allocations, 1, memory_order_relaxed);
+  return __libc_malloc(size);
+}
+
+void *
+calloc (size_t count, size_t size)
+{
+  atomic_fetch_add_explicit(&allocations, 1, memory_order_relaxed);
+  return __libc_calloc(count, size);
+}
+
+void *
+realloc (void *ptr, size_t size)
+{
+  atomic_fetch_add_explicit(&allocations, 1, memory_order_relaxed);
+  return __libc_realloc(ptr, size);
+}
+
+void *
+aligned_alloc (size_t alignment, size_t size)
+{
+  atomic_fetch_add_explicit(&allocations, 1, memory_order_relaxed);
+  return __libc_memalign(alignment, size);
+}
+
+/*
+ * CASES
+ */
+
+static const char *type_names[] = {
+  [game_of_life]       = "life",
+  [seeds]              = "seeds",
+  [greenberg_hastings] = "greenberg-hastings",
+  [highlife]           = "highlife",
+  [day_and_night]      = "day-and-night",
+  [brians_brain]       = "brians-brain"
+};
+static const char *backend_names[] = {
+  [point_set_backend]  = "point-set",
+  [dense_grid_backend] = "dense-grid",
+  [sparse_backend]     = "sparse",
+  [hashlife_backend]   = "hashlife",
+  [wavefront_backend]  = "wavefront"
+};
+
+static const int sizes[]        = { 64, 512 };
+static const double densities[] = { 0.1, 0.5 };
+
+struct CASE
+{
+  const char *name;         /* "soup" or the pattern's file name */
+  Automaton_Type type;
+  Automaton_Backend backend;
+  int size;
+  double density;           /* of the soup, 0 for a pattern */
+  const char *pattern;      /* path of the pattern, NULL for a soup */
+};
+
+static double
+elapsed_seconds (const struct timespec *start, const struct timespec *end)
+{
+  return (end->tv_sec - start->tv_sec) + (end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+// A small generator of its own so every soup is the same on every libc
+static uint64_t
+next_random (uint64_t *seed)
+{
+  *seed ^= *seed << 13;
+  *seed ^= *seed >> 7;
+  *seed ^= *seed << 17;
+  return *seed;
+}
+
+// Sets a fraction of the board's cells live, seeded by the case
+static void
+fill_soup (Automaton *automaton, const struct CASE *c)
+{
+  uint64_t seed = 0x9e3779b97f4a7c15ULL ^ ((uint64_t) c->type << 32)
+    ^ ((uint64_t) c->size << 8) ^ (uint64_t) (c->density * 100);
+  uint64_t threshold = (uint64_t) (c->density * (double) UINT32_MAX);
+
+  for (int y = -c->size / 2; y < c->size - c->size / 2; y++)
+    for (int x = -c->size / 2; x < c->size - c->size / 2; x++)
+      if ((next_random(&seed) >> 32) < threshold)
+        automaton_set_state(automaton, y, x, 1);
+}
+
+// Runs a case and prints its line, called in the case's own process
+static int
+run_case (const struct CASE *c, double min_seconds)
+{
+  struct timespec start, now;
+  struct rusage usage;
+  long generations = 0;
+  double seconds   = 0;
+  Automaton *automaton = automaton_create_backend(c->type, c->size, c->size,
+                                                  c->backend);
+
+  if (!automaton)
+    return EXIT_FAILURE;
+  if (c->pattern)
+    {
+      if (!pattern_load(automaton, c->pattern))
+        return EXIT_FAILURE;
+    }
+  else
+    fill_soup(automaton, c);
+
+  // generations are run until the case has taken long enough to measure
+  long allocated = atomic_load(&allocations);
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  while (seconds < min_seconds && generations < MAX_GENERATIONS)
+    {
+      if (!automaton_update_state(automaton))
+        return EXIT_FAILURE;
+      generations++;
+      clock_gettime(CLOCK_MONOTONIC, &now);
+      seconds = elapsed_seconds(&start, &now);
+    }
+  allocated = atomic_load(&allocations) - allocated;
+  getrusage(RUSAGE_SELF, &usage);
+
+  printf("%s\t%s\t%s\t%d\t%.2f\t%ld\t%.4f\t%.1f\t%.4g\t%ld\t%.2f\n",
+         c->name, type_names[c->type], backend_names[c->backend], c->size,
+         c->density, generations, seconds, generations / seconds,
+         generations / seconds * c->size * c->size, usage.ru_maxrss,
+         (double) allocated / generations);
+  automaton_destroy(automaton);
+
+  return EXIT_SUCCESS;
+}
+
+// Runs a case in a child process, skipping backends that can't run its rule
+static void
+fork_case (const struct CASE *c, double min_seconds)
+{
+  Automaton *probe = automaton_create_backend(c->type, 1, 1, c->backend);
+  if (!probe)
+    {
+      fprintf(stderr, "case %s %s %s %d skipped, no automaton\n", c->name,
+              type_names[c->type], backend_names[c->backend], c->size);
+      return;
+    }
+
+  bool supported = automaton_get_backend(probe) == c->backend;
+  automaton_destroy(probe);
+  if (!supported)
+    return;
+
+  fflush(stdout);
+  pid_t pid = fork();
+  if (pid == 0)
+    {
+      int status = run_case(c, min_seconds);
+      fflush(stdout);
+      _exit(status);
+    }
+
+  int status = EXIT_FAILURE;
+  if (pid < 0 || waitpid(pid, &status, 0) < 0 || status != 0)
+    fprintf(stderr, "case %s %s %s %d failed\n", c->name,
+            type_names[c->type], backend_names[c->backend], c->size);
+}
+
+// Runs every backend on a pattern, its directory names the type
+static void
+run_pattern (const char *directory, const char *file, Automaton_Type type,
+             double min_seconds)
+{
+  char path[DIRECTORY_LENGTH + NAME_MAX + 2];
+
+  snprintf(path, sizeof(path), "%s/%s", directory, file);
+  for (Automaton_Backend backend = point_set_backend;
+       backend <= wavefront_backend; backend++)
+    {
+      struct CASE c = { file, type, backend, PATTERN_BOARD, 0, path };
+      fork_case(&c, min_seconds);
+    }
+}
+
+static void
+run_patterns (const char *root, double min_seconds)
+{
+  char directory[DIRECTORY_LENGTH];
+
+  for (Automaton_Type type = game_of_life; type < custom_rule; type++)
+    {
+      snprintf(directory, sizeof(directory), "%s/%s", root,
+               type_names[type]);
+      DIR *dir = opendir(directory);
+      if (!dir)
+        continue;
+
+      struct dirent *entry;
+      while ((entry = readdir(dir)))
+        if (entry->d_name[0] != '.')
+          run_pattern(directory, entry->d_name, type, min_seconds);
+      closedir(dir);
+    }
+}
+
+int
+main (int argc, char **argv)
+{
+  double min_seconds   = argc > 1 ? atof(argv[1]) : 0.05;
+  const char *patterns = argc > 2 ? argv[2] : "patterns";
+
+  printf("case\ttype\tbackend\tsize\tdensity\tgenerations\tseconds\t"
+         "gens_per_sec\tcells_per_sec\tpeak_rss_kb\tallocs_per_gen\n");
+
+  for (Automaton_Type type = game_of_life; type < custom_rule; type++)
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+      for (size_t d = 0; d < sizeof(densities) / sizeof(densities[0]); d++)
+        for (Automaton_Backend backend = point_set_backend;
+             backend <= wavefront_backend; backend++)
+          {
+            struct CASE c = {
+              "soup", type, backend, sizes[s], densities[d], NULL
+            };
+            fork_case(&c, min_seconds);
+          }
+
+  run_patterns(patterns, min_seconds);
+
+  return 0;
+}
@@ -0,0 +1,97 @@
+/*
+ * Measures how the parallel update scales with the number of threads,
+ * doubling the thread count up to the number of online processors or the
+ * given maximum.  Besides soups covering the whole board there are clustered
+ * workloads where all the activity starts in one corner, which static
+ * partitioning of the board balances badly.
+ *
+ * Usage: bench_threads [max threads] [size]
+ */
+
+#include "CellularAutomaton.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+static const struct
+{
+  const char *name;
+  Automaton_Backend backend;
+  Automaton_Type type;
+  int soup;               /* side of the soup in the corner, 0 for all */
+  int generations;
+} workloads[] = {
+  { "point_set", point_set_backend, game_of_life, 0, 2 },
+  { "dense_grid", dense_grid_backend, game_of_life, 0, 200 },
+  { "life_corner", dense_grid_backend, game_of_life, 256, 500 },
+  { "brain_corner", dense_grid_backend, brians_brain, 64, 200 }
+};
+
+// Fills a square in the top left corner of the board with a random soup
+static void
+corner_soup (Automaton *automaton, int size, int soup)
+{
+  for (int y = -size / 2; y < -size / 2 + soup; y++)
+    {
+      for (int x = -size / 2; x < -size / 2 + soup; x++)
+        automaton_set_state(automaton, y, x, rand() % 2);
+    }
+}
+
+static double
+elapsed_seconds (const struct timespec *start, const struct timespec *end)
+{
+  return (end->tv_sec - start->tv_sec) + (end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+int
+main (int argc, char **argv)
+{
+  long online     = sysconf(_SC_NPROCESSORS_ONLN);
+  int max_threads = argc > 1 ? atoi(argv[1]) : (online > 0 ? (int) online : 1);
+  int size        = argc > 2 ? atoi(argv[2]) : 1024;
+
+  printf("%-12s %8s %8s %12s %10s\n", "workload", "size", "threads",
+         "gens/sec", "speedup");
+  for (size_t i = 0; i < sizeof(workloads) / sizeof(workloads[0]); i++)
+    {
+      double baseline = 0;
+
+      for (int threads = 1; threads <= max_threads; threads *= 2)
+        {
+          struct timespec start, end;
+          Automaton *automaton = automaton_create_backend(workloads[i].type,
+                                                          size, size,
+                                                          workloads[i].backend);
+          if (!automaton || !automaton_set_threads(automaton, threads))
+            {
+              fprintf(stderr, "failed to create automaton\n");
+              return EXIT_FAILURE;
+            }
+          srand(1);
+          if (workloads[i].soup)
+            corner_soup(automaton, size, workloads[i].soup);
+          else
+            automaton_random_state(automaton);
+
+          clock_gettime(CLOCK_MONOTONIC, &start);
+          automaton_step_n(automaton, workloads[i].generations);
+          clock_gettime(CLOCK_MONOTONIC, &end);
+          automaton_destroy(automaton);
+
+          double rate = workloads[i].generations
+            / elapsed_seconds(&start, &end);
+          if (threads == 1)
+            baseline = rate;
+          printf("%-12s %8d %8d %12.2f %9.2fx\n", workloads[i].name, size,
+                 threads, rate, rate / baseline);
+
+          // always finish on the maximum even when it isn't a power of two
+          if (threads < max_threads && threads * 2 > max_threads)
+            threads = max_threads / 2;
+        }
+    }
+
+  return EXIT_SUCCESS;
+}
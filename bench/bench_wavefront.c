@@ -0,0 +1,86 @@
+/*
+ * Times the wavefront backend against the dense grid and sparse backends on
+ * mostly quiescent multi-state boards: a Greenberg-Hastings spiral wave and
+ * a small Brian's Brain soup in the middle of a large empty board.
+ *
+ * Usage: bench_wavefront [size] [generations]
+ */
+
+#include "CellularAutomaton.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static double
+elapsed_seconds (const struct timespec *start, const struct timespec *end)
+{
+  return (end->tv_sec - start->tv_sec) + (end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+// A broken wave with its refractory tail on one side curls into a spiral
+static void
+spiral (Automaton *automaton, int size)
+{
+  for (int x = 0; x < size / 2; x++)
+    {
+      automaton_set_state(automaton, 0, x, 1);
+      automaton_set_state(automaton, 1, x, 2);
+    }
+}
+
+static void
+brain_soup (Automaton *automaton, int size)
+{
+  (void) size;
+  srand(1);
+  for (int y = -32; y < 32; y++)
+    for (int x = -32; x < 32; x++)
+      automaton_set_state(automaton, y, x, rand() % 3);
+}
+
+int
+main (int argc, char **argv)
+{
+  int size        = argc > 1 ? atoi(argv[1]) : 1024;
+  int generations = argc > 2 ? atoi(argv[2]) : 200;
+  struct {
+    const char *name;
+    Automaton_Type type;
+    void (*seed)(Automaton *automaton, int size);
+  } workloads[] = {
+    { "gh_spiral", greenberg_hastings, spiral },
+    { "brain_soup", brians_brain, brain_soup }
+  };
+  struct { const char *name; Automaton_Backend backend; } backends[] = {
+    { "dense_grid", dense_grid_backend },
+    { "sparse", sparse_backend },
+    { "wavefront", wavefront_backend }
+  };
+
+  printf("%-12s %-12s %12s %12s\n", "workload", "backend", "gens/sec",
+         "population");
+  for (size_t w = 0; w < sizeof(workloads) / sizeof(workloads[0]); w++)
+    {
+      for (size_t b = 0; b < sizeof(backends) / sizeof(backends[0]); b++)
+        {
+          struct timespec start, end;
+          Automaton *automaton =
+            automaton_create_backend(workloads[w].type, size, size,
+                                     backends[b].backend);
+
+          workloads[w].seed(automaton, size);
+          clock_gettime(CLOCK_MONOTONIC, &start);
+          if (!automaton_step_n(automaton, generations))
+            fprintf(stderr, "step failed\n");
+          clock_gettime(CLOCK_MONOTONIC, &end);
+
+          printf("%-12s %-12s %12.1f %12ld\n", workloads[w].name,
+                 backends[b].name,
+                 generations / elapsed_seconds(&start, &end),
+                 automaton_get_population(automaton));
+          automaton_destroy(automaton);
+        }
+    }
+
+  return 0;
+}
@@ -0,0 +1,42 @@
+/**
+ * @file Batch.h
+ * @author Aaron Nedelec
+ * @date 16 Oct 2026
+ * @brief Interface for running an automaton from the command line.
+ *
+ * Batch mode runs an automaton for a number of generations without any
+ * terminal I/O, so the life binary can be used in scripts and pipelines:
+ *
+ *   life --rule brians-brain --size 200x300 --pattern FILE
+ *        --generations 1000 --seed 7 --output FILE --backend wavefront
+ *        --checkpoint FILE --interval 100 --record FILE --keyframes 100
+ *   life --restore FILE --generations 1000
+ *
+ * Every option has a default.  Without a pattern the board starts from a
+ * random soup drawn with the seed.  The final board is written to the output
+ * path in the text format of Pattern.h, or as Macrocell when the path ends in
+ * ".mc", and a summary of the run is printed to standard output as one
+ * "key value" pair per line.  The summary includes the counters of
+ * automaton_get_stats when they are compiled in.
+ *
+ * The generation count is the generation to stop at, so a run restored from
+ * one of its checkpoints with the same count ends where it would have.
+ *
+ * A run that is recorded goes a generation at a time, each one appended to
+ * a log of Replay.h that "life --replay FILE" plays back.
+ */
+
+#ifndef BATCH_H
+#define BATCH_H
+
+/**
+ * @brief Run an automaton as described by command line arguments
+ *
+ * @param argc The number of arguments, including the program name.
+ * @param argv The arguments, including the program name.
+ * @return The exit status of the run, 0 on success.
+ */
+int
+batch_main (int argc, char **argv);
+
+#endif
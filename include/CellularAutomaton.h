@@ -13,7 +13,14 @@
 #define CELLULAR_AUTOMATON_H
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
 
+/*
+ * Every automaton runs a rule given by a rulestring, see Rule.h.  The types
+ * other than custom_rule are presets for well known rules and custom_rule is
+ * the type of an automaton running any other rule.
+ */
 typedef enum AUTOMATON_TYPE
   {
     game_of_life,
@@ -21,11 +28,66 @@ typedef enum AUTOMATON_TYPE
     greenberg_hastings,
     highlife,
     day_and_night,
-    brians_brain
+    brians_brain,
+    custom_rule
   } Automaton_Type;
 
+/*
+ * The storage backends an automaton can keep its board in.  The point set
+ * backend can hold cells anywhere while the dense grid backend packs the
+ * cells inside the automaton's borders into a bit array.  The sparse backend
+ * stores its board in a point set but only evaluates cells next to non-dead
+ * cells, so an update costs time proportional to the population.
+ *
+ * The hashlife backend stores its board as a memoised quadtree and can skip
+ * ahead by billions of generations with automaton_step_n.  It only runs the
+ * two-state automata and treats the board as unbounded, so patterns are free
+ * to grow past the automaton's borders.
+ *
+ * The wavefront backend keeps a state per cell inside the borders along with
+ * lists of the live and dying cells, and an update only visits those lists
+ * and the neighbours of live cells.  It is meant for the Greenberg-Hastings
+ * and Brian's Brain automata, whose boards are mostly quiescent between thin
+ * waves, and runs any rule without birth on zero neighbours.
+ */
+typedef enum AUTOMATON_BACKEND
+  {
+    point_set_backend,
+    dense_grid_backend,
+    sparse_backend,
+    hashlife_backend,
+    wavefront_backend
+  } Automaton_Backend;
+
 typedef struct AUTOMATON Automaton;
 
+/* A cell whose state was changed by an update */
+typedef struct AUTOMATON_CHANGE Automaton_Change;
+struct AUTOMATON_CHANGE
+{
+  int y;
+  int x;
+  int state;  /* the state the cell was changed to */
+};
+
+/*
+ * What the last call to automaton_update_state or automaton_step_n cost.
+ * The counters are totals over every generation the call advanced, so
+ * dividing by generations gives the cost of a generation.
+ */
+typedef struct AUTOMATON_STATS Automaton_Stats;
+struct AUTOMATON_STATS
+{
+  long generations;       /* generations the call advanced the board by */
+  double seconds;         /* wall time the call took */
+  long cells_evaluated;   /* cells whose next state was worked out */
+  long searches;          /* calls made to point_set_search */
+  long node_allocations;  /* point set or quadtree nodes handed out */
+  long node_frees;        /* point set or quadtree nodes given back */
+  long population;        /* non-dead cells on the board now */
+  int tree_height;        /* of the point set, or the quadtree's level */
+};
+
 /**
  * @brief Creates a new cellular automaton
  *
@@ -39,6 +101,37 @@ typedef struct AUTOMATON Automaton;
 Automaton *
 automaton_create (Automaton_Type type, int height, int width);
 
+/**
+ * @brief Creates a new cellular automaton using the given storage backend
+ *
+ * Behaves like automaton_create but lets the caller pick how the board is
+ * stored.  All backends produce the same states for the same rules.  Should
+ * the backend not support the given type the sparse backend is used instead.
+ * @param type The type of automaton that is being created.
+ * @param height Height of the automaton's grid.
+ * @param width Width of the automaton's grid.
+ * @param backend The storage backend used for the automaton's board.
+ * @return Returns a pointer to the newly created automaton.
+ */
+Automaton *
+automaton_create_backend (Automaton_Type type, int height, int width,
+                          Automaton_Backend backend);
+
+/**
+ * @brief Creates a new cellular automaton running the given rule
+ *
+ * Behaves like automaton_create for an automaton running the rule given by a
+ * rulestring such as "B36/S23".  The automaton's type is the preset running
+ * the same rule, or custom_rule if there isn't one.
+ * @param rule The rulestring of the rule the automaton runs.
+ * @param height Height of the automaton's grid.
+ * @param width Width of the automaton's grid.
+ * @return Returns a pointer to the newly created automaton or NULL if the
+ * rulestring is invalid or creation failed.
+ */
+Automaton *
+automaton_create_rule (const char *rule, int height, int width);
+
 /**
  * @brief Destroys the given automaton.
  *
@@ -51,18 +144,40 @@ automaton_destroy (Automaton *automaton);
 /**
  * @brief Updates the state of the given automaton
  *
- * Updates the state of the given automaton.
+ * Updates the state of the given automaton.  While change tracking is on,
+ * the cells the update changed are listed for automaton_get_changes.
  * @param automaton The cellular automaton to be updated.
- * @return Returns whether the state update was successful.
- */ 
+ * @return Returns whether the state update was successful.  With change
+ * tracking on, an update whose changes didn't all fit in memory still
+ * happens but returns false.
+ */
 bool
 automaton_update_state (Automaton *automaton);
 
+/**
+ * @brief Advances the automaton by several generations
+ *
+ * Advances the automaton by the given number of generations without
+ * returning to the caller in between.  The hashlife backend advances by the
+ * powers of two making up the count, which lets it reach generation counts
+ * far beyond what repeated calls to automaton_update_state could.  The dense
+ * grid backend runs two-state automata on the Moore neighbourhood in blocks
+ * small enough to stay in the cache, each advanced by several generations
+ * before moving on to the next, unless most of the board has settled and
+ * skipping unchanged tiles is cheaper.
+ * @param automaton The cellular automaton to be updated.
+ * @param generations The number of generations to advance by.
+ * @return Returns whether every generation was computed successfully.
+ */
+bool
+automaton_step_n (Automaton *automaton, long generations);
+
 /**
  * @brief Retrieve the state at the given location.
  *
  * Retrieves the state of the cell at the given location.  Depending on the 
- * automaton this will return 0, 1, or 2.
+ * automaton this will return 0, 1, or 2, or a later dying state of a
+ * Generations rule.
  * @param automaton The automaton to retrieve a state from.
  * @param y The y coordinate of the requested cell.
  * @param x The x coordinate of the requested cell.
@@ -71,6 +186,40 @@ automaton_update_state (Automaton *automaton);
 int
 automaton_get_state (Automaton *automaton, int y, int x);
 
+/**
+ * @brief Calls a function on every non-dead cell inside a rectangle
+ *
+ * Visits every cell within the given inclusive bounds that is not in the
+ * dead state.  The cost depends on the number of cells visited rather than
+ * the area of the rectangle, except on the dense grid backend which skips
+ * empty words of the board and the wavefront backend which goes through
+ * every non-dead cell.  Cells are visited in row-major order by every backend
+ * except hashlife, which visits them in quadtree order, and wavefront, which
+ * visits them in no particular order.  The automaton must not be modified
+ * while it is being visited.
+ * @param automaton The automaton to visit.
+ * @param y_min The smallest y coordinate visited.
+ * @param x_min The smallest x coordinate visited.
+ * @param y_max The largest y coordinate visited.
+ * @param x_max The largest x coordinate visited.
+ * @param fn The function called with the location and state of each cell.
+ * @param ctx A pointer passed through to every call of fn.
+ */
+void
+automaton_foreach_in_rect (Automaton *automaton, int y_min, int x_min,
+                           int y_max, int x_max,
+                           void (*fn)(int y, int x, int state, void *ctx),
+                           void *ctx);
+
+/**
+ * @brief Count the non-dead cells of an automaton
+ *
+ * @param automaton The automaton to count the cells of.
+ * @return The number of cells that are not in the dead state.
+ */
+long
+automaton_get_population (Automaton *automaton);
+
 /**
  * @brief Get the current width of an automaton
  *
@@ -91,6 +240,101 @@ automaton_get_width (Automaton *automaton);
 int
 automaton_get_height (Automaton *automaton);
 
+/**
+ * @brief Get the storage backend of an automaton
+ *
+ * @param automaton The cellular automaton whose backend is returned
+ * @return The backend currently storing the automaton's board
+ */
+Automaton_Backend
+automaton_get_backend (Automaton *automaton);
+
+/**
+ * @brief Get the type of an automaton
+ *
+ * @param automaton The cellular automaton whose type is returned
+ * @return The preset type of the automaton's rule, or custom_rule
+ */
+Automaton_Type
+automaton_get_type (Automaton *automaton);
+
+/**
+ * @brief Get the generation an automaton has reached
+ *
+ * Counts the generations the automaton has advanced since it was created or
+ * its board was last reset by automaton_dead_state or
+ * automaton_random_state.
+ * @param automaton The cellular automaton whose generation is returned
+ * @return The number of generations advanced
+ */
+long
+automaton_get_generation (Automaton *automaton);
+
+/**
+ * @brief Get the rulestring of the rule an automaton runs
+ *
+ * @param automaton The cellular automaton whose rule is written.
+ * @param buffer Where the rulestring is written, always null terminated.
+ * @param size The size of the buffer, RULE_STRING_MAX is always enough.
+ * @return The length of the full rulestring.
+ */
+size_t
+automaton_get_rule (Automaton *automaton, char *buffer, size_t size);
+
+/**
+ * @brief Get the number of threads updating an automaton
+ *
+ * @param automaton The cellular automaton whose thread count is returned
+ * @return The number of threads used by each update, including the caller
+ */
+int
+automaton_get_threads (Automaton *automaton);
+
+/**
+ * @brief Get how many tiles of the board the last update evaluated
+ *
+ * The dense grid backend splits its board into tiles 32 rows high and 64
+ * columns wide and skips any tile whose surroundings were the same one and
+ * two generations ago.  Both counts are 0 for the other backends.
+ * @param automaton The cellular automaton to inspect.
+ * @param evaluated Set to the number of tiles the last update computed.
+ * @param skipped Set to the number of tiles the last update skipped.
+ */
+void
+automaton_get_tile_counts (Automaton *automaton, long *evaluated,
+                           long *skipped);
+
+/**
+ * @brief Get what the last update or step of the automaton cost
+ *
+ * The counters are kept by the update's hot paths and are only compiled in
+ * when built with COLLECT_STATS, see Stats.h.  Without it everything but
+ * the population and tree height is left 0.  The tree height of the point
+ * set and sparse backends is worked out by walking the whole point set, once
+ * for each board, and it is 0 for the backends that don't keep a tree.
+ * @param automaton The cellular automaton to inspect.
+ * @param stats Filled in with the cost of the last update or step.
+ * @return Returns whether the counters were collected.
+ */
+bool
+automaton_get_stats (Automaton *automaton, Automaton_Stats *stats);
+
+/**
+ * @brief Get the cells changed by the last update
+ *
+ * Only filled in while change tracking is on.  After automaton_step_n the
+ * list holds the changes made by its last generation, except on the hashlife
+ * backend where it holds those of its last power of two step.  Cells are
+ * listed once each, in no particular order, and the hashlife backend also
+ * lists cells outside the automaton's borders, as far as an int reaches.
+ * The list is reused by the next update, so it is only valid until then.
+ * @param automaton The automaton whose changes are returned.
+ * @param count Set to the number of changed cells.
+ * @return The changed cells with the states they were changed to.
+ */
+const Automaton_Change *
+automaton_get_changes (Automaton *automaton, size_t *count);
+
 /**
  * @brief Sets the boundaries of the given automaton.
  *
@@ -99,8 +343,10 @@ automaton_get_height (Automaton *automaton);
  * @param automaton The automaton to set the boundaries for
  * @param height The new height of the automaton.
  * @param width The new width of the given automaton.
+ * @return Whether the boundaries were set.  The automaton is unchanged if
+ * there wasn't the memory to resize its board.
  */
-void
+bool
 automaton_set_border (Automaton *automaton, int height, int width);
 
 /**
@@ -139,16 +385,131 @@ automaton_dead_state (Automaton *automaton);
 bool
 automaton_set_state (Automaton *automaton, int y, int x, int state);
 
+/**
+ * @brief Set the states of many cells at once
+ *
+ * Behaves like calling automaton_set_state on each cell in turn, except that
+ * every cell is checked before any is set.  An empty point set or sparse
+ * board is built in one pass when the cells are sorted by y and then x with
+ * none given twice, which is much faster than setting them one at a time.
+ * @param automaton The automaton that we're changing the cells of.
+ * @param cells The cells to set and the state to set each of them to.
+ * @param count The number of cells.
+ * @return Returns whether the cells were set.  Nothing is set if any state is
+ * invalid or any cell is outside the bounds of the board.
+ */
+bool
+automaton_set_cells (Automaton *automaton, const Automaton_Change *cells,
+                     size_t count);
+
+/**
+ * @brief Add the live cells of a Macrocell pattern to an automaton
+ *
+ * Macrocell is the hashed quadtree format of HashLife.h, which stores each
+ * distinct subtree of a pattern once.  On the hashlife backend the pattern
+ * is added to the universe as the file's quadtree, so it may be far larger
+ * than the board.  Other backends expand a pattern that fits on the board
+ * into its cells, and an automaton whose pattern doesn't fit is moved to the
+ * hashlife backend if its rule can run there.  Cells already on the board
+ * are left alone.
+ * @param automaton The automaton to add the cells to.
+ * @param text The contents of the Macrocell file, which needn't end in a
+ * null character.
+ * @param length The number of characters in text.
+ * @return Returns whether the pattern was loaded.  Nothing is set if the
+ * text is malformed or the pattern doesn't fit on a board that can't grow.
+ */
+bool
+automaton_load_macrocell (Automaton *automaton, const char *text,
+                          size_t length);
+
+/**
+ * @brief Write the live cells of an automaton in the Macrocell format
+ *
+ * The hashlife backend writes its whole universe, which may reach past the
+ * board, and any other backend writes the cells of its board.  Only
+ * automata with two states can be written.
+ * @param automaton The automaton to write.
+ * @param file The file written to.
+ * @return Returns whether the automaton was written.
+ */
+bool
+automaton_save_macrocell (Automaton *automaton, FILE *file);
+
+/**
+ * @brief Sets the generation an automaton has reached
+ *
+ * Lets a board restored from elsewhere carry on counting from the generation
+ * it was saved at.
+ * @param automaton The automaton to set the generation of.
+ * @param generation The generation, at least 0.
+ */
+void
+automaton_set_generation (Automaton *automaton, long generation);
+
 /**
  * @brief Sets the automaton's type
  *
- * Sets the given automaton to whatever the given type is
+ * Sets the given automaton to whatever the given type is.  An automaton whose
+ * backend cannot run the new type is moved to the sparse backend.  Setting
+ * the type to custom_rule does nothing, use automaton_set_rule instead.
  * @param automaton The automaton to set the type of.
  * @param type The type to set the automaton to.
+ * @return Whether the type was set.  The automaton is unchanged if there
+ * wasn't the memory to move or rebuild its board for the new type.
  */
-void
+bool
 automaton_set_type (Automaton *automaton, Automaton_Type type);
 
+/**
+ * @brief Sets the rule an automaton runs
+ *
+ * Behaves like automaton_set_type for the rule given by a rulestring.  Rules
+ * with birth on zero neighbours can't run on the sparse backend, so such an
+ * automaton is moved to the dense grid backend instead.
+ * @param automaton The automaton to set the rule of.
+ * @param rule The rulestring of the new rule.
+ * @return Returns whether the rule was set.  The automaton is unchanged if
+ * the rulestring wasn't valid or there wasn't the memory to move or rebuild
+ * its board for the new rule.
+ */
+bool
+automaton_set_rule (Automaton *automaton, const char *rule);
+
+/**
+ * @brief Sets how many threads update the automaton
+ *
+ * The point set and dense grid backends update in parallel on a pool of
+ * worker threads kept alive between updates.  The point set backend splits
+ * each update into horizontal stripes of the board, one per worker.  The
+ * dense grid backend hands each worker a share of the tiles that need
+ * updating, and workers that run out steal tiles from the others.  The
+ * calling thread is one of the workers.  The other backends always update
+ * on the calling thread.  An automaton starts out with a single thread.
+ * @param automaton The automaton to set the thread count of.
+ * @param threads The number of threads, at least 1.
+ * @return Returns whether the threads could be started.  The automaton keeps
+ * its previous threads if they couldn't.
+ */
+bool
+automaton_set_threads (Automaton *automaton, int threads);
+
+/**
+ * @brief Turns listing the cells changed by each update on or off
+ *
+ * Changes are recorded where each update writes the new states, so listing
+ * costs time proportional to the number of changes rather than to the board
+ * or its population.  The dense grid backend compares only the words of the
+ * tiles that differ from the generation before and the hashlife backend
+ * walks only the subtrees that differ.  The list keeps its memory between
+ * updates, so once it has grown large enough listing allocates nothing.
+ * Tracking is off to begin with and changing it empties the list.
+ * @param automaton The automaton to track the changes of.
+ * @param enabled Whether changes are listed.
+ */
+void
+automaton_set_change_tracking (Automaton *automaton, bool enabled);
+
 /**
  * @brief Cycles the given cell to the next state
  *
@@ -0,0 +1,121 @@
+/**
+ * @file Checkpoint.h
+ * @author Aaron Nedelec
+ * @date 16 Oct 2026
+ * @brief Interface for saving and restoring an automaton mid-run.
+ *
+ * A checkpoint holds everything needed to carry on a run where it left off:
+ * the automaton's type and rule, its backend, the bounds of its board, the
+ * generation it reached and the state of every cell that isn't dead.  The
+ * file is binary and small:
+ *
+ *   magic        the 8 bytes "LIFECKPT"
+ *   version      varint, CHECKPOINT_VERSION
+ *   type         varint
+ *   backend      varint
+ *   height       varint
+ *   width        varint
+ *   generation   varint
+ *   rule         varint length followed by the rulestring
+ *   count        varint number of cells
+ *   cells        count cells in row-major order, each the number of rows
+ *                skipped since the last cell, then the number of columns
+ *                skipped since it on the same row or its column on a new
+ *                row, then its state if the rule has more than two states
+ *
+ * except on the hashlife backend, whose universe isn't bounded by the board
+ * and is saved whole in place of the count and cells:
+ *
+ *   length       varint length of the universe
+ *   universe     the universe in the Macrocell format of HashLife.h
+ *
+ * after which comes
+ *
+ *   checksum     CRC-32 of every byte before it, 4 bytes little endian
+ *
+ * Varints are unsigned LEB128, 7 bits a byte with the high bit set on every
+ * byte but the last, so a run of live cells costs two bytes a cell.  Rows and
+ * columns count from the top left of the board.
+ *
+ * Checkpoints are written to a temporary file which then replaces the old
+ * one, so a process that dies while writing leaves the last checkpoint
+ * whole.
+ */
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include "CellularAutomaton.h"
+#include <stdbool.h>
+
+/* The version written, and the only one read */
+#define CHECKPOINT_VERSION 1
+
+typedef struct CHECKPOINTER Checkpointer;
+
+/**
+ * @brief Write a checkpoint of an automaton
+ *
+ * @param automaton The automaton to save.
+ * @param path The path of the checkpoint, which is replaced if it exists.
+ * @return Whether the whole checkpoint was written.
+ */
+bool
+automaton_save_checkpoint (Automaton *automaton, const char *path);
+
+/**
+ * @brief Create an automaton from a checkpoint
+ *
+ * The automaton runs on the backend the checkpoint was saved from, with a
+ * single thread.
+ * @param path The path of the checkpoint.
+ * @return A pointer to the restored automaton or NULL if the file couldn't
+ * be read, isn't a checkpoint of this version or fails its checksum.
+ */
+Automaton *
+automaton_load_checkpoint (const char *path);
+
+/**
+ * @brief Create a checkpointer and start its thread
+ *
+ * A checkpointer writes checkpoints on a background thread, so that a run
+ * is only held up for as long as it takes to copy its board.
+ * @return A pointer to the new checkpointer or NULL if creation failed.
+ */
+Checkpointer *
+checkpointer_create (void);
+
+/**
+ * @brief Finish writing any checkpoint and destroy a checkpointer
+ *
+ * @param checkpointer The checkpointer to destroy.
+ */
+void
+checkpointer_destroy (Checkpointer *checkpointer);
+
+/**
+ * @brief Write a checkpoint of an automaton on the background thread
+ *
+ * The automaton is copied before this returns and may be advanced straight
+ * away.  If the thread is still busy with an earlier checkpoint, the newest
+ * one waiting replaces any that hasn't been started.
+ * @param checkpointer The checkpointer to write with.
+ * @param automaton The automaton to save.
+ * @param path The path of the checkpoint, which is replaced if it exists.
+ * @return Whether the automaton could be copied.  Whether it was written is
+ * reported by checkpointer_wait.
+ */
+bool
+checkpointer_save (Checkpointer *checkpointer, Automaton *automaton,
+                   const char *path);
+
+/**
+ * @brief Wait until every checkpoint handed to a checkpointer is written
+ *
+ * @param checkpointer The checkpointer to wait for.
+ * @return Whether every checkpoint since the last wait was written.
+ */
+bool
+checkpointer_wait (Checkpointer *checkpointer);
+
+#endif
@@ -0,0 +1,170 @@
+/**
+ * @file Codec.h
+ * @author Aaron Nedelec
+ * @date 16 Oct 2026
+ * @brief Interface for the binary encodings shared by the on-disk formats.
+ *
+ * Checkpoints and replays are built from the same few pieces: unsigned
+ * LEB128 varints, lists of cells in row-major order stored as the gaps
+ * between them, a CRC-32 to catch damage, and a small LZ77 compressor in the
+ * style of the LZ4 block format.
+ *
+ * A list of cells is stored as, for each cell, the number of rows skipped
+ * since the last cell, then the number of columns skipped since it on the
+ * same row or its column on a new row, then optionally its state.  Rows and
+ * columns count from the top left of the board, so a run of live cells
+ * costs two bytes a cell.
+ *
+ * A compressed block is a series of sequences, each a token byte holding
+ * the number of literals in its high nibble and the length of the match
+ * less 4 in its low nibble, a nibble of 15 being followed by bytes of 255
+ * and one less than 255 that are added to it.  Then come the literals, and
+ * unless the block ends there, the distance back to the match in 2 bytes
+ * little endian.
+ */
+
+#ifndef CODEC_H
+#define CODEC_H
+
+#include "CellularAutomaton.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Bytes being written, which grow as needed */
+typedef struct CODEC_BUFFER Codec_Buffer;
+struct CODEC_BUFFER
+{
+  uint8_t *bytes;
+  size_t size;
+  size_t capacity;
+  bool failed;              /* the buffer couldn't grow, so bytes were lost */
+};
+
+/* Bytes being read, which never reads past end */
+typedef struct CODEC_READER Codec_Reader;
+struct CODEC_READER
+{
+  const uint8_t *next;
+  const uint8_t *end;
+};
+
+/**
+ * @brief Append bytes to a buffer
+ *
+ * @param buffer The buffer to append to.  It starts out zeroed.
+ * @param bytes The bytes to append.
+ * @param size The number of bytes.
+ */
+void
+codec_put (Codec_Buffer *buffer, const void *bytes, size_t size);
+
+/**
+ * @brief Append a varint to a buffer
+ *
+ * @param buffer The buffer to append to.
+ * @param value The value to append.
+ */
+void
+codec_put_varint (Codec_Buffer *buffer, uint64_t value);
+
+/**
+ * @brief Append a list of cells to a buffer
+ *
+ * @param buffer The buffer to append to.
+ * @param cells The cells, sorted by y and then x.
+ * @param count The number of cells.
+ * @param height The height of the board the cells are on.
+ * @param width The width of the board the cells are on.
+ * @param states Whether the state of each cell is stored.
+ */
+void
+codec_put_cells (Codec_Buffer *buffer, const Automaton_Change *cells,
+                 size_t count, int height, int width, bool states);
+
+/**
+ * @brief Read a varint
+ *
+ * @param reader The bytes to read from.
+ * @param max The largest value allowed.
+ * @param value Set to the value read.
+ * @return Whether a varint no larger than max was read.
+ */
+bool
+codec_get_varint (Codec_Reader *reader, uint64_t max, uint64_t *value);
+
+/**
+ * @brief Read a list of cells
+ *
+ * @param reader The bytes to read from.
+ * @param cells Filled in with the cells, which must have room for count.
+ * @param count The number of cells to read.
+ * @param height The height of the board the cells are on.
+ * @param width The width of the board the cells are on.
+ * @param max_state The largest state allowed, or 0 if the states weren't
+ * stored, in which case every cell is given state 1.
+ * @return Whether every cell was read and lies on the board in order.
+ */
+bool
+codec_get_cells (Codec_Reader *reader, Automaton_Change *cells, size_t count,
+                 int height, int width, int max_state);
+
+/**
+ * @brief Sort cells by y and then x
+ *
+ * @param cells The cells to sort, which may be NULL if count is 0.
+ * @param count The number of cells.
+ */
+void
+codec_sort_cells (Automaton_Change *cells, size_t count);
+
+/**
+ * @brief Compute the CRC-32 of some bytes
+ *
+ * This is the CRC-32 of zlib and PNG, and like zlib's crc32 the checksum of
+ * bytes following on from others is found by passing in the checksum of
+ * those before.
+ * @param crc The checksum of the bytes before, or 0 to start afresh.
+ * @param bytes The bytes to check.
+ * @param size The number of bytes.
+ * @return The checksum.
+ */
+uint32_t
+codec_crc32 (uint32_t crc, const uint8_t *bytes, size_t size);
+
+/**
+ * @brief Get the most bytes compressing a block can take
+ *
+ * @param size The size of the block.
+ * @return The size of the buffer codec_compress needs.
+ */
+size_t
+codec_compress_bound (size_t size);
+
+/**
+ * @brief Compress a block of bytes
+ *
+ * @param in The bytes to compress.
+ * @param size The number of bytes.
+ * @param out Where the compressed block is written, which must have room for
+ * codec_compress_bound(size) bytes.
+ * @return The size of the compressed block.
+ */
+size_t
+codec_compress (const uint8_t *in, size_t size, uint8_t *out);
+
+/**
+ * @brief Decompress a block of bytes
+ *
+ * @param in The compressed block.
+ * @param size The size of the compressed block.
+ * @param out Where the bytes are written.
+ * @param out_size The number of bytes the block decompresses to.
+ * @return Whether the block decompressed to exactly out_size bytes, false
+ * if it is damaged.
+ */
+bool
+codec_decompress (const uint8_t *in, size_t size, uint8_t *out,
+                  size_t out_size);
+
+#endif
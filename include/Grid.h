@@ -0,0 +1,117 @@
+/**
+ * @file Grid.h
+ * @author Aaron Nedelec
+ * @date 16 Oct 2026
+ * @brief Interface for a dense bit-packed grid of cells.
+ *
+ * A Grid stores a bounded rectangle of cells in contiguous memory.  Each
+ * non-zero cell state is stored in its own bit plane so a two-state board
+ * takes a single bit per cell and a three-state board takes two.  Every row
+ * of a plane is surrounded by a zero word on either side and every plane has
+ * a zero row above and below it so neighbourhood checks never need to test
+ * for the edges of the grid.
+ */
+
+#ifndef GRID_H
+#define GRID_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Number of cells packed into each word of a row */
+#define GRID_WORD_BITS 64
+
+typedef struct GRID Grid;
+struct GRID
+{
+  int height;
+  int width;
+  int planes;        /* number of bit planes, one per non-zero state */
+  size_t words;      /* words needed to hold one row of cells */
+  size_t stride;     /* words per row including the padding words */
+  uint64_t *cells;   /* planes * (height + 2) rows of stride words */
+};
+
+/**
+ * @brief Create a new grid
+ *
+ * Creates a grid of the given size with every cell in the zero state.
+ * @param height The number of rows in the grid.
+ * @param width The number of columns in the grid.
+ * @param planes The number of non-zero states a cell can be in.
+ * @return A pointer to the new grid or NULL if creation failed.
+ */
+Grid *
+grid_create (int height, int width, int planes);
+
+/**
+ * @brief Destroy a grid
+ *
+ * @param grid The grid to destroy.
+ */
+void
+grid_destroy (Grid *grid);
+
+/**
+ * @brief Set every cell of the grid to the zero state
+ *
+ * @param grid The grid to clear.
+ */
+void
+grid_clear (Grid *grid);
+
+/**
+ * @brief Get a pointer to the first word of a row
+ *
+ * Rows and words outside the grid by one are valid and always zero.
+ * @param grid The grid containing the row.
+ * @param plane The bit plane of the row, state - 1.
+ * @param row The index of the row.
+ * @return A pointer to the first word of the row.
+ */
+static inline uint64_t *
+grid_row (const Grid *grid, int plane, int row)
+{
+  return grid->cells + ((size_t) plane * (grid->height + 2) + row + 1)
+    * grid->stride + 1;
+}
+
+/**
+ * @brief Get the mask of valid cells in the last word of a row
+ *
+ * @param grid The grid to get the mask for.
+ * @return A mask with a bit set for every column in the last word.
+ */
+static inline uint64_t
+grid_last_word_mask (const Grid *grid)
+{
+  int used = grid->width % GRID_WORD_BITS;
+  return used ? (UINT64_C(1) << used) - 1 : ~UINT64_C(0);
+}
+
+/**
+ * @brief Get the state of a cell
+ *
+ * Cells outside the grid are always in the zero state.
+ * @param grid The grid to read from.
+ * @param row The row of the cell.
+ * @param col The column of the cell.
+ * @return The state of the cell.
+ */
+int
+grid_get (const Grid *grid, int row, int col);
+
+/**
+ * @brief Set the state of a cell
+ *
+ * @param grid The grid to modify.
+ * @param row The row of the cell.
+ * @param col The column of the cell.
+ * @param state The new state of the cell, at most the number of planes.
+ * @return Whether the cell was inside the grid and the state was valid.
+ */
+bool
+grid_set (Grid *grid, int row, int col, int state);
+
+#endif
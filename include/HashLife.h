@@ -0,0 +1,206 @@
+/**
+ * @file HashLife.h
+ * @author Aaron Nedelec
+ * @date 16 Oct 2026
+ * @brief Interface for a HashLife universe.
+ *
+ * A HashLife universe stores an unbounded two-state board as a canonicalised
+ * quadtree.  Identical subtrees are shared and the future of every node is
+ * memoised, which lets periodic and highly repetitive patterns be advanced by
+ * huge numbers of generations at once.  Only outer-totalistic rules on the
+ * Moore neighbourhood without birth on zero neighbours are supported.
+ */
+
+#ifndef HASH_LIFE_H
+#define HASH_LIFE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/* The largest power of two a single step can advance the universe by */
+#define HASH_LIFE_MAX_STEP 60
+
+typedef struct HASH_LIFE Hash_Life;
+
+/* Work counters of a universe, all but nodes and level need COLLECT_STATS */
+typedef struct HASH_LIFE_STATS Hash_Life_Stats;
+struct HASH_LIFE_STATS
+{
+  size_t nodes;             /* nodes currently in the node cache */
+  size_t node_allocations;  /* nodes created over the universe's lifetime */
+  size_t node_frees;        /* nodes swept out over the universe's lifetime */
+  uint64_t cells_evaluated; /* cells advanced by brute force, not memoised */
+  int level;                /* the root covers 2^level by 2^level cells */
+};
+
+/**
+ * @brief Create a new HashLife universe
+ *
+ * Bit n of each mask is set if a cell with n live neighbours is born or
+ * survives respectively.
+ * @param birth The birth mask of the rule.
+ * @param survival The survival mask of the rule.
+ * @return A pointer to the new empty universe or NULL if creation failed.
+ */
+Hash_Life *
+hash_life_create (uint16_t birth, uint16_t survival);
+
+/**
+ * @brief Destroy a HashLife universe
+ *
+ * @param hash_life The universe to destroy.
+ */
+void
+hash_life_destroy (Hash_Life *hash_life);
+
+/**
+ * @brief Change the rule of a universe
+ *
+ * Changing the rule discards every memoised result.
+ * @param hash_life The universe to change.
+ * @param birth The new birth mask.
+ * @param survival The new survival mask.
+ */
+void
+hash_life_set_rule (Hash_Life *hash_life, uint16_t birth, uint16_t survival);
+
+/**
+ * @brief Kill every cell in the universe
+ *
+ * @param hash_life The universe to clear.
+ */
+void
+hash_life_clear (Hash_Life *hash_life);
+
+/**
+ * @brief Get the state of a cell
+ *
+ * @param hash_life The universe to read from.
+ * @param y The y coordinate of the cell.
+ * @param x The x coordinate of the cell.
+ * @return 1 if the cell is alive, otherwise 0.
+ */
+int
+hash_life_get (Hash_Life *hash_life, int64_t y, int64_t x);
+
+/**
+ * @brief Set the state of a cell
+ *
+ * @param hash_life The universe to modify.
+ * @param y The y coordinate of the cell.
+ * @param x The x coordinate of the cell.
+ * @param state 1 to make the cell alive, 0 to kill it.
+ * @return Whether the cell could be set.
+ */
+bool
+hash_life_set (Hash_Life *hash_life, int64_t y, int64_t x, int state);
+
+/**
+ * @brief Advance the universe by a power of two generations
+ *
+ * @param hash_life The universe to advance.
+ * @param log2_generations The universe advances 2^log2_generations
+ * generations, at most HASH_LIFE_MAX_STEP.
+ * @return Whether the step succeeded.  The universe is unchanged on failure.
+ */
+bool
+hash_life_step (Hash_Life *hash_life, int log2_generations);
+
+/**
+ * @brief Calls a function on every live cell inside a rectangle
+ *
+ * Empty subtrees are skipped, so the cost depends on the number of live
+ * cells rather than the area of the rectangle.  Cells are visited
+ * in quadtree order rather than row-major order.
+ * @param hash_life The universe to visit.
+ * @param y_min The smallest y coordinate visited.
+ * @param x_min The smallest x coordinate visited.
+ * @param y_max The largest y coordinate visited.
+ * @param x_max The largest x coordinate visited.
+ * @param fn The function called with the coordinates of each live cell.
+ * @param ctx A pointer passed through to every call of fn.
+ */
+void
+hash_life_foreach_in_rect (Hash_Life *hash_life, int64_t y_min, int64_t x_min,
+                           int64_t y_max, int64_t x_max,
+                           void (*fn)(int64_t y, int64_t x, void *ctx),
+                           void *ctx);
+
+/**
+ * @brief Calls a function on every cell changed by the last step
+ *
+ * Compares the universe with the one before the last call to
+ * hash_life_step, including any cells set since.  Identical subtrees are the
+ * same node, so only the parts of the tree that changed are walked.
+ * @param hash_life The universe to compare.
+ * @param fn The function called with the coordinates and new state of each
+ * cell that changed.
+ * @param ctx A pointer passed through to every call of fn.
+ * @return Whether the comparison could be made, false if there was no memory
+ * to line up the two trees.
+ */
+bool
+hash_life_foreach_change (Hash_Life *hash_life,
+                          void (*fn)(int64_t y, int64_t x, int state,
+                                     void *ctx),
+                          void *ctx);
+
+/**
+ * @brief Add the cells of a pattern in the Macrocell format to the universe
+ *
+ * Macrocell files store a quadtree the way the universe does, each distinct
+ * node once, so a pattern is added by building its nodes rather than setting
+ * its cells and repetitive patterns far too large to expand can be loaded.
+ * Only two-state files are read and the rule in the file is ignored.  The
+ * text is read in place and doesn't need to end in a null character.
+ * @param hash_life The universe to add the cells to.
+ * @param text The contents of the file.
+ * @param length The number of characters in text.
+ * @return Whether the pattern was added, false if the text is malformed or
+ * there was no memory.  The universe is unchanged on failure.
+ */
+bool
+hash_life_read_macrocell (Hash_Life *hash_life, const char *text,
+                          size_t length);
+
+/**
+ * @brief Write the universe to a file in the Macrocell format
+ *
+ * Each distinct node of the universe is written once.
+ * @param hash_life The universe to write.
+ * @param file The file written to.
+ * @return Whether the universe was written.
+ */
+bool
+hash_life_write_macrocell (Hash_Life *hash_life, FILE *file);
+
+/**
+ * @brief Get the number of live cells in the universe
+ *
+ * @param hash_life The universe to count.
+ * @return The number of live cells.
+ */
+uint64_t
+hash_life_population (Hash_Life *hash_life);
+
+/**
+ * @brief Get the number of quadtree nodes currently held in the node cache
+ *
+ * @param hash_life The universe to inspect.
+ * @return The number of cached nodes.
+ */
+size_t
+hash_life_node_count (Hash_Life *hash_life);
+
+/**
+ * @brief Get the work counters of a universe
+ *
+ * @param hash_life The universe to inspect.
+ * @param stats Filled in with the universe's counters.
+ */
+void
+hash_life_get_stats (Hash_Life *hash_life, Hash_Life_Stats *stats);
+
+#endif
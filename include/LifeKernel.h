@@ -0,0 +1,86 @@
+/**
+ * @file LifeKernel.h
+ * @author Aaron Nedelec
+ * @date 16 Oct 2026
+ * @brief Interface for the bit-parallel Life-like rule kernel.
+ *
+ * The kernel advances a row of bit-packed cells of a two-state Moore rule
+ * one word at a time.  Neighbour counts for all 64 cells of a word are built
+ * with bit-sliced adders and the birth and survival masks of the rule are
+ * applied to the resulting counts.  Vector versions handle two (SSE2) or four
+ * (AVX2) words per instruction and the fastest one the CPU supports is picked
+ * at runtime.
+ */
+
+#ifndef LIFE_KERNEL_H
+#define LIFE_KERNEL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* The instruction sets the kernel can be run with */
+typedef enum LIFE_KERNEL_ISA
+  {
+    life_kernel_scalar,
+    life_kernel_sse2,
+    life_kernel_avx2
+  } Life_Kernel_Isa;
+
+/**
+ * @brief Get the fastest instruction set the running CPU supports
+ *
+ * @return The fastest supported instruction set.
+ */
+Life_Kernel_Isa
+life_kernel_best_isa (void);
+
+/**
+ * @brief Choose the instruction set used by life_kernel_row
+ *
+ * The best supported instruction set is used until one is selected.
+ * @param isa The instruction set to use.
+ * @return Whether the running CPU supports the instruction set.  The
+ * selection is unchanged on failure.
+ */
+bool
+life_kernel_select (Life_Kernel_Isa isa);
+
+/**
+ * @brief Get the instruction set used by life_kernel_row
+ *
+ * @return The selected instruction set.
+ */
+Life_Kernel_Isa
+life_kernel_selected (void);
+
+/**
+ * @brief Get the name of an instruction set
+ *
+ * @param isa The instruction set.
+ * @return A short lower case name such as "avx2".
+ */
+const char *
+life_kernel_isa_name (Life_Kernel_Isa isa);
+
+/**
+ * @brief Compute the next generation of a row of cells
+ *
+ * Each row must be readable one word either side of its first and last
+ * word, as the padded rows of a Grid are.  Bit n of each mask is set if a
+ * cell with n live neighbours is born or survives respectively.  Bits of the
+ * last word past the end of the row are not cleared.
+ * @param above The row above the one being updated.
+ * @param here The row being updated.
+ * @param below The row below the one being updated.
+ * @param out Where the next state of the row is written.
+ * @param words The number of words in each row.
+ * @param birth The birth mask of the rule.
+ * @param survival The survival mask of the rule.
+ */
+void
+life_kernel_row (const uint64_t *above, const uint64_t *here,
+                 const uint64_t *below, uint64_t *out, size_t words,
+                 uint16_t birth, uint16_t survival);
+
+#endif
@@ -0,0 +1,120 @@
+/**
+ * @file Pattern.h
+ * @author Aaron Nedelec
+ * @date 16 Oct 2026
+ * @brief Interface for reading and writing pattern files.
+ *
+ * The text format of the files in patterns/ starts with a line holding the
+ * height and width of the pattern, followed by a line per row with a
+ * character per cell: '0' for a live cell, '-' for a dying one and anything
+ * else for a dead one.  Short rows and missing rows are dead.
+ *
+ * Patterns in the run length encoded (.rle) format used by most other Life
+ * programs can be loaded too, including the multi-state extension used for
+ * Generations rules such as Brian's Brain.  The rule in an RLE header is
+ * ignored, the pattern runs under whatever rule the automaton has.
+ *
+ * Macrocell (.mc) files hold a pattern as the hashed quadtree of HashLife.h,
+ * which can describe repetitive patterns far larger than any board.  They
+ * are memory-mapped and parsed in place, and only two-state patterns can be
+ * read or written.
+ *
+ * Patterns are centred on the origin just like an automaton's board.  Files
+ * are parsed in full before any cell is set, so a file that can't be loaded
+ * leaves the automaton unchanged.
+ */
+
+#ifndef PATTERN_H
+#define PATTERN_H
+
+#include "CellularAutomaton.h"
+#include <stdbool.h>
+
+/**
+ * @brief Add the cells of a text pattern file to an automaton
+ *
+ * Cells already on the board are left alone.
+ * @param automaton The automaton to add the cells to.
+ * @param path The path of the pattern file.
+ * @return Whether the pattern was loaded, false if the file couldn't be read
+ * or a cell lies outside the automaton's borders.
+ */
+bool
+pattern_load_text (Automaton *automaton, const char *path);
+
+/**
+ * @brief Add the cells of an RLE pattern file to an automaton
+ *
+ * Cells already on the board are left alone.
+ * @param automaton The automaton to add the cells to.
+ * @param path The path of the pattern file.
+ * @return Whether the pattern was loaded, false if the file couldn't be read
+ * or is malformed, the pattern is larger than the automaton's board, or a
+ * state isn't one of the automaton's.
+ */
+bool
+pattern_load_rle (Automaton *automaton, const char *path);
+
+/**
+ * @brief Add the cells of a Macrocell pattern file to an automaton
+ *
+ * Loads the file as automaton_load_macrocell does, so a pattern larger than
+ * the board may move the automaton to the hashlife backend.
+ * @param automaton The automaton to add the cells to.
+ * @param path The path of the pattern file.
+ * @return Whether the pattern was loaded, false if the file couldn't be read
+ * or is malformed, or the pattern doesn't fit on the automaton's board.
+ */
+bool
+pattern_load_macrocell (Automaton *automaton, const char *path);
+
+/**
+ * @brief Add the cells of a pattern file in any format to an automaton
+ *
+ * Files whose names end in ".rle" are loaded as RLE, ".mc" as Macrocell and
+ * any others as text.
+ * @param automaton The automaton to add the cells to.
+ * @param path The path of the pattern file.
+ * @return Whether the pattern was loaded.
+ */
+bool
+pattern_load (Automaton *automaton, const char *path);
+
+/**
+ * @brief Write an automaton's board to a text pattern file
+ *
+ * The pattern is the size of the board, so loading it into an automaton of
+ * the same size puts every cell back where it was.  States above 2 are
+ * written as dying cells.
+ * @param automaton The automaton to write.
+ * @param path The path of the file, which is replaced if it exists.
+ * @return Whether the whole pattern was written.
+ */
+bool
+pattern_save_text (Automaton *automaton, const char *path);
+
+/**
+ * @brief Write an automaton to a Macrocell pattern file
+ *
+ * See automaton_save_macrocell for what is written.
+ * @param automaton The automaton to write.
+ * @param path The path of the file, which is replaced if it exists.
+ * @return Whether the whole pattern was written, false if the automaton has
+ * more than two states.
+ */
+bool
+pattern_save_macrocell (Automaton *automaton, const char *path);
+
+/**
+ * @brief Write an automaton to a pattern file
+ *
+ * Files whose names end in ".mc" are written as Macrocell and any others as
+ * text.
+ * @param automaton The automaton to write.
+ * @param path The path of the file, which is replaced if it exists.
+ * @return Whether the whole pattern was written.
+ */
+bool
+pattern_save (Automaton *automaton, const char *path);
+
+#endif
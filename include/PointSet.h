@@ -20,11 +20,40 @@
  */
 typedef struct POINT_SET Point_Set;
 
+/**
+ * @brief Memory and allocation counters of a point set
+ */
+typedef struct POINT_SET_STATS Point_Set_Stats;
+struct POINT_SET_STATS
+{
+  size_t points;             /* points currently in the set */
+  size_t blocks;             /* blocks of nodes currently held */
+  size_t bytes_reserved;     /* bytes held by those blocks or the table */
+  size_t block_allocations;  /* calls made to malloc for blocks */
+  size_t table_allocations;  /* calls made to malloc for hash table arrays */
+  size_t node_allocations;   /* nodes handed out over the set's lifetime */
+  size_t node_frees;         /* nodes returned over the set's lifetime */
+};
+
+/**
+ * @brief A point and the data to store at it, for point_set_load_sorted
+ */
+typedef struct POINT_SET_ENTRY Point_Set_Entry;
+struct POINT_SET_ENTRY
+{
+  int x;
+  int y;
+  const void *data;          /* copied into the set */
+};
+
 /**
  * @brief Create a new point set
  *
+ * The set owns the storage of the data stored at each point.  Points are
+ * allocated from blocks which are only released when the set is destroyed.
  * @param data_size The size of the data that is going to be stored at a point
- * @param free_fn A function pointer used to free a stored data element
+ * @param free_fn A function pointer used to release any resources owned by a
+ * stored data element, or NULL if the elements own none
  * @return This function returns a pointer to the newly created point set or 
  * NULL if creation failed.
  */
@@ -34,12 +63,26 @@ point_set_create (size_t data_size, void (*free_fn)(void *));
 /**
  * @brief Destroy a point set.
  *
- * Destroys the given point set freeing all allocated resources.
+ * Destroys the given point set freeing all allocated resources.  Without a
+ * free function this takes time proportional to the number of blocks rather
+ * than the number of points.
  * @param ps The point set to destroy
  */
 void
 point_set_destroy (Point_Set *point_set);
 
+/**
+ * @brief Removes every point from a set
+ *
+ * Empties the given set while keeping the memory it has allocated, so
+ * refilling the set to its previous size allocates nothing.  Without a free
+ * function this takes time proportional to the number of blocks rather than
+ * the number of points.
+ * @param point_set The point set to clear
+ */
+void
+point_set_clear (Point_Set *point_set);
+
 /**
  * @brief Inserts point into a PointSet
  *
@@ -55,6 +98,23 @@ point_set_destroy (Point_Set *point_set);
 bool
 point_set_insert (Point_Set *point_set, int x, int y, const void *data);
 
+/**
+ * @brief Fills an empty set with points given in order
+ *
+ * Loads the points in one pass without searching the set or rebalancing it,
+ * which is much faster than inserting them one at a time.  The points must
+ * be sorted by their x coordinate and then their y coordinate, the order
+ * point_set_foreach visits them in, with no point given twice.
+ * @param point_set The empty point set to fill
+ * @param entries The points and the data stored at each of them
+ * @param count The number of points
+ * @return Whether the points were loaded.  Loading fails if the points
+ * aren't in order or memory runs out, and the set is left empty.
+ */
+bool
+point_set_load_sorted (Point_Set *point_set, const Point_Set_Entry *entries,
+                       size_t count);
+
 /**
  * @brief Deletes the given point from the set
  *
@@ -83,4 +143,89 @@ point_set_delete (Point_Set *point_set, int x, int y);
 void *
 point_set_search (Point_Set *point_set, int x, int y);
 
+/**
+ * @brief Calls a function on every point in the set
+ *
+ * Visits every point of the given set in order of their x coordinate and then
+ * their y coordinate.  The red-black tree takes time proportional to the
+ * number of points.  The hash table scans all of its slots and sorts the n
+ * points it finds, taking time proportional to its capacity plus n log n,
+ * and visits them in no particular order if there is no memory to sort them
+ * in.  The set must not be modified while it is being visited.
+ * @param point_set The point set to visit
+ * @param fn The function called with each point's coordinates and data
+ * @param ctx A pointer passed through to every call of fn
+ */
+void
+point_set_foreach (Point_Set *point_set,
+                   void (*fn)(int x, int y, void *data, void *ctx), void *ctx);
+
+/**
+ * @brief Calls a function on every point inside a rectangle
+ *
+ * Visits the points whose coordinates lie within the given inclusive bounds
+ * in the same order as point_set_foreach.  The red-black tree walks from one
+ * search for the first point, seeking ahead past the points of each column
+ * that lie outside the rectangle.  A seek costs the logarithm of the points
+ * it skips rather than of the set, so the cost follows the points visited
+ * and the columns they span.  The hash table
+ * looks up every coordinate of a rectangle with no more coordinates than the
+ * set has points.  A larger rectangle costs a scan of every slot plus k log k
+ * to sort the k points visited, as for point_set_foreach.  The set must not
+ * be modified while it is being visited.
+ * @param point_set The point set to visit
+ * @param x_min The smallest x coordinate visited
+ * @param y_min The smallest y coordinate visited
+ * @param x_max The largest x coordinate visited
+ * @param y_max The largest y coordinate visited
+ * @param fn The function called with each point's coordinates and data
+ * @param ctx A pointer passed through to every call of fn
+ */
+void
+point_set_foreach_in_rect (Point_Set *point_set, int x_min, int y_min,
+                           int x_max, int y_max,
+                           void (*fn)(int x, int y, void *data, void *ctx),
+                           void *ctx);
+
+/**
+ * @brief Gets the number of points in a set
+ *
+ * @param point_set The point set to count
+ * @return The number of points in the set
+ */
+size_t
+point_set_size (Point_Set *point_set);
+
+/**
+ * @brief Gets the memory and allocation counters of a point set
+ *
+ * @param point_set The point set to get the counters of
+ * @param stats Filled in with the set's counters
+ */
+void
+point_set_get_stats (Point_Set *point_set, Point_Set_Stats *stats);
+
+/**
+ * @brief Gets the height of the tree a set's points are kept in
+ *
+ * Walks the whole tree, so the cost is proportional to the size of the set.
+ * @param point_set The point set to measure
+ * @return The number of nodes on the longest path from the root to a leaf,
+ * or 0 if the set isn't kept in a tree
+ */
+int
+point_set_height (Point_Set *point_set);
+
+/**
+ * @brief Gets the number of searches made by the calling thread
+ *
+ * Searches are counted per thread, across every set, so that threads
+ * searching at the same time don't contend for a counter.  They are only
+ * counted when built with COLLECT_STATS, see Stats.h.
+ * @return The number of calls the calling thread has made to
+ * point_set_search, or 0 if searches aren't being counted
+ */
+unsigned long
+point_set_searches (void);
+
 #endif
@@ -0,0 +1,133 @@
+/**
+ * @file Renderer.h
+ * @author Aaron Nedelec
+ * @date 16 Oct 2026
+ * @brief Interface for drawing an automaton into a curses window.
+ *
+ * A renderer keeps a shadow copy of the last frame it drew, so each new
+ * frame only writes the characters that changed, a run at a time, and never
+ * clears the window.  Besides one cell per character it can pack several
+ * cells into each character with Unicode half blocks or braille patterns,
+ * which needs a UTF-8 locale set with setlocale before curses is started.
+ */
+
+#ifndef RENDERER_H
+#define RENDERER_H
+
+#include "CellularAutomaton.h"
+#include <ncurses.h>
+#include <stdbool.h>
+
+/* How many cells each character of the window shows */
+typedef enum RENDER_MODE
+  {
+    render_cells,       /* a '#' for each non-dead cell */
+    render_half_blocks, /* two rows of one cell in each character */
+    render_braille      /* four rows of two cells in each character */
+  } Render_Mode;
+
+typedef struct RENDERER Renderer;
+
+/**
+ * @brief Create a renderer drawing into the given window
+ *
+ * @param window The window the automaton is drawn in.
+ * @param mode How cells are packed into characters.  Falls back to
+ * render_cells if the locale can't show the mode's characters.
+ * @return A pointer to the new renderer or NULL if creation failed.
+ */
+Renderer *
+renderer_create (WINDOW *window, Render_Mode mode);
+
+/**
+ * @brief Destroy a renderer, leaving its window as it is
+ *
+ * @param renderer The renderer to destroy.
+ */
+void
+renderer_destroy (Renderer *renderer);
+
+/**
+ * @brief Change how cells are packed into characters
+ *
+ * The whole window is redrawn by the next frame.
+ * @param renderer The renderer to change.
+ * @param mode The new mode.
+ * @return Whether the mode was changed, false if the locale can't show the
+ * mode's characters.
+ */
+bool
+renderer_set_mode (Renderer *renderer, Render_Mode mode);
+
+/**
+ * @brief Get how cells are packed into characters
+ *
+ * @param renderer The renderer to query.
+ * @return The renderer's current mode.
+ */
+Render_Mode
+renderer_get_mode (Renderer *renderer);
+
+/**
+ * @brief Forget what is on screen so the next frame redraws everything
+ *
+ * Needed whenever something else has drawn over the window, such as another
+ * window or a clear of the whole screen.
+ * @param renderer The renderer to invalidate.
+ */
+void
+renderer_invalidate (Renderer *renderer);
+
+/**
+ * @brief Draw the automaton's board centred in the window
+ *
+ * Captures a frame and presents it at once.  Only the characters that
+ * differ from the last frame are written to the window, which still has to
+ * be refreshed by the caller.  A resized window is redrawn in full.
+ * @param renderer The renderer to draw with.
+ * @param automaton The automaton to draw.
+ * @return Whether the frame was drawn, false if there was no memory for a
+ * resized window.
+ */
+bool
+renderer_draw (Renderer *renderer, Automaton *automaton);
+
+/**
+ * @brief Build a frame of the automaton's board for presenting later
+ *
+ * Unlike the rest of the renderer this may be called on another thread than
+ * the one using curses, for instance by the thread advancing the automaton,
+ * as long as nothing changes the automaton meanwhile.  A capture replaces
+ * any earlier one that hasn't been presented yet.
+ * @param renderer The renderer to capture with.
+ * @param automaton The automaton to capture.
+ */
+void
+renderer_capture (Renderer *renderer, Automaton *automaton);
+
+/**
+ * @brief Write the latest captured frame to the window
+ *
+ * Only the characters that differ from the last frame presented are
+ * written, and the window still has to be refreshed by the caller.
+ * @param renderer The renderer to present with.
+ * @return Whether a frame was written, false if none was captured since the
+ * last one, or if the window was resized or the mode changed since the
+ * capture.
+ */
+bool
+renderer_present (Renderer *renderer);
+
+/**
+ * @brief Find the cell shown at a position of the window
+ *
+ * @param renderer The renderer to query.
+ * @param row The row of the window.
+ * @param col The column of the window.
+ * @param y Set to the y coordinate of the top left cell of the character.
+ * @param x Set to the x coordinate of the top left cell of the character.
+ */
+void
+renderer_cell_at (Renderer *renderer, int row, int col, int *y, int *x);
+
+#endif
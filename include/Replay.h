@@ -0,0 +1,181 @@
+/**
+ * @file Replay.h
+ * @author Aaron Nedelec
+ * @date 16 Oct 2026
+ * @brief Interface for recording a run and playing it back.
+ *
+ * A recorder appends each generation of a run to a log as the cells that
+ * were born or died, so that a player can show the run again at any speed,
+ * and jump about in it, without computing a single rule.  The log is
+ * binary, built from the encodings of Codec.h:
+ *
+ *   magic        the 8 bytes "LIFEREPL"
+ *   version      varint, REPLAY_VERSION
+ *   height       varint
+ *   width        varint
+ *   rule         varint length followed by the rulestring
+ *   checksum     CRC-32 of every byte before it, 4 bytes little endian
+ *   blocks       until the end of the file
+ *
+ * Each block holds the records of a run of consecutive generations:
+ *
+ *   keyframe     1 byte, 1 if the first record is a keyframe, else 0
+ *   generation   varint, the generation of the first record
+ *   records      varint number of records
+ *   raw size     varint size of the records
+ *   size         varint size of the records as stored, compressed unless it
+ *                is the same as the raw size
+ *   data check   CRC-32 of the stored records
+ *   checksum     CRC-32 of the block's bytes before it
+ *   data         the stored records
+ *
+ * A keyframe lists every cell that isn't dead, and any other record the
+ * cells that changed since the generation before.  A record starts with a
+ * varint holding twice the number of cells, plus 1 if they are stored as a
+ * bitmap rather than a list.  A list is stored as in Codec.h.  A bitmap has
+ * a bit for every cell of the board, row by row and low bit first, set for
+ * the cells listed, followed by their states as varints.  Whichever of the
+ * two is smaller is written, a bitmap only winning for the first few
+ * generations of a soup.  The states are left out when the rule has only
+ * two, as a changed cell can only have flipped.
+ *
+ * A keyframe starts a new block, which the player can start from when
+ * seeking.  Blocks are written whole as they fill up, so a log cut short by
+ * a process that died plays back up to its last whole block.
+ */
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "CellularAutomaton.h"
+#include <stdbool.h>
+
+/* The version written, and the only one read */
+#define REPLAY_VERSION 1
+
+typedef struct RECORDER Recorder;
+typedef struct PLAYER Player;
+
+/**
+ * @brief Create a recorder and record an automaton's current generation
+ *
+ * Turns on the automaton's change tracking, which the recorder reads the
+ * births and deaths of each generation from.
+ * @param automaton The automaton to record.
+ * @param path The path of the log, which is replaced if it exists.
+ * @param keyframe_interval The most generations between keyframes, at
+ * least 1.  Shorter intervals seek faster and make larger logs.
+ * @return A pointer to the new recorder or NULL if the log couldn't be
+ * created.
+ */
+Recorder *
+recorder_create (Automaton *automaton, const char *path,
+                 long keyframe_interval);
+
+/**
+ * @brief Finish the log and destroy a recorder
+ *
+ * @param recorder The recorder to destroy.
+ * @return Whether every generation recorded was written.
+ */
+bool
+recorder_destroy (Recorder *recorder);
+
+/**
+ * @brief Record the generation an automaton has just reached
+ *
+ * Call after each automaton_update_state, or automaton_step_n by one
+ * generation.  A generation that doesn't follow the last one recorded, as
+ * after a longer step, is recorded as a keyframe.
+ * @param recorder The recorder to record with.
+ * @param automaton The automaton being recorded.
+ * @return Whether the generation was recorded.  It isn't if the automaton
+ * hasn't moved past the last generation recorded, or if writing failed.
+ */
+bool
+recorder_record (Recorder *recorder, Automaton *automaton);
+
+/**
+ * @brief Open a log for playing back
+ *
+ * The player starts at the first generation recorded.
+ * @param path The path of the log.
+ * @return A pointer to the new player or NULL if the file couldn't be read
+ * or isn't a log of this version.
+ */
+Player *
+player_open (const char *path);
+
+/**
+ * @brief Close a log and destroy its player
+ *
+ * @param player The player to destroy.
+ */
+void
+player_destroy (Player *player);
+
+/**
+ * @brief Get the automaton a player shows the recorded boards in
+ *
+ * The automaton belongs to the player.  It is never updated, only set to
+ * each recorded board in turn, and is meant to be drawn with Renderer.h.
+ * @param player The player whose automaton is returned.
+ * @return The player's automaton.
+ */
+Automaton *
+player_get_automaton (Player *player);
+
+/**
+ * @brief Get the generation a player is showing
+ *
+ * @param player The player to inspect.
+ * @return The generation of the board in the player's automaton.
+ */
+long
+player_get_generation (Player *player);
+
+/**
+ * @brief Get the first generation of a log
+ *
+ * @param player The player to inspect.
+ * @return The generation recording started at.
+ */
+long
+player_get_first_generation (Player *player);
+
+/**
+ * @brief Get the last generation of a log
+ *
+ * @param player The player to inspect.
+ * @return The last generation there is a whole block for.
+ */
+long
+player_get_last_generation (Player *player);
+
+/**
+ * @brief Move a player on to the next recorded generation
+ *
+ * @param player The player to advance.
+ * @return Whether there was a next generation and it could be read.  The
+ * player is left where it was if not.
+ */
+bool
+player_step (Player *player);
+
+/**
+ * @brief Move a player to a generation
+ *
+ * Playing starts over from the last keyframe before the generation, unless
+ * the generation is ahead of the player and no keyframe lies between them.
+ * @param player The player to move.
+ * @param generation The generation to move to.  The player stops at the last
+ * recorded generation before it if it wasn't recorded.
+ * @return Whether the generation could be read.  The generation must lie
+ * between the first and last generations of the log.  If it couldn't be
+ * read the player is left at the last generation it did read, which is
+ * where it was if the keyframe it had to start from couldn't be read.
+ */
+bool
+player_seek (Player *player, long generation);
+
+#endif
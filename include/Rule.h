@@ -0,0 +1,110 @@
+/**
+ * @file Rule.h
+ * @author Aaron Nedelec
+ * @date 16 Oct 2026
+ * @brief Interface for outer-totalistic cellular automaton rules.
+ *
+ * A rule decides the next state of a cell from its current state and the
+ * number of live cells around it.  Rules are written as rulestrings such as
+ * "B3/S23" for Conway's Game of Life, listing the neighbour counts that cause
+ * a dead cell to be born and a live cell to survive.  A "/C" part such as
+ * "B2/S/C3" gives a Generations rule, where a live cell that doesn't survive
+ * passes through dying states before it is dead, and a trailing "V" counts
+ * only the four von Neumann neighbours.  The classic "23/3" survival/birth
+ * form is also understood.
+ */
+
+#ifndef RULE_H
+#define RULE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* The most states a Generations rule can have */
+#define RULE_MAX_STATES 256
+
+/* The most neighbours a cell can have */
+#define RULE_MAX_NEIGHBOURS 8
+
+/* Large enough for any rulestring written by rule_format */
+#define RULE_STRING_MAX 32
+
+typedef struct RULE Rule;
+struct RULE
+{
+  uint16_t birth;     /* bit n set if n live neighbours give birth */
+  uint16_t survival;  /* bit n set if n live neighbours keep a cell alive */
+  int num_states;     /* 2, or the number of states of a Generations rule */
+  bool von_neumann;   /* only the four orthogonal neighbours are counted */
+
+  /* the next state of a dead (0) and a live (1) cell by live neighbours */
+  uint8_t next[2][RULE_MAX_NEIGHBOURS + 1];
+};
+
+/**
+ * @brief Initialize a rule from its birth and survival masks
+ *
+ * @param rule The rule to initialize.
+ * @param birth Bit n is set if a dead cell with n live neighbours is born.
+ * @param survival Bit n is set if a live cell with n live neighbours survives.
+ * @param num_states The number of states a cell can be in, at least 2.
+ * @param von_neumann Whether only the orthogonal neighbours are counted.
+ */
+void
+rule_init (Rule *rule, uint16_t birth, uint16_t survival, int num_states,
+           bool von_neumann);
+
+/**
+ * @brief Parse a rulestring
+ *
+ * @param string The rulestring, such as "B36/S23", "B2/S/C3" or "23/3".
+ * @param rule The rule to fill in.
+ * @return Whether the rulestring was valid.  The rule is unchanged on
+ * failure.
+ */
+bool
+rule_parse (const char *string, Rule *rule);
+
+/**
+ * @brief Write the canonical rulestring of a rule
+ *
+ * @param rule The rule to write.
+ * @param buffer Where the rulestring is written, always null terminated.
+ * @param size The size of the buffer, RULE_STRING_MAX is always enough.
+ * @return The length of the full rulestring, which was truncated if it is
+ * not less than size.
+ */
+size_t
+rule_format (const Rule *rule, char *buffer, size_t size);
+
+/**
+ * @brief Check whether two rules behave the same
+ *
+ * @param a The first rule.
+ * @param b The second rule.
+ * @return Whether the rules are equal.
+ */
+bool
+rule_equal (const Rule *a, const Rule *b);
+
+/**
+ * @brief Get the next state of a cell
+ *
+ * Dying states of a Generations rule, and any state the rule doesn't have,
+ * advance towards the dead state regardless of the neighbourhood.
+ * @param rule The rule to apply.
+ * @param state The current state of the cell.
+ * @param live_neighbours The number of neighbours in state 1.
+ * @return The next state of the cell.
+ */
+static inline int
+rule_next_state (const Rule *rule, int state, int live_neighbours)
+{
+  if (state < 2)
+    return rule->next[state][live_neighbours];
+
+  return state + 1 < rule->num_states ? state + 1 : 0;
+}
+
+#endif
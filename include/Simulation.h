@@ -0,0 +1,118 @@
+/**
+ * @file Simulation.h
+ * @author Aaron Nedelec
+ * @date 16 Oct 2026
+ * @brief Interface for advancing an automaton on a thread of its own.
+ *
+ * A simulation steps its automaton on a background thread at a target rate
+ * of generations per second, or as fast as it can, so the speed of the
+ * automaton is independent of whoever is showing it.  Frames are sampled by
+ * requesting one: the frame function is then called on the simulation's
+ * thread right after the next generation completes, which lets a display
+ * take the latest generation at its own refresh rate and drop the rest.
+ *
+ * While a simulation runs its thread owns the automaton.  Anything else may
+ * only touch the automaton while the simulation is paused.
+ */
+
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include "CellularAutomaton.h"
+#include <stdbool.h>
+
+typedef struct SIMULATION Simulation;
+
+/**
+ * @brief Create a new paused simulation and start its thread
+ *
+ * @param automaton The automaton to advance.  It must outlive the
+ * simulation.
+ * @param frame_fn The function called with the automaton after a generation
+ * when a frame has been requested, or NULL.  It is called on the
+ * simulation's thread.
+ * @param ctx A pointer passed through to every call of frame_fn.
+ * @return A pointer to the new simulation or NULL if creation failed.
+ */
+Simulation *
+simulation_create (Automaton *automaton,
+                   void (*frame_fn)(Automaton *automaton, void *ctx),
+                   void *ctx);
+
+/**
+ * @brief Destroy a simulation, stopping and joining its thread
+ *
+ * The automaton is left as it was after the last generation.
+ * @param simulation The simulation to destroy.
+ */
+void
+simulation_destroy (Simulation *simulation);
+
+/**
+ * @brief Start or resume advancing the automaton
+ *
+ * @param simulation The simulation to run.
+ */
+void
+simulation_run (Simulation *simulation);
+
+/**
+ * @brief Stop advancing the automaton
+ *
+ * Waits for a generation in progress to finish, after which the caller may
+ * use the automaton until the simulation is run again.
+ * @param simulation The simulation to pause.
+ */
+void
+simulation_pause (Simulation *simulation);
+
+/**
+ * @brief Check whether a simulation is advancing its automaton
+ *
+ * A simulation pauses itself if a generation fails.
+ * @param simulation The simulation to query.
+ * @return Whether the simulation is running.
+ */
+bool
+simulation_is_running (Simulation *simulation);
+
+/**
+ * @brief Set the target rate of a simulation
+ *
+ * Takes effect without waiting for the current generation.
+ * @param simulation The simulation to change.
+ * @param rate The target number of generations per second, 0 to run as
+ * fast as possible.
+ */
+void
+simulation_set_rate (Simulation *simulation, double rate);
+
+/**
+ * @brief Get the target rate of a simulation
+ *
+ * @param simulation The simulation to query.
+ * @return The target number of generations per second, 0 if unlimited.
+ */
+double
+simulation_get_rate (Simulation *simulation);
+
+/**
+ * @brief Ask for the frame function to be called after the next generation
+ *
+ * Requests made before the frame function has been called are merged into
+ * one, so at most one frame is taken per request.
+ * @param simulation The simulation to sample.
+ */
+void
+simulation_request_frame (Simulation *simulation);
+
+/**
+ * @brief Get the number of generations a simulation has completed
+ *
+ * @param simulation The simulation to query.
+ * @return The number of generations since the simulation was created.
+ */
+long
+simulation_get_generations (Simulation *simulation);
+
+#endif
@@ -0,0 +1,24 @@
+/**
+ * @file Stats.h
+ * @author Aaron Nedelec
+ * @date 16 Oct 2026
+ * @brief Counters of the work done on the automaton's hot paths.
+ *
+ * The counters are only kept when the tree is built with COLLECT_STATS
+ * defined, which the Makefile does unless it is run with STATS=no.  Without
+ * it every STATS_ADD compiles to nothing, so the instrumented loops are the
+ * same as if the counters weren't there, and the counters read as zero.
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+#ifdef COLLECT_STATS
+#define STATS_ENABLED true
+#define STATS_ADD(counter, amount) ((counter) += (amount))
+#else
+#define STATS_ENABLED false
+#define STATS_ADD(counter, amount) ((void) 0)
+#endif
+
+#endif
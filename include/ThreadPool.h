@@ -0,0 +1,62 @@
+/**
+ * @file ThreadPool.h
+ * @author Aaron Nedelec
+ * @date 16 Oct 2026
+ * @brief Interface for a persistent pool of worker threads.
+ *
+ * A thread pool keeps its workers alive between jobs so that handing out a
+ * job costs a wake up rather than a thread creation.  Every job is run by
+ * every worker at once, each being told its index so it can pick its own
+ * share of the work, and the caller waits until all of them have finished.
+ * The calling thread counts as one of the workers.
+ */
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <stdbool.h>
+
+typedef struct THREAD_POOL Thread_Pool;
+
+/**
+ * @brief Create a new thread pool
+ *
+ * @param workers The number of workers including the calling thread, so a
+ * pool of one worker starts no threads.
+ * @return A pointer to the new pool or NULL if creation failed.
+ */
+Thread_Pool *
+thread_pool_create (int workers);
+
+/**
+ * @brief Destroy a thread pool, stopping and joining its threads
+ *
+ * @param pool The pool to destroy.
+ */
+void
+thread_pool_destroy (Thread_Pool *pool);
+
+/**
+ * @brief Get the number of workers in a pool
+ *
+ * @param pool The pool to query.
+ * @return The number of workers including the calling thread.
+ */
+int
+thread_pool_size (Thread_Pool *pool);
+
+/**
+ * @brief Run a job on every worker and wait for all of them to finish
+ *
+ * The calling thread runs the job as worker 0.  Everything the workers wrote
+ * is visible to the caller once this returns.
+ * @param pool The pool to run the job on.
+ * @param fn The job, called with the index of the worker running it and the
+ * number of workers.
+ * @param ctx A pointer passed through to every call of fn.
+ */
+void
+thread_pool_run (Thread_Pool *pool,
+                 void (*fn)(int worker, int workers, void *ctx), void *ctx);
+
+#endif
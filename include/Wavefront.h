@@ -0,0 +1,165 @@
+/**
+ * @file Wavefront.h
+ * @author Aaron Nedelec
+ * @date 16 Oct 2026
+ * @brief Interface for a board that only updates its wavefront.
+ *
+ * A wavefront board keeps explicit lists of its live and dying cells next to
+ * a byte per cell of the board.  A dead cell can only be born next to a live
+ * one, so an update only visits the listed cells and their neighbours and
+ * costs time proportional to the number of non-dead cells rather than to the
+ * area of the board.  This suits Generations rules such as Greenberg-Hastings
+ * and Brian's Brain, whose boards are mostly quiescent with a thin front of
+ * excited cells followed by a refractory tail.  Rules with birth on zero
+ * neighbours aren't supported.
+ *
+ * Cells are addressed the same way as on an automaton, with the board
+ * centred on the origin.
+ */
+
+#ifndef WAVEFRONT_H
+#define WAVEFRONT_H
+
+#include "Rule.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct WAVEFRONT Wavefront;
+
+/**
+ * @brief Create a new wavefront board
+ *
+ * @param height The height of the board.
+ * @param width The width of the board.
+ * @param rule The rule the board runs, without birth on zero neighbours.
+ * @return A pointer to the new empty board or NULL if creation failed.
+ */
+Wavefront *
+wavefront_create (int height, int width, const Rule *rule);
+
+/**
+ * @brief Destroy a wavefront board
+ *
+ * @param wavefront The board to destroy.
+ */
+void
+wavefront_destroy (Wavefront *wavefront);
+
+/**
+ * @brief Change the rule a board runs
+ *
+ * Cells in states the new rule doesn't have are killed.
+ * @param wavefront The board to change.
+ * @param rule The new rule, without birth on zero neighbours.
+ */
+void
+wavefront_set_rule (Wavefront *wavefront, const Rule *rule);
+
+/**
+ * @brief Change the size of a board
+ *
+ * Cells outside the new borders are lost.
+ * @param wavefront The board to resize.
+ * @param height The new height of the board.
+ * @param width The new width of the board.
+ * @return Whether the board was resized.  The board is unchanged on failure.
+ */
+bool
+wavefront_resize (Wavefront *wavefront, int height, int width);
+
+/**
+ * @brief Kill every cell on a board
+ *
+ * @param wavefront The board to clear.
+ */
+void
+wavefront_clear (Wavefront *wavefront);
+
+/**
+ * @brief Get the state of a cell
+ *
+ * @param wavefront The board to read.
+ * @param y The y coordinate of the cell.
+ * @param x The x coordinate of the cell.
+ * @return The state of the cell, 0 outside the board.
+ */
+int
+wavefront_get (Wavefront *wavefront, int y, int x);
+
+/**
+ * @brief Set the state of a cell
+ *
+ * @param wavefront The board to change.
+ * @param y The y coordinate of the cell.
+ * @param x The x coordinate of the cell.
+ * @param state The new state of the cell.
+ * @return Whether the cell was set, false if it is outside the board or
+ * there was no memory to list it.
+ */
+bool
+wavefront_set (Wavefront *wavefront, int y, int x, int state);
+
+/**
+ * @brief Advance a board by one generation
+ *
+ * @param wavefront The board to advance.
+ * @return Whether the board was advanced.  The board is unchanged on failure.
+ */
+bool
+wavefront_step (Wavefront *wavefront);
+
+/**
+ * @brief Call a function on every non-dead cell inside a rectangle
+ *
+ * Cells are visited in no particular order and the cost is proportional to
+ * the number of non-dead cells on the whole board.
+ * @param wavefront The board to visit.
+ * @param y_min The smallest y coordinate visited.
+ * @param x_min The smallest x coordinate visited.
+ * @param y_max The largest y coordinate visited.
+ * @param x_max The largest x coordinate visited.
+ * @param fn The function called with each cell and its state.
+ * @param ctx A pointer passed through to every call of fn.
+ */
+void
+wavefront_foreach_in_rect (Wavefront *wavefront, int y_min, int x_min,
+                           int y_max, int x_max,
+                           void (*fn)(int y, int x, int state, void *ctx),
+                           void *ctx);
+
+/**
+ * @brief Call a function on every cell whose state the last step changed
+ *
+ * The cells were recorded by the step itself, so the cost is proportional
+ * to the number of changes.  Clearing or resizing the board forgets them.
+ * @param wavefront The board to visit.
+ * @param fn The function called with each changed cell and its current
+ * state.
+ * @param ctx A pointer passed through to every call of fn.
+ */
+void
+wavefront_foreach_change (Wavefront *wavefront,
+                          void (*fn)(int y, int x, int state, void *ctx),
+                          void *ctx);
+
+/**
+ * @brief Get the number of non-dead cells on a board
+ *
+ * @param wavefront The board to count.
+ * @return The number of non-dead cells.
+ */
+long
+wavefront_population (Wavefront *wavefront);
+
+/**
+ * @brief Get the number of cells evaluated by every step so far
+ *
+ * A step evaluates each listed cell and each cell with a live neighbour.
+ * Cells are only counted when built with COLLECT_STATS, see Stats.h.
+ * @param wavefront The board to inspect.
+ * @return The number of cells evaluated over the board's lifetime.
+ */
+uint64_t
+wavefront_evaluated (Wavefront *wavefront);
+
+#endif
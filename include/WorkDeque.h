@@ -0,0 +1,74 @@
+/**
+ * @file WorkDeque.h
+ * @author Aaron Nedelec
+ * @date 16 Oct 2026
+ * @brief Interface for a work-stealing deque of task indices.
+ *
+ * Each worker of a parallel job owns a deque holding a range of indices
+ * into a shared array of tasks.  The owner takes tasks from the bottom of
+ * its own deque and, once that is empty, steals them from the top of the
+ * other workers' deques, so workers that finish early help out the ones that
+ * were handed the busy part of the board.  Tasks are only added while no
+ * worker is running, which keeps every deque a plain range of indices.
+ */
+
+#ifndef WORK_DEQUE_H
+#define WORK_DEQUE_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+
+/* Keeps each deque on its own cache line */
+#define WORK_DEQUE_ALIGN 64
+
+typedef struct WORK_DEQUE Work_Deque;
+struct WORK_DEQUE
+{
+  _Alignas(WORK_DEQUE_ALIGN) atomic_long top;  /* next task to be stolen */
+  atomic_long bottom;                          /* one past the owner's next */
+};
+
+/**
+ * @brief Fill a deque with a range of tasks
+ *
+ * Must not be called while any worker is using the deque.
+ * @param deque The deque to fill.
+ * @param begin The index of the first task.
+ * @param end One past the index of the last task.
+ */
+void
+work_deque_reset (Work_Deque *deque, long begin, long end);
+
+/**
+ * @brief Take a task from the bottom of a deque, only called by its owner
+ *
+ * @param deque The worker's own deque.
+ * @param task Set to the index of the task taken.
+ * @return Whether a task was taken.
+ */
+bool
+work_deque_pop (Work_Deque *deque, long *task);
+
+/**
+ * @brief Take a task from the top of another worker's deque
+ *
+ * @param deque The deque to steal from.
+ * @param task Set to the index of the task taken.
+ * @return Whether a task was taken.  A steal can fail while tasks remain if
+ * another worker took the same task first.
+ */
+bool
+work_deque_steal (Work_Deque *deque, long *task);
+
+/**
+ * @brief Check whether a deque has run out of tasks
+ *
+ * Lets a thief whose steal failed tell a deque that is empty from one where
+ * another worker won the race for a task.
+ * @param deque The deque to check.
+ * @return Whether no task was left when the deque was checked.
+ */
+bool
+work_deque_empty (Work_Deque *deque);
+
+#endif
@@ -0,0 +1,424 @@
+#include "Batch.h"
+#include "CellularAutomaton.h"
+#include "Checkpoint.h"
+#include "Pattern.h"
+#include "Replay.h"
+#include "Rule.h"
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* Indices of these arrays should match the type and backend enums */
+static const char *type_names[] = {
+  [game_of_life]       = "life",
+  [seeds]              = "seeds",
+  [greenberg_hastings] = "greenberg-hastings",
+  [highlife]           = "highlife",
+  [day_and_night]      = "day-and-night",
+  [brians_brain]       = "brians-brain"
+};
+static const char *backend_names[] = {
+  [point_set_backend]  = "point-set",
+  [dense_grid_backend] = "dense-grid",
+  [sparse_backend]     = "sparse",
+  [hashlife_backend]   = "hashlife",
+  [wavefront_backend]  = "wavefront"
+};
+
+/* What a run was asked to do */
+struct BATCH_OPTIONS
+{
+  Automaton_Type type;
+  Automaton_Backend backend;
+  int height;
+  int width;
+  const char *pattern;      /* NULL to start from a random soup */
+  long generations;
+  unsigned int seed;
+  const char *output;       /* NULL to not write the final board */
+  const char *checkpoint;   /* NULL to not write checkpoints */
+  long interval;            /* generations between checkpoints */
+  const char *restore;      /* checkpoint to carry on from, or NULL */
+  const char *record;       /* NULL to not record the run */
+  long keyframes;           /* generations between keyframes of the log */
+};
+
+static const struct option long_options[] = {
+  { "rule",        required_argument, NULL, 'r' },
+  { "size",        required_argument, NULL, 's' },
+  { "pattern",     required_argument, NULL, 'p' },
+  { "generations", required_argument, NULL, 'g' },
+  { "seed",        required_argument, NULL, 'S' },
+  { "output",      required_argument, NULL, 'o' },
+  { "backend",     required_argument, NULL, 'b' },
+  { "checkpoint",  required_argument, NULL, 'c' },
+  { "interval",    required_argument, NULL, 'i' },
+  { "restore",     required_argument, NULL, 'R' },
+  { "record",      required_argument, NULL, 'l' },
+  { "keyframes",   required_argument, NULL, 'k' },
+  { "help",        no_argument,       NULL, 'h' },
+  { NULL,          0,                 NULL, 0 }
+};
+
+static void
+print_usage (const char *program)
+{
+  printf("Usage: %s [OPTION]...\n", program);
+  printf("Run an automaton without a terminal and print a summary.\n\n");
+  printf("  -r, --rule NAME         life, seeds, greenberg-hastings, "
+         "highlife,\n                          day-and-night or "
+         "brians-brain (life)\n");
+  printf("  -s, --size HxW          size of the board (256x256)\n");
+  printf("  -p, --pattern FILE      start from a text, .rle or .mc "
+         "pattern file\n                          instead of a soup\n");
+  printf("  -g, --generations N     generation to run to (100)\n");
+  printf("  -S, --seed N            seed of the random soup (the "
+         "time)\n");
+  printf("  -o, --output FILE       write the final board to FILE, as "
+         "Macrocell if\n                          it ends in .mc\n");
+  printf("  -b, --backend NAME      point-set, dense-grid, sparse, "
+         "hashlife or\n                          wavefront (dense-grid)\n");
+  printf("  -c, --checkpoint FILE   write a checkpoint to FILE as the "
+         "run goes\n");
+  printf("  -i, --interval N        generations between checkpoints "
+         "(1000)\n");
+  printf("  -R, --restore FILE      carry on from a checkpoint, which "
+         "sets the\n                          rule, size and backend\n");
+  printf("  -l, --record FILE       record every generation to FILE for "
+         "life\n                          --replay\n");
+  printf("  -k, --keyframes N       generations between keyframes of the "
+         "record\n                          (100)\n");
+  printf("  -h, --help              show this help\n");
+}
+
+// Finds a name in a table of names, returns -1 if it isn't there
+static int
+find_name (const char *name, const char **names, int count)
+{
+  int index = -1;
+
+  for (int i = 0; i < count && index < 0; i++)
+    if (strcmp(name, names[i]) == 0)
+      index = i;
+
+  return index;
+}
+
+static bool
+parse_long (const char *string, long min, long *value)
+{
+  char *end;
+
+  *value = strtol(string, &end, 10);
+  return end != string && *end == '\0' && *value >= min;
+}
+
+static bool
+parse_size (const char *string, int *height, int *width)
+{
+  char extra;
+
+  return sscanf(string, "%dx%d%c", height, width, &extra) == 2
+    && *height > 0 && *width > 0;
+}
+
+// Fills in the options, reporting the first bad argument on stderr
+static bool
+parse_options (int argc, char **argv, struct BATCH_OPTIONS *options,
+               bool *help)
+{
+  bool success = true;
+  int option;
+  int index;
+  long value;
+
+  // glibc only restarts its scan from scratch when optind is 0
+  optind = 0;
+  opterr = 0;
+  while (success
+         && (option = getopt_long(argc, argv, "r:s:p:g:S:o:b:c:i:R:l:k:h",
+                                  long_options, NULL)) != -1)
+    {
+      switch (option)
+        {
+        case 'r':
+          index   = find_name(optarg, type_names, custom_rule);
+          success = index >= 0;
+          if (success)
+            options->type = index;
+          break;
+        case 's':
+          success = parse_size(optarg, &options->height, &options->width);
+          break;
+        case 'p':
+          options->pattern = optarg;
+          break;
+        case 'g':
+          success = parse_long(optarg, 0, &options->generations);
+          break;
+        case 'S':
+          success = parse_long(optarg, 0, &value);
+          options->seed = value;
+          break;
+        case 'o':
+          options->output = optarg;
+          break;
+        case 'b':
+          index   = find_name(optarg, backend_names, wavefront_backend + 1);
+          success = index >= 0;
+          if (success)
+            options->backend = index;
+          break;
+        case 'c':
+          options->checkpoint = optarg;
+          break;
+        case 'i':
+          success = parse_long(optarg, 1, &options->interval);
+          break;
+        case 'R':
+          options->restore = optarg;
+          break;
+        case 'l':
+          options->record = optarg;
+          break;
+        case 'k':
+          success = parse_long(optarg, 1, &options->keyframes);
+          break;
+        case 'h':
+          *help = true;
+          break;
+        default:
+          success = false;
+          break;
+        }
+
+      if (!success)
+        {
+          if (option == '?' || option == ':')
+            fprintf(stderr, "%s: bad option '%s'\n", argv[0],
+                    argv[optind - 1]);
+          else
+            fprintf(stderr, "%s: bad argument '%s' to -%c\n", argv[0],
+                    optarg, option);
+        }
+    }
+
+  if (success && optind < argc)
+    {
+      fprintf(stderr, "%s: unexpected argument '%s'\n", argv[0],
+              argv[optind]);
+      success = false;
+    }
+
+  return success;
+}
+
+static double
+elapsed_seconds (const struct timespec *start, const struct timespec *end)
+{
+  return (end->tv_sec - start->tv_sec) + (end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+// Adds the counters of a call to automaton_step_n to the run's totals
+static void
+add_stats (Automaton_Stats *total, const Automaton_Stats *stats)
+{
+  total->generations      += stats->generations;
+  total->seconds          += stats->seconds;
+  total->cells_evaluated  += stats->cells_evaluated;
+  total->searches         += stats->searches;
+  total->node_allocations += stats->node_allocations;
+  total->node_frees       += stats->node_frees;
+}
+
+/*
+ * Advances the automaton to the generation asked for.  With a checkpointer,
+ * the run stops at every multiple of the interval and at the end to hand it
+ * a checkpoint, which it writes while the run carries on.  With a recorder,
+ * the run goes a generation at a time so that each one is recorded, and
+ * still hands over only the checkpoints that are due.
+ */
+static bool
+run_generations (Automaton *automaton, const struct BATCH_OPTIONS *options,
+                 Checkpointer *checkpointer, Recorder *recorder,
+                 Automaton_Stats *total)
+{
+  bool success = true;
+  Automaton_Stats stats;
+
+  while (success && automaton_get_generation(automaton) < options->generations)
+    {
+      long generation = automaton_get_generation(automaton);
+      long step       = options->generations - generation;
+      long due        = options->interval - generation % options->interval;
+
+      if (checkpointer && step > due)
+        step = due;
+      if (recorder)
+        step = 1;
+
+      success = automaton_step_n(automaton, step);
+      automaton_get_stats(automaton, &stats);
+      add_stats(total, &stats);
+      if (success && recorder)
+        success = recorder_record(recorder, automaton);
+
+      generation += step;
+      if (success && checkpointer
+          && (step == due || generation == options->generations))
+        success = checkpointer_save(checkpointer, automaton,
+                                    options->checkpoint);
+    }
+
+  return success;
+}
+
+int
+batch_main (int argc, char **argv)
+{
+  int status = EXIT_FAILURE;
+  bool help  = false;
+  struct BATCH_OPTIONS options = {
+    game_of_life, dense_grid_backend, 256, 256, NULL, 100, time(NULL), NULL,
+    NULL, 1000, NULL, NULL, 100
+  };
+  struct timespec start, end;
+  Automaton_Stats stats;
+  Automaton_Stats total = { 0 };
+  Automaton *automaton;
+  Checkpointer *checkpointer = NULL;
+  Recorder *recorder = NULL;
+  char rule[RULE_STRING_MAX];
+
+  if (!parse_options(argc, argv, &options, &help))
+    {
+      fprintf(stderr, "Try '%s --help' for more information.\n", argv[0]);
+      goto done;
+    }
+  if (help)
+    {
+      print_usage(argv[0]);
+      status = EXIT_SUCCESS;
+      goto done;
+    }
+
+  if (options.restore)
+    {
+      automaton = automaton_load_checkpoint(options.restore);
+      if (!automaton)
+        {
+          fprintf(stderr, "%s: can't restore checkpoint '%s'\n", argv[0],
+                  options.restore);
+          goto done;
+        }
+      options.height = automaton_get_height(automaton);
+      options.width  = automaton_get_width(automaton);
+    }
+  else
+    {
+      automaton = automaton_create_backend(options.type, options.height,
+                                           options.width, options.backend);
+      if (!automaton)
+        {
+          fprintf(stderr, "%s: can't create a %dx%d board\n", argv[0],
+                  options.height, options.width);
+          goto done;
+        }
+
+      if (!options.pattern)
+        {
+          srand(options.seed);
+          automaton_random_state(automaton);
+        }
+      else if (!pattern_load(automaton, options.pattern))
+        {
+          fprintf(stderr, "%s: can't load pattern '%s' onto a %dx%d board\n",
+                  argv[0], options.pattern, options.height, options.width);
+          goto err;
+        }
+    }
+
+  if (options.checkpoint && !(checkpointer = checkpointer_create()))
+    {
+      fprintf(stderr, "%s: can't start writing checkpoints\n", argv[0]);
+      goto err;
+    }
+
+  if (options.record
+      && !(recorder = recorder_create(automaton, options.record,
+                                      options.keyframes)))
+    {
+      fprintf(stderr, "%s: can't record to '%s'\n", argv[0],
+              options.record);
+      goto err;
+    }
+
+  long first = automaton_get_generation(automaton);
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  if (!run_generations(automaton, &options, checkpointer, recorder, &total))
+    {
+      if (recorder)
+        fprintf(stderr, "%s: ran out of memory or can't record to '%s'\n",
+                argv[0], options.record);
+      else
+        fprintf(stderr, "%s: ran out of memory\n", argv[0]);
+      goto err;
+    }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  bool recorded = !recorder || recorder_destroy(recorder);
+  recorder = NULL;
+  if (!recorded)
+    {
+      fprintf(stderr, "%s: can't record to '%s'\n", argv[0],
+              options.record);
+      goto err;
+    }
+
+  if (checkpointer && !checkpointer_wait(checkpointer))
+    {
+      fprintf(stderr, "%s: can't write checkpoint '%s'\n", argv[0],
+              options.checkpoint);
+      goto err;
+    }
+
+  if (options.output && !pattern_save(automaton, options.output))
+    {
+      fprintf(stderr, "%s: can't write '%s'\n", argv[0], options.output);
+      goto err;
+    }
+
+  double seconds = elapsed_seconds(&start, &end);
+  automaton_get_rule(automaton, rule, sizeof(rule));
+  printf("rule %s\n", rule);
+  printf("backend %s\n", backend_names[automaton_get_backend(automaton)]);
+  printf("size %dx%d\n", options.height, options.width);
+  if (!options.pattern && !options.restore)
+    printf("seed %u\n", options.seed);
+  long generations = automaton_get_generation(automaton) - first;
+  printf("generations %ld\n", generations);
+  printf("generation %ld\n", automaton_get_generation(automaton));
+  printf("seconds %.6f\n", seconds);
+  printf("gens_per_sec %.1f\n", seconds > 0 ? generations / seconds : 0);
+  printf("population %ld\n", automaton_get_population(automaton));
+  if (automaton_get_stats(automaton, &stats))
+    {
+      printf("cells_evaluated %ld\n", total.cells_evaluated);
+      printf("searches %ld\n", total.searches);
+      printf("node_allocations %ld\n", total.node_allocations);
+      printf("node_frees %ld\n", total.node_frees);
+    }
+  printf("tree_height %d\n", stats.tree_height);
+  status = EXIT_SUCCESS;
+
+ err:
+  if (recorder)
+    recorder_destroy(recorder);
+  if (checkpointer)
+    checkpointer_destroy(checkpointer);
+  automaton_destroy(automaton);
+ done:
+  return status;
+}
@@ -1,17 +1,164 @@
 #include "CellularAutomaton.h"
+#include "Grid.h"
+#include "HashLife.h"
+#include "LifeKernel.h"
 #include "PointSet.h"
+#include "Rule.h"
+#include "Stats.h"
+#include "ThreadPool.h"
+#include "Wavefront.h"
+#include "WorkDeque.h"
 #include <assert.h>
+#include <limits.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+/* The cells changed by the last update, when they are being listed */
+struct CHANGES
+{
+  Automaton_Change *records;
+  size_t size;
+  size_t capacity;        /* kept between updates so listing rarely allocates */
+  bool enabled;
+  bool failed;            /* a change didn't fit and the list is incomplete */
+};
+
+/* A worker's share of a parallel point set update */
+struct STRIPE
+{
+  Work_Deque deque;       /* tile tasks left for the worker to run */
+  Point_Set *cells;       /* the next state of the stripe's rows */
+  struct CHANGES changes; /* the cells of the stripe's rows that changed */
+  unsigned long searches; /* point_set_search calls of the last update */
+  bool failed;
+};
+
+/* A run of neighbouring tiles in one row of tiles that need an update */
+struct TILE_TASK
+{
+  int tile_row;
+  int col_begin;
+  int col_end;
+};
+
+/* Which tiles of the dense grid the next update has to evaluate */
+struct TILES
+{
+  int rows;               /* tiles down the grid */
+  int cols;               /* tiles across the grid, one per word */
+  uint8_t *flags;         /* how each tile of the current grid differs */
+  uint8_t *next_flags;    /* the flags of the grid being written */
+  struct TILE_TASK *tasks; /* the tiles queued for the current update */
+  long num_tasks;
+  long evaluated;         /* tiles evaluated by the last update */
+  long skipped;           /* tiles skipped by the last update */
+};
 
 struct AUTOMATON
 {
   int height;
   int width;
   Automaton_Type type;
-  Point_Set *board_state;
+  Rule rule;              /* the rule every backend runs */
+  Automaton_Backend backend;
+  long generation;        /* generations advanced since the board was reset */
+  Point_Set *board_state; /* board of the point set and sparse backends */
+  Point_Set *next_board;  /* cleared and refilled with the next board */
+  Point_Set *visited;     /* cells the sparse backend has evaluated */
+  int tree_height;        /* of board_state, -1 until it's next walked */
+  Grid *grid;             /* board of the dense grid backend */
+  Grid *next_grid;        /* buffer the next dense board is written to */
+  struct TILES tiles;     /* change tracking of the dense grid */
+  Hash_Life *hash_life;   /* board of the hashlife backend */
+  Wavefront *wavefront;   /* board of the wavefront backend */
+  Thread_Pool *pool;      /* workers of a parallel update, NULL if serial */
+  struct STRIPE *stripes; /* one per worker of the pool */
+  struct CHANGES changes; /* what the last update changed */
+  Automaton_Stats stats;  /* what the last update or step cost */
+  Automaton_Stats counting; /* what the update or step running has cost */
+};
+
+/*
+ * The rulestring run by each preset automaton type.  Dying cells of the
+ * three-state types don't count as live neighbours, which makes them
+ * Generations rules.
+ */
+static const char *type_rules[] = {
+  [game_of_life]       = "B3/S23",
+  [seeds]              = "B2/S",
+  [greenberg_hastings] = "B1234/S/C3V",
+  [highlife]           = "B36/S23",
+  [day_and_night]      = "B3678/S34678",
+  [brians_brain]       = "B2/S/C3"
 };
 
+// Gets the rule run by a preset automaton type
+static void
+type_rule (Automaton_Type type, Rule *rule)
+{
+  assert(type < custom_rule);
+
+  bool valid = rule_parse(type_rules[type], rule);
+  assert(valid);
+  (void) valid;
+}
+
+// Gets the preset type that runs the given rule, if there is one
+static Automaton_Type
+rule_type (const Rule *rule)
+{
+  Automaton_Type type = custom_rule;
+  Rule preset;
+
+  for (Automaton_Type t = game_of_life; t < custom_rule; t++)
+    {
+      type_rule(t, &preset);
+      if (rule_equal(rule, &preset))
+        {
+          type = t;
+          break;
+        }
+    }
+
+  return type;
+}
+
+// Whether the given backend is able to run the given rule
+static bool
+backend_supports_rule (Automaton_Backend backend, const Rule *rule)
+{
+  bool supported     = true;
+  bool birth_on_zero = rule->birth & 1;
+
+  switch (backend)
+    {
+    case point_set_backend:
+    case dense_grid_backend:
+      break;
+    case sparse_backend:
+    case wavefront_backend:
+      // cells far away from any live cell would be born
+      supported = !birth_on_zero;
+      break;
+    case hashlife_backend:
+      supported = rule->num_states == 2 && !rule->von_neumann
+        && !birth_on_zero;
+      break;
+    }
+
+  return supported;
+}
+
+// The backend used in place of one that can't run the given rule
+static Automaton_Backend
+fallback_backend (const Rule *rule)
+{
+  return backend_supports_rule(sparse_backend, rule)
+    ? sparse_backend : dense_grid_backend;
+}
+
 /*
  * NEIGHBOURHOOD CHECKS
  *
@@ -52,323 +199,1987 @@ check_moore_neighbourhood (Automaton *automaton, int y, int x, int state)
   return count;
 }
 
-static Point_Set *
-random_state (int height, int width, int num_states)
+// Counts the live cells in the neighbourhood the automaton's rule uses
+static int
+count_live_neighbours (Automaton *automaton, int y, int x)
 {
-  Point_Set *new_state = point_set_create(sizeof(int), free);
-  if (!new_state)
-    goto done;
+  if (automaton->rule.von_neumann)
+    return check_von_neumann_neighbourhood(automaton, y, x, 1);
+
+  return check_moore_neighbourhood(automaton, y, x, 1);
+}
+
+static void
+changes_push (struct CHANGES *changes, int y, int x, int state);
 
-  for (int y = -height / 2; y < height / 2 + height; y++)
+/*
+ * Adds the next state of the rows from y_begin up to y_end to the given set,
+ * listing the cells whose state changes unless changes is NULL
+ */
+static bool
+next_board_rows (Automaton *automaton, Point_Set *next_state,
+                 struct CHANGES *changes, int y_begin, int y_end)
+{
+  bool success = true;
+  const Rule *rule = &automaton->rule;
+
+  for (int y = y_begin; y < y_end; y++)
     {
-      for (int x = -width / 2; x < width / 2 + width; x++)
+      for (int x = -automaton->width / 2;
+           x < automaton->width - automaton->width / 2; x++)
         {
-          int state = rand() % num_states;
-          if (state)
-            point_set_insert(new_state, y, x, &state);
+          int current_state = automaton_get_state(automaton, y, x);
+          int cell_state = rule_next_state(rule, current_state,
+                                           count_live_neighbours(automaton, y,
+                                                                 x));
+          
+          // Any point not in the point set is assumed to be zero
+          if (cell_state && !point_set_insert(next_state, y, x, &cell_state))
+            success = false;
+          if (changes && cell_state != current_state)
+            changes_push(changes, y, x, cell_state);
         }
     }
 
- done:
-  return new_state;
+  return success;
 }
 
 /*
- * STATE UPDATE FUNCTIONS
+ * SPARSE UPDATE
  *
- * The following functions update the state of the given cellular automaton.  
- * Each function implementing a different set of rules corresponding to the 
- * different cellular automaton implemented here.
+ * A dead cell can only change state when one of its neighbours is not dead,
+ * so the sparse backend evaluates each non-dead cell and its neighbourhood
+ * instead of the whole board.  Every candidate is evaluated once, with the
+ * same rules as the full scan, and only if it lies inside the borders.
  */
 
-static int
-next_state_seeds (Automaton *automaton, int y, int x)
+struct SPARSE_UPDATE
 {
-  int next_state      = 0;
-  int current_state   = automaton_get_state(automaton, y, x);
-  int live_neighbours = check_moore_neighbourhood(automaton, y, x, 1);
-  
-  if (!current_state && live_neighbours == 2)
-    next_state = 1;
+  Automaton *automaton;
+  const Rule *rule;
+  Point_Set *next_state;
+  Point_Set *visited;     /* candidates that have already been evaluated */
+  struct CHANGES *changes; /* where changed cells are listed, or NULL */
+  bool failed;
+};
+
+static void
+sparse_evaluate (struct SPARSE_UPDATE *update, int y, int x)
+{
+  Automaton *automaton = update->automaton;
+  static const char seen = 1;
+
+  if (y < -automaton->height / 2
+      || y >= automaton->height - automaton->height / 2
+      || x < -automaton->width / 2
+      || x >= automaton->width - automaton->width / 2)
+    return;
+
+  // a cell already evaluated is in the set, anything else is out of memory
+  if (!point_set_insert(update->visited, y, x, &seen))
+    {
+      if (!point_set_search(update->visited, y, x))
+        update->failed = true;
+      return;
+    }
 
-  return next_state;
+  int current_state = automaton_get_state(automaton, y, x);
+  int cell_state = rule_next_state(update->rule, current_state,
+                                   count_live_neighbours(automaton, y, x));
+  if (cell_state && !point_set_insert(update->next_state, y, x, &cell_state))
+    update->failed = true;
+  if (update->changes && cell_state != current_state)
+    changes_push(update->changes, y, x, cell_state);
 }
 
-static int
-next_state_life (Automaton *automaton, int y, int x)
+// Evaluates a non-dead cell along with its neighbourhood
+static void
+sparse_visit (int y, int x, void *data, void *ctx)
 {
-  int next_state      = 0;
-  int current_state   = automaton_get_state(automaton, y, x);
-  int live_neighbours = check_moore_neighbourhood(automaton, y, x, 1);
+  struct SPARSE_UPDATE *update = ctx;
+  (void) data;
 
-  if ((current_state && (live_neighbours == 2 || live_neighbours == 3))
-      || (!current_state && live_neighbours == 3))
-    next_state = 1;
+  sparse_evaluate(update, y, x);
+  sparse_evaluate(update, y - 1, x);
+  sparse_evaluate(update, y + 1, x);
+  sparse_evaluate(update, y, x - 1);
+  sparse_evaluate(update, y, x + 1);
 
-  return next_state;
+  if (!update->rule->von_neumann)
+    {
+      sparse_evaluate(update, y - 1, x - 1);
+      sparse_evaluate(update, y - 1, x + 1);
+      sparse_evaluate(update, y + 1, x - 1);
+      sparse_evaluate(update, y + 1, x + 1);
+    }
 }
 
-static int
-next_state_highlife (Automaton *automaton, int y, int x)
+// Fills the given empty set with the next state of the board
+static bool
+next_sparse_state (Automaton *automaton, Point_Set *next_state)
+{
+  struct SPARSE_UPDATE update = {
+    .automaton  = automaton,
+    .rule       = &automaton->rule,
+    .next_state = next_state,
+    .visited    = automaton->visited,
+    .changes    = automaton->changes.enabled ? &automaton->changes : NULL,
+    .failed     = false
+  };
+
+  point_set_clear(update.visited);
+  point_set_foreach(automaton->board_state, sparse_visit, &update);
+
+  return !update.failed;
+}
+
+/*
+ * DENSE GRID UPDATE
+ *
+ * The dense grid backend reads the neighbourhood of a cell straight out of
+ * the bit planes of the current grid and writes the next state into the
+ * second grid, which then becomes the current one.  Two-state automata are
+ * updated a word at a time by the rule kernel, the others cell by cell.
+ *
+ * The grid is divided into tiles TILE_ROWS rows high and one word wide,
+ * each flagged when it differs between the two grids.  The grid being
+ * written already holds the generation before the current one, so a tile
+ * whose neighbourhood of tiles is the same in both grids would be written
+ * with exactly what it already holds and is skipped.  This skips still lifes
+ * and period two oscillators such as blinkers.  Writing to the current grid
+ * from outside an update marks the tile as modified, which forces it to be
+ * evaluated for the next two updates since neither grid can be trusted
+ * until it has been written over twice.
+ *
+ * A tile is also flagged when it differs from the generation before it,
+ * which the change list reads.  A skipped tile ends up holding the
+ * generation before the one before, so it differs from the generation
+ * before exactly when it did after the last update, and keeps its flag.
+ */
+
+#define TILE_ROWS 32
+
+/* The most tiles evaluated by a single task */
+#define TASK_MAX_TILES 16
+
+/* Words the rule kernel writes to a stack buffer at a time */
+#define KERNEL_CHUNK_WORDS 64
+
+enum
+  {
+    TILE_CHANGED  = 1,  /* the tile differs from the other grid */
+    TILE_MODIFIED = 2,  /* the tile was written outside of an update */
+    TILE_DIFFERS  = 4   /* the tile differs from the generation before */
+  };
+
+// Get the bit for the given column from a padded row
+static inline int
+row_bit (const uint64_t *row, int col)
 {
-  int next_state      = 0;
-  int current_state   = automaton_get_state(automaton, y, x);
-  int live_neighbours = check_moore_neighbourhood(automaton, y, x, 1);
+  col += GRID_WORD_BITS;
+  return (row[col / GRID_WORD_BITS - 1] >> (col % GRID_WORD_BITS)) & 1;
+}
 
-  // Born with 3 or 6 neighbours; survives with 2 or 3 neighbours
-  if ((!current_state && (live_neighbours == 3 || live_neighbours == 6))
-      || (current_state && (live_neighbours == 2 || live_neighbours == 3)))
-    next_state = 1;
+// Flags the tile holding the given cell of the current grid as modified
+static void
+tiles_mark (Automaton *automaton, int row, int col)
+{
+  struct TILES *tiles = &automaton->tiles;
 
-  return next_state;
+  if (row >= 0 && row < automaton->grid->height && col >= 0
+      && col < automaton->grid->width)
+    tiles->flags[(size_t) (row / TILE_ROWS) * tiles->cols
+                 + col / GRID_WORD_BITS] = TILE_CHANGED | TILE_MODIFIED;
 }
 
-static int
-next_state_greenberg_hastings (Automaton *automaton, int y, int x)
+// Flags every tile as modified and as differing from the generation before
+static void
+tiles_mark_all (Automaton *automaton)
+{
+  struct TILES *tiles = &automaton->tiles;
+
+  memset(tiles->flags, TILE_CHANGED | TILE_MODIFIED | TILE_DIFFERS,
+         (size_t) tiles->rows * tiles->cols);
+}
+
+// Whether a tile or any tile around it differs between the two grids
+static bool
+tile_needs_update (const struct TILES *tiles, int tile_row, int tile_col)
+{
+  for (int r = tile_row - 1; r <= tile_row + 1; r++)
+    {
+      for (int c = tile_col - 1; c <= tile_col + 1; c++)
+        {
+          if (r >= 0 && r < tiles->rows && c >= 0 && c < tiles->cols
+              && (tiles->flags[(size_t) r * tiles->cols + c]
+                  & (TILE_CHANGED | TILE_MODIFIED)))
+            return true;
+        }
+    }
+
+  return false;
+}
+
+/*
+ * Advances the words from word_begin up to word_end of the given rows of a
+ * two-state grid with the bit-parallel rule kernel, flagging the tiles
+ * whose words changed.
+ */
+static void
+next_grid_words_kernel (Automaton *automaton, int row_begin, int row_end,
+                        size_t word_begin, size_t word_end, uint8_t *changed)
+{
+  Grid *curr = automaton->grid;
+  Grid *next = automaton->next_grid;
+  uint64_t buffer[KERNEL_CHUNK_WORDS];
+
+  for (int row = row_begin; row < row_end; row++)
+    {
+      const uint64_t *above = grid_row(curr, 0, row - 1);
+      const uint64_t *here  = grid_row(curr, 0, row);
+      const uint64_t *below = grid_row(curr, 0, row + 1);
+      uint64_t *out         = grid_row(next, 0, row);
+
+      for (size_t word = word_begin; word < word_end;
+           word += KERNEL_CHUNK_WORDS)
+        {
+          size_t words = word_end - word;
+          if (words > KERNEL_CHUNK_WORDS)
+            words = KERNEL_CHUNK_WORDS;
+
+          life_kernel_row(above + word, here + word, below + word, buffer,
+                          words, automaton->rule.birth,
+                          automaton->rule.survival);
+
+          // keep the columns past the edge of the board dead
+          if (word + words == curr->words)
+            buffer[words - 1] &= grid_last_word_mask(curr);
+
+          for (size_t i = 0; i < words; i++)
+            {
+              changed[word + i] |= (out[word + i] != buffer[i]) * TILE_CHANGED
+                | (here[word + i] != buffer[i]) * TILE_DIFFERS;
+              out[word + i] = buffer[i];
+            }
+        }
+    }
+}
+
+/*
+ * Advances the words from word_begin up to word_end of the given rows one
+ * cell at a time, flagging the tiles whose words changed.
+ */
+static void
+next_grid_words (Automaton *automaton, int row_begin, int row_end,
+                 size_t word_begin, size_t word_end, uint8_t *changed)
+{
+  Grid *curr = automaton->grid;
+  Grid *next = automaton->next_grid;
+  const Rule *rule = &automaton->rule;
+
+  if (rule->num_states == 2 && !rule->von_neumann)
+    {
+      next_grid_words_kernel(automaton, row_begin, row_end, word_begin,
+                             word_end, changed);
+      return;
+    }
+
+  for (int row = row_begin; row < row_end; row++)
+    {
+      const uint64_t *above = grid_row(curr, 0, row - 1);
+      const uint64_t *here  = grid_row(curr, 0, row);
+      const uint64_t *below = grid_row(curr, 0, row + 1);
+
+      for (size_t word = word_begin; word < word_end; word++)
+        {
+          uint64_t out[RULE_MAX_STATES - 1];
+          for (int plane = 0; plane < next->planes; plane++)
+            out[plane] = 0;
+
+          int end = curr->width - (int) word * GRID_WORD_BITS;
+          if (end > GRID_WORD_BITS)
+            end = GRID_WORD_BITS;
+
+          for (int bit = 0; bit < end; bit++)
+            {
+              int col = (int) word * GRID_WORD_BITS + bit;
+              int live_neighbours = row_bit(above, col) + row_bit(below, col)
+                + row_bit(here, col - 1) + row_bit(here, col + 1);
+
+              if (!rule->von_neumann)
+                live_neighbours += row_bit(above, col - 1)
+                  + row_bit(above, col + 1) + row_bit(below, col - 1)
+                  + row_bit(below, col + 1);
+
+              int current_state = 0;
+              for (int plane = 0; plane < curr->planes && !current_state;
+                   plane++)
+                {
+                  if (row_bit(grid_row(curr, plane, row), col))
+                    current_state = plane + 1;
+                }
+
+              int cell_state = rule_next_state(rule, current_state,
+                                               live_neighbours);
+              if (cell_state)
+                out[cell_state - 1] |= UINT64_C(1) << bit;
+            }
+
+          for (int plane = 0; plane < next->planes; plane++)
+            {
+              uint64_t *word_out = &grid_row(next, plane, row)[word];
+              changed[word] |= (*word_out != out[plane]) * TILE_CHANGED
+                | (grid_row(curr, plane, row)[word] != out[plane])
+                * TILE_DIFFERS;
+              *word_out = out[plane];
+            }
+        }
+    }
+}
+
+// Counts the cells of the board in a run of tiles in one row of tiles
+static inline long
+tile_cells (Automaton *automaton, int tile_row, int col_begin, int col_end)
+{
+  int rows = automaton->grid->height - tile_row * TILE_ROWS;
+  int cols = automaton->grid->width - col_begin * GRID_WORD_BITS;
+
+  if (rows > TILE_ROWS)
+    rows = TILE_ROWS;
+  if (cols > (col_end - col_begin) * GRID_WORD_BITS)
+    cols = (col_end - col_begin) * GRID_WORD_BITS;
+  return (long) rows * cols;
+}
+
+/*
+ * Queues every run of neighbouring tiles in a row of tiles that need an
+ * update as a task, clearing the flags of the grid being written.  Runs are
+ * kept short enough for the tasks to be spread between threads.
+ */
+static void
+queue_tile_tasks (Automaton *automaton)
+{
+  struct TILES *tiles = &automaton->tiles;
+
+  tiles->num_tasks = 0;
+  tiles->evaluated = 0;
+  tiles->skipped   = 0;
+  memset(tiles->next_flags, 0, (size_t) tiles->rows * tiles->cols);
+
+  for (int tile_row = 0; tile_row < tiles->rows; tile_row++)
+    {
+      int col = 0;
+
+      while (col < tiles->cols)
+        {
+          int run_end = col;
+          while (run_end < tiles->cols && run_end - col < TASK_MAX_TILES
+                 && tile_needs_update(tiles, tile_row, run_end))
+            run_end++;
+
+          if (run_end == col)
+            {
+              size_t tile = (size_t) tile_row * tiles->cols + col;
+              tiles->next_flags[tile] = tiles->flags[tile] & TILE_DIFFERS;
+              tiles->skipped++;
+              col++;
+              continue;
+            }
+
+          tiles->tasks[tiles->num_tasks++] = (struct TILE_TASK) {
+            tile_row, col, run_end
+          };
+          tiles->evaluated += run_end - col;
+          STATS_ADD(automaton->counting.cells_evaluated,
+                    tile_cells(automaton, tile_row, col, run_end));
+          col = run_end;
+        }
+    }
+}
+
+// Writes the next state of the tiles of a task
+static void
+run_tile_task (Automaton *automaton, const struct TILE_TASK *task)
+{
+  struct TILES *tiles  = &automaton->tiles;
+  size_t first         = (size_t) task->tile_row * tiles->cols;
+  uint8_t *changed     = &tiles->next_flags[first];
+  const uint8_t *flags = &tiles->flags[first];
+  int height           = automaton->grid->height;
+  int row_begin        = task->tile_row * TILE_ROWS;
+  int row_end          = row_begin + TILE_ROWS < height
+    ? row_begin + TILE_ROWS : height;
+
+  next_grid_words(automaton, row_begin, row_end, task->col_begin,
+                  task->col_end, changed);
+
+  // modified tiles are evaluated once more on the next update
+  for (int col = task->col_begin; col < task->col_end; col++)
+    {
+      if (flags[col] & TILE_MODIFIED)
+        changed[col] |= TILE_CHANGED;
+    }
+}
+
+/*
+ * PARALLEL UPDATE
+ *
+ * With more than one thread the update is shared between the workers of the
+ * automaton's thread pool.  Every worker reads the shared current board and
+ * writes to private output.
+ *
+ * The point set backend splits the board into horizontal stripes of rows,
+ * one per worker, each filling a set of its own which are merged into the
+ * next board once every worker has finished.
+ *
+ * The dense grid backend only queues the tiles that need an update.  Each
+ * worker starts with an even share of the queued tasks in its own deque and
+ * steals from the others once it runs out, so activity clustered in one part
+ * of the board is still spread over every thread.  A task writes straight
+ * into its own tiles of the next grid.
+ */
+
+// Stops a pool's workers and frees the stripes they wrote to
+static void
+threads_destroy (Thread_Pool *pool, struct STRIPE *stripes, int workers)
+{
+  for (int worker = 0; stripes && worker < workers; worker++)
+    {
+      if (stripes[worker].cells)
+        point_set_destroy(stripes[worker].cells);
+      free(stripes[worker].changes.records);
+    }
+  free(stripes);
+
+  if (pool)
+    thread_pool_destroy(pool);
+}
+
+// The rows from begin up to end make up the given worker's stripe
+static void
+stripe_bounds (int rows, int worker, int workers, int *begin, int *end)
+{
+  *begin = (int) ((long) rows * worker / workers);
+  *end   = (int) ((long) rows * (worker + 1) / workers);
+}
+
+static void
+board_stripe (int worker, int workers, void *ctx)
+{
+  Automaton *automaton  = ctx;
+  struct STRIPE *stripe = &automaton->stripes[worker];
+  int begin, end;
+
+  stripe_bounds(automaton->height, worker, workers, &begin, &end);
+  point_set_clear(stripe->cells);
+  stripe->changes.size   = 0;
+  stripe->changes.failed = false;
+#ifdef COLLECT_STATS
+  // searches are counted per thread, so the stripe keeps its own count
+  unsigned long searches = point_set_searches();
+#endif
+  stripe->failed = !next_board_rows(automaton, stripe->cells,
+                                    automaton->changes.enabled
+                                    ? &stripe->changes : NULL,
+                                    begin - automaton->height / 2,
+                                    end - automaton->height / 2);
+#ifdef COLLECT_STATS
+  stripe->searches = point_set_searches() - searches;
+#endif
+}
+
+struct MERGE
+{
+  Point_Set *into;
+  bool failed;
+};
+
+static void
+merge_point (int y, int x, void *data, void *ctx)
+{
+  struct MERGE *merge = ctx;
+
+  if (!point_set_insert(merge->into, y, x, data))
+    merge->failed = true;
+}
+
+static void
+changes_append (struct CHANGES *changes, const struct CHANGES *more);
+
+// Fills the given empty set with the next state of the board
+static bool
+next_board_state (Automaton *automaton, Point_Set *next_state)
+{
+  struct MERGE merge = { next_state, false };
+  bool tracking      = automaton->changes.enabled;
+
+  if (!automaton->pool)
+    return next_board_rows(automaton, next_state,
+                           tracking ? &automaton->changes : NULL,
+                           -automaton->height / 2,
+                           automaton->height - automaton->height / 2);
+
+  thread_pool_run(automaton->pool, board_stripe, automaton);
+  for (int worker = 0; worker < thread_pool_size(automaton->pool); worker++)
+    {
+      struct STRIPE *stripe = &automaton->stripes[worker];
+      merge.failed = merge.failed || stripe->failed;
+      point_set_foreach(stripe->cells, merge_point, &merge);
+      if (tracking)
+        changes_append(&automaton->changes, &stripe->changes);
+      // worker 0 is this thread, whose own count already has its searches
+      if (worker > 0)
+        STATS_ADD(automaton->counting.searches, (long) stripe->searches);
+    }
+
+  return !merge.failed;
+}
+
+/*
+ * Runs tile tasks until none are left anywhere, starting with the worker's
+ * own and then stealing from the other workers in turn.  No tasks are added
+ * while the workers run, so once every deque is empty the update is done.
+ */
+static void
+grid_worker (int worker, int workers, void *ctx)
+{
+  Automaton *automaton = ctx;
+  long task;
+
+  while (work_deque_pop(&automaton->stripes[worker].deque, &task))
+    run_tile_task(automaton, &automaton->tiles.tasks[task]);
+
+  for (int victim = (worker + 1) % workers; victim != worker;)
+    {
+      if (work_deque_steal(&automaton->stripes[victim].deque, &task))
+        run_tile_task(automaton, &automaton->tiles.tasks[task]);
+      else if (work_deque_empty(&automaton->stripes[victim].deque))
+        victim = (victim + 1) % workers;
+    }
+}
+
+static void
+next_grid_state (Automaton *automaton)
+{
+  Grid *curr          = automaton->grid;
+  struct TILES *tiles = &automaton->tiles;
+  uint8_t *flags      = tiles->flags;
+
+  queue_tile_tasks(automaton);
+  if (automaton->pool)
+    {
+      // hand every worker an even share of the tasks to start with
+      int workers = thread_pool_size(automaton->pool);
+      for (int worker = 0; worker < workers; worker++)
+        work_deque_reset(&automaton->stripes[worker].deque,
+                         tiles->num_tasks * worker / workers,
+                         tiles->num_tasks * (worker + 1) / workers);
+
+      // settle the kernel choice before the workers all ask for it
+      life_kernel_selected();
+      thread_pool_run(automaton->pool, grid_worker, automaton);
+    }
+  else
+    {
+      for (long task = 0; task < tiles->num_tasks; task++)
+        run_tile_task(automaton, &tiles->tasks[task]);
+    }
+
+  automaton->grid      = automaton->next_grid;
+  automaton->next_grid = curr;
+  tiles->flags         = tiles->next_flags;
+  tiles->next_flags    = flags;
+}
+
+/*
+ * TEMPORAL BLOCKING
+ *
+ * A single update streams the whole grid through the cache once per
+ * generation.  When advancing several generations at once, the dense grid
+ * backend instead copies a block of the board along with a halo of the
+ * cells around it into a pair of small buffers and advances the block by up
+ * to BLOCK_GENERATIONS generations there before writing it out.
+ *
+ * Every generation the cells on the edge of the buffer are missing some of
+ * their neighbours, so the part of the buffer that is still correct shrinks
+ * by a row at the top and bottom and by a column at either side.  The halo
+ * is BLOCK_GENERATIONS rows high and a word wide, which keeps the block
+ * itself correct up to the last generation.  Halos overlap between blocks,
+ * so their rows are evaluated more than once, and blocks don't keep track
+ * of which tiles changed.  Only two-state automata on the Moore
+ * neighbourhood are blocked since they go through the rule kernel.
+ */
+
+/* The most generations a block is advanced by at once, at most a word */
+#define BLOCK_GENERATIONS 32
+
+#define BLOCK_ROWS (TILE_ROWS * 4)
+#define BLOCK_WORDS 32
+
+/* A block with its halo and a zeroed word past each side, kept on the stack */
+#define BLOCK_BUFFER_ROWS (BLOCK_ROWS + 2 * BLOCK_GENERATIONS)
+#define BLOCK_BUFFER_WORDS (BLOCK_WORDS + 4)
+
+// Whether the automaton's rule can be advanced a block at a time
+static bool
+blocks_supported (Automaton *automaton)
+{
+  return automaton->backend == dense_grid_backend
+    && automaton->rule.num_states == 2 && !automaton->rule.von_neumann;
+}
+
+/*
+ * Advances a block of the current grid by the given number of generations,
+ * writing the result to the next grid.  The task's tile row is the row of
+ * blocks and its columns are the words of the block.
+ */
+static void
+run_block (Automaton *automaton, const struct TILE_TASK *task,
+           int generations)
+{
+  uint64_t buffers[2][BLOCK_BUFFER_ROWS][BLOCK_BUFFER_WORDS];
+  Grid *curr       = automaton->grid;
+  Grid *next       = automaton->next_grid;
+  int block_row    = task->tile_row * BLOCK_ROWS;
+  int block_rows   = curr->height - block_row < BLOCK_ROWS
+    ? curr->height - block_row : BLOCK_ROWS;
+  int rows         = block_rows + 2 * generations;
+  int first_row    = block_row - generations;
+  long first_word  = (long) task->col_begin - 2;
+  int words        = task->col_end - task->col_begin + 4;
+
+  // rows and words of the buffer that are inside the board
+  int row_begin  = first_row < 0 ? -first_row : 0;
+  int row_end    = curr->height - first_row < rows
+    ? curr->height - first_row : rows;
+  int word_begin = first_word < 0 ? (int) -first_word : 1;
+  int word_end   = (long) curr->words - first_word < words - 1
+    ? (int) ((long) curr->words - first_word) : words - 1;
+  bool last_word = first_word + word_end == (long) curr->words;
+
+  for (int row = 0; row < rows; row++)
+    {
+      for (int word = 0; word < words; word++)
+        {
+          bool inside = row >= row_begin && row < row_end
+            && word >= word_begin && word < word_end;
+          buffers[0][row][word] = inside
+            ? grid_row(curr, 0, first_row + row)[first_word + word] : 0;
+          buffers[1][row][word] = 0;
+        }
+    }
+
+  // each generation leaves the cells next to the ones it evaluated behind
+  for (int gen = 1; gen <= generations; gen++)
+    {
+      uint64_t (*src)[BLOCK_BUFFER_WORDS] = buffers[(gen - 1) % 2];
+      uint64_t (*dst)[BLOCK_BUFFER_WORDS] = buffers[gen % 2];
+      int begin = row_begin > gen ? row_begin : gen;
+      int end   = row_end < rows - gen ? row_end : rows - gen;
+
+      for (int row = begin; row < end; row++)
+        {
+          life_kernel_row(src[row - 1] + word_begin, src[row] + word_begin,
+                          src[row + 1] + word_begin, dst[row] + word_begin,
+                          word_end - word_begin, automaton->rule.birth,
+                          automaton->rule.survival);
+
+          // keep the columns past the edge of the board dead
+          if (last_word)
+            dst[row][word_end - 1] &= grid_last_word_mask(curr);
+        }
+    }
+
+  for (int row = generations; row < generations + block_rows; row++)
+    {
+      uint64_t *out = grid_row(next, 0, first_row + row);
+      for (int word = 2; word < words - 2; word++)
+        out[first_word + word] = buffers[generations % 2][row][word];
+    }
+}
+
+struct BLOCK_STEP
 {
-  int next_state      = 0;
-  int current_state   = automaton_get_state(automaton, y, x);
-  int live_neighbours = check_von_neumann_neighbourhood(automaton, y, x, 1);
+  Automaton *automaton;
+  int generations;
+};
+
+// Runs blocks until none are left anywhere, like grid_worker does tiles
+static void
+block_worker (int worker, int workers, void *ctx)
+{
+  struct BLOCK_STEP *step = ctx;
+  Automaton *automaton    = step->automaton;
+  struct TILE_TASK *tasks = automaton->tiles.tasks;
+  long task;
 
-  if (current_state == 1)
-    next_state = 2;
-  else if (current_state == 2)
-    next_state = 0;
-  else if (live_neighbours > 0)
-    next_state = 1;
+  while (work_deque_pop(&automaton->stripes[worker].deque, &task))
+    run_block(automaton, &tasks[task], step->generations);
 
-  return next_state;
+  for (int victim = (worker + 1) % workers; victim != worker;)
+    {
+      if (work_deque_steal(&automaton->stripes[victim].deque, &task))
+        run_block(automaton, &tasks[task], step->generations);
+      else if (work_deque_empty(&automaton->stripes[victim].deque))
+        victim = (victim + 1) % workers;
+    }
+}
+
+// Advances the whole dense grid by up to BLOCK_GENERATIONS generations
+static void
+next_grid_blocks (Automaton *automaton, int generations)
+{
+  assert(generations > 0 && generations <= BLOCK_GENERATIONS);
+
+  Grid *curr              = automaton->grid;
+  struct TILES *tiles     = &automaton->tiles;
+  struct BLOCK_STEP step  = { automaton, generations };
+  int block_rows          = (curr->height + BLOCK_ROWS - 1) / BLOCK_ROWS;
+
+  // blocks are made of whole tiles so there are never more than tiles
+  tiles->num_tasks = 0;
+  for (int block_row = 0; block_row < block_rows; block_row++)
+    {
+      for (int word = 0; word < (int) curr->words; word += BLOCK_WORDS)
+        {
+          int end = word + BLOCK_WORDS < (int) curr->words
+            ? word + BLOCK_WORDS : (int) curr->words;
+          tiles->tasks[tiles->num_tasks++] = (struct TILE_TASK) {
+            block_row, word, end
+          };
+        }
+    }
+
+  if (automaton->pool)
+    {
+      int workers = thread_pool_size(automaton->pool);
+      for (int worker = 0; worker < workers; worker++)
+        work_deque_reset(&automaton->stripes[worker].deque,
+                         tiles->num_tasks * worker / workers,
+                         tiles->num_tasks * (worker + 1) / workers);
+
+      life_kernel_selected();
+      thread_pool_run(automaton->pool, block_worker, &step);
+    }
+  else
+    {
+      for (long task = 0; task < tiles->num_tasks; task++)
+        run_block(automaton, &tiles->tasks[task], generations);
+    }
+
+  automaton->grid      = automaton->next_grid;
+  automaton->next_grid = curr;
+
+  STATS_ADD(automaton->counting.cells_evaluated,
+            (long) curr->height * curr->width * generations);
+
+  // the other grid is several generations behind, so no tile can be skipped
+  tiles_mark_all(automaton);
+  tiles->evaluated = (long) tiles->rows * tiles->cols;
+  tiles->skipped   = 0;
+}
+
+/*
+ * CHANGE LISTS
+ *
+ * The cells an update changes are recorded where their new state is
+ * written.  The point set backends push a change whenever a cell's next
+ * state differs from its current one, each worker into a list of its own
+ * which is appended once the workers have finished.  The dense grid flags
+ * the tiles that differ from the generation before and only compares the
+ * words of those tiles once the update has finished.  The hashlife backend
+ * only walks the subtrees that differ and the wavefront backend recorded its
+ * changes while stepping.
+ */
+
+static void
+changes_push (struct CHANGES *changes, int y, int x, int state)
+{
+  if (changes->size == changes->capacity)
+    {
+      size_t capacity = changes->capacity ? changes->capacity * 2 : 256;
+      Automaton_Change *records = realloc(changes->records,
+                                          sizeof(Automaton_Change)
+                                          * capacity);
+      if (!records)
+        {
+          changes->failed = true;
+          return;
+        }
+      changes->records  = records;
+      changes->capacity = capacity;
+    }
+
+  changes->records[changes->size++] = (Automaton_Change) { y, x, state };
+}
+
+// Appends the changes of another list, such as a worker's
+static void
+changes_append (struct CHANGES *changes, const struct CHANGES *more)
+{
+  if (more->failed)
+    changes->failed = true;
+
+  if (changes->size + more->size > changes->capacity)
+    {
+      size_t capacity = changes->capacity ? changes->capacity : 256;
+      while (capacity < changes->size + more->size)
+        capacity *= 2;
+      Automaton_Change *records = realloc(changes->records,
+                                          sizeof(Automaton_Change)
+                                          * capacity);
+      if (!records)
+        {
+          changes->failed = true;
+          return;
+        }
+      changes->records  = records;
+      changes->capacity = capacity;
+    }
+
+  if (more->size)
+    memcpy(changes->records + changes->size, more->records,
+           sizeof(Automaton_Change) * more->size);
+  changes->size += more->size;
+}
+
+// Lists the cells of the tiles that differ from the generation before
+static void
+list_grid_changes (Automaton *automaton)
+{
+  struct TILES *tiles = &automaton->tiles;
+  Grid *curr          = automaton->grid;
+  Grid *old           = automaton->next_grid;
+
+  for (int tile_row = 0; tile_row < tiles->rows; tile_row++)
+    for (int word = 0; word < tiles->cols; word++)
+      {
+        if (!(tiles->flags[(size_t) tile_row * tiles->cols + word]
+              & TILE_DIFFERS))
+          continue;
+
+        int row_end = (tile_row + 1) * TILE_ROWS;
+        if (row_end > curr->height)
+          row_end = curr->height;
+
+        for (int row = tile_row * TILE_ROWS; row < row_end; row++)
+          {
+            uint64_t differs = 0;
+            for (int plane = 0; plane < curr->planes; plane++)
+              differs |= grid_row(curr, plane, row)[word]
+                ^ grid_row(old, plane, row)[word];
+
+            while (differs)
+              {
+                int col = word * GRID_WORD_BITS + __builtin_ctzll(differs);
+                changes_push(&automaton->changes,
+                             row - automaton->height / 2,
+                             col - automaton->width / 2,
+                             grid_get(curr, row, col));
+                differs &= differs - 1;
+              }
+          }
+      }
+}
+
+// Whether hashlife coordinates can be narrowed to ints
+static bool
+fits_int (int64_t y, int64_t x)
+{
+  return y >= INT_MIN && y <= INT_MAX && x >= INT_MIN && x <= INT_MAX;
+}
+
+static void
+list_hash_life_change (int64_t y, int64_t x, int state, void *ctx)
+{
+  // a pattern can grow further out than a change can say
+  if (fits_int(y, x))
+    changes_push(ctx, y, x, state);
+}
+
+static void
+list_wavefront_change (int y, int x, int state, void *ctx)
+{
+  changes_push(ctx, y, x, state);
+}
+
+/*
+ * Lists the cells the last update changed that the update didn't record as
+ * it went, returning whether all of them fit
+ */
+static bool
+list_changes (Automaton *automaton)
+{
+  struct CHANGES *changes = &automaton->changes;
+
+  switch (automaton->backend)
+    {
+    case point_set_backend:
+    case sparse_backend:
+      break;
+    case dense_grid_backend:
+      list_grid_changes(automaton);
+      break;
+    case hashlife_backend:
+      if (!hash_life_foreach_change(automaton->hash_life,
+                                    list_hash_life_change, changes))
+        changes->failed = true;
+      break;
+    case wavefront_backend:
+      wavefront_foreach_change(automaton->wavefront, list_wavefront_change,
+                               changes);
+      break;
+    }
+
+  return !changes->failed;
+}
+
+/*
+ * Replaces the automaton's grids with ones of the given size, keeping the
+ * cells that still fit.  Cells keep their coordinates so the board stays
+ * centred on the origin.
+ */
+static bool
+rebuild_grids (Automaton *automaton, int height, int width, int planes)
+{
+  bool success = false;
+  Grid *grid = grid_create(height, width, planes);
+  Grid *next_grid = grid_create(height, width, planes);
+  int tile_rows = (height + TILE_ROWS - 1) / TILE_ROWS;
+  int tile_cols = grid ? (int) grid->words : 0;
+  uint8_t *flags = malloc((size_t) tile_rows * tile_cols + 1);
+  uint8_t *next_flags = malloc((size_t) tile_rows * tile_cols + 1);
+  struct TILE_TASK *tasks = malloc(sizeof(struct TILE_TASK)
+                                   * ((size_t) tile_rows * tile_cols + 1));
+  if (!grid || !next_grid || !flags || !next_flags || !tasks)
+    goto err;
+
+  Grid *old = automaton->grid;
+  if (old)
+    {
+      for (int row = 0; row < old->height; row++)
+        {
+          for (int col = 0; col < old->width; col++)
+            {
+              int state = grid_get(old, row, col);
+              if (state && state <= planes)
+                grid_set(grid, row - old->height / 2 + height / 2,
+                         col - old->width / 2 + width / 2, state);
+            }
+        }
+      grid_destroy(automaton->grid);
+      grid_destroy(automaton->next_grid);
+      free(automaton->tiles.flags);
+      free(automaton->tiles.next_flags);
+      free(automaton->tiles.tasks);
+    }
+
+  automaton->grid             = grid;
+  automaton->next_grid        = next_grid;
+  automaton->tiles.rows       = tile_rows;
+  automaton->tiles.cols       = tile_cols;
+  automaton->tiles.flags      = flags;
+  automaton->tiles.next_flags = next_flags;
+  automaton->tiles.tasks      = tasks;
+  tiles_mark_all(automaton);
+  success = true;
+  goto done;
+
+ err:
+  if (grid)
+    grid_destroy(grid);
+  if (next_grid)
+    grid_destroy(next_grid);
+  free(flags);
+  free(next_flags);
+  free(tasks);
+ done:
+  return success;
+}
+
+/*
+ * BOARD ACCESS
+ *
+ * Reads and writes cells on the automaton's board without validating the
+ * state against the automaton's type.
+ */
+
+static void
+board_set (Automaton *automaton, int y, int x, int state)
+{
+  switch (automaton->backend)
+    {
+    case point_set_backend:
+    case sparse_backend:
+      automaton->tree_height = -1;
+      if (state == 0)
+        point_set_delete(automaton->board_state, y, x);
+      else
+        {
+          int *curr_state = point_set_search(automaton->board_state, y, x);
+          if (!curr_state)
+            point_set_insert(automaton->board_state, y, x, &state);
+          else
+            *curr_state = state;
+        }
+      break;
+    case dense_grid_backend:
+      if (grid_set(automaton->grid, y + automaton->height / 2,
+                   x + automaton->width / 2, state))
+        tiles_mark(automaton, y + automaton->height / 2,
+                   x + automaton->width / 2);
+      break;
+    case hashlife_backend:
+      hash_life_set(automaton->hash_life, y, x, state);
+      break;
+    case wavefront_backend:
+      wavefront_set(automaton->wavefront, y, x, state);
+      break;
+    }
+}
+
+// Frees whatever storage the automaton's board is using
+static void
+board_destroy (Automaton *automaton)
+{
+  if (automaton->board_state)
+    point_set_destroy(automaton->board_state);
+  if (automaton->next_board)
+    point_set_destroy(automaton->next_board);
+  if (automaton->visited)
+    point_set_destroy(automaton->visited);
+  if (automaton->grid)
+    grid_destroy(automaton->grid);
+  if (automaton->next_grid)
+    grid_destroy(automaton->next_grid);
+  free(automaton->tiles.flags);
+  free(automaton->tiles.next_flags);
+  free(automaton->tiles.tasks);
+  if (automaton->hash_life)
+    hash_life_destroy(automaton->hash_life);
+  if (automaton->wavefront)
+    wavefront_destroy(automaton->wavefront);
+
+  automaton->board_state = NULL;
+  automaton->next_board  = NULL;
+  automaton->visited     = NULL;
+  automaton->grid        = NULL;
+  automaton->next_grid   = NULL;
+  automaton->hash_life   = NULL;
+  automaton->wavefront   = NULL;
+  automaton->tiles       = (struct TILES) { 0 };
+}
+
+static Automaton *
+create_with_rule (const Rule *rule, Automaton_Type type, int height,
+                  int width, Automaton_Backend backend);
+
+/*
+ * Moves the board inside the automaton's borders into a new backend running
+ * the given rule.  The automaton is left untouched if the new board can't be
+ * created.
+ */
+static bool
+convert_backend (Automaton *automaton, const Rule *rule,
+                 Automaton_Backend backend)
+{
+  bool success = false;
+  Automaton *converted = create_with_rule(rule, automaton->type,
+                                          automaton->height, automaton->width,
+                                          backend);
+  if (!converted)
+    goto done;
+
+  for (int y = -automaton->height / 2;
+       y < automaton->height - automaton->height / 2; y++)
+    {
+      for (int x = -automaton->width / 2;
+           x < automaton->width - automaton->width / 2; x++)
+        {
+          int state = automaton_get_state(automaton, y, x);
+          if (state)
+            board_set(converted, y, x, state);
+        }
+    }
+
+  // take over the converted automaton's board
+  board_destroy(automaton);
+  automaton->backend     = converted->backend;
+  automaton->board_state = converted->board_state;
+  automaton->tree_height = -1;
+  automaton->next_board  = converted->next_board;
+  automaton->visited     = converted->visited;
+  automaton->grid        = converted->grid;
+  automaton->next_grid   = converted->next_grid;
+  automaton->tiles       = converted->tiles;
+  automaton->hash_life   = converted->hash_life;
+  automaton->wavefront   = converted->wavefront;
+  free(converted);
+  success = true;
+
+ done:
+  return success;
+}
+
+/*
+ * RUNTIME STATS
+ *
+ * Built with COLLECT_STATS, an update or step counts what it costs in the
+ * automaton's counting stats.  The counters that are kept elsewhere, by the
+ * clock, the point sets and the backends, start out subtracted so that adding
+ * them back at the end leaves what the call added to them.  The finished
+ * counts are copied to the stats automaton_get_stats reports.
+ */
+
+#ifdef COLLECT_STATS
+// Adds sign times every counter kept outside the automaton to stats
+static void
+stats_add_counters (Automaton *automaton, Automaton_Stats *stats, int sign)
+{
+  Point_Set *sets[] = {
+    automaton->board_state, automaton->next_board, automaton->visited
+  };
+  Point_Set_Stats set_stats;
+  Hash_Life_Stats hash_stats;
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  stats->seconds  += sign * (now.tv_sec + now.tv_nsec / 1e9);
+  stats->searches += sign * (long) point_set_searches();
+
+  for (int worker = 0; automaton->stripes
+         && worker < automaton_get_threads(automaton); worker++)
+    {
+      point_set_get_stats(automaton->stripes[worker].cells, &set_stats);
+      stats->node_allocations += sign * (long) set_stats.node_allocations;
+      stats->node_frees       += sign * (long) set_stats.node_frees;
+    }
+  for (size_t i = 0; i < sizeof(sets) / sizeof(sets[0]); i++)
+    {
+      if (!sets[i])
+        continue;
+      point_set_get_stats(sets[i], &set_stats);
+      stats->node_allocations += sign * (long) set_stats.node_allocations;
+      stats->node_frees       += sign * (long) set_stats.node_frees;
+    }
+
+  if (automaton->hash_life)
+    {
+      hash_life_get_stats(automaton->hash_life, &hash_stats);
+      stats->node_allocations += sign * (long) hash_stats.node_allocations;
+      stats->node_frees       += sign * (long) hash_stats.node_frees;
+      stats->cells_evaluated  += sign * (long) hash_stats.cells_evaluated;
+    }
+  if (automaton->wavefront)
+    stats->cells_evaluated += sign
+      * (long) wavefront_evaluated(automaton->wavefront);
+}
+#endif
+
+static void
+stats_begin (Automaton *automaton)
+{
+#ifdef COLLECT_STATS
+  automaton->counting = (Automaton_Stats) { 0 };
+  stats_add_counters(automaton, &automaton->counting, -1);
+#else
+  (void) automaton;
+#endif
+}
+
+static void
+stats_end (Automaton *automaton, long generations)
+{
+#ifdef COLLECT_STATS
+  stats_add_counters(automaton, &automaton->counting, 1);
+  automaton->counting.generations = generations;
+  automaton->stats = automaton->counting;
+#else
+  (void) automaton;
+  (void) generations;
+#endif
+}
+
+/*
+ * CONSTRUCTION AND DESTRUCTION
+ */
+
+static Automaton *
+automaton_new_struct (const Rule *rule, Automaton_Type type, int height,
+                      int width, Automaton_Backend backend)
+{
+  Automaton *new_automaton = malloc(sizeof(Automaton));
+  if (!new_automaton)
+    goto done;
+
+  // initialize the automaton's members
+  new_automaton->height      = height;
+  new_automaton->width       = width;
+  new_automaton->type        = type;
+  new_automaton->rule        = *rule;
+  new_automaton->backend     = backend;
+  new_automaton->generation  = 0;
+  new_automaton->board_state = NULL;
+  new_automaton->tree_height = -1;
+  new_automaton->next_board  = NULL;
+  new_automaton->visited     = NULL;
+  new_automaton->grid        = NULL;
+  new_automaton->next_grid   = NULL;
+  new_automaton->tiles       = (struct TILES) { 0 };
+  new_automaton->hash_life   = NULL;
+  new_automaton->wavefront   = NULL;
+  new_automaton->pool        = NULL;
+  new_automaton->stripes     = NULL;
+  new_automaton->changes     = (struct CHANGES) { 0 };
+  new_automaton->stats       = (Automaton_Stats) { 0 };
+  new_automaton->counting    = (Automaton_Stats) { 0 };
+
+ done:
+  return new_automaton;
+}
+
+Automaton *
+automaton_create (Automaton_Type type, int height, int width)
+{
+  return automaton_create_backend(type, height, width, point_set_backend);
+}
+
+Automaton *
+automaton_create_backend (Automaton_Type type, int height, int width,
+                          Automaton_Backend backend)
+{
+  Rule rule;
+
+  type_rule(type, &rule);
+  return create_with_rule(&rule, type, height, width, backend);
+}
+
+Automaton *
+automaton_create_rule (const char *rule_string, int height, int width)
+{
+  Automaton *new_automaton = NULL;
+  Rule rule;
+
+  if (rule_parse(rule_string, &rule))
+    new_automaton = create_with_rule(&rule, rule_type(&rule), height, width,
+                                     point_set_backend);
+
+  return new_automaton;
+}
+
+static Automaton *
+create_with_rule (const Rule *rule, Automaton_Type type, int height,
+                  int width, Automaton_Backend backend)
+{
+  bool success = false;
+
+  if (!backend_supports_rule(backend, rule))
+    backend = fallback_backend(rule);
+
+  Automaton *new_automaton = automaton_new_struct(rule, type, height, width,
+                                                  backend);
+  if (!new_automaton)
+    goto done;
+
+  switch (backend)
+    {
+    case point_set_backend:
+    case sparse_backend:
+      new_automaton->board_state = point_set_create(sizeof(int), NULL);
+      new_automaton->next_board  = point_set_create(sizeof(int), NULL);
+      new_automaton->visited     = point_set_create(sizeof(char), NULL);
+      success = new_automaton->board_state && new_automaton->next_board
+        && new_automaton->visited;
+      break;
+    case dense_grid_backend:
+      success = rebuild_grids(new_automaton, height, width,
+                              rule->num_states - 1);
+      break;
+    case hashlife_backend:
+      new_automaton->hash_life = hash_life_create(rule->birth, rule->survival);
+      success = new_automaton->hash_life != NULL;
+      break;
+    case wavefront_backend:
+      new_automaton->wavefront = wavefront_create(height, width, rule);
+      success = new_automaton->wavefront != NULL;
+      break;
+    }
+
+  if (!success)
+    {
+      board_destroy(new_automaton);
+      free(new_automaton);
+      new_automaton = NULL;
+    }
+
+ done:
+  return new_automaton;
+}
+
+void
+automaton_destroy (Automaton *automaton)
+{
+  board_destroy(automaton);
+  threads_destroy(automaton->pool, automaton->stripes,
+                  automaton_get_threads(automaton));
+  free(automaton->changes.records);
+  free(automaton);
+}
+
+// Advances the board by a generation, without resetting the stats
+static bool
+update_state (Automaton *automaton)
+{
+  bool success = true;
+  Point_Set *next_state = automaton->next_board;
+
+  // the point set backends record their changes while updating
+  automaton->changes.size   = 0;
+  automaton->changes.failed = false;
+
+  switch (automaton->backend)
+    {
+    case point_set_backend:
+    case sparse_backend:
+      // the back buffer keeps its memory so refilling it allocates nothing
+      point_set_clear(next_state);
+      if (automaton->backend == point_set_backend)
+        {
+          success = next_board_state(automaton, next_state);
+          STATS_ADD(automaton->counting.cells_evaluated,
+                    (long) automaton->height * automaton->width);
+        }
+      else
+        {
+          success = next_sparse_state(automaton, next_state);
+          STATS_ADD(automaton->counting.cells_evaluated,
+                    (long) point_set_size(automaton->visited));
+        }
+      if (!success)
+        goto done;
+
+      // set the automaton's state to the next one
+      automaton->next_board  = automaton->board_state;
+      automaton->board_state = next_state;
+      automaton->tree_height = -1;
+      break;
+    case dense_grid_backend:
+      next_grid_state(automaton);
+      break;
+    case hashlife_backend:
+      success = hash_life_step(automaton->hash_life, 0);
+      break;
+    case wavefront_backend:
+      success = wavefront_step(automaton->wavefront);
+      break;
+    }
+
+  if (success)
+    automaton->generation++;
+  if (success && automaton->changes.enabled)
+    success = list_changes(automaton);
+
+ done:
+  return success;
+}
+
+bool
+automaton_update_state (Automaton *automaton)
+{
+  assert(automaton);
+
+  stats_begin(automaton);
+  bool success = update_state(automaton);
+  stats_end(automaton, 1);
+
+  return success;
+}
+
+bool
+automaton_step_n (Automaton *automaton, long generations)
+{
+  assert(automaton);
+  assert(generations >= 0);
+
+  bool success   = true;
+  bool tracking  = automaton->changes.enabled;
+  long requested = generations;
+
+  stats_begin(automaton);
+
+  // the change list is only written for the last step
+  automaton->changes.enabled = false;
+  automaton->changes.size    = 0;
+  automaton->changes.failed  = false;
+
+  if (automaton->backend == hashlife_backend)
+    {
+      bool stepped = generations > 0;
+
+      // take the largest power of two steps first
+      for (int step = HASH_LIFE_MAX_STEP; step >= 0 && success; step--)
+        {
+          while (success && generations >= (long) 1 << step)
+            {
+              success = hash_life_step(automaton->hash_life, step);
+              generations -= (long) 1 << step;
+              if (success)
+                automaton->generation += (long) 1 << step;
+            }
+        }
+
+      automaton->changes.enabled = tracking;
+      if (success && stepped && tracking)
+        success = list_changes(automaton);
+    }
+  else if (blocks_supported(automaton))
+    {
+      int single_updates = 0;
+
+      /*
+       * Blocking is only worth it while most tiles need evaluating, and
+       * after a block it takes three single updates before the tile counts
+       * show whether the board has settled again.  The last generation is
+       * always a single update so that its changes can be listed.
+       */
+      while (success && generations > 0)
+        {
+          struct TILES *tiles = &automaton->tiles;
+
+          if (single_updates == 0 && generations > 2
+              && tiles->evaluated >= tiles->skipped)
+            {
+              int block = generations - 1 < BLOCK_GENERATIONS
+                ? (int) generations - 1 : BLOCK_GENERATIONS;
+              next_grid_blocks(automaton, block);
+              generations   -= block;
+              automaton->generation += block;
+              single_updates = 3;
+            }
+          else
+            {
+              if (generations == 1)
+                automaton->changes.enabled = tracking;
+              success = update_state(automaton);
+              generations--;
+              if (single_updates > 0)
+                single_updates--;
+            }
+        }
+    }
+  else
+    {
+      for (long gen = 0; gen < generations && success; gen++)
+        {
+          if (gen == generations - 1)
+            automaton->changes.enabled = tracking;
+          success = update_state(automaton);
+        }
+    }
+
+  automaton->changes.enabled = tracking;
+  stats_end(automaton, requested);
+  return success;
+}
+
+/*
+ * GETTERS
+ */
+
+struct RECT_VISIT
+{
+  void (*fn)(int y, int x, int state, void *ctx);
+  void *ctx;
+};
+
+/*
+ * The automaton passes its (y, x) as a point set's (x, y), so the set calls
+ * back with the automaton's y in its x parameter, named y here, and its x in
+ * its y parameter
+ */
+static void
+visit_point (int y, int x, void *data, void *ctx)
+{
+  struct RECT_VISIT *visit = ctx;
+  visit->fn(y, x, *(int *) data, visit->ctx);
+}
+
+static void
+visit_hash_life_cell (int64_t y, int64_t x, void *ctx)
+{
+  struct RECT_VISIT *visit = ctx;
+
+  if (fits_int(y, x))
+    visit->fn(y, x, 1, visit->ctx);
+}
+
+static void
+grid_foreach_in_rect (Automaton *automaton, int y_min, int x_min, int y_max,
+                      int x_max, struct RECT_VISIT *visit)
+{
+  Grid *grid = automaton->grid;
+  int row_min = y_min + automaton->height / 2;
+  int row_max = y_max + automaton->height / 2;
+  int col_min = x_min + automaton->width / 2;
+  int col_max = x_max + automaton->width / 2;
+
+  // clip the rectangle to the grid
+  if (row_min < 0)
+    row_min = 0;
+  if (row_max >= grid->height)
+    row_max = grid->height - 1;
+  if (col_min < 0)
+    col_min = 0;
+  if (col_max >= grid->width)
+    col_max = grid->width - 1;
+  if (row_min > row_max || col_min > col_max)
+    return;
+
+  for (int row = row_min; row <= row_max; row++)
+    {
+      for (int word = col_min / GRID_WORD_BITS;
+           word <= col_max / GRID_WORD_BITS; word++)
+        {
+          uint64_t any  = 0;
+          uint64_t mask = ~UINT64_C(0);
+          int first     = word * GRID_WORD_BITS;
+
+          if (first < col_min)
+            mask &= ~UINT64_C(0) << (col_min - first);
+          if (col_max - first < GRID_WORD_BITS - 1)
+            mask &= ~UINT64_C(0) >> (GRID_WORD_BITS - 1 - (col_max - first));
+
+          for (int plane = 0; plane < grid->planes; plane++)
+            any |= grid_row(grid, plane, row)[word] & mask;
+
+          // visit the set bits of every plane in column order
+          while (any)
+            {
+              int bit   = __builtin_ctzll(any);
+              int state = 1;
+              while (!((grid_row(grid, state - 1, row)[word] >> bit) & 1))
+                state++;
+              visit->fn(row - automaton->height / 2,
+                        first + bit - automaton->width / 2, state,
+                        visit->ctx);
+              any &= any - 1;
+            }
+        }
+    }
+}
+
+void
+automaton_foreach_in_rect (Automaton *automaton, int y_min, int x_min,
+                           int y_max, int x_max,
+                           void (*fn)(int y, int x, int state, void *ctx),
+                           void *ctx)
+{
+  assert(automaton);
+  assert(fn);
+
+  struct RECT_VISIT visit = { fn, ctx };
+
+  switch (automaton->backend)
+    {
+    case point_set_backend:
+    case sparse_backend:
+      point_set_foreach_in_rect(automaton->board_state, y_min, x_min, y_max,
+                                x_max, visit_point, &visit);
+      break;
+    case dense_grid_backend:
+      grid_foreach_in_rect(automaton, y_min, x_min, y_max, x_max, &visit);
+      break;
+    case hashlife_backend:
+      hash_life_foreach_in_rect(automaton->hash_life, y_min, x_min, y_max,
+                                x_max, visit_hash_life_cell, &visit);
+      break;
+    case wavefront_backend:
+      wavefront_foreach_in_rect(automaton->wavefront, y_min, x_min, y_max,
+                                x_max, fn, ctx);
+      break;
+    }
+}
+
+long
+automaton_get_population (Automaton *automaton)
+{
+  assert(automaton);
+
+  long population = 0;
+  Grid *grid;
+
+  switch (automaton->backend)
+    {
+    case point_set_backend:
+    case sparse_backend:
+      population = point_set_size(automaton->board_state);
+      break;
+    case dense_grid_backend:
+      grid = automaton->grid;
+      for (int plane = 0; plane < grid->planes; plane++)
+        for (int row = 0; row < grid->height; row++)
+          for (size_t word = 0; word < grid->words; word++)
+            population += __builtin_popcountll(grid_row(grid, plane,
+                                                        row)[word]);
+      break;
+    case hashlife_backend:
+      population = hash_life_population(automaton->hash_life);
+      break;
+    case wavefront_backend:
+      population = wavefront_population(automaton->wavefront);
+      break;
+    }
+
+  return population;
+}
+
+int
+automaton_get_width (Automaton *automaton)
+{
+  return automaton->width;
+}
+
+int
+automaton_get_height (Automaton *automaton)
+{
+  return automaton->height;
+}
+
+Automaton_Backend
+automaton_get_backend (Automaton *automaton)
+{
+  return automaton->backend;
+}
+
+Automaton_Type
+automaton_get_type (Automaton *automaton)
+{
+  return automaton->type;
+}
+
+long
+automaton_get_generation (Automaton *automaton)
+{
+  return automaton->generation;
+}
+
+size_t
+automaton_get_rule (Automaton *automaton, char *buffer, size_t size)
+{
+  return rule_format(&automaton->rule, buffer, size);
+}
+
+int
+automaton_get_threads (Automaton *automaton)
+{
+  return automaton->pool ? thread_pool_size(automaton->pool) : 1;
 }
 
-static int
-next_state_brians_brain (Automaton *automaton, int y, int x)
+const Automaton_Change *
+automaton_get_changes (Automaton *automaton, size_t *count)
 {
-  int next_state    = 0;
-  int current_state = automaton_get_state(automaton, y, x);
-  int on_neighbours = check_moore_neighbourhood(automaton, y, x, 1);
-
-  if (current_state == 1)
-    next_state = 2;
-  else if (current_state == 2)
-    next_state = 0;
-  else if (on_neighbours == 2)
-    next_state = 1;
+  *count = automaton->changes.size;
+  return automaton->changes.records;
+}
 
-  return next_state;
+void
+automaton_get_tile_counts (Automaton *automaton, long *evaluated,
+                           long *skipped)
+{
+  *evaluated = automaton->tiles.evaluated;
+  *skipped   = automaton->tiles.skipped;
 }
 
-static int
-next_state_day_and_night (Automaton *automaton, int y, int x)
+bool
+automaton_get_stats (Automaton *automaton, Automaton_Stats *stats)
 {
-  int next_state      = 0;
-  int current_state   = automaton_get_state(automaton, y, x);
-  int live_neighbours = check_moore_neighbourhood(automaton, y, x, 1);
+  assert(automaton);
+  assert(stats);
+
+  Hash_Life_Stats hash_stats;
 
-  /* B3678/S34678 */
-  if ((current_state && (live_neighbours == 3 || live_neighbours == 4
-                         || live_neighbours == 6 || live_neighbours == 7
-                         || live_neighbours == 8))
-      || (!current_state && (live_neighbours == 3 || live_neighbours == 6
-                             || live_neighbours == 7 || live_neighbours == 8)))
-    next_state = 1;
+  *stats = automaton->stats;
+  stats->population  = automaton_get_population(automaton);
+  stats->tree_height = 0;
+  switch (automaton->backend)
+    {
+    case point_set_backend:
+    case sparse_backend:
+      // the walk is only made once for each board
+      if (automaton->tree_height < 0)
+        automaton->tree_height = point_set_height(automaton->board_state);
+      stats->tree_height = automaton->tree_height;
+      break;
+    case hashlife_backend:
+      hash_life_get_stats(automaton->hash_life, &hash_stats);
+      stats->tree_height = hash_stats.level;
+      break;
+    case dense_grid_backend:
+    case wavefront_backend:
+      break;
+    }
 
-  return next_state;
+  return STATS_ENABLED;
 }
 
-static Point_Set *
-next_board_state (Automaton *automaton)
+int
+automaton_get_state (Automaton *automaton, int y, int x)
 {
-  Point_Set *next_state = point_set_create(sizeof(int), free);
-  if (!next_state)
-    goto done;
+  int state = 0;
+  int *state_ptr;
 
-  for (int y = -automaton->height / 2;
-       y < automaton->height - automaton->height / 2; y++)
+  switch (automaton->backend)
     {
-      for (int x = -automaton->width / 2;
-           x < automaton->width - automaton->width / 2; x++)
-        {
-          int cell_state = 0;
-
-          // Get the next state of the cell according to the automaton's type
-          switch (automaton->type)
-            {
-            case seeds:
-              cell_state = next_state_seeds(automaton, y, x);
-              break;
-            case game_of_life:
-              cell_state = next_state_life(automaton, y, x);
-              break;
-            case highlife:
-              cell_state = next_state_highlife(automaton, y, x);
-              break;
-            case greenberg_hastings:
-              cell_state = next_state_greenberg_hastings(automaton, y, x);
-              break;
-            case brians_brain:
-              cell_state = next_state_brians_brain(automaton, y, x);
-              break;
-            case day_and_night:
-              cell_state = next_state_day_and_night(automaton, y, x);
-              break;
-            }
-          
-          // Any point not in the point set is assumed to be zero
-          if (cell_state)
-            point_set_insert(next_state, y, x, &cell_state);
-        }
+    case point_set_backend:
+    case sparse_backend:
+      state_ptr = point_set_search(automaton->board_state, y, x);
+      if (state_ptr)
+        state = *state_ptr;
+      break;
+    case dense_grid_backend:
+      state = grid_get(automaton->grid, y + automaton->height / 2,
+                       x + automaton->width / 2);
+      break;
+    case hashlife_backend:
+      state = hash_life_get(automaton->hash_life, y, x);
+      break;
+    case wavefront_backend:
+      state = wavefront_get(automaton->wavefront, y, x);
+      break;
     }
 
- done:
-  return next_state;
+  return state;
 }
 
 /*
- * CONSTRUCTION AND DESTRUCTION
+ * SETTERS
  */
 
-static Automaton *
-automaton_new_struct (Automaton_Type type, int height, int width)
+// Whether a cell lies inside the borders and the state is one of the rule's
+static bool
+valid_cell (Automaton *automaton, int y, int x, int state)
 {
-  Automaton *new_automaton = malloc(sizeof(Automaton));
-  if (!new_automaton)
-    goto done;
+  return state >= 0 && state < automaton->rule.num_states
+    && y >= -automaton->height / 2
+    && y < automaton->height - automaton->height / 2
+    && x >= -automaton->width / 2
+    && x < automaton->width - automaton->width / 2;
+}
 
-  // initialize the automaton's members
-  new_automaton->height = height;
-  new_automaton->width  = width;
-  new_automaton->type   = type;
+bool
+automaton_set_state (Automaton *automaton, int y, int x, int state)
+{
+  bool success = valid_cell(automaton, y, x, state);
 
- done:
-  return new_automaton;
+  /* set the cell's state */
+  if (success)
+    board_set(automaton, y, x, state);
+
+  return success;
 }
 
-Automaton *
-automaton_create (Automaton_Type type, int height, int width)
+/*
+ * Builds an empty point set board out of cells sorted by row and then
+ * column, which is the order the set keeps its points in.  Returns false
+ * without touching the board if they aren't in order.
+ */
+static bool
+load_point_set (Automaton *automaton, const Automaton_Change *cells,
+                size_t count)
 {
-  Automaton *new_automaton = automaton_new_struct(type, height, width);
-  if (!new_automaton)
+  bool success = false;
+  size_t live  = 0;
+  Point_Set_Entry *entries = malloc(sizeof(Point_Set_Entry)
+                                    * (count ? count : 1));
+  if (!entries)
     goto done;
 
-  new_automaton->board_state = point_set_create(sizeof(int), free);
-  if (!new_automaton->board_state)
+  // the points of the board are keyed on y first
+  for (size_t i = 0; i < count; i++)
     {
-      free(new_automaton);
-      new_automaton = NULL;
+      if (cells[i].state)
+        entries[live++] = (Point_Set_Entry) {
+          cells[i].y, cells[i].x, &cells[i].state
+        };
     }
+  success = point_set_load_sorted(automaton->board_state, entries, live);
+  automaton->tree_height = -1;
+  free(entries);
 
  done:
-  return new_automaton;
-}
-
-void
-automaton_destroy (Automaton *automaton)
-{
-  point_set_destroy(automaton->board_state);
-  free(automaton);
+  return success;
 }
 
 bool
-automaton_update_state (Automaton *automaton)
+automaton_set_cells (Automaton *automaton, const Automaton_Change *cells,
+                     size_t count)
 {
   assert(automaton);
-  assert(automaton->board_state);
-  
+  assert(cells || count == 0);
+
   bool success = true;
-  Point_Set *next_state;
 
-  next_state = next_board_state(automaton);
-  if (!next_state)
-    {
-      success = false;
-      goto done;
-    }
+  for (size_t i = 0; i < count && success; i++)
+    success = valid_cell(automaton, cells[i].y, cells[i].x, cells[i].state);
+  if (!success)
+    goto done;
 
-  // set the automaton's state to the next one
-  point_set_destroy(automaton->board_state);
-  automaton->board_state = next_state;
+  if ((automaton->backend == point_set_backend
+       || automaton->backend == sparse_backend)
+      && point_set_size(automaton->board_state) == 0
+      && load_point_set(automaton, cells, count))
+    goto done;
+
+  for (size_t i = 0; i < count; i++)
+    board_set(automaton, cells[i].y, cells[i].x, cells[i].state);
 
  done:
   return success;
 }
 
-/*
- * GETTERS
- */
+struct HASH_LIFE_COPY
+{
+  Hash_Life *hash_life;
+  bool failed;
+};
 
-int
-automaton_get_width (Automaton *automaton)
+static void
+copy_to_hash_life (int y, int x, int state, void *ctx)
 {
-  return automaton->width;
+  struct HASH_LIFE_COPY *copy = ctx;
+
+  if (!hash_life_set(copy->hash_life, y, x, state))
+    copy->failed = true;
 }
 
-int
-automaton_get_height (Automaton *automaton)
+/*
+ * Adds the board to the given universe and makes it the automaton's board,
+ * switching to the hashlife backend.  The automaton is left untouched if the
+ * board can't be added.
+ */
+static bool
+adopt_hash_life (Automaton *automaton, Hash_Life *universe)
 {
-  return automaton->height;
+  struct HASH_LIFE_COPY copy = { universe, false };
+
+  automaton_foreach_in_rect(automaton, -automaton->height / 2,
+                            -automaton->width / 2,
+                            automaton->height - automaton->height / 2 - 1,
+                            automaton->width - automaton->width / 2 - 1,
+                            copy_to_hash_life, &copy);
+  if (copy.failed)
+    return false;
+
+  board_destroy(automaton);
+  automaton->backend   = hashlife_backend;
+  automaton->hash_life = universe;
+  return true;
 }
 
-int
-automaton_get_state (Automaton *automaton, int y, int x)
+static void
+list_hash_life_cell (int64_t y, int64_t x, void *ctx)
 {
-  int state = 0;
+  changes_push(ctx, y, x, 1);
+}
 
-  int *state_ptr = point_set_search(automaton->board_state, y, x);
-  if (state_ptr)
-    state = *state_ptr;
+// Orders cells by y and then x, the order automaton_set_cells loads fastest
+static int
+compare_cells (const void *a, const void *b)
+{
+  const Automaton_Change *first  = a;
+  const Automaton_Change *second = b;
 
-  return state;
+  if (first->y != second->y)
+    return first->y < second->y ? -1 : 1;
+  return (first->x > second->x) - (first->x < second->x);
 }
 
-/*
- * SETTERS
- */
-
 bool
-automaton_set_state (Automaton *automaton, int y, int x, int state)
+automaton_load_macrocell (Automaton *automaton, const char *text,
+                          size_t length)
 {
-  bool success = true;
+  assert(automaton);
+  assert(text || length == 0);
 
-  /* check whether the state is valid */
-  switch (automaton->type)
-    {
-    case game_of_life:
-    case highlife:
-    case seeds:
-    case day_and_night:
-      success = state == 0 || state == 1;
-      break;
-    case greenberg_hastings:
-    case brians_brain:
-      success = state == 0 || state == 1 || state == 2;
-      break;
-    }
-  if (!success)
-    goto done;
+  bool success            = false;
+  struct CHANGES on_board = { 0 };
+  Hash_Life *pattern      = NULL;
 
-  /* check whether the cell is valid */
-  if (y < -automaton->height / 2
-      || y > automaton->height - automaton->height / 2
-      || x < -automaton->width / 2
-      || x > automaton->width - automaton->width / 2)
+  if (automaton->backend != hashlife_backend)
     {
-      success = false;
+      pattern = hash_life_create(automaton->rule.birth,
+                                 automaton->rule.survival);
+      if (!pattern || !hash_life_read_macrocell(pattern, text, length))
+        goto done;
+
+      hash_life_foreach_in_rect(pattern, -automaton->height / 2,
+                                -automaton->width / 2,
+                                automaton->height - automaton->height / 2 - 1,
+                                automaton->width - automaton->width / 2 - 1,
+                                list_hash_life_cell, &on_board);
+      if (on_board.failed)
+        goto done;
+
+      // a pattern that fits on the board is expanded into its cells
+      if (on_board.size == hash_life_population(pattern))
+        {
+          qsort(on_board.records, on_board.size, sizeof(Automaton_Change),
+                compare_cells);
+          success = automaton_set_cells(automaton, on_board.records,
+                                        on_board.size);
+          goto done;
+        }
+
+      // and one that doesn't is only kept whole by the hashlife backend
+      success = backend_supports_rule(hashlife_backend, &automaton->rule)
+        && adopt_hash_life(automaton, pattern);
+      if (success)
+        pattern = NULL;
       goto done;
     }
 
-  /* set the cell's state */
-  if (state == 0)
-    point_set_delete(automaton->board_state, y, x);
-  else
+  success = hash_life_read_macrocell(automaton->hash_life, text, length);
+
+ done:
+  if (pattern)
+    hash_life_destroy(pattern);
+  free(on_board.records);
+  return success;
+}
+
+bool
+automaton_save_macrocell (Automaton *automaton, FILE *file)
+{
+  assert(automaton);
+  assert(file);
+
+  bool success = false;
+  struct HASH_LIFE_COPY copy = { NULL, false };
+
+  if (automaton->backend == hashlife_backend)
     {
-      int *curr_state = point_set_search(automaton->board_state, y, x);
-      if (!curr_state)
-        point_set_insert(automaton->board_state, y, x, &state);
-      else
-        *curr_state = state;
+      success = hash_life_write_macrocell(automaton->hash_life, file);
+      goto done;
     }
-  
+  if (automaton->rule.num_states > 2)
+    goto done;
+
+  // the board is copied into a universe of its own to be written
+  copy.hash_life = hash_life_create(automaton->rule.birth,
+                                    automaton->rule.survival);
+  if (!copy.hash_life)
+    goto done;
+
+  automaton_foreach_in_rect(automaton, -automaton->height / 2,
+                            -automaton->width / 2,
+                            automaton->height - automaton->height / 2 - 1,
+                            automaton->width - automaton->width / 2 - 1,
+                            copy_to_hash_life, &copy);
+  success = !copy.failed && hash_life_write_macrocell(copy.hash_life, file);
+
  done:
+  if (copy.hash_life)
+    hash_life_destroy(copy.hash_life);
   return success;
 }
 /*
@@ -380,7 +2191,7 @@ automaton_set_board_state (Automaton *automaton, int height, int width, int **bo
   assert(board);
   
   bool success         = false;
-  Point_Set *new_board = point_set_create(sizeof(int), free);
+  Point_Set *new_board = point_set_create(sizeof(int), NULL);
   if (!new_board)
     goto done;
 
@@ -429,28 +2240,134 @@ bool
 automaton_random_state (Automaton *automaton)
 {
   assert(automaton);
-  assert(automaton->board_state);
 
+  bool success   = false;
+  int num_states = automaton->rule.num_states;
+
+  if (!automaton_dead_state(automaton))
+    goto done;
+
+  for (int y = -automaton->height / 2;
+       y < automaton->height - automaton->height / 2; y++)
+    {
+      for (int x = -automaton->width / 2;
+           x < automaton->width - automaton->width / 2; x++)
+        {
+          int state = rand() % num_states;
+          if (state)
+            board_set(automaton, y, x, state);
+        }
+    }
+  success = true;
+
+ done:
+  return success;
+}
+
+bool
+automaton_set_border (Automaton *automaton, int height, int width)
+{
+  bool resized = height != automaton->height || width != automaton->width;
+  bool success = true;
+
+  // the size is only taken once the boards it bounds have been resized
+  if (automaton->backend == dense_grid_backend && resized)
+    success = rebuild_grids(automaton, height, width,
+                            automaton->grid->planes);
+  else if (automaton->backend == wavefront_backend && resized)
+    success = wavefront_resize(automaton->wavefront, height, width);
+
+  if (success)
+    {
+      automaton->height = height;
+      automaton->width  = width;
+    }
+
+  return success;
+}
+
+/* The cells of a point set board kept under a rule with fewer states */
+struct PRUNE
+{
+  Point_Set *into;
+  int num_states;
+  bool failed;
+};
+
+static void
+prune_point (int y, int x, void *data, void *ctx)
+{
+  struct PRUNE *prune = ctx;
+
+  if (*(int *) data < prune->num_states
+      && !point_set_insert(prune->into, y, x, data))
+    prune->failed = true;
+}
+
+/*
+ * Drops the cells of a point set board in states the given number of states
+ * doesn't have, as the dense grid drops their bit planes.  The board is left
+ * untouched if there's no memory for the pruned one.
+ */
+static bool
+prune_board (Automaton *automaton, int num_states)
+{
+  struct PRUNE prune = { automaton->next_board, num_states, false };
+
+  point_set_clear(prune.into);
+  point_set_foreach(automaton->board_state, prune_point, &prune);
+  if (!prune.failed)
+    {
+      automaton->next_board  = automaton->board_state;
+      automaton->board_state = prune.into;
+      automaton->tree_height = -1;
+    }
+
+  return !prune.failed;
+}
+
+/*
+ * Switches the automaton over to a new rule, changing backend if need be.
+ * The automaton is left untouched if there's no memory for the new board.
+ */
+static bool
+apply_rule (Automaton *automaton, const Rule *rule)
+{
   bool success = false;
-  Point_Set *new_state;
+  int planes   = rule->num_states - 1;
 
-  switch (automaton->type)
+  // a converted board is already built for the rule
+  if (!backend_supports_rule(automaton->backend, rule))
     {
-    case game_of_life:
-    case seeds:
-    case highlife:
-    case day_and_night:
-      new_state = random_state(automaton->height, automaton->width, 2);
-      break;
-    case greenberg_hastings:
-    case brians_brain:
-      new_state = random_state(automaton->height, automaton->width, 3);
+      if (!convert_backend(automaton, rule, fallback_backend(rule)))
+        goto done;
+    }
+
+  // every non-dead state needs its own bit plane
+  if (automaton->backend == dense_grid_backend
+      && planes != automaton->grid->planes)
+    {
+      if (!rebuild_grids(automaton, automaton->height, automaton->width,
+                         planes))
+        goto done;
+    }
+  else if (automaton->backend == dense_grid_backend)
+    tiles_mark_all(automaton);
+  else if ((automaton->backend == point_set_backend
+            || automaton->backend == sparse_backend)
+           && rule->num_states < automaton->rule.num_states)
+    {
+      if (!prune_board(automaton, rule->num_states))
+        goto done;
     }
-  if (!new_state)
-    goto done;
 
-  free(automaton->board_state);
-  automaton->board_state = new_state;
+  if (automaton->backend == hashlife_backend)
+    hash_life_set_rule(automaton->hash_life, rule->birth, rule->survival);
+  else if (automaton->backend == wavefront_backend)
+    wavefront_set_rule(automaton->wavefront, rule);
+
+  automaton->rule = *rule;
+  automaton->type = rule_type(rule);
   success = true;
 
  done:
@@ -458,65 +2375,136 @@ automaton_random_state (Automaton *automaton)
 }
 
 void
-automaton_set_border (Automaton *automaton, int height, int width)
+automaton_set_generation (Automaton *automaton, long generation)
 {
-  automaton->height = height;
-  automaton->width = width;
+  assert(automaton);
+  assert(generation >= 0);
+
+  automaton->generation = generation;
 }
 
-void
+bool
 automaton_set_type (Automaton *automaton, Automaton_Type type)
 {
-  automaton->type = type;
+  Rule rule;
+
+  // a custom rule can only be set from its rulestring
+  if (type == custom_rule)
+    return true;
+
+  type_rule(type, &rule);
+  return apply_rule(automaton, &rule);
+}
+
+bool
+automaton_set_rule (Automaton *automaton, const char *rule_string)
+{
+  bool success = false;
+  Rule rule;
+
+  if (!rule_parse(rule_string, &rule))
+    goto done;
+
+  success = apply_rule(automaton, &rule);
+
+ done:
+  return success;
 }
 
-void
-automaton_cycle_state (Automaton *automaton, int y, int x)
+bool
+automaton_set_threads (Automaton *automaton, int threads)
 {
-  assert(automaton);
-  assert(automaton->board_state);
+  assert(threads > 0);
 
-  static const int live  = 1;
+  bool success           = false;
+  Thread_Pool *pool      = NULL;
+  struct STRIPE *stripes = NULL;
 
-  int *value = point_set_search(automaton->board_state, y, x);
+  if (threads == automaton_get_threads(automaton))
+    {
+      success = true;
+      goto done;
+    }
 
-  /* Dead state to live */
-  if (!value)
-    point_set_insert(automaton->board_state, y, x, &live);
-  else if ((*value) == 1)
+  if (threads > 1)
     {
-      switch (automaton->type)
+      pool    = thread_pool_create(threads);
+      // keep every worker's deque on its own cache line
+      stripes = aligned_alloc(WORK_DEQUE_ALIGN,
+                              sizeof(struct STRIPE) * threads);
+      if (!pool || !stripes)
+        goto err;
+      memset(stripes, 0, sizeof(struct STRIPE) * threads);
+
+      for (int worker = 0; worker < threads; worker++)
         {
-        case game_of_life:
-        case seeds:
-        case highlife:
-        case day_and_night:
-          point_set_delete(automaton->board_state, y, x);
-          break;
-        case greenberg_hastings:
-        case brians_brain:
-          ++(*value);
+          stripes[worker].cells = point_set_create(sizeof(int), NULL);
+          if (!stripes[worker].cells)
+            goto err;
         }
     }
+
+  threads_destroy(automaton->pool, automaton->stripes,
+                  automaton_get_threads(automaton));
+  automaton->pool    = pool;
+  automaton->stripes = stripes;
+  success = true;
+  goto done;
+
+ err:
+  threads_destroy(pool, stripes, threads);
+ done:
+  return success;
+}
+
+void
+automaton_set_change_tracking (Automaton *automaton, bool enabled)
+{
+  automaton->changes.enabled = enabled;
+  automaton->changes.size    = 0;
+}
+
+void
+automaton_cycle_state (Automaton *automaton, int y, int x)
+{
+  assert(automaton);
+
+  int state = automaton_get_state(automaton, y, x);
+
+  /* Dead state to live, live to dying for three state automata */
+  if (state + 1 < automaton->rule.num_states)
+    board_set(automaton, y, x, state + 1);
   else
-    point_set_delete(automaton->board_state, y, x);
+    board_set(automaton, y, x, 0);
 }
 
 bool
 automaton_dead_state (Automaton *automaton)
 {
   assert(automaton);
-  assert(automaton->board_state);
 
-  bool success          = false;
-  Point_Set *dead_state = point_set_create(sizeof(int), free);
-  if (!dead_state)
-    goto done;
+  bool success = false;
 
-  point_set_destroy(automaton->board_state);
-  automaton->board_state = dead_state;
+  switch (automaton->backend)
+    {
+    case point_set_backend:
+    case sparse_backend:
+      point_set_clear(automaton->board_state);
+      automaton->tree_height = -1;
+      break;
+    case dense_grid_backend:
+      grid_clear(automaton->grid);
+      tiles_mark_all(automaton);
+      break;
+    case hashlife_backend:
+      hash_life_clear(automaton->hash_life);
+      break;
+    case wavefront_backend:
+      wavefront_clear(automaton->wavefront);
+      break;
+    }
+  automaton->generation = 0;
   success = true;
 
- done:
   return success;
 }
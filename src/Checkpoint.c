@@ -0,0 +1,485 @@
+#include "Checkpoint.h"
+#include "Codec.h"
+#include "Rule.h"
+#include <assert.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static const char magic[8] = { 'L', 'I', 'F', 'E', 'C', 'K', 'P', 'T' };
+
+/* A copy of an automaton taken to be written later */
+struct SNAPSHOT
+{
+  Automaton_Type type;
+  Automaton_Backend backend;
+  int height;
+  int width;
+  long generation;
+  char rule[RULE_STRING_MAX];
+  int num_states;
+  Automaton_Change *cells;  /* in the order the automaton visited them */
+  size_t size;
+  size_t capacity;
+  bool failed;              /* a cell didn't fit in memory */
+  char *universe;           /* the Macrocell text of a hashlife universe */
+  size_t universe_size;
+  char *path;
+};
+
+struct CHECKPOINTER
+{
+  pthread_t thread;
+  pthread_mutex_t lock;       /* guards everything below */
+  pthread_cond_t changed;     /* signalled when the fields below change */
+  struct SNAPSHOT *pending;   /* the next checkpoint to write, if any */
+  bool writing;               /* a checkpoint is being written */
+  bool failed;                /* a checkpoint since the last wait failed */
+  bool stopping;
+};
+
+/*
+ * SNAPSHOTS
+ */
+
+static void
+snapshot_destroy (struct SNAPSHOT *snapshot)
+{
+  free(snapshot->cells);
+  free(snapshot->universe);
+  free(snapshot->path);
+  free(snapshot);
+}
+
+static void
+copy_cell (int y, int x, int state, void *ctx)
+{
+  struct SNAPSHOT *snapshot = ctx;
+
+  if (snapshot->size == snapshot->capacity)
+    {
+      size_t capacity = snapshot->capacity ? snapshot->capacity * 2 : 1024;
+      Automaton_Change *cells = realloc(snapshot->cells,
+                                        capacity * sizeof(Automaton_Change));
+      if (!cells)
+        {
+          snapshot->failed = true;
+          return;
+        }
+      snapshot->cells    = cells;
+      snapshot->capacity = capacity;
+    }
+
+  snapshot->cells[snapshot->size++] = (Automaton_Change) { y, x, state };
+}
+
+/*
+ * Writes a hashlife universe to the snapshot as Macrocell text, which keeps
+ * the cells that have left the board along with the rest
+ */
+static bool
+copy_universe (struct SNAPSHOT *snapshot, Automaton *automaton)
+{
+  FILE *fp = open_memstream(&snapshot->universe, &snapshot->universe_size);
+  if (!fp)
+    return false;
+
+  bool success = automaton_save_macrocell(automaton, fp);
+  return fclose(fp) == 0 && success;
+}
+
+// Copies the automaton, returns NULL if there wasn't the memory to
+static struct SNAPSHOT *
+snapshot_create (Automaton *automaton, const char *path)
+{
+  struct SNAPSHOT *snapshot = calloc(1, sizeof(struct SNAPSHOT));
+  Rule rule;
+
+  if (!snapshot)
+    goto done;
+
+  snapshot->type       = automaton_get_type(automaton);
+  snapshot->backend    = automaton_get_backend(automaton);
+  snapshot->height     = automaton_get_height(automaton);
+  snapshot->width      = automaton_get_width(automaton);
+  snapshot->generation = automaton_get_generation(automaton);
+  automaton_get_rule(automaton, snapshot->rule, sizeof(snapshot->rule));
+  rule_parse(snapshot->rule, &rule);
+  snapshot->num_states = rule.num_states;
+  snapshot->path       = strdup(path);
+  if (!snapshot->path)
+    goto err;
+
+  if (snapshot->backend == hashlife_backend)
+    {
+      if (!copy_universe(snapshot, automaton))
+        goto err;
+      goto done;
+    }
+
+  automaton_foreach_in_rect(automaton, -snapshot->height / 2,
+                            -snapshot->width / 2,
+                            snapshot->height - snapshot->height / 2 - 1,
+                            snapshot->width - snapshot->width / 2 - 1,
+                            copy_cell, snapshot);
+  if (snapshot->failed)
+    goto err;
+
+ done:
+  return snapshot;
+
+ err:
+  snapshot_destroy(snapshot);
+  return NULL;
+}
+
+/*
+ * ENCODING
+ */
+
+static void
+encode_snapshot (struct SNAPSHOT *snapshot, Codec_Buffer *buffer)
+{
+  size_t rule_length = strlen(snapshot->rule);
+
+  // backends that don't visit their cells in row-major order are sorted here,
+  // off the thread that copied them
+  codec_sort_cells(snapshot->cells, snapshot->size);
+
+  codec_put(buffer, magic, sizeof(magic));
+  codec_put_varint(buffer, CHECKPOINT_VERSION);
+  codec_put_varint(buffer, snapshot->type);
+  codec_put_varint(buffer, snapshot->backend);
+  codec_put_varint(buffer, snapshot->height);
+  codec_put_varint(buffer, snapshot->width);
+  codec_put_varint(buffer, snapshot->generation);
+  codec_put_varint(buffer, rule_length);
+  codec_put(buffer, snapshot->rule, rule_length);
+  if (snapshot->universe)
+    {
+      codec_put_varint(buffer, snapshot->universe_size);
+      codec_put(buffer, snapshot->universe, snapshot->universe_size);
+    }
+  else
+    {
+      codec_put_varint(buffer, snapshot->size);
+      codec_put_cells(buffer, snapshot->cells, snapshot->size,
+                      snapshot->height, snapshot->width,
+                      snapshot->num_states > 2);
+    }
+
+  uint32_t crc = codec_crc32(0, buffer->bytes, buffer->size);
+  uint8_t checksum[4] = { crc, crc >> 8, crc >> 16, crc >> 24 };
+  codec_put(buffer, checksum, sizeof(checksum));
+}
+
+// Writes the snapshot beside its path, then moves it over the old checkpoint
+static bool
+write_snapshot (struct SNAPSHOT *snapshot)
+{
+  bool success = false;
+  Codec_Buffer buffer = { NULL, 0, 0, false };
+  size_t length = strlen(snapshot->path);
+  char *temporary = malloc(length + sizeof(".tmp"));
+  FILE *fp;
+
+  if (!temporary)
+    goto done;
+  memcpy(temporary, snapshot->path, length);
+  memcpy(temporary + length, ".tmp", sizeof(".tmp"));
+
+  encode_snapshot(snapshot, &buffer);
+  if (buffer.failed)
+    goto done;
+
+  fp = fopen(temporary, "wb");
+  if (!fp)
+    goto done;
+
+  // the data must be on disk before the rename can make it the checkpoint
+  success = fwrite(buffer.bytes, 1, buffer.size, fp) == buffer.size
+    && fflush(fp) == 0 && fsync(fileno(fp)) == 0;
+  success = fclose(fp) == 0 && success;
+  success = success && rename(temporary, snapshot->path) == 0;
+  if (!success)
+    remove(temporary);
+
+ done:
+  free(buffer.bytes);
+  free(temporary);
+  return success;
+}
+
+/*
+ * DECODING
+ */
+
+static bool
+read_file (const char *path, uint8_t **bytes, size_t *size)
+{
+  bool success = false;
+  FILE *fp = fopen(path, "rb");
+  long length;
+
+  *bytes = NULL;
+  if (!fp)
+    goto done;
+
+  if (fseek(fp, 0, SEEK_END) != 0 || (length = ftell(fp)) < 0
+      || fseek(fp, 0, SEEK_SET) != 0)
+    goto err;
+
+  *size  = length;
+  *bytes = malloc(length ? length : 1);
+  success = *bytes && fread(*bytes, 1, length, fp) == (size_t) length;
+
+ err:
+  fclose(fp);
+ done:
+  return success;
+}
+
+// Sets the cells of a restored automaton, false if any is out of place
+static bool
+decode_cells (Automaton *automaton, Codec_Reader *reader, int num_states)
+{
+  bool success = false;
+  uint64_t count;
+  Automaton_Change *cells = NULL;
+
+  // every cell takes at least two bytes
+  if (!codec_get_varint(reader, (reader->end - reader->next) / 2, &count))
+    goto done;
+
+  cells = malloc(sizeof(Automaton_Change) * (count ? count : 1));
+  if (!cells)
+    goto done;
+
+  success = codec_get_cells(reader, cells, count,
+                            automaton_get_height(automaton),
+                            automaton_get_width(automaton),
+                            num_states > 2 ? num_states - 1 : 0)
+    && reader->next == reader->end
+    && automaton_set_cells(automaton, cells, count);
+
+ done:
+  free(cells);
+  return success;
+}
+
+// Adds the universe of a restored hashlife automaton, false if it's damaged
+static bool
+decode_universe (Automaton *automaton, Codec_Reader *reader)
+{
+  uint64_t size;
+
+  return codec_get_varint(reader, reader->end - reader->next, &size)
+    && reader->next + size == reader->end
+    && automaton_load_macrocell(automaton, (const char *) reader->next, size);
+}
+
+/*
+ * BACKGROUND THREAD
+ */
+
+static void *
+checkpointer_main (void *arg)
+{
+  Checkpointer *checkpointer = arg;
+
+  pthread_mutex_lock(&checkpointer->lock);
+  for (;;)
+    {
+      while (!checkpointer->pending && !checkpointer->stopping)
+        pthread_cond_wait(&checkpointer->changed, &checkpointer->lock);
+      // a checkpoint still waiting is written before stopping
+      if (!checkpointer->pending)
+        break;
+
+      struct SNAPSHOT *snapshot = checkpointer->pending;
+      checkpointer->pending = NULL;
+      checkpointer->writing = true;
+      pthread_mutex_unlock(&checkpointer->lock);
+
+      bool success = write_snapshot(snapshot);
+      snapshot_destroy(snapshot);
+
+      pthread_mutex_lock(&checkpointer->lock);
+      checkpointer->writing = false;
+      if (!success)
+        checkpointer->failed = true;
+      pthread_cond_broadcast(&checkpointer->changed);
+    }
+  pthread_mutex_unlock(&checkpointer->lock);
+
+  return NULL;
+}
+
+/*
+ * Definitions for the interface functions found in the header
+ */
+
+bool
+automaton_save_checkpoint (Automaton *automaton, const char *path)
+{
+  assert(automaton);
+  assert(path);
+
+  bool success = false;
+  struct SNAPSHOT *snapshot = snapshot_create(automaton, path);
+  if (!snapshot)
+    goto done;
+
+  success = write_snapshot(snapshot);
+  snapshot_destroy(snapshot);
+
+ done:
+  return success;
+}
+
+Automaton *
+automaton_load_checkpoint (const char *path)
+{
+  assert(path);
+
+  Automaton *automaton = NULL;
+  Codec_Reader reader;
+  uint64_t version, type, backend, height, width, generation, rule_length;
+  char rule_string[RULE_STRING_MAX];
+  uint8_t *bytes;
+  size_t size;
+  Rule rule;
+
+  if (!read_file(path, &bytes, &size) || size < sizeof(magic) + 4
+      || memcmp(bytes, magic, sizeof(magic)) != 0)
+    goto done;
+
+  const uint8_t *checksum = bytes + size - 4;
+  uint32_t crc = checksum[0] | checksum[1] << 8 | checksum[2] << 16
+    | (uint32_t) checksum[3] << 24;
+  if (codec_crc32(0, bytes, size - 4) != crc)
+    goto done;
+
+  reader = (Codec_Reader) { bytes + sizeof(magic), checksum };
+  if (!codec_get_varint(&reader, CHECKPOINT_VERSION, &version)
+      || version != CHECKPOINT_VERSION
+      || !codec_get_varint(&reader, custom_rule, &type)
+      || !codec_get_varint(&reader, wavefront_backend, &backend)
+      || !codec_get_varint(&reader, INT_MAX, &height) || height == 0
+      || !codec_get_varint(&reader, INT_MAX, &width) || width == 0
+      || !codec_get_varint(&reader, LONG_MAX, &generation)
+      || !codec_get_varint(&reader, RULE_STRING_MAX - 1, &rule_length)
+      || (size_t) (reader.end - reader.next) < rule_length)
+    goto done;
+
+  memcpy(rule_string, reader.next, rule_length);
+  rule_string[rule_length] = '\0';
+  reader.next += rule_length;
+  if (!rule_parse(rule_string, &rule))
+    goto done;
+
+  // the backend is chosen before the rule, which it falls back from if it
+  // can't run it just as it did when the checkpoint was saved
+  automaton = automaton_create_backend(game_of_life, height, width, backend);
+  if (!automaton)
+    goto done;
+  if (!automaton_set_rule(automaton, rule_string)
+      || automaton_get_type(automaton) != (Automaton_Type) type)
+    goto err;
+
+  if (backend == hashlife_backend
+      ? !decode_universe(automaton, &reader)
+      : !decode_cells(automaton, &reader, rule.num_states))
+    goto err;
+
+  automaton_set_generation(automaton, generation);
+  goto done;
+
+ err:
+  automaton_destroy(automaton);
+  automaton = NULL;
+ done:
+  free(bytes);
+  return automaton;
+}
+
+Checkpointer *
+checkpointer_create (void)
+{
+  Checkpointer *checkpointer = malloc(sizeof(Checkpointer));
+  if (!checkpointer)
+    goto done;
+
+  checkpointer->pending  = NULL;
+  checkpointer->writing  = false;
+  checkpointer->failed   = false;
+  checkpointer->stopping = false;
+  pthread_mutex_init(&checkpointer->lock, NULL);
+  pthread_cond_init(&checkpointer->changed, NULL);
+
+  if (pthread_create(&checkpointer->thread, NULL, checkpointer_main,
+                     checkpointer) != 0)
+    goto err;
+  goto done;
+
+ err:
+  pthread_mutex_destroy(&checkpointer->lock);
+  pthread_cond_destroy(&checkpointer->changed);
+  free(checkpointer);
+  checkpointer = NULL;
+ done:
+  return checkpointer;
+}
+
+void
+checkpointer_destroy (Checkpointer *checkpointer)
+{
+  pthread_mutex_lock(&checkpointer->lock);
+  checkpointer->stopping = true;
+  pthread_cond_broadcast(&checkpointer->changed);
+  pthread_mutex_unlock(&checkpointer->lock);
+
+  pthread_join(checkpointer->thread, NULL);
+
+  pthread_mutex_destroy(&checkpointer->lock);
+  pthread_cond_destroy(&checkpointer->changed);
+  free(checkpointer);
+}
+
+bool
+checkpointer_save (Checkpointer *checkpointer, Automaton *automaton,
+                   const char *path)
+{
+  assert(automaton);
+  assert(path);
+
+  struct SNAPSHOT *snapshot = snapshot_create(automaton, path);
+  if (!snapshot)
+    return false;
+
+  pthread_mutex_lock(&checkpointer->lock);
+  if (checkpointer->pending)
+    snapshot_destroy(checkpointer->pending);
+  checkpointer->pending = snapshot;
+  pthread_cond_broadcast(&checkpointer->changed);
+  pthread_mutex_unlock(&checkpointer->lock);
+
+  return true;
+}
+
+bool
+checkpointer_wait (Checkpointer *checkpointer)
+{
+  pthread_mutex_lock(&checkpointer->lock);
+  while (checkpointer->pending || checkpointer->writing)
+    pthread_cond_wait(&checkpointer->changed, &checkpointer->lock);
+  bool success = !checkpointer->failed;
+  checkpointer->failed = false;
+  pthread_mutex_unlock(&checkpointer->lock);
+
+  return success;
+}
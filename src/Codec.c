@@ -0,0 +1,331 @@
+#include "Codec.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MIN_MATCH 4
+#define MAX_OFFSET 65535
+#define HASH_BITS 12
+
+/*
+ * BUFFERS
+ */
+
+void
+codec_put (Codec_Buffer *buffer, const void *bytes, size_t size)
+{
+  if (buffer->size + size > buffer->capacity)
+    {
+      size_t capacity = buffer->capacity ? buffer->capacity : 256;
+      while (capacity < buffer->size + size)
+        capacity *= 2;
+
+      uint8_t *grown = realloc(buffer->bytes, capacity);
+      if (!grown)
+        {
+          buffer->failed = true;
+          return;
+        }
+      buffer->bytes    = grown;
+      buffer->capacity = capacity;
+    }
+
+  memcpy(buffer->bytes + buffer->size, bytes, size);
+  buffer->size += size;
+}
+
+void
+codec_put_varint (Codec_Buffer *buffer, uint64_t value)
+{
+  uint8_t bytes[10];
+  size_t size = 0;
+
+  while (value >= 0x80)
+    {
+      bytes[size++] = (value & 0x7F) | 0x80;
+      value >>= 7;
+    }
+  bytes[size++] = value;
+  codec_put(buffer, bytes, size);
+}
+
+void
+codec_put_cells (Codec_Buffer *buffer, const Automaton_Change *cells,
+                 size_t count, int height, int width, bool states)
+{
+  long prev_row = 0;
+  long prev_col = -1;
+
+  for (size_t i = 0; i < count; i++)
+    {
+      long row = cells[i].y + height / 2;
+      long col = cells[i].x + width / 2;
+
+      codec_put_varint(buffer, row - prev_row);
+      codec_put_varint(buffer, row == prev_row ? col - prev_col - 1 : col);
+      if (states)
+        codec_put_varint(buffer, cells[i].state);
+      prev_row = row;
+      prev_col = col;
+    }
+}
+
+/*
+ * READERS
+ */
+
+bool
+codec_get_varint (Codec_Reader *reader, uint64_t max, uint64_t *value)
+{
+  *value = 0;
+  for (int shift = 0; reader->next < reader->end && shift < 64; shift += 7)
+    {
+      uint8_t byte = *reader->next++;
+      *value |= (uint64_t) (byte & 0x7F) << shift;
+      if (!(byte & 0x80))
+        return *value <= max;
+    }
+
+  return false;
+}
+
+bool
+codec_get_cells (Codec_Reader *reader, Automaton_Change *cells, size_t count,
+                 int height, int width, int max_state)
+{
+  uint64_t row_gap, col_gap, state = 1;
+  uint64_t row = 0;
+  int64_t col  = -1;
+
+  for (size_t i = 0; i < count; i++)
+    {
+      if (!codec_get_varint(reader, height - row, &row_gap)
+          || !codec_get_varint(reader, width, &col_gap)
+          || (max_state && !codec_get_varint(reader, max_state, &state)))
+        return false;
+
+      row += row_gap;
+      col  = row_gap ? (int64_t) col_gap : col + 1 + (int64_t) col_gap;
+      if (row >= (uint64_t) height || col >= width)
+        return false;
+
+      cells[i] = (Automaton_Change) {
+        (int) row - height / 2, (int) col - width / 2, (int) state
+      };
+    }
+
+  return true;
+}
+
+// Orders cells by y and then x
+static int
+compare_cells (const void *a, const void *b)
+{
+  const Automaton_Change *first  = a;
+  const Automaton_Change *second = b;
+
+  if (first->y != second->y)
+    return first->y < second->y ? -1 : 1;
+  return (first->x > second->x) - (first->x < second->x);
+}
+
+void
+codec_sort_cells (Automaton_Change *cells, size_t count)
+{
+  // an empty list may have no array at all, which qsort mustn't be given
+  if (count > 0)
+    qsort(cells, count, sizeof(Automaton_Change), compare_cells);
+}
+
+/*
+ * CRC-32
+ *
+ * Computed a byte at a time from a table built on first use.
+ */
+
+static uint32_t crc_table[256];
+static pthread_once_t crc_once = PTHREAD_ONCE_INIT;
+
+static void
+init_crc_table (void)
+{
+  for (uint32_t n = 0; n < 256; n++)
+    {
+      uint32_t crc = n;
+      for (int bit = 0; bit < 8; bit++)
+        crc = crc & 1 ? 0xEDB88320u ^ (crc >> 1) : crc >> 1;
+      crc_table[n] = crc;
+    }
+}
+
+uint32_t
+codec_crc32 (uint32_t crc, const uint8_t *bytes, size_t size)
+{
+  crc ^= 0xFFFFFFFFu;
+  pthread_once(&crc_once, init_crc_table);
+  for (size_t i = 0; i < size; i++)
+    crc = crc_table[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+
+  return crc ^ 0xFFFFFFFFu;
+}
+
+/*
+ * COMPRESSION
+ *
+ * Matches are found greedily through a table of the last position each hash
+ * of 4 bytes was seen at, which is fast and does well on the long runs of
+ * small varints that cell lists are made of.
+ */
+
+static uint32_t
+read32 (const uint8_t *bytes)
+{
+  uint32_t value;
+  memcpy(&value, bytes, sizeof(value));
+  return value;
+}
+
+static size_t
+hash4 (uint32_t value)
+{
+  return (value * 2654435761u) >> (32 - HASH_BITS);
+}
+
+// Writes what's left of a length that didn't fit in its nibble
+static uint8_t *
+put_length (uint8_t *out, size_t length)
+{
+  for (; length >= 255; length -= 255)
+    *out++ = 255;
+  *out++ = length;
+  return out;
+}
+
+// Writes a sequence, the last of a block having a match length of 0
+static uint8_t *
+put_sequence (uint8_t *out, const uint8_t *literals, size_t num_literals,
+              size_t match_length, size_t offset)
+{
+  size_t match = match_length ? match_length - MIN_MATCH : 0;
+
+  *out++ = (num_literals < 15 ? num_literals : 15) << 4
+    | (match < 15 ? match : 15);
+  if (num_literals >= 15)
+    out = put_length(out, num_literals - 15);
+  memcpy(out, literals, num_literals);
+  out += num_literals;
+
+  if (match_length)
+    {
+      *out++ = offset;
+      *out++ = offset >> 8;
+      if (match >= 15)
+        out = put_length(out, match - 15);
+    }
+
+  return out;
+}
+
+// Reads a length whose nibble was 15, false if it runs off the end
+static bool
+get_length (const uint8_t **in, const uint8_t *end, size_t *length)
+{
+  uint8_t byte;
+
+  do
+    {
+      if (*in == end)
+        return false;
+      byte     = *(*in)++;
+      *length += byte;
+    }
+  while (byte == 255);
+
+  return true;
+}
+
+size_t
+codec_compress_bound (size_t size)
+{
+  return size + size / 255 + 16;
+}
+
+size_t
+codec_compress (const uint8_t *in, size_t size, uint8_t *out)
+{
+  size_t table[1 << HASH_BITS] = { 0 };
+  uint8_t *start = out;
+  size_t anchor  = 0;
+  size_t pos     = 0;
+
+  while (pos + MIN_MATCH <= size)
+    {
+      uint32_t sequence = read32(in + pos);
+      size_t hash       = hash4(sequence);
+      size_t candidate  = table[hash];
+
+      table[hash] = pos;
+      if (candidate < pos && pos - candidate <= MAX_OFFSET
+          && read32(in + candidate) == sequence)
+        {
+          size_t length = MIN_MATCH;
+          while (pos + length < size
+                 && in[candidate + length] == in[pos + length])
+            length++;
+
+          out = put_sequence(out, in + anchor, pos - anchor, length,
+                             pos - candidate);
+          pos   += length;
+          anchor = pos;
+        }
+      else
+        pos++;
+    }
+
+  out = put_sequence(out, in + anchor, size - anchor, 0, 0);
+  return out - start;
+}
+
+bool
+codec_decompress (const uint8_t *in, size_t size, uint8_t *out,
+                  size_t out_size)
+{
+  const uint8_t *end = in + size;
+  size_t produced    = 0;
+
+  // every block ends with a sequence of literals alone, so one cut short
+  // after a match is caught
+  while (in < end)
+    {
+      uint8_t token   = *in++;
+      size_t literals = token >> 4;
+      size_t match    = token & 0xF;
+
+      if (literals == 15 && !get_length(&in, end, &literals))
+        return false;
+      if ((size_t) (end - in) < literals || out_size - produced < literals)
+        return false;
+      memcpy(out + produced, in, literals);
+      in       += literals;
+      produced += literals;
+
+      if (in == end)
+        return produced == out_size;
+
+      if (end - in < 2)
+        return false;
+      size_t offset = in[0] | in[1] << 8;
+      in += 2;
+      if (match == 15 && !get_length(&in, end, &match))
+        return false;
+      match += MIN_MATCH;
+      if (offset == 0 || offset > produced || out_size - produced < match)
+        return false;
+
+      // the match may overlap the bytes it produces, so it's copied in order
+      for (size_t i = 0; i < match; i++, produced++)
+        out[produced] = out[produced - offset];
+    }
+
+  return false;
+}
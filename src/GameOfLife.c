@@ -1,6 +1,15 @@
+#include "Batch.h"
 #include "CellularAutomaton.h"
+#include "Pattern.h"
+#include "Renderer.h"
+#include "Replay.h"
+#include "Simulation.h"
 #include "String.h"
+#include <locale.h>
+#include <stdio.h>
 #include <ncurses.h>
+#include <pthread.h>
+#include <stdatomic.h>
 #include <stdlib.h>
 #include <time.h>
 #include <assert.h>
@@ -8,13 +17,41 @@
 
 #define MENU_WIDTH 25
 #define MENU_HEIGHT 10
+#define FRAME_MS 16     /* how often the board is redrawn while running */
+#define STATS_WIDTH 30
+#define STATS_HEIGHT 9
 
-static char controls_msg[] = "F1 Exit   F2 Toggle Menu   ";
+static char controls_msg[] = "F1 Exit   F2 Toggle Menu   F3 Cycle Glyphs   F4 Stats   -/+ Speed   ";
 static char input_controls[] = "ARROWS Move   SPACE Cycle State   ENTER Start Automaton";
+static char replay_controls[] = "F1 Exit   F3 Cycle Glyphs   -/+ Speed   SPACE Pause   LEFT/RIGHT Seek   ";
 
 static Automaton *life;
+static Renderer *renderer;
+static Simulation *simulation;
 static String *input_buffer;
 
+/* Target speeds in generations per second, 0 being as fast as possible */
+static const double speeds[] = { 1, 2, 4, 8, 15, 30, 60, 120, 240, 480, 0 };
+static const int num_speeds  = 11;
+static int speed_choice      = 0;
+
+/* Counts behind the speed readout since it was last shown */
+static struct
+{
+  struct timespec since;
+  long generations;
+  int frames;
+} readout;
+
+/* The stats of the last generation captured, shared with the simulation */
+static struct
+{
+  pthread_mutex_t lock;
+  Automaton_Stats stats;
+  bool collected;         /* whether the counters were compiled in */
+} frame_stats = { .lock = PTHREAD_MUTEX_INITIALIZER };
+static atomic_bool show_stats;
+
 /* State variables of our program */
 static bool collecting_input = false;
 static bool loading_file     = false;
@@ -23,6 +60,7 @@ static bool loading_file     = false;
 static WINDOW *life_win;
 static WINDOW *menu_win;
 static WINDOW *input_win;
+static WINDOW *stats_win;
 
 /*
  * FILE IO
@@ -51,88 +89,316 @@ print_invalid_file ()
   wrefresh(input_win);
 }
 
-bool
-load_file_state ()
+/*
+ * PRINTING TO SCREEN
+ */
+
+void
+print_basic_controls ()
 {
-  bool success = true;
-  int height;
-  int width;
-  FILE *fp;
+  clear();
+  printw(controls_msg);
+  refresh();
+}
 
-  fp = fopen(input_buffer->s, "r");
-  if (!fp)
-    {
-      success = false;
-      goto done;
-    }
+/* Starts counting the generations and frames shown by the readout afresh */
+void
+reset_readout ()
+{
+  clock_gettime(CLOCK_MONOTONIC, &readout.since);
+  readout.generations = simulation_get_generations(simulation);
+  readout.frames      = 0;
+}
+
+/* Shows the measured speed next to the controls about once a second */
+void
+update_readout (bool presented)
+{
+  struct timespec now;
+  double elapsed;
+
+  if (presented)
+    ++readout.frames;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  elapsed = (now.tv_sec - readout.since.tv_sec)
+    + (now.tv_nsec - readout.since.tv_nsec) / 1e9;
+  if (elapsed < 1)
+    return;
+
+  long generations = simulation_get_generations(simulation);
+  move(0, sizeof(controls_msg) - 1);
+  clrtoeol();
+  printw("%.1f gens/s (", (generations - readout.generations) / elapsed);
+  if (speeds[speed_choice] > 0)
+    printw("limit %g)   ", speeds[speed_choice]);
+  else
+    printw("no limit)   ");
+  printw("%.1f fps", readout.frames / elapsed);
+  refresh();
+
+  reset_readout();
+}
+
+/* Moves the target speed up or down the list of speeds */
+void
+change_speed (int step)
+{
+  speed_choice += step;
+  if (speed_choice < 0)
+    speed_choice = 0;
+  else if (speed_choice >= num_speeds)
+    speed_choice = num_speeds - 1;
+  if (simulation)
+    simulation_set_rate(simulation, speeds[speed_choice]);
+}
+
+/* Keeps the stats of the automaton's last generation for the overlay */
+static void
+copy_stats (Automaton *automaton)
+{
+  Automaton_Stats stats;
+  bool collected = automaton_get_stats(automaton, &stats);
+
+  pthread_mutex_lock(&frame_stats.lock);
+  frame_stats.stats     = stats;
+  frame_stats.collected = collected;
+  pthread_mutex_unlock(&frame_stats.lock);
+}
+
+/* The simulation's frame function, called on its thread */
+static void
+capture_frame (Automaton *automaton, void *ctx)
+{
+  renderer_capture(ctx, automaton);
+  if (atomic_load(&show_stats))
+    copy_stats(automaton);
+}
+
+/* Prints a counter of the overlay, or a dash if it wasn't collected */
+static void
+print_stat (int row, const char *label, long value, bool collected)
+{
+  if (collected)
+    mvwprintw(stats_win, row, 2, "%-12s %12ld", label, value);
+  else
+    mvwprintw(stats_win, row, 2, "%-12s %12s", label, "-");
+}
+
+/* Draws the stats of the last generation over the corner of the board */
+void
+print_stats ()
+{
+  Automaton_Stats stats;
+  bool collected;
+
+  pthread_mutex_lock(&frame_stats.lock);
+  stats     = frame_stats.stats;
+  collected = frame_stats.collected;
+  pthread_mutex_unlock(&frame_stats.lock);
+
+  // a step covers several generations, the overlay shows one
+  long generations = stats.generations > 0 ? stats.generations : 1;
+
+  werase(stats_win);
+  box(stats_win, 0, 0);
+  mvwprintw(stats_win, 0, 2, " Per generation ");
+  if (collected)
+    mvwprintw(stats_win, 1, 2, "%-12s %9.3f ms", "step time",
+              stats.seconds * 1e3 / generations);
+  else
+    mvwprintw(stats_win, 1, 2, "%-12s %12s", "step time", "-");
+  print_stat(2, "cells", stats.cells_evaluated / generations, collected);
+  print_stat(3, "searches", stats.searches / generations, collected);
+  print_stat(4, "node allocs", stats.node_allocations / generations,
+             collected);
+  print_stat(5, "node frees", stats.node_frees / generations, collected);
+  print_stat(6, "population", stats.population, true);
+  print_stat(7, "tree height", stats.tree_height, true);
+
+  // the board under the overlay may have been redrawn
+  touchwin(stats_win);
+  wnoutrefresh(stats_win);
+}
+
+/* Shows or hides the stats overlay */
+void
+toggle_stats ()
+{
+  atomic_store(&show_stats, !atomic_load(&show_stats));
+
+  // a paused automaton won't capture its stats until it runs again
+  if (atomic_load(&show_stats) && !simulation_is_running(simulation))
+    copy_stats(life);
+  renderer_invalidate(renderer);
+}
+
+/* Switches to the next way of packing cells the terminal can show */
+void
+cycle_render_mode ()
+{
+  Render_Mode mode = renderer_get_mode(renderer);
+
+  do
+    mode = (mode + 1) % (render_braille + 1);
+  while (!renderer_set_mode(renderer, mode));
+}
+
+/*
+ * REPLAY
+ *
+ * A log written by a recorded run is played back without the simulation,
+ * the player setting its automaton to each recorded board in turn.
+ */
 
-  /* first line of the file should contain the height followed by the width */
-  int rv = fscanf(fp, "%d %d\n", &height, &width);
-  if (rv != 2)
+/* Where playback is and how far behind the speed it has fallen */
+static struct
+{
+  struct timespec last;
+  double owed;            /* generations due but not yet played */
+  bool paused;
+} playback;
+
+static double
+seconds_since (struct timespec *since)
+{
+  struct timespec now;
+  double seconds;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  seconds = (now.tv_sec - since->tv_sec) + (now.tv_nsec - since->tv_nsec) / 1e9;
+  *since  = now;
+  return seconds;
+}
+
+/* Plays the generations due since the last frame */
+void
+advance_playback (Player *player)
+{
+  double seconds = seconds_since(&playback.last);
+  double rate    = speeds[speed_choice];
+
+  if (playback.paused)
+    return;
+
+  if (rate > 0)
     {
-      success = false;
-      goto err;
+      // a slow frame mustn't make the next ones rush to catch up
+      playback.owed += seconds * rate;
+      if (playback.owed > rate * FRAME_MS / 1e3 + 1)
+        playback.owed = rate * FRAME_MS / 1e3 + 1;
+      while (playback.owed >= 1 && player_step(player))
+        playback.owed -= 1;
     }
-  
-  int c = fgetc(fp);
-  for (int line = 0; line < height && c != EOF && success; ++line)
+  else
     {
-      for (int col = 0; col < width && c != EOF && c != '\n' && success; ++col)
-        {
-          switch (c)
-            {
-            case '0':
-              success = automaton_set_state(life, line - height / 2,
-                                            col - width / 2, 1);
-              break;
-            case '-':
-              success = automaton_set_state(life, line - height / 2,
-                                            col - width / 2, 2);
-              break;
-            }
-          c = fgetc(fp);
-        }
-      c = fgetc(fp);
+      // as many generations as fit in a frame
+      struct timespec start = playback.last;
+      while (seconds_since(&start) < FRAME_MS / 1e3 && player_step(player))
+        ;
     }
 
- err:
-  fclose(fp);
- done:
-  return success;
+  if (player_get_generation(player) == player_get_last_generation(player))
+    playback.owed = 0;
 }
 
-/*
- * PRINTING TO SCREEN
- */
-
+/* Jumps a twentieth of the log back or forth */
 void
-print_basic_controls ()
+seek_playback (Player *player, int direction)
 {
-  clear();
-  printw(controls_msg);
-  refresh();
+  long first  = player_get_first_generation(player);
+  long last   = player_get_last_generation(player);
+  long jump   = (last - first) / 20 > 0 ? (last - first) / 20 : 1;
+  long target = player_get_generation(player) + direction * jump;
+
+  if (target < first)
+    target = first;
+  else if (target > last)
+    target = last;
+  player_seek(player, target);
+  playback.owed = 0;
 }
 
+/* Shows the generation shown and the speed next to the controls */
 void
-render_automaton (Automaton *automaton)
+print_playback (Player *player)
 {
-  int height, width;
-  getmaxyx(life_win, height, width);
-  wclear(life_win);
+  move(0, sizeof(replay_controls) - 1);
+  clrtoeol();
+  printw("gen %ld/%ld ", player_get_generation(player),
+         player_get_last_generation(player));
+  if (playback.paused)
+    printw("(paused)");
+  else if (speeds[speed_choice] > 0)
+    printw("(%g gens/s)", speeds[speed_choice]);
+  else
+    printw("(no limit)");
+  wnoutrefresh(stdscr);
+}
+
+/* Plays a recorded run in the terminal, returns the exit status */
+int
+replay_main (const char *program, const char *path)
+{
+  Player *player = player_open(path);
 
-  for (int row = 0; row < height; row++)
+  if (!player)
     {
-      for (int col = 0; col < width; col++)
+      fprintf(stderr, "%s: can't play '%s'\n", program, path);
+      return EXIT_FAILURE;
+    }
+
+  setlocale(LC_ALL, "");
+  initscr();
+  cbreak();
+  curs_set(0);
+  keypad(stdscr, true);
+  timeout(FRAME_MS);
+  noecho();
+
+  printw(replay_controls);
+  refresh();
+  life_win = newwin(LINES - 1, COLS, 1, 0);
+  renderer = renderer_create(life_win, render_cells);
+  clock_gettime(CLOCK_MONOTONIC, &playback.last);
+
+  int key = ERR;
+  do
+    {
+      switch (key)
         {
-          int state = automaton_get_state(automaton, row - height / 2,
-                                          col - width / 2);
-          if (state)
-            {
-              wattrset(life_win, (state == 1) ? A_NORMAL : A_DIM);
-              mvwaddch(life_win, row, col, '#');
-            }
+        case KEY_F(3): /* Pack more cells into each character */
+          cycle_render_mode();
+          break;
+        case '-':
+        case '+':
+          change_speed(key == '+' ? 1 : -1);
+          playback.owed = 0;
+          break;
+        case ' ':
+          playback.paused = !playback.paused;
+          break;
+        case KEY_LEFT:
+        case KEY_RIGHT:
+          seek_playback(player, key == KEY_RIGHT ? 1 : -1);
+          break;
         }
+
+      advance_playback(player);
+      renderer_draw(renderer, player_get_automaton(player));
+      wnoutrefresh(life_win);
+      print_playback(player);
+      doupdate();
+
+      key = getch();
     }
+  while (key != KEY_F(1) && key != KEY_RESIZE);
+
+  renderer_destroy(renderer);
+  delwin(life_win);
+  endwin();
+  player_destroy(player);
+  return EXIT_SUCCESS;
 }
 
 /*
@@ -207,10 +473,10 @@ select_menu_option (int key)
         {
         case 0:/* generate a soup */
           automaton_random_state(life);
-          timeout(1000);
+          timeout(FRAME_MS);
           print_basic_controls();
           break;
-        case 1:/* load from a text file */
+        case 1:/* load from a pattern file */
           automaton_dead_state(life);
           print_basic_controls();
           loading_file = true;
@@ -258,6 +524,7 @@ get_user_state (WINDOW *life_win, Automaton *automaton, int key)
 {
   int height, width;
   int y, x;
+  int cell_y, cell_x;
   getmaxyx(life_win, height, width);
   getyx(life_win, y, x);
   
@@ -280,23 +547,32 @@ get_user_state (WINDOW *life_win, Automaton *automaton, int key)
         wmove(life_win, y, --x);
       break;
     case ' ':
-      automaton_cycle_state(automaton, y - height / 2, x - width / 2);
+      renderer_cell_at(renderer, y, x, &cell_y, &cell_x);
+      automaton_cycle_state(automaton, cell_y, cell_x);
     }
-  render_automaton(automaton);
+  renderer_draw(renderer, automaton);
   wmove(life_win, y, x);
 }
 
 int
-main ()
+main (int argc, char **argv)
 {
+  // a recorded run is played back, any other arguments ask for a
+  // headless run
+  if (argc == 3 && strcmp(argv[1], "--replay") == 0)
+    return replay_main(argv[0], argv[2]);
+  if (argc > 1)
+    return batch_main(argc, argv);
+
   // initialize menu struct
   menu.curr_choice       = 0;
   menu.is_automaton_menu = true;
   menu.is_open           = true;
   menu.num_choices       = num_automaton_choices;
   
-  // initialization curses
+  // initialization curses, the locale lets the renderer draw Unicode
   srand(time(NULL));
+  setlocale(LC_ALL, "");
   initscr();
   cbreak();
   curs_set(0);
@@ -308,7 +584,8 @@ main ()
   printw(controls_msg);
   refresh();
 
-  life         = automaton_create(game_of_life, (LINES - 1) * 2, COLS * 2);
+  life         = automaton_create_backend(game_of_life, (LINES - 1) * 2,
+                                          COLS * 2, dense_grid_backend);
   input_buffer = string_create();
 
   /* Initialize our windows */
@@ -316,13 +593,31 @@ main ()
   menu_win = newwin(MENU_HEIGHT, MENU_WIDTH, LINES / 2 - MENU_HEIGHT / 2,
                     COLS / 2 - MENU_WIDTH / 2);
   input_win = newwin(4, COLS, LINES / 2, 0);
+  stats_win = newwin(STATS_HEIGHT, STATS_WIDTH, 1, COLS - STATS_WIDTH);
+  leaveok(stats_win, true);
+  renderer  = renderer_create(life_win, render_cells);
+
+  /* The automaton runs on its own thread while the board is shown */
+  simulation = simulation_create(life, capture_frame, renderer);
+  simulation_set_rate(simulation, speeds[speed_choice]);
   
   /* Used a do while so that the menu gets displayed before asking for input */
-  int key;
+  int key = ERR;
   do
     { 
       switch (key)
         {
+        case KEY_F(3): /* Pack more cells into each character */
+          cycle_render_mode();
+          break;
+        case KEY_F(4): /* Toggle the stats overlay on/off */
+          toggle_stats();
+          break;
+        case '-':
+        case '+':
+          if (!loading_file)
+            change_speed(key == '+' ? 1 : -1);
+          break;
         case KEY_F(2): /* Toggle the menu on/off */
           menu.is_open = !menu.is_open;
           if (menu.is_open)
@@ -332,7 +627,7 @@ main ()
             }
           else
             {
-              timeout(1000);
+              timeout(FRAME_MS);
               if (collecting_input)
                 curs_set(1);
             }
@@ -344,19 +639,19 @@ main ()
             {
               collecting_input = false;
               curs_set(0);
-              timeout(1000);
+              timeout(FRAME_MS);
               print_basic_controls();
             }
           else if (loading_file)
             {
-              bool rv = load_file_state();
+              bool rv = pattern_load(life, input_buffer->s);
               string_clear(input_buffer);
               if (!rv)
                 print_invalid_file();
               else
                 {
                   loading_file = false;
-                  timeout(1000);
+                  timeout(FRAME_MS);
                 }
             }
           break;
@@ -378,24 +673,45 @@ main ()
           print_menu(menu_win);
         }  
       
+      // The automaton only runs while nothing else is using it
+      bool should_run = !menu.is_open && !loading_file && !collecting_input;
+      if (should_run && !simulation_is_running(simulation))
+        {
+          simulation_run(simulation);
+          reset_readout();
+        }
+      else if (!should_run && simulation_is_running(simulation))
+        simulation_pause(simulation);
+
       // The menu may have just been closed
       if (!menu.is_open && !loading_file)
         {
+          // a key press may have drawn other windows over the board
+          if (key != ERR)
+            renderer_invalidate(renderer);
+
+          // show the latest generation the simulation captured, if any,
+          // and ask for the one after the next frame
           if (!collecting_input)
             {
-              automaton_update_state(life);
-              render_automaton(life);
+              update_readout(renderer_present(renderer));
+              simulation_request_frame(simulation);
             }
           else
             get_user_state(life_win, life, key);
-          wrefresh(life_win);
+          wnoutrefresh(life_win);
+          if (atomic_load(&show_stats))
+            print_stats();
+          doupdate();
         }
 
       key = getch();
     }
   while (key != KEY_F(1) && key != KEY_RESIZE);
   
+  simulation_destroy(simulation);
   automaton_destroy(life);
+  renderer_destroy(renderer);
   string_destroy(input_buffer);
   endwin();
   return 0;
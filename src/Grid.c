@@ -0,0 +1,94 @@
+#include "Grid.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+Grid *
+grid_create (int height, int width, int planes)
+{
+  assert(height >= 0);
+  assert(width >= 0);
+  assert(planes > 0);
+
+  Grid *new_grid = malloc(sizeof(Grid));
+  if (!new_grid)
+    goto done;
+
+  new_grid->height = height;
+  new_grid->width  = width;
+  new_grid->planes = planes;
+  new_grid->words  = (width + GRID_WORD_BITS - 1) / GRID_WORD_BITS;
+  new_grid->stride = new_grid->words + 2;
+
+  // every plane gets a padding row above and below it
+  new_grid->cells = calloc((size_t) planes * (height + 2) * new_grid->stride,
+                           sizeof(uint64_t));
+  if (!new_grid->cells)
+    {
+      free(new_grid);
+      new_grid = NULL;
+    }
+
+ done:
+  return new_grid;
+}
+
+void
+grid_destroy (Grid *grid)
+{
+  free(grid->cells);
+  free(grid);
+}
+
+void
+grid_clear (Grid *grid)
+{
+  memset(grid->cells, 0, (size_t) grid->planes * (grid->height + 2)
+         * grid->stride * sizeof(uint64_t));
+}
+
+int
+grid_get (const Grid *grid, int row, int col)
+{
+  int state = 0;
+
+  if (row < 0 || row >= grid->height || col < 0 || col >= grid->width)
+    goto done;
+
+  for (int plane = 0; plane < grid->planes && !state; plane++)
+    {
+      uint64_t word = grid_row(grid, plane, row)[col / GRID_WORD_BITS];
+      if ((word >> (col % GRID_WORD_BITS)) & 1)
+        state = plane + 1;
+    }
+
+ done:
+  return state;
+}
+
+bool
+grid_set (Grid *grid, int row, int col, int state)
+{
+  bool success = true;
+
+  if (row < 0 || row >= grid->height || col < 0 || col >= grid->width
+      || state < 0 || state > grid->planes)
+    {
+      success = false;
+      goto done;
+    }
+
+  // a cell is only ever set in the plane matching its state
+  uint64_t bit = UINT64_C(1) << (col % GRID_WORD_BITS);
+  for (int plane = 0; plane < grid->planes; plane++)
+    {
+      uint64_t *word = &grid_row(grid, plane, row)[col / GRID_WORD_BITS];
+      if (plane + 1 == state)
+        *word |= bit;
+      else
+        *word &= ~bit;
+    }
+
+ done:
+  return success;
+}
@@ -0,0 +1,1082 @@
+#include "HashLife.h"
+#include "Stats.h"
+#include <assert.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* The tallest tree whose coordinates still fit in 64 bits */
+#define MAX_LEVEL 63
+
+/* Number of nodes carved out of each allocation */
+#define BLOCK_NODES 4096
+
+static const size_t INIT_BUCKETS      = 1 << 16;
+static const size_t INIT_GC_THRESHOLD = 1 << 20;
+
+typedef struct HL_NODE HL_Node;
+struct HL_NODE
+{
+  HL_Node *nw, *ne, *sw, *se;  /* quadrants, all NULL for a leaf */
+  HL_Node *result;             /* memoised centre after 2^result_step gens */
+  HL_Node *next;               /* next node in a hash chain or the free list */
+  uint64_t population;
+  int level;                   /* the node covers 2^level by 2^level cells */
+  int result_step;
+  bool marked;
+};
+
+typedef struct HL_BLOCK HL_Block;
+struct HL_BLOCK
+{
+  HL_Block *next;
+  HL_Node nodes[BLOCK_NODES];
+};
+
+struct HASH_LIFE
+{
+  HL_Node *root;               /* centred on the origin */
+  HL_Node *previous;           /* the root before the last step */
+  HL_Node dead_leaf;
+  HL_Node live_leaf;
+  HL_Node *empty[MAX_LEVEL + 1];
+  HL_Node **buckets;
+  size_t num_buckets;
+  size_t num_nodes;
+  size_t gc_threshold;         /* node count that triggers a collection */
+  HL_Node *free_list;
+  HL_Block *blocks;
+  uint16_t birth;
+  uint16_t survival;
+  Hash_Life_Stats stats;       /* the counters kept with COLLECT_STATS */
+};
+
+/*
+ * NODE CACHE
+ *
+ * Every node above the leaves is canonical: there is exactly one node for
+ * each combination of quadrants, found through a chained hash table.  Nodes
+ * are carved out of large blocks and recycled through a free list when the
+ * garbage collector sweeps them out of the table.
+ */
+
+static size_t
+node_hash (const HL_Node *nw, const HL_Node *ne, const HL_Node *sw,
+           const HL_Node *se)
+{
+  uint64_t hash = (uintptr_t) nw;
+  hash = hash * 0x9E3779B97F4A7C15u + (uintptr_t) ne;
+  hash = hash * 0x9E3779B97F4A7C15u + (uintptr_t) sw;
+  hash = hash * 0x9E3779B97F4A7C15u + (uintptr_t) se;
+  return (size_t) (hash ^ (hash >> 29));
+}
+
+static HL_Node *
+alloc_node (Hash_Life *hash_life)
+{
+  if (!hash_life->free_list)
+    {
+      HL_Block *block = malloc(sizeof(HL_Block));
+      if (!block)
+        return NULL;
+
+      block->next       = hash_life->blocks;
+      hash_life->blocks = block;
+      for (int i = 0; i < BLOCK_NODES; i++)
+        {
+          block->nodes[i].next = hash_life->free_list;
+          hash_life->free_list = &block->nodes[i];
+        }
+    }
+
+  HL_Node *node = hash_life->free_list;
+  hash_life->free_list = node->next;
+  STATS_ADD(hash_life->stats.node_allocations, 1);
+  return node;
+}
+
+// double the number of buckets, keeping the old table if we run out of memory
+static void
+grow_buckets (Hash_Life *hash_life)
+{
+  size_t num_buckets = hash_life->num_buckets * 2;
+  HL_Node **buckets  = calloc(num_buckets, sizeof(HL_Node *));
+  if (!buckets)
+    return;
+
+  for (size_t i = 0; i < hash_life->num_buckets; i++)
+    {
+      HL_Node *node = hash_life->buckets[i];
+      while (node)
+        {
+          HL_Node *next = node->next;
+          size_t bucket = node_hash(node->nw, node->ne, node->sw, node->se)
+            & (num_buckets - 1);
+          node->next       = buckets[bucket];
+          buckets[bucket]  = node;
+          node             = next;
+        }
+    }
+
+  free(hash_life->buckets);
+  hash_life->buckets     = buckets;
+  hash_life->num_buckets = num_buckets;
+}
+
+// Returns the canonical node with the given quadrants or NULL if out of memory
+static HL_Node *
+find_node (Hash_Life *hash_life, HL_Node *nw, HL_Node *ne, HL_Node *sw,
+           HL_Node *se)
+{
+  if (!nw || !ne || !sw || !se)
+    return NULL;
+
+  size_t bucket = node_hash(nw, ne, sw, se) & (hash_life->num_buckets - 1);
+  HL_Node *node = hash_life->buckets[bucket];
+
+  while (node && (node->nw != nw || node->ne != ne || node->sw != sw
+                  || node->se != se))
+    node = node->next;
+  if (node)
+    return node;
+
+  node = alloc_node(hash_life);
+  if (!node)
+    return NULL;
+
+  node->nw          = nw;
+  node->ne          = ne;
+  node->sw          = sw;
+  node->se          = se;
+  node->result      = NULL;
+  node->result_step = -1;
+  node->level       = nw->level + 1;
+  node->population  = nw->population + ne->population + sw->population
+    + se->population;
+  node->marked      = false;
+
+  node->next                   = hash_life->buckets[bucket];
+  hash_life->buckets[bucket]   = node;
+  if (++hash_life->num_nodes > hash_life->num_buckets)
+    grow_buckets(hash_life);
+
+  return node;
+}
+
+static HL_Node *
+empty_node (Hash_Life *hash_life, int level)
+{
+  if (!hash_life->empty[level])
+    {
+      HL_Node *child = empty_node(hash_life, level - 1);
+      hash_life->empty[level] = find_node(hash_life, child, child, child,
+                                          child);
+    }
+  return hash_life->empty[level];
+}
+
+/*
+ * GARBAGE COLLECTION
+ *
+ * Marks every node reachable from the root and the root before the last
+ * step, the empty nodes and the
+ * memoised results of those nodes, then sweeps everything else back onto the
+ * free list.  Collection only ever happens between steps because nodes built
+ * in the middle of a step are only referenced from the C stack.
+ */
+
+static void
+mark_node (HL_Node *node, bool keep_results)
+{
+  while (node && node->level > 0 && !node->marked)
+    {
+      node->marked = true;
+      mark_node(node->nw, keep_results);
+      mark_node(node->ne, keep_results);
+      mark_node(node->sw, keep_results);
+      if (keep_results)
+        mark_node(node->result, keep_results);
+      else
+        {
+          node->result      = NULL;
+          node->result_step = -1;
+        }
+      node = node->se;
+    }
+}
+
+static void
+sweep_nodes (Hash_Life *hash_life)
+{
+  for (size_t i = 0; i < hash_life->num_buckets; i++)
+    {
+      HL_Node **link = &hash_life->buckets[i];
+      while (*link)
+        {
+          HL_Node *node = *link;
+          if (node->marked)
+            {
+              node->marked = false;
+              link = &node->next;
+            }
+          else
+            {
+              *link = node->next;
+              node->next = hash_life->free_list;
+              hash_life->free_list = node;
+              --hash_life->num_nodes;
+              STATS_ADD(hash_life->stats.node_frees, 1);
+            }
+        }
+    }
+}
+
+static void
+collect_garbage (Hash_Life *hash_life, bool keep_results)
+{
+  mark_node(hash_life->root, keep_results);
+  mark_node(hash_life->previous, keep_results);
+  for (int level = 1; level <= MAX_LEVEL; level++)
+    mark_node(hash_life->empty[level], keep_results);
+  sweep_nodes(hash_life);
+}
+
+static void
+maybe_collect_garbage (Hash_Life *hash_life)
+{
+  if (hash_life->num_nodes < hash_life->gc_threshold)
+    return;
+
+  collect_garbage(hash_life, true);
+
+  /* still too big, so give up the memoised results as well */
+  if (hash_life->num_nodes > hash_life->gc_threshold / 2)
+    collect_garbage(hash_life, false);
+
+  /* the live pattern itself is large, so allow the cache to grow */
+  if (hash_life->num_nodes > hash_life->gc_threshold / 2)
+    hash_life->gc_threshold *= 2;
+}
+
+/*
+ * EVOLUTION
+ *
+ * A node of level n knows the state of its centre 2^(n-1) square for up to
+ * 2^(n-2) generations.  node_result computes that centre after 2^step
+ * generations by combining the results of nine overlapping sub-squares.
+ */
+
+static HL_Node *
+leaf (Hash_Life *hash_life, int state)
+{
+  return state ? &hash_life->live_leaf : &hash_life->dead_leaf;
+}
+
+// Advances a 4x4 node by one generation by brute force
+static HL_Node *
+base_result (Hash_Life *hash_life, HL_Node *node)
+{
+  HL_Node *quads[4] = { node->nw, node->ne, node->sw, node->se };
+  int cells[4][4];
+
+  for (int q = 0; q < 4; q++)
+    {
+      int row = (q / 2) * 2;
+      int col = (q % 2) * 2;
+      cells[row][col]         = quads[q]->nw->population != 0;
+      cells[row][col + 1]     = quads[q]->ne->population != 0;
+      cells[row + 1][col]     = quads[q]->sw->population != 0;
+      cells[row + 1][col + 1] = quads[q]->se->population != 0;
+    }
+
+  HL_Node *next[4];
+  for (int i = 0; i < 4; i++)
+    {
+      int row = 1 + i / 2;
+      int col = 1 + i % 2;
+      int live_neighbours = 0;
+
+      for (int y = row - 1; y <= row + 1; y++)
+        for (int x = col - 1; x <= col + 1; x++)
+          if (y != row || x != col)
+            live_neighbours += cells[y][x];
+
+      uint16_t mask = cells[row][col] ? hash_life->survival : hash_life->birth;
+      next[i] = leaf(hash_life, (mask >> live_neighbours) & 1);
+    }
+  STATS_ADD(hash_life->stats.cells_evaluated, 4);
+
+  return find_node(hash_life, next[0], next[1], next[2], next[3]);
+}
+
+static HL_Node *
+centre (Hash_Life *hash_life, HL_Node *node)
+{
+  if (!node)
+    return NULL;
+  return find_node(hash_life, node->nw->se, node->ne->sw, node->sw->ne,
+                   node->se->nw);
+}
+
+static HL_Node *
+node_result (Hash_Life *hash_life, HL_Node *node, int step)
+{
+  if (!node)
+    return NULL;
+
+  assert(node->level >= 2);
+  assert(step <= node->level - 2);
+
+  if (node->result && node->result_step == step)
+    return node->result;
+
+  HL_Node *result;
+  if (node->population == 0)
+    result = empty_node(hash_life, node->level - 1);
+  else if (node->level == 2)
+    result = base_result(hash_life, node);
+  else
+    {
+      HL_Node *nw = node->nw, *ne = node->ne, *sw = node->sw, *se = node->se;
+      HL_Node *sub[3][3] = {
+        { nw,
+          find_node(hash_life, nw->ne, ne->nw, nw->se, ne->sw),
+          ne },
+        { find_node(hash_life, nw->sw, nw->se, sw->nw, sw->ne),
+          find_node(hash_life, nw->se, ne->sw, sw->ne, se->nw),
+          find_node(hash_life, ne->sw, ne->se, se->nw, se->ne) },
+        { sw,
+          find_node(hash_life, sw->ne, se->nw, sw->se, se->sw),
+          se }
+      };
+
+      /* at full speed both halves advance, otherwise only the second does */
+      bool full_speed = step == node->level - 2;
+      int half_step   = full_speed ? step - 1 : step;
+
+      for (int i = 0; i < 3; i++)
+        for (int j = 0; j < 3; j++)
+          {
+            if (!sub[i][j])
+              return NULL;
+            sub[i][j] = full_speed ? node_result(hash_life, sub[i][j],
+                                                 half_step)
+              : centre(hash_life, sub[i][j]);
+            if (!sub[i][j])
+              return NULL;
+          }
+
+      HL_Node *quads[2][2];
+      for (int i = 0; i < 2; i++)
+        for (int j = 0; j < 2; j++)
+          {
+            HL_Node *quad = find_node(hash_life, sub[i][j], sub[i][j + 1],
+                                      sub[i + 1][j], sub[i + 1][j + 1]);
+            if (!quad)
+              return NULL;
+            quads[i][j] = node_result(hash_life, quad, half_step);
+          }
+
+      result = find_node(hash_life, quads[0][0], quads[0][1], quads[1][0],
+                         quads[1][1]);
+    }
+
+  if (result)
+    {
+      node->result      = result;
+      node->result_step = step;
+    }
+  return result;
+}
+
+/*
+ * ROOT MANAGEMENT
+ */
+
+// Surrounds the root with empty space, doubling its size around the origin
+static HL_Node *
+expand (Hash_Life *hash_life, HL_Node *root)
+{
+  if (root->level >= MAX_LEVEL)
+    return NULL;
+
+  HL_Node *border = empty_node(hash_life, root->level - 1);
+  return find_node(hash_life,
+                   find_node(hash_life, border, border, border, root->nw),
+                   find_node(hash_life, border, border, root->ne, border),
+                   find_node(hash_life, border, root->sw, border, border),
+                   find_node(hash_life, root->se, border, border, border));
+}
+
+// Whether every live cell lies in the centre half of the root
+static bool
+is_padded (HL_Node *root)
+{
+  return root->population == root->nw->se->population
+    + root->ne->sw->population + root->sw->ne->population
+    + root->se->nw->population;
+}
+
+static int64_t
+half_size (const HL_Node *node)
+{
+  return (int64_t) 1 << (node->level - 1);
+}
+
+static HL_Node *
+set_cell (Hash_Life *hash_life, HL_Node *node, int64_t y, int64_t x,
+          int state)
+{
+  if (node->level == 0)
+    return leaf(hash_life, state);
+
+  int64_t half = (int64_t) 1 << (node->level - 1);
+  HL_Node *nw = node->nw, *ne = node->ne, *sw = node->sw, *se = node->se;
+
+  if (y < half && x < half)
+    nw = set_cell(hash_life, nw, y, x, state);
+  else if (y < half)
+    ne = set_cell(hash_life, ne, y, x - half, state);
+  else if (x < half)
+    sw = set_cell(hash_life, sw, y - half, x, state);
+  else
+    se = set_cell(hash_life, se, y - half, x - half, state);
+
+  return find_node(hash_life, nw, ne, sw, se);
+}
+
+static void
+foreach_in_node (HL_Node *node, int64_t top, int64_t left, int64_t y_min,
+                 int64_t x_min, int64_t y_max, int64_t x_max,
+                 void (*fn)(int64_t y, int64_t x, void *ctx), void *ctx)
+{
+  int64_t last = (int64_t) ((UINT64_C(1) << node->level) - 1);
+
+  if (node->population == 0 || top > y_max || left > x_max
+      || top + last < y_min || left + last < x_min)
+    return;
+
+  if (node->level == 0)
+    {
+      fn(top, left, ctx);
+      return;
+    }
+
+  int64_t half = (int64_t) 1 << (node->level - 1);
+  foreach_in_node(node->nw, top, left, y_min, x_min, y_max, x_max, fn, ctx);
+  foreach_in_node(node->ne, top, left + half, y_min, x_min, y_max, x_max, fn,
+                  ctx);
+  foreach_in_node(node->sw, top + half, left, y_min, x_min, y_max, x_max, fn,
+                  ctx);
+  foreach_in_node(node->se, top + half, left + half, y_min, x_min, y_max,
+                  x_max, fn, ctx);
+}
+
+// Visits the cells that differ between two nodes of the same level
+static void
+foreach_change_in_node (HL_Node *old, HL_Node *new, int64_t top, int64_t left,
+                        void (*fn)(int64_t y, int64_t x, int state,
+                                   void *ctx),
+                        void *ctx)
+{
+  // canonical nodes with the same contents are the same node
+  if (old == new)
+    return;
+
+  if (new->level == 0)
+    {
+      fn(top, left, new->population != 0, ctx);
+      return;
+    }
+
+  int64_t half = (int64_t) 1 << (new->level - 1);
+  foreach_change_in_node(old->nw, new->nw, top, left, fn, ctx);
+  foreach_change_in_node(old->ne, new->ne, top, left + half, fn, ctx);
+  foreach_change_in_node(old->sw, new->sw, top + half, left, fn, ctx);
+  foreach_change_in_node(old->se, new->se, top + half, left + half, fn, ctx);
+}
+
+/*
+ * MACROCELL FORMAT
+ *
+ * A Macrocell file lists the distinct nodes of a quadtree bottom up, one per
+ * line, numbered from 1 in the order they appear.  A line starting with '.',
+ * '*' or '$' is an 8x8 node drawn a row at a time, '*' for a live cell and
+ * '$' ending a row, with trailing dead cells and rows left out.  Any other
+ * node is "level nw ne sw se", naming its quadrants by number and 0 for an
+ * empty quadrant.  At level 1 the quadrants are cell states instead.  The
+ * last node is the root, centred on the origin just like ours.
+ *
+ * Since every node is built with find_node, subtrees shared in the file are
+ * shared in the universe and a node is never expanded into its cells.
+ */
+
+/* The level of the nodes drawn as 8x8 cells */
+#define LEAF_LEVEL 3
+
+struct MC_READER
+{
+  const char *next;
+  const char *end;
+  HL_Node **nodes;          /* the nodes read so far, by number - 1 */
+  size_t count;
+  size_t capacity;
+};
+
+// Builds the node of a level covering the given corner of an 8x8 bitmap
+static HL_Node *
+bitmap_node (Hash_Life *hash_life, const uint8_t rows[8], int top, int left,
+             int level)
+{
+  if (level == 0)
+    return leaf(hash_life, (rows[top] >> left) & 1);
+
+  int half = 1 << (level - 1);
+  return find_node(hash_life,
+                   bitmap_node(hash_life, rows, top, left, level - 1),
+                   bitmap_node(hash_life, rows, top, left + half, level - 1),
+                   bitmap_node(hash_life, rows, top + half, left, level - 1),
+                   bitmap_node(hash_life, rows, top + half, left + half,
+                               level - 1));
+}
+
+// Reads an unsigned number after any spaces, false if there isn't one
+static bool
+read_number (struct MC_READER *reader, uint64_t *number)
+{
+  while (reader->next < reader->end && *reader->next == ' ')
+    reader->next++;
+  if (reader->next == reader->end || *reader->next < '0'
+      || *reader->next > '9')
+    return false;
+
+  *number = 0;
+  while (reader->next < reader->end && *reader->next >= '0'
+         && *reader->next <= '9')
+    {
+      if (*number > (UINT64_MAX - 9) / 10)
+        return false;
+      *number = *number * 10 + (*reader->next++ - '0');
+    }
+  return true;
+}
+
+// Whether the rest of the line is blank, moving past its end if it is
+static bool
+end_line (struct MC_READER *reader)
+{
+  while (reader->next < reader->end && (*reader->next == ' '
+                                        || *reader->next == '\r'))
+    reader->next++;
+  if (reader->next < reader->end && *reader->next != '\n')
+    return false;
+
+  if (reader->next < reader->end)
+    reader->next++;
+  return true;
+}
+
+static HL_Node *
+read_leaf (Hash_Life *hash_life, struct MC_READER *reader)
+{
+  uint8_t rows[8] = { 0 };
+  int y = 0, x = 0;
+
+  for (; reader->next < reader->end && *reader->next != '\n'
+         && *reader->next != '\r'; reader->next++)
+    {
+      if (*reader->next == '$')
+        {
+          y++;
+          x = 0;
+        }
+      else if ((*reader->next != '.' && *reader->next != '*') || y >= 8
+               || x >= 8)
+        return NULL;
+      else
+        rows[y] |= (*reader->next == '*') << x++;
+    }
+  if (!end_line(reader))
+    return NULL;
+
+  return bitmap_node(hash_life, rows, 0, 0, LEAF_LEVEL);
+}
+
+static HL_Node *
+read_branch (Hash_Life *hash_life, struct MC_READER *reader)
+{
+  uint64_t level, numbers[4];
+  HL_Node *quads[4];
+
+  if (!read_number(reader, &level) || level < 1 || level > MAX_LEVEL)
+    return NULL;
+
+  for (int q = 0; q < 4; q++)
+    {
+      if (!read_number(reader, &numbers[q]))
+        return NULL;
+
+      if (level == 1)
+        quads[q] = numbers[q] <= 1 ? leaf(hash_life, numbers[q]) : NULL;
+      else if (numbers[q] == 0)
+        quads[q] = empty_node(hash_life, level - 1);
+      else if (numbers[q] <= reader->count
+               && reader->nodes[numbers[q] - 1]->level == (int) level - 1)
+        quads[q] = reader->nodes[numbers[q] - 1];
+      else
+        quads[q] = NULL;
+    }
+  if (!end_line(reader))
+    return NULL;
+
+  return find_node(hash_life, quads[0], quads[1], quads[2], quads[3]);
+}
+
+// Reads every node of the file, returning the root, NULL if it is malformed
+static HL_Node *
+read_macrocell (Hash_Life *hash_life, struct MC_READER *reader)
+{
+  static const char magic[] = "[M2]";
+
+  if ((size_t) (reader->end - reader->next) < sizeof(magic) - 1
+      || memcmp(reader->next, magic, sizeof(magic) - 1) != 0)
+    return NULL;
+  reader->next = memchr(reader->next, '\n', reader->end - reader->next);
+  reader->next = reader->next ? reader->next + 1 : reader->end;
+
+  while (reader->next < reader->end)
+    {
+      char first = *reader->next;
+      HL_Node *node;
+
+      if (first == '#' || first == '\n' || first == '\r')
+        {
+          reader->next = memchr(reader->next, '\n',
+                                reader->end - reader->next);
+          reader->next = reader->next ? reader->next + 1 : reader->end;
+          continue;
+        }
+
+      if (first == '.' || first == '*' || first == '$')
+        node = read_leaf(hash_life, reader);
+      else
+        node = read_branch(hash_life, reader);
+      if (!node)
+        return NULL;
+
+      if (reader->count == reader->capacity)
+        {
+          size_t capacity = reader->capacity ? reader->capacity * 2 : 1024;
+          HL_Node **nodes = realloc(reader->nodes,
+                                    sizeof(HL_Node *) * capacity);
+          if (!nodes)
+            return NULL;
+          reader->nodes    = nodes;
+          reader->capacity = capacity;
+        }
+      reader->nodes[reader->count++] = node;
+    }
+
+  return reader->count ? reader->nodes[reader->count - 1]
+    : empty_node(hash_life, LEAF_LEVEL);
+}
+
+// The union of the live cells of two nodes of the same level
+static HL_Node *
+union_nodes (Hash_Life *hash_life, HL_Node *a, HL_Node *b)
+{
+  if (!a || !b)
+    return NULL;
+  if (a == b || a->population == 0)
+    return b;
+  if (b->population == 0)
+    return a;
+
+  return find_node(hash_life, union_nodes(hash_life, a->nw, b->nw),
+                   union_nodes(hash_life, a->ne, b->ne),
+                   union_nodes(hash_life, a->sw, b->sw),
+                   union_nodes(hash_life, a->se, b->se));
+}
+
+/* The numbers given to the nodes written so far, in an open hash table */
+struct MC_WRITER
+{
+  FILE *file;
+  const HL_Node **nodes;
+  uint64_t *numbers;
+  size_t mask;
+  uint64_t count;
+};
+
+// Finds the slot of a node in the table, or the empty slot it would go in
+static size_t
+find_written (struct MC_WRITER *writer, const HL_Node *node)
+{
+  size_t slot = node_hash(node, NULL, NULL, NULL) & writer->mask;
+
+  while (writer->nodes[slot] && writer->nodes[slot] != node)
+    slot = (slot + 1) & writer->mask;
+  return slot;
+}
+
+static void
+write_leaf (FILE *file, const HL_Node *node)
+{
+  char line[8 * 9 + 2];
+  size_t length = 0;
+  size_t last_row_end = 0;
+
+  for (int y = 0; y < 8; y++)
+    {
+      size_t row_start = length;
+      size_t row_end   = length;
+      for (int x = 0; x < 8; x++)
+        {
+          const HL_Node *cell = node;
+          for (int level = LEAF_LEVEL; level > 0; level--)
+            {
+              int half = 1 << (level - 1);
+              bool south = (y & half) != 0, east = (x & half) != 0;
+              cell = south ? (east ? cell->se : cell->sw)
+                : (east ? cell->ne : cell->nw);
+            }
+          line[length++] = cell->population ? '*' : '.';
+          if (cell->population)
+            row_end = length;
+        }
+      // trailing dead cells are left out of every row
+      length = row_end;
+      line[length++] = '$';
+      if (row_end > row_start)
+        last_row_end = length;
+    }
+
+  // and the trailing empty rows out of the node
+  line[last_row_end]     = '\n';
+  line[last_row_end + 1] = '\0';
+  fputs(line, file);
+}
+
+// Writes a node after its quadrants unless it has been already, returns its
+// number
+static uint64_t
+write_node (struct MC_WRITER *writer, const HL_Node *node)
+{
+  if (node->population == 0)
+    return 0;
+
+  size_t slot = find_written(writer, node);
+  if (writer->nodes[slot])
+    return writer->numbers[slot];
+
+  if (node->level == LEAF_LEVEL)
+    write_leaf(writer->file, node);
+  else
+    {
+      uint64_t nw = write_node(writer, node->nw);
+      uint64_t ne = write_node(writer, node->ne);
+      uint64_t sw = write_node(writer, node->sw);
+      uint64_t se = write_node(writer, node->se);
+      fprintf(writer->file, "%d %" PRIu64 " %" PRIu64 " %" PRIu64 " %"
+              PRIu64 "\n", node->level, nw, ne, sw, se);
+      // the quadrants may have taken the slot
+      slot = find_written(writer, node);
+    }
+
+  writer->nodes[slot]   = node;
+  writer->numbers[slot] = ++writer->count;
+  return writer->count;
+}
+
+/*
+ * Definitions for the interface functions found in the header
+ */
+
+Hash_Life *
+hash_life_create (uint16_t birth, uint16_t survival)
+{
+  Hash_Life *new_hash_life = calloc(1, sizeof(Hash_Life));
+  if (!new_hash_life)
+    goto done;
+
+  new_hash_life->buckets = calloc(INIT_BUCKETS, sizeof(HL_Node *));
+  if (!new_hash_life->buckets)
+    goto err;
+
+  new_hash_life->num_buckets           = INIT_BUCKETS;
+  new_hash_life->gc_threshold          = INIT_GC_THRESHOLD;
+  new_hash_life->birth                 = birth;
+  new_hash_life->survival              = survival;
+  new_hash_life->dead_leaf.population  = 0;
+  new_hash_life->live_leaf.population  = 1;
+  new_hash_life->empty[0]              = &new_hash_life->dead_leaf;
+
+  new_hash_life->root = empty_node(new_hash_life, 3);
+  if (!new_hash_life->root)
+    goto err;
+
+ done:
+  return new_hash_life;
+
+ err:
+  hash_life_destroy(new_hash_life);
+  return NULL;
+}
+
+void
+hash_life_destroy (Hash_Life *hash_life)
+{
+  HL_Block *block = hash_life->blocks;
+  while (block)
+    {
+      HL_Block *next = block->next;
+      free(block);
+      block = next;
+    }
+
+  free(hash_life->buckets);
+  free(hash_life);
+}
+
+void
+hash_life_set_rule (Hash_Life *hash_life, uint16_t birth, uint16_t survival)
+{
+  if (birth == hash_life->birth && survival == hash_life->survival)
+    return;
+
+  hash_life->birth    = birth;
+  hash_life->survival = survival;
+  for (size_t i = 0; i < hash_life->num_buckets; i++)
+    for (HL_Node *node = hash_life->buckets[i]; node; node = node->next)
+      {
+        node->result      = NULL;
+        node->result_step = -1;
+      }
+}
+
+void
+hash_life_clear (Hash_Life *hash_life)
+{
+  hash_life->root     = empty_node(hash_life, 3);
+  hash_life->previous = NULL;
+  collect_garbage(hash_life, true);
+}
+
+int
+hash_life_get (Hash_Life *hash_life, int64_t y, int64_t x)
+{
+  HL_Node *node = hash_life->root;
+  int64_t half  = half_size(node);
+
+  if (y < -half || y >= half || x < -half || x >= half)
+    return 0;
+
+  y += half;
+  x += half;
+  while (node->level > 0 && node->population)
+    {
+      half = half_size(node);
+      if (y < half && x < half)
+        node = node->nw;
+      else if (y < half)
+        {
+          node = node->ne;
+          x -= half;
+        }
+      else if (x < half)
+        {
+          node = node->sw;
+          y -= half;
+        }
+      else
+        {
+          node = node->se;
+          y -= half;
+          x -= half;
+        }
+    }
+
+  return node->population != 0;
+}
+
+bool
+hash_life_set (Hash_Life *hash_life, int64_t y, int64_t x, int state)
+{
+  bool success = false;
+  HL_Node *root = hash_life->root;
+
+  // grow the universe until it contains the cell
+  while (y < -half_size(root) || y >= half_size(root)
+         || x < -half_size(root) || x >= half_size(root))
+    {
+      root = expand(hash_life, root);
+      if (!root)
+        goto done;
+    }
+
+  root = set_cell(hash_life, root, y + half_size(root), x + half_size(root),
+                  state != 0);
+  if (!root)
+    goto done;
+
+  hash_life->root = root;
+  success = true;
+
+ done:
+  maybe_collect_garbage(hash_life);
+  return success;
+}
+
+bool
+hash_life_step (Hash_Life *hash_life, int log2_generations)
+{
+  assert(log2_generations >= 0 && log2_generations <= HASH_LIFE_MAX_STEP);
+
+  bool success = false;
+  HL_Node *root = hash_life->root;
+
+  /* the pattern must sit in the centre quarter of a root large enough for
+     the step so that nothing can escape the result */
+  while (root && (root->level < log2_generations + 2 || !is_padded(root)))
+    root = expand(hash_life, root);
+  if (root)
+    root = expand(hash_life, root);
+  if (!root)
+    goto done;
+
+  root = node_result(hash_life, root, log2_generations);
+  if (!root)
+    goto done;
+
+  hash_life->previous = hash_life->root;
+  hash_life->root     = root;
+  success = true;
+
+ done:
+  maybe_collect_garbage(hash_life);
+  return success;
+}
+
+void
+hash_life_foreach_in_rect (Hash_Life *hash_life, int64_t y_min, int64_t x_min,
+                           int64_t y_max, int64_t x_max,
+                           void (*fn)(int64_t y, int64_t x, void *ctx),
+                           void *ctx)
+{
+  HL_Node *root = hash_life->root;
+  foreach_in_node(root, -half_size(root), -half_size(root), y_min, x_min,
+                  y_max, x_max, fn, ctx);
+}
+
+bool
+hash_life_foreach_change (Hash_Life *hash_life,
+                          void (*fn)(int64_t y, int64_t x, int state,
+                                     void *ctx),
+                          void *ctx)
+{
+  bool success = true;
+  HL_Node *old = hash_life->previous ? hash_life->previous
+    : empty_node(hash_life, 3);
+  HL_Node *new = hash_life->root;
+
+  // both roots are centred on the origin, so padding lines them up
+  while (old && new && old->level < new->level)
+    old = expand(hash_life, old);
+  while (old && new && new->level < old->level)
+    new = expand(hash_life, new);
+  if (!old || !new)
+    {
+      success = false;
+      goto done;
+    }
+
+  foreach_change_in_node(old, new, -half_size(new), -half_size(new), fn, ctx);
+
+ done:
+  return success;
+}
+
+bool
+hash_life_read_macrocell (Hash_Life *hash_life, const char *text,
+                          size_t length)
+{
+  bool success = false;
+  struct MC_READER reader = { text, text + length, NULL, 0, 0 };
+  HL_Node *root    = hash_life->root;
+  HL_Node *pattern = read_macrocell(hash_life, &reader);
+
+  // both roots are centred on the origin, so padding lines them up
+  while (pattern && root && pattern->level < root->level)
+    pattern = expand(hash_life, pattern);
+  while (pattern && root && root->level < pattern->level)
+    root = expand(hash_life, root);
+
+  root = union_nodes(hash_life, root, pattern);
+  if (!root)
+    goto done;
+
+  hash_life->root = root;
+  success = true;
+
+ done:
+  free(reader.nodes);
+  maybe_collect_garbage(hash_life);
+  return success;
+}
+
+bool
+hash_life_write_macrocell (Hash_Life *hash_life, FILE *file)
+{
+  bool success = false;
+  struct MC_WRITER writer = { file, NULL, NULL, 0, 0 };
+  size_t size = 16;
+
+  // every node written is in the node cache, so twice as many slots is plenty
+  while (size < hash_life->num_nodes * 2)
+    size *= 2;
+  writer.nodes   = calloc(size, sizeof(const HL_Node *));
+  writer.numbers = malloc(size * sizeof(uint64_t));
+  writer.mask    = size - 1;
+  if (!writer.nodes || !writer.numbers)
+    goto done;
+
+  fputs("[M2] (game-of-life)\n#R B", file);
+  for (int n = 0; n <= 8; n++)
+    if ((hash_life->birth >> n) & 1)
+      fputc('0' + n, file);
+  fputs("/S", file);
+  for (int n = 0; n <= 8; n++)
+    if ((hash_life->survival >> n) & 1)
+      fputc('0' + n, file);
+  fputc('\n', file);
+
+  assert(hash_life->root->level >= LEAF_LEVEL);
+  write_node(&writer, hash_life->root);
+  success = !ferror(file);
+
+ done:
+  free(writer.nodes);
+  free(writer.numbers);
+  return success;
+}
+
+uint64_t
+hash_life_population (Hash_Life *hash_life)
+{
+  return hash_life->root->population;
+}
+
+size_t
+hash_life_node_count (Hash_Life *hash_life)
+{
+  return hash_life->num_nodes;
+}
+
+void
+hash_life_get_stats (Hash_Life *hash_life, Hash_Life_Stats *stats)
+{
+  *stats       = hash_life->stats;
+  stats->nodes = hash_life->num_nodes;
+  stats->level = hash_life->root->level;
+}
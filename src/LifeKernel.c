@@ -0,0 +1,226 @@
+#include "LifeKernel.h"
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define LIFE_KERNEL_X86
+#endif
+
+static Life_Kernel_Isa selected_isa;
+static bool isa_chosen = false;
+
+/*
+ * ROW KERNELS
+ *
+ * Each kernel is the same word-parallel update written for a different word
+ * type.  The scalar kernel works on plain 64-bit words and the vector kernels
+ * use GCC vector extensions, which apply the same operators lane by lane, so
+ * one definition serves every instruction set.  A kernel updates as many
+ * whole vectors as fit in the row and returns the number of words it wrote.
+ *
+ * Column c of a row is bit c % 64 of word c / 64, so the western neighbours
+ * of a word are found by shifting it left and carrying in the top bit of the
+ * word before it, and the eastern ones the other way around.
+ *
+ * The eight neighbour bits are summed with carry-save adders into the four
+ * bits of a count between 0 and 8, which is then compared against every
+ * count the rule cares about.
+ */
+
+#define DEFINE_ROW_KERNEL(name, word_t, attributes)                           \
+  attributes static size_t                                                    \
+  name (const uint64_t *above, const uint64_t *here, const uint64_t *below,   \
+        uint64_t *out, size_t words, uint16_t birth, uint16_t survival)       \
+  {                                                                           \
+    const size_t lanes = sizeof(word_t) / sizeof(uint64_t);                   \
+    size_t word;                                                              \
+                                                                              \
+    for (word = 0; word + lanes <= words; word += lanes)                      \
+      {                                                                       \
+        word_t a, a_west, a_east, h, h_west, h_east, b, b_west, b_east;       \
+        memcpy(&a, above + word, sizeof(word_t));                             \
+        memcpy(&a_west, above + word - 1, sizeof(word_t));                    \
+        memcpy(&a_east, above + word + 1, sizeof(word_t));                    \
+        memcpy(&h, here + word, sizeof(word_t));                              \
+        memcpy(&h_west, here + word - 1, sizeof(word_t));                     \
+        memcpy(&h_east, here + word + 1, sizeof(word_t));                     \
+        memcpy(&b, below + word, sizeof(word_t));                             \
+        memcpy(&b_west, below + word - 1, sizeof(word_t));                    \
+        memcpy(&b_east, below + word + 1, sizeof(word_t));                    \
+                                                                              \
+        a_west = (a << 1) | (a_west >> 63);                                   \
+        a_east = (a >> 1) | (a_east << 63);                                   \
+        h_west = (h << 1) | (h_west >> 63);                                   \
+        h_east = (h >> 1) | (h_east << 63);                                   \
+        b_west = (b << 1) | (b_west >> 63);                                   \
+        b_east = (b >> 1) | (b_east << 63);                                   \
+                                                                              \
+        /* count each row of the neighbourhood, then sum the three counts */  \
+        word_t above_ones = a_west ^ a ^ a_east;                              \
+        word_t above_twos = (a_west & a) | (a_east & (a_west ^ a));           \
+        word_t below_ones = b_west ^ b ^ b_east;                              \
+        word_t below_twos = (b_west & b) | (b_east & (b_west ^ b));           \
+        word_t here_ones  = h_west ^ h_east;                                  \
+        word_t here_twos  = h_west & h_east;                                  \
+                                                                              \
+        word_t ones  = above_ones ^ below_ones ^ here_ones;                   \
+        word_t carry = (above_ones & below_ones)                              \
+          | (here_ones & (above_ones ^ below_ones));                          \
+        word_t twos_sum   = above_twos ^ below_twos ^ here_twos;              \
+        word_t twos_carry = (above_twos & below_twos)                         \
+          | (here_twos & (above_twos ^ below_twos));                          \
+        word_t twos  = twos_sum ^ carry;                                      \
+        word_t fours = twos_carry ^ (twos_sum & carry);                       \
+        word_t eights = twos_carry & twos_sum & carry;                        \
+                                                                              \
+        word_t next = { 0 };                                                  \
+        for (int count = 0; count <= 8; count++)                              \
+          {                                                                   \
+            bool born = (birth >> count) & 1;                                 \
+            bool lives = (survival >> count) & 1;                             \
+            if (!born && !lives)                                              \
+              continue;                                                       \
+                                                                              \
+            word_t match = (count & 1 ? ones : ~ones)                         \
+              & (count & 2 ? twos : ~twos)                                    \
+              & (count & 4 ? fours : ~fours)                                  \
+              & (count & 8 ? eights : ~eights);                               \
+            if (!born)                                                        \
+              match &= h;                                                     \
+            else if (!lives)                                                  \
+              match &= ~h;                                                    \
+            next |= match;                                                    \
+          }                                                                   \
+                                                                              \
+        memcpy(out + word, &next, sizeof(word_t));                            \
+      }                                                                       \
+                                                                              \
+    return word;                                                              \
+  }
+
+DEFINE_ROW_KERNEL(row_kernel_scalar, uint64_t, )
+
+#ifdef LIFE_KERNEL_X86
+typedef uint64_t Sse2_Words __attribute__((vector_size(16)));
+typedef uint64_t Avx2_Words __attribute__((vector_size(32)));
+
+DEFINE_ROW_KERNEL(row_kernel_sse2, Sse2_Words, __attribute__((target("sse2"))))
+DEFINE_ROW_KERNEL(row_kernel_avx2, Avx2_Words, __attribute__((target("avx2"))))
+#endif
+
+/*
+ * DISPATCH
+ */
+
+static bool
+isa_supported (Life_Kernel_Isa isa)
+{
+  bool supported = false;
+
+  switch (isa)
+    {
+    case life_kernel_scalar:
+      supported = true;
+      break;
+#ifdef LIFE_KERNEL_X86
+    case life_kernel_sse2:
+      supported = __builtin_cpu_supports("sse2");
+      break;
+    case life_kernel_avx2:
+      supported = __builtin_cpu_supports("avx2");
+      break;
+#else
+    case life_kernel_sse2:
+    case life_kernel_avx2:
+      break;
+#endif
+    }
+
+  return supported;
+}
+
+Life_Kernel_Isa
+life_kernel_best_isa (void)
+{
+  Life_Kernel_Isa best = life_kernel_scalar;
+
+  if (isa_supported(life_kernel_avx2))
+    best = life_kernel_avx2;
+  else if (isa_supported(life_kernel_sse2))
+    best = life_kernel_sse2;
+
+  return best;
+}
+
+bool
+life_kernel_select (Life_Kernel_Isa isa)
+{
+  bool success = isa_supported(isa);
+
+  if (success)
+    {
+      selected_isa = isa;
+      isa_chosen   = true;
+    }
+
+  return success;
+}
+
+Life_Kernel_Isa
+life_kernel_selected (void)
+{
+  if (!isa_chosen)
+    life_kernel_select(life_kernel_best_isa());
+
+  return selected_isa;
+}
+
+const char *
+life_kernel_isa_name (Life_Kernel_Isa isa)
+{
+  const char *name = "scalar";
+
+  switch (isa)
+    {
+    case life_kernel_scalar:
+      name = "scalar";
+      break;
+    case life_kernel_sse2:
+      name = "sse2";
+      break;
+    case life_kernel_avx2:
+      name = "avx2";
+      break;
+    }
+
+  return name;
+}
+
+void
+life_kernel_row (const uint64_t *above, const uint64_t *here,
+                 const uint64_t *below, uint64_t *out, size_t words,
+                 uint16_t birth, uint16_t survival)
+{
+  size_t done = 0;
+
+  switch (life_kernel_selected())
+    {
+    case life_kernel_scalar:
+      break;
+#ifdef LIFE_KERNEL_X86
+    case life_kernel_sse2:
+      done = row_kernel_sse2(above, here, below, out, words, birth, survival);
+      break;
+    case life_kernel_avx2:
+      done = row_kernel_avx2(above, here, below, out, words, birth, survival);
+      break;
+#else
+    case life_kernel_sse2:
+    case life_kernel_avx2:
+      break;
+#endif
+    }
+
+  // the words left over after the last whole vector
+  row_kernel_scalar(above + done, here + done, below + done, out + done,
+                    words - done, birth, survival);
+}
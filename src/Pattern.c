@@ -0,0 +1,402 @@
+#include "Pattern.h"
+#include <assert.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define READ_BUFFER_SIZE 65536
+#define HEADER_MAX 256      /* longest header line kept, the rest is dropped */
+
+/*
+ * READING
+ *
+ * Pattern files are read a character at a time out of a buffer of our own,
+ * without going through stdio for every character.  The cells a file sets
+ * are collected in row order and handed to the automaton in one call once
+ * the whole file has been parsed, so a bad file leaves the board alone and
+ * an empty point set board is built without a search per cell.
+ */
+
+struct READER
+{
+  FILE *fp;
+  size_t size;              /* characters in the buffer */
+  size_t next;              /* the next character to read */
+  unsigned char buffer[READ_BUFFER_SIZE];
+};
+
+/* The cells set by a file so far, in the order they were read */
+struct CELL_LIST
+{
+  Automaton_Change *cells;
+  size_t size;
+  size_t capacity;
+};
+
+static inline int
+reader_get (struct READER *reader)
+{
+  if (reader->next == reader->size)
+    {
+      reader->size = fread(reader->buffer, 1, sizeof(reader->buffer),
+                           reader->fp);
+      reader->next = 0;
+      if (reader->size == 0)
+        return EOF;
+    }
+
+  return reader->buffer[reader->next++];
+}
+
+// Reads the rest of a line, returns false if there was nothing left to read
+static bool
+reader_line (struct READER *reader, char *line, size_t size)
+{
+  size_t length = 0;
+  int c;
+
+  while ((c = reader_get(reader)) != EOF && c != '\n')
+    {
+      if (length + 1 < size)
+        line[length++] = c;
+    }
+  line[length] = '\0';
+
+  return c != EOF || length > 0;
+}
+
+static bool
+cells_push (struct CELL_LIST *list, int y, int x, int state)
+{
+  if (list->size == list->capacity)
+    {
+      size_t capacity = list->capacity ? list->capacity * 2 : 1024;
+      Automaton_Change *cells = realloc(list->cells,
+                                        capacity * sizeof(Automaton_Change));
+      if (!cells)
+        return false;
+
+      list->cells    = cells;
+      list->capacity = capacity;
+    }
+
+  list->cells[list->size++] = (Automaton_Change) { y, x, state };
+  return true;
+}
+
+/*
+ * TEXT FORMAT
+ */
+
+bool
+pattern_load_text (Automaton *automaton, const char *path)
+{
+  assert(automaton);
+  assert(path);
+
+  bool success = false;
+  struct READER reader;
+  struct CELL_LIST list = { NULL, 0, 0 };
+  char header[HEADER_MAX];
+  int height;
+  int width;
+
+  reader.size = reader.next = 0;
+  reader.fp   = fopen(path, "r");
+  if (!reader.fp)
+    goto done;
+
+  /* first line of the file should contain the height followed by the width */
+  if (!reader_line(&reader, header, sizeof(header))
+      || sscanf(header, "%d %d", &height, &width) != 2)
+    goto err;
+
+  int c = reader_get(&reader);
+  for (int line = 0; line < height && c != EOF; ++line)
+    {
+      // characters past the width are skipped up to the end of the line
+      for (int col = 0; c != EOF && c != '\n'; ++col)
+        {
+          if (col < width && (c == '0' || c == '-')
+              && !cells_push(&list, line - height / 2, col - width / 2,
+                             c == '0' ? 1 : 2))
+            goto err;
+          c = reader_get(&reader);
+        }
+      c = reader_get(&reader);
+    }
+
+  success = automaton_set_cells(automaton, list.cells, list.size);
+
+ err:
+  free(list.cells);
+  fclose(reader.fp);
+ done:
+  return success;
+}
+
+struct BOARD_WRITE
+{
+  char *text;           /* the rows of the board, each ending in a newline */
+  int top;              /* coordinates of the first character */
+  int left;
+  int width;
+};
+
+static void
+write_cell (int y, int x, int state, void *ctx)
+{
+  struct BOARD_WRITE *write = ctx;
+
+  write->text[(size_t) (y - write->top) * (write->width + 1)
+              + (x - write->left)] = state == 1 ? '0' : '-';
+}
+
+bool
+pattern_save_text (Automaton *automaton, const char *path)
+{
+  assert(automaton);
+  assert(path);
+
+  bool success = false;
+  int height = automaton_get_height(automaton);
+  int width  = automaton_get_width(automaton);
+  size_t size = (size_t) height * (width + 1);
+  struct BOARD_WRITE write = { NULL, -height / 2, -width / 2, width };
+  FILE *fp;
+
+  fp = fopen(path, "w");
+  if (!fp)
+    goto done;
+
+  // the whole board is laid out first since some backends can only visit
+  // their cells in no particular order
+  write.text = malloc(size ? size : 1);
+  if (!write.text)
+    goto err;
+  memset(write.text, '.', size);
+  for (int row = 0; row < height; row++)
+    write.text[(size_t) row * (width + 1) + width] = '\n';
+  automaton_foreach_in_rect(automaton, write.top, write.left,
+                            write.top + height - 1, write.left + width - 1,
+                            write_cell, &write);
+
+  success = fprintf(fp, "%d %d\n", height, width) > 0
+    && fwrite(write.text, 1, size, fp) == size;
+  free(write.text);
+
+ err:
+  success = fclose(fp) == 0 && success;
+ done:
+  return success;
+}
+
+/*
+ * RUN LENGTH ENCODING
+ *
+ * The cells of an RLE pattern come row by row as runs, each an optional
+ * count followed by a tag.  Two-state patterns tag dead cells 'b' and live
+ * ones 'o'.  Multi-state patterns tag dead cells '.' and states 1 to 24 'A'
+ * to 'X', with a prefix of 'p' to 'y' adding 24 times one to ten.  A '$'
+ * ends as many rows as its count and a '!' ends the pattern.
+ */
+
+// The state of a run's cells, -1 if the tag isn't a cell's
+static int
+tag_state (int prefix, int tag)
+{
+  int state = -1;
+
+  if (tag == 'b' || tag == '.')
+    state = prefix ? -1 : 0;
+  else if (tag == 'o')
+    state = prefix ? -1 : 1;
+  else if (tag >= 'A' && tag <= 'X')
+    state = prefix * 24 + tag - 'A' + 1;
+
+  return state;
+}
+
+bool
+pattern_load_rle (Automaton *automaton, const char *path)
+{
+  assert(automaton);
+  assert(path);
+
+  bool success = false;
+  struct READER reader;
+  struct CELL_LIST list = { NULL, 0, 0 };
+  char header[HEADER_MAX];
+  int height;
+  int width;
+  long row   = 0;
+  long col   = 0;
+  long count = 0;           /* of the run being read, 0 before its digits */
+  int prefix = 0;           /* of the multi-state tag being read */
+  int c;
+
+  reader.size = reader.next = 0;
+  reader.fp   = fopen(path, "r");
+  if (!reader.fp)
+    goto done;
+
+  // comments and blank lines come before the header
+  do
+    {
+      if (!reader_line(&reader, header, sizeof(header)))
+        goto err;
+    }
+  while (header[0] == '#' || header[strspn(header, " \t\r")] == '\0');
+
+  if (sscanf(header, " x = %d , y = %d", &width, &height) != 2
+      || width < 0 || height < 0
+      || width > automaton_get_width(automaton)
+      || height > automaton_get_height(automaton))
+    goto err;
+
+  while ((c = reader_get(&reader)) != EOF && c != '!')
+    {
+      if (isdigit(c))
+        {
+          count = count * 10 + (c - '0');
+          if (count > INT_MAX)
+            goto err;
+          continue;
+        }
+      if (isspace(c))
+        continue;
+      if (c >= 'p' && c <= 'y' && !prefix)
+        {
+          prefix = c - 'o';
+          continue;
+        }
+
+      long run = count ? count : 1;
+      count = 0;
+      if (c == '$' && !prefix)
+        {
+          row += run;
+          col  = 0;
+          continue;
+        }
+
+      int state = tag_state(prefix, c);
+      prefix = 0;
+      if (state < 0 || col + run > width || (state && row >= height))
+        goto err;
+
+      for (long i = 0; state && i < run; i++)
+        {
+          if (!cells_push(&list, row - height / 2, col + i - width / 2,
+                          state))
+            goto err;
+        }
+      col += run;
+    }
+
+  success = automaton_set_cells(automaton, list.cells, list.size);
+
+ err:
+  free(list.cells);
+  fclose(reader.fp);
+ done:
+  return success;
+}
+
+/*
+ * MACROCELL
+ *
+ * A Macrocell file is mapped into memory and its quadtree is parsed where it
+ * lies, so loading it copies nothing but the nodes it describes.
+ */
+
+bool
+pattern_load_macrocell (Automaton *automaton, const char *path)
+{
+  assert(automaton);
+  assert(path);
+
+  bool success = false;
+  struct stat info;
+  void *text;
+  int fd;
+
+  fd = open(path, O_RDONLY);
+  if (fd < 0)
+    goto done;
+
+  // an empty file can't be mapped and isn't a pattern anyway
+  if (fstat(fd, &info) != 0 || info.st_size == 0)
+    goto err;
+  text = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (text == MAP_FAILED)
+    goto err;
+
+  success = automaton_load_macrocell(automaton, text, info.st_size);
+  munmap(text, info.st_size);
+
+ err:
+  close(fd);
+ done:
+  return success;
+}
+
+bool
+pattern_save_macrocell (Automaton *automaton, const char *path)
+{
+  assert(automaton);
+  assert(path);
+
+  bool success = false;
+  FILE *fp = fopen(path, "w");
+  if (!fp)
+    goto done;
+
+  success = automaton_save_macrocell(automaton, fp);
+  success = fclose(fp) == 0 && success;
+
+ done:
+  return success;
+}
+
+/*
+ * ANY FORMAT
+ */
+
+static bool
+has_suffix (const char *path, const char *suffix)
+{
+  size_t length        = strlen(path);
+  size_t suffix_length = strlen(suffix);
+
+  return length >= suffix_length
+    && strcmp(path + length - suffix_length, suffix) == 0;
+}
+
+bool
+pattern_load (Automaton *automaton, const char *path)
+{
+  assert(path);
+
+  if (has_suffix(path, ".rle"))
+    return pattern_load_rle(automaton, path);
+  if (has_suffix(path, ".mc"))
+    return pattern_load_macrocell(automaton, path);
+  return pattern_load_text(automaton, path);
+}
+
+bool
+pattern_save (Automaton *automaton, const char *path)
+{
+  assert(path);
+
+  if (has_suffix(path, ".mc"))
+    return pattern_save_macrocell(automaton, path);
+  return pattern_save_text(automaton, path);
+}
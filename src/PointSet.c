@@ -1,8 +1,17 @@
 #include "PointSet.h"
+#include "Stats.h"
 #include <assert.h>
+#include <stdalign.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
-#include <stdio.h>
+
+/* Slots in the first block of a set, each later block doubles in size */
+static const size_t INIT_BLOCK_SLOTS = 64;
+static const size_t MAX_BLOCK_SLOTS  = 1 << 16;
+
+/* Searches made by each thread, see point_set_searches */
+static _Thread_local unsigned long searches;
 
 typedef struct RB_TREE_NODE RB_Tree_Node;
 struct RB_TREE_NODE
@@ -12,19 +21,116 @@ struct RB_TREE_NODE
   RB_Tree_Node *right_child;
   RB_Tree_Node *parent;
   int x, y;
-  void *data;
+  void *data;  /* points just past the node within the same slot */
+};
+
+/*
+ * Nodes are carved out of blocks of slots, each slot holding a node followed
+ * by its data.  Deleted slots go on a free list and the blocks are only given
+ * back when the set is destroyed.  Clearing the set starts carving from the
+ * first block again, so a cleared set refills without calling malloc.
+ */
+typedef struct SLAB_BLOCK Slab_Block;
+struct SLAB_BLOCK
+{
+  Slab_Block *next;
+  size_t num_slots;
+  alignas(max_align_t) unsigned char slots[];
 };
 
 struct POINT_SET
 {
   RB_Tree_Node *root;
   size_t data_size;
+  size_t slot_size;
   void (*free_fn)(void *);
+  Slab_Block *blocks;         /* oldest block first */
+  Slab_Block *current_block;  /* block new slots are carved from */
+  size_t used_slots;          /* slots handed out from the current block */
+  RB_Tree_Node *free_list;    /* linked through the left_child pointers */
+  Point_Set_Stats stats;
 };
 
 // sentinel for the leaves of the tree
 static RB_Tree_Node tree_null = { .is_red = false };
 
+/*
+ * SLAB ALLOCATION
+ */
+
+static RB_Tree_Node *
+alloc_node (Point_Set *point_set)
+{
+  RB_Tree_Node *node = point_set->free_list;
+
+  if (node)
+    point_set->free_list = node->left_child;
+  else
+    {
+      Slab_Block *block = point_set->current_block;
+
+      // move on to the next block once the current one is full
+      if (block && point_set->used_slots == block->num_slots && block->next)
+        {
+          block = point_set->current_block = block->next;
+          point_set->used_slots = 0;
+        }
+      else if (!block || point_set->used_slots == block->num_slots)
+        {
+          size_t num_slots = block ? block->num_slots * 2 : INIT_BLOCK_SLOTS;
+          if (num_slots > MAX_BLOCK_SLOTS)
+            num_slots = MAX_BLOCK_SLOTS;
+
+          Slab_Block *new_block = malloc(sizeof(Slab_Block)
+                                         + num_slots * point_set->slot_size);
+          if (!new_block)
+            return NULL;
+
+          new_block->next      = NULL;
+          new_block->num_slots = num_slots;
+          if (block)
+            block->next = new_block;
+          else
+            point_set->blocks = new_block;
+          block = point_set->current_block = new_block;
+          point_set->used_slots = 0;
+          ++point_set->stats.blocks;
+          ++point_set->stats.block_allocations;
+          point_set->stats.bytes_reserved += sizeof(Slab_Block)
+            + num_slots * point_set->slot_size;
+        }
+
+      node = (RB_Tree_Node *) (block->slots
+                               + point_set->used_slots++ * point_set->slot_size);
+    }
+
+  node->data = (unsigned char *) node + sizeof(RB_Tree_Node);
+  ++point_set->stats.node_allocations;
+  ++point_set->stats.points;
+  return node;
+}
+
+static void
+free_node (Point_Set *point_set, RB_Tree_Node *node)
+{
+  node->left_child     = point_set->free_list;
+  point_set->free_list = node;
+  ++point_set->stats.node_frees;
+  --point_set->stats.points;
+}
+
+// Call the set's free function on the data of every node in a subtree
+static void
+free_subtree_data (Point_Set *point_set, RB_Tree_Node *curr)
+{
+  while (curr != &tree_null)
+    {
+      free_subtree_data(point_set, curr->left_child);
+      point_set->free_fn(curr->data);
+      curr = curr->right_child;
+    }
+}
+
 /*
  * The point set is implemented as a red-black tree.  The following functions 
  * are for performing operations on said red-black tree.  These functions are 
@@ -141,30 +247,42 @@ rb_insert_fixup (Point_Set *point_set, RB_Tree_Node *z)
 }
 
 /*
- * Returns false if we find a node with the same xy.  No duplicates are allowed
- * so the given node does not get inserted into the tree.
+ * Finds the node a new point at (px, py) would be inserted under.  Returns
+ * false if we find a node with the same xy, since no duplicates are allowed.
  */
 static bool
-rb_insert (Point_Set *point_set, RB_Tree_Node *z)
+rb_find_parent (Point_Set *point_set, int px, int py, RB_Tree_Node **parent)
 {
   assert(point_set);
-  assert(z);
-  
+  assert(parent);
+
   RB_Tree_Node *y = &tree_null;
   RB_Tree_Node *x = point_set->root;
 
-  // search the tree for where to insert z, exit if duplicate is found
+  // search the tree for where to insert the point, exit if duplicate is found
   while (x != &tree_null)
     {
       y = x;
-      if (z->x == x->x && z->y == x->y)
+      if (px == x->x && py == x->y)
         return false;
-      else if (z->x < x->x || (z->x == x->x && z->y < x->y))
+      else if (px < x->x || (px == x->x && py < x->y))
         x = x->left_child;
       else
         x = x->right_child;
     }
 
+  *parent = y;
+  return true;
+}
+
+// Inserts z under the parent rb_find_parent found for it
+static void
+rb_insert (Point_Set *point_set, RB_Tree_Node *y, RB_Tree_Node *z)
+{
+  assert(point_set);
+  assert(y);
+  assert(z);
+
   // insert the node into the tree
   z->parent = y;
   if (y == &tree_null)
@@ -179,8 +297,6 @@ rb_insert (Point_Set *point_set, RB_Tree_Node *z)
   z->right_child = &tree_null;
   z->is_red = true;
   rb_insert_fixup(point_set, z);
-
-  return true;
 }
 
 // replace one subtree with another
@@ -318,8 +434,9 @@ rb_delete (Point_Set *point_set, RB_Tree_Node *z)
     rb_delete_fixup(point_set, x);
 
   // free the node's resources
-  point_set->free_fn(z->data);
-  free(z);
+  if (point_set->free_fn)
+    point_set->free_fn(z->data);
+  free_node(point_set, z);
 }
 
 static RB_Tree_Node *
@@ -335,6 +452,131 @@ tree_search (RB_Tree_Node *curr, int x, int y)
   return curr;
 }
 
+// visit the subtree rooted at the given node in order
+static void
+tree_foreach (RB_Tree_Node *curr,
+              void (*fn)(int x, int y, void *data, void *ctx), void *ctx)
+{
+  while (curr != &tree_null)
+    {
+      tree_foreach(curr->left_child, fn, ctx);
+      fn(curr->x, curr->y, curr->data, ctx);
+      curr = curr->right_child;
+    }
+}
+
+// Counts the nodes on the longest path down from the given node
+static int
+tree_height (RB_Tree_Node *curr)
+{
+  if (curr == &tree_null)
+    return 0;
+
+  int left  = tree_height(curr->left_child);
+  int right = tree_height(curr->right_child);
+  return 1 + (left > right ? left : right);
+}
+
+/*
+ * Builds a balanced subtree out of the next count entries, which are in
+ * order.  Every level of the tree but the deepest is full, so colouring the
+ * nodes of the deepest level red and the rest black gives every path the
+ * same number of black nodes.  Returns NULL if a node can't be allocated.
+ */
+static RB_Tree_Node *
+tree_build (Point_Set *point_set, const Point_Set_Entry **next, size_t count,
+            int depth, int red_depth)
+{
+  if (count == 0)
+    return &tree_null;
+
+  RB_Tree_Node *left = tree_build(point_set, next, count / 2, depth + 1,
+                                  red_depth);
+  RB_Tree_Node *node = left ? alloc_node(point_set) : NULL;
+  if (!node)
+    return NULL;
+
+  node->x      = (*next)->x;
+  node->y      = (*next)->y;
+  node->is_red = depth == red_depth;
+  memcpy(node->data, (*next)->data, point_set->data_size);
+  ++*next;
+
+  RB_Tree_Node *right = tree_build(point_set, next, count - count / 2 - 1,
+                                   depth + 1, red_depth);
+  if (!right)
+    return NULL;
+
+  node->left_child  = left;
+  node->right_child = right;
+  if (left != &tree_null)
+    left->parent = node;
+  if (right != &tree_null)
+    right->parent = node;
+  return node;
+}
+
+// Returns the first node at or after the given coordinates
+static RB_Tree_Node *
+tree_lower_bound (RB_Tree_Node *curr, int x, int y)
+{
+  RB_Tree_Node *bound = &tree_null;
+
+  while (curr != &tree_null)
+    {
+      if (curr->x > x || (curr->x == x && curr->y >= y))
+        {
+          bound = curr;
+          curr  = curr->left_child;
+        }
+      else
+        curr = curr->right_child;
+    }
+  return bound;
+}
+
+/*
+ * Returns the first node at or after the given coordinates, which must lie
+ * after the given node.  The search climbs from the node only as far as an
+ * ancestor after the coordinates, so it costs the logarithm of the number
+ * of nodes skipped rather than of the whole tree.
+ */
+static RB_Tree_Node *
+tree_seek (RB_Tree_Node *from, int x, int y)
+{
+  RB_Tree_Node *curr = from;
+
+  while (curr->parent != &tree_null)
+    {
+      RB_Tree_Node *parent = curr->parent;
+
+      // everything after curr's subtree starts with this parent
+      if (curr == parent->left_child
+          && (parent->x > x || (parent->x == x && parent->y >= y)))
+        {
+          RB_Tree_Node *bound = tree_lower_bound(curr, x, y);
+          return bound != &tree_null ? bound : parent;
+        }
+      curr = parent;
+    }
+  return tree_lower_bound(curr, x, y);
+}
+
+static RB_Tree_Node *
+tree_successor (RB_Tree_Node *x)
+{
+  if (x->right_child != &tree_null)
+    return tree_minimum(x->right_child);
+
+  RB_Tree_Node *y = x->parent;
+  while (y != &tree_null && x == y->right_child)
+    {
+      x = y;
+      y = y->parent;
+    }
+  return y;
+}
+
 /*
  * Definitions for the interface functions found in the header
  */
@@ -342,16 +584,24 @@ tree_search (RB_Tree_Node *curr, int x, int y)
 Point_Set *
 point_set_create (size_t data_size, void (*free_fn)(void *))
 {
-  assert(free_fn);
   assert(data_size > 0);
   
   Point_Set *new_point_set = malloc(sizeof(Point_Set));
   
   if (new_point_set)
     {
-      new_point_set->root = &tree_null;
-      new_point_set->data_size = data_size;
-      new_point_set->free_fn = free_fn;
+      static const size_t align = alignof(max_align_t);
+
+      new_point_set->root       = &tree_null;
+      new_point_set->data_size  = data_size;
+      new_point_set->slot_size  = (sizeof(RB_Tree_Node) + data_size
+                                   + align - 1) / align * align;
+      new_point_set->free_fn    = free_fn;
+      new_point_set->blocks        = NULL;
+      new_point_set->current_block = NULL;
+      new_point_set->used_slots    = 0;
+      new_point_set->free_list  = NULL;
+      memset(&new_point_set->stats, 0, sizeof(Point_Set_Stats));
     }
   
   return new_point_set;
@@ -360,13 +610,37 @@ point_set_create (size_t data_size, void (*free_fn)(void *))
 void
 point_set_destroy (Point_Set *point_set)
 {
-  // we keep deleting the root until no nodes are left
-  while (point_set->root != &tree_null)
-    rb_delete(point_set, point_set->root);
+  if (point_set->free_fn)
+    free_subtree_data(point_set, point_set->root);
+
+  // every node lives in a block so the whole tree goes with the blocks
+  Slab_Block *block = point_set->blocks;
+  while (block)
+    {
+      Slab_Block *next = block->next;
+      free(block);
+      block = next;
+    }
 
   free(point_set);
 }
 
+void
+point_set_clear (Point_Set *point_set)
+{
+  assert(point_set);
+
+  if (point_set->free_fn)
+    free_subtree_data(point_set, point_set->root);
+
+  point_set->root          = &tree_null;
+  point_set->free_list     = NULL;
+  point_set->current_block = point_set->blocks;
+  point_set->used_slots    = 0;
+  point_set->stats.node_frees += point_set->stats.points;
+  point_set->stats.points  = 0;
+}
+
 bool
 point_set_insert (Point_Set *point_set, int x, int y, const void *data)
 {
@@ -374,33 +648,64 @@ point_set_insert (Point_Set *point_set, int x, int y, const void *data)
   assert(data != NULL);
   
   bool ret = false;
+  RB_Tree_Node *parent;
   RB_Tree_Node *new_node;
 
-  // allocate memory for the new node exit if NULL
-  new_node = malloc(sizeof(RB_Tree_Node));
+  // a duplicate is turned away before it takes a slot
+  if (!rb_find_parent(point_set, x, y, &parent))
+    goto done;
+
+  // take a slot for the new node exit if NULL
+  new_node = alloc_node(point_set);
   if (!new_node)
     goto done;
 
   new_node->x = x;
   new_node->y = y;
+  memcpy(new_node->data, data, point_set->data_size);
 
-  new_node->data = malloc(point_set->data_size);
-  if (!new_node->data)
+  rb_insert(point_set, parent, new_node);
+  ret = true;
+
+ done: 
+  return ret;
+}
+
+bool
+point_set_load_sorted (Point_Set *point_set, const Point_Set_Entry *entries,
+                       size_t count)
+{
+  assert(point_set);
+  assert(point_set->root == &tree_null);
+
+  bool success  = true;
+  int red_depth = 0;
+
+  for (size_t i = 1; i < count && success; i++)
+    success = entries[i - 1].x < entries[i].x
+      || (entries[i - 1].x == entries[i].x && entries[i - 1].y < entries[i].y);
+  if (!success)
+    goto done;
+
+  // the deepest level is full when count + 1 is a power of two
+  while (((size_t) 2 << red_depth) <= count + 1)
+    red_depth++;
+
+  const Point_Set_Entry *next = entries;
+  RB_Tree_Node *root = tree_build(point_set, &next, count, 0, red_depth);
+  if (!root)
     {
-      free(new_node);
+      // the nodes built so far are given back along with the whole slab
+      point_set_clear(point_set);
+      success = false;
       goto done;
     }
-  memcpy(new_node->data, data, point_set->data_size);
 
-  ret = rb_insert(point_set, new_node);
-  if (!ret)
-    {
-      point_set->free_fn(new_node->data);
-      free(new_node);
-    }
+  root->parent    = &tree_null;
+  point_set->root = root;
 
- done: 
-  return ret;
+ done:
+  return success;
 }
 
 bool
@@ -429,76 +734,85 @@ point_set_search (Point_Set *point_set, int x, int y)
   void *ret = NULL;
   RB_Tree_Node *node = tree_search(point_set->root, x, y);
 
+  STATS_ADD(searches, 1);
+
   if (node != &tree_null)
     ret = node->data;
   
   return ret;
 }
-/*
-int
-main ()
+
+void
+point_set_foreach (Point_Set *point_set,
+                   void (*fn)(int x, int y, void *data, void *ctx), void *ctx)
 {
-  Point_Set *points = point_set_create(sizeof(int), free);
-  int num = 53;
-  bool success;
+  assert(point_set);
+  assert(fn);
 
-  for (int x = -50; x < 50; x++)
-    {
-      for (int y = -50; y < 50; y++)
-        {
-          assert(!point_set_search(points, x, y));
-        }
-    }
-  
+  tree_foreach(point_set->root, fn, ctx);
+}
+
+void
+point_set_foreach_in_rect (Point_Set *point_set, int x_min, int y_min,
+                           int x_max, int y_max,
+                           void (*fn)(int x, int y, void *data, void *ctx),
+                           void *ctx)
+{
+  assert(point_set);
+  assert(fn);
+
+  if (x_min > x_max || y_min > y_max)
+    return;
 
-  for (int x = -50; x < 50; x++)
+  RB_Tree_Node *curr = tree_lower_bound(point_set->root, x_min, y_min);
+
+  /* walk forward through each column, seeking ahead from where the walk
+     left the rectangle's rows rather than searching from the root */
+  while (curr != &tree_null && curr->x <= x_max)
     {
-      for (int y = -50; y < 50; y++)
+      if (curr->y < y_min)
+        curr = tree_seek(curr, curr->x, y_min);
+      else if (curr->y > y_max)
         {
-          success = point_set_insert(points, x, y, &num);
-          assert(success);
-          int *num_ptr = point_set_search(points, x, y);
-          assert(num_ptr);
-          assert(*num_ptr == 53);
+          if (curr->x == x_max)
+            break;
+          curr = tree_seek(curr, curr->x + 1, y_min);
         }
-    }
-  printf("Test 1 passed\n");
-  
-  for (int x = -50; x < 50; x++)
-    {
-      for (int y = -50; y < 50; y++)
+      else
         {
-          success = point_set_insert(points, x, y, &num);
-          assert(!success);
-          assert(point_set_search(points, x, y));
+          fn(curr->x, curr->y, curr->data, ctx);
+          curr = tree_successor(curr);
         }
     }
-  printf("Test 2 passed\n");
+}
 
-  for (int x = -50; x < 0; x++)
-    {
-      for (int y = 0; y < 50; y++)
-        {
-          success = point_set_delete(points, x, y);
-          assert(success);
-          assert(point_set_search(points, x, y) == NULL);
-        }
-    }
-  printf("Test 3 passed\n");
+size_t
+point_set_size (Point_Set *point_set)
+{
+  assert(point_set);
 
-  for (int x = -50; x < 0; x++)
-    {
-      for (int y = 0; y < 50; y++)
-        {
-          success = point_set_delete(points, x, y);
-          assert(!success);
-          assert(!point_set_search(points, x, y));
-        }
-    }
-  printf("Test 4 passed\n");
+  return point_set->stats.points;
+}
 
-  point_set_destroy(points);
+void
+point_set_get_stats (Point_Set *point_set, Point_Set_Stats *stats)
+{
+  assert(point_set);
+  assert(stats);
+
+  *stats = point_set->stats;
+}
+
+int
+point_set_height (Point_Set *point_set)
+{
+  assert(point_set);
 
-  return 0;
+  return tree_height(point_set->root);
+}
+
+unsigned long
+point_set_searches (void)
+{
+  return searches;
 }
-*/
@@ -0,0 +1,567 @@
+#include "PointSet.h"
+#include "Stats.h"
+#include <assert.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/*
+ * This point set is an open-addressing hash table keyed on the packed
+ * coordinates of each point.  It is a drop in replacement for the red-black
+ * tree in PointSet.c, selected at build time with POINT_SET=hash.
+ *
+ * Every slot has a control byte holding either EMPTY, DELETED or seven bits
+ * of the key's hash.  Probing walks aligned groups of GROUP_SIZE control
+ * bytes, comparing a whole group against the hash at once, so most lookups
+ * touch one cache line of control bytes and a single key.  Data is stored
+ * inline in one array beside the keys.
+ */
+
+#define GROUP_SIZE 16
+
+static const uint8_t EMPTY   = 0x80;
+static const uint8_t DELETED = 0xFE;
+
+static const size_t INIT_CAPACITY = 64;
+
+/* Searches made by each thread, see point_set_searches */
+static _Thread_local unsigned long searches;
+
+struct POINT_SET
+{
+  uint8_t *control;
+  uint64_t *keys;
+  unsigned char *values;
+  size_t capacity;            /* always a power of two, at least GROUP_SIZE */
+  size_t size;
+  size_t deleted;
+  size_t data_size;
+  void (*free_fn)(void *);
+  struct SORT_ENTRY *order;   /* scratch space for ordered traversals */
+  size_t order_capacity;
+  Point_Set_Stats stats;
+};
+
+struct SORT_ENTRY
+{
+  uint64_t key;               /* the coordinates made to sort as unsigned */
+  size_t slot;
+};
+
+static uint64_t
+pack_key (int x, int y)
+{
+  return (uint64_t) (uint32_t) x << 32 | (uint32_t) y;
+}
+
+static int
+key_x (uint64_t key)
+{
+  return (int32_t) (uint32_t) (key >> 32);
+}
+
+static int
+key_y (uint64_t key)
+{
+  return (int32_t) (uint32_t) key;
+}
+
+static uint64_t
+hash_key (uint64_t key)
+{
+  key ^= key >> 33;
+  key *= 0xFF51AFD7ED558CCDu;
+  key ^= key >> 33;
+  key *= 0xC4CEB9FE1A85EC53u;
+  key ^= key >> 33;
+  return key;
+}
+
+/*
+ * GROUP MATCHING
+ *
+ * Returns a mask with bit i set when control byte i of the group equals the
+ * given byte.
+ */
+
+static unsigned
+match_byte (const uint8_t *group, uint8_t byte)
+{
+#ifdef __SSE2__
+  __m128i ctrl = _mm_loadu_si128((const __m128i *) group);
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(byte)));
+#else
+  unsigned mask = 0;
+  for (int i = 0; i < GROUP_SIZE; i++)
+    mask |= (unsigned) (group[i] == byte) << i;
+  return mask;
+#endif
+}
+
+// Slots that are free to insert into, EMPTY and DELETED both have the top bit
+static unsigned
+match_free (const uint8_t *group)
+{
+#ifdef __SSE2__
+  return _mm_movemask_epi8(_mm_loadu_si128((const __m128i *) group));
+#else
+  unsigned mask = 0;
+  for (int i = 0; i < GROUP_SIZE; i++)
+    mask |= (unsigned) (group[i] >> 7) << i;
+  return mask;
+#endif
+}
+
+static void *
+slot_value (Point_Set *point_set, size_t slot)
+{
+  return point_set->values + slot * point_set->data_size;
+}
+
+// Returns the slot holding the key or capacity if the key is not in the set
+static size_t
+find_slot (Point_Set *point_set, uint64_t key, uint64_t hash)
+{
+  size_t mask  = point_set->capacity - 1;
+  size_t group = (hash >> 7) & mask & ~(size_t) (GROUP_SIZE - 1);
+  uint8_t tag  = hash & 0x7F;
+
+  for (size_t probed = 0; probed < point_set->capacity; probed += GROUP_SIZE)
+    {
+      const uint8_t *ctrl = point_set->control + group;
+      unsigned matches    = match_byte(ctrl, tag);
+
+      while (matches)
+        {
+          size_t slot = group + __builtin_ctz(matches);
+          if (point_set->keys[slot] == key)
+            return slot;
+          matches &= matches - 1;
+        }
+
+      // an empty slot ends the probe sequence
+      if (match_byte(ctrl, EMPTY))
+        break;
+      group = (group + GROUP_SIZE) & mask;
+    }
+
+  return point_set->capacity;
+}
+
+// Returns the first slot a new key with the given hash can go in
+static size_t
+find_free_slot (Point_Set *point_set, uint64_t hash)
+{
+  size_t mask  = point_set->capacity - 1;
+  size_t group = (hash >> 7) & mask & ~(size_t) (GROUP_SIZE - 1);
+  unsigned free_slots;
+
+  while (!(free_slots = match_free(point_set->control + group)))
+    group = (group + GROUP_SIZE) & mask;
+
+  return group + __builtin_ctz(free_slots);
+}
+
+static bool
+allocate_table (Point_Set *point_set, size_t capacity)
+{
+  point_set->control = malloc(capacity);
+  point_set->keys    = malloc(capacity * sizeof(uint64_t));
+  point_set->values  = malloc(capacity * point_set->data_size);
+  if (!point_set->control || !point_set->keys || !point_set->values)
+    {
+      free(point_set->control);
+      free(point_set->keys);
+      free(point_set->values);
+      return false;
+    }
+
+  memset(point_set->control, EMPTY, capacity);
+  point_set->capacity = capacity;
+  point_set->deleted  = 0;
+  // the control bytes, keys and values are each allocated on their own
+  point_set->stats.table_allocations += 3;
+  point_set->stats.bytes_reserved = capacity
+    * (1 + sizeof(uint64_t) + point_set->data_size);
+  return true;
+}
+
+// Move every point into a table of the given capacity, dropping tombstones
+static bool
+rehash (Point_Set *point_set, size_t capacity)
+{
+  uint8_t *control       = point_set->control;
+  uint64_t *keys         = point_set->keys;
+  unsigned char *values  = point_set->values;
+  size_t old_capacity    = point_set->capacity;
+
+  if (!allocate_table(point_set, capacity))
+    {
+      point_set->control = control;
+      point_set->keys    = keys;
+      point_set->values  = values;
+      return false;
+    }
+
+  for (size_t slot = 0; slot < old_capacity; slot++)
+    {
+      if (control[slot] & 0x80)
+        continue;
+
+      uint64_t hash    = hash_key(keys[slot]);
+      size_t new_slot  = find_free_slot(point_set, hash);
+      point_set->control[new_slot] = hash & 0x7F;
+      point_set->keys[new_slot]    = keys[slot];
+      memcpy(slot_value(point_set, new_slot),
+             values + slot * point_set->data_size, point_set->data_size);
+    }
+
+  free(control);
+  free(keys);
+  free(values);
+  return true;
+}
+
+static int
+compare_entries (const void *a, const void *b)
+{
+  uint64_t key_a = ((const struct SORT_ENTRY *) a)->key;
+  uint64_t key_b = ((const struct SORT_ENTRY *) b)->key;
+  return (key_a > key_b) - (key_a < key_b);
+}
+
+static bool
+in_rect (uint64_t key, int x_min, int y_min, int x_max, int y_max)
+{
+  return key_x(key) >= x_min && key_x(key) <= x_max
+    && key_y(key) >= y_min && key_y(key) <= y_max;
+}
+
+// Visits the points inside the given inclusive bounds in the table's order
+static void
+visit_unsorted (Point_Set *point_set, int x_min, int y_min, int x_max,
+                int y_max, void (*fn)(int x, int y, void *data, void *ctx),
+                void *ctx)
+{
+  for (size_t slot = 0; slot < point_set->capacity; slot++)
+    {
+      uint64_t key = point_set->keys[slot];
+      if (!(point_set->control[slot] & 0x80)
+          && in_rect(key, x_min, y_min, x_max, y_max))
+        fn(key_x(key), key_y(key), slot_value(point_set, slot), ctx);
+    }
+}
+
+/*
+ * Visits the points inside the given inclusive bounds ordered by x and then
+ * y, sorting them in the set's scratch buffer first unless the table already
+ * held them in order.  Should the buffer not grow large enough, the points
+ * are visited in the order of the table rather than lost.
+ */
+static void
+visit_sorted (Point_Set *point_set, int x_min, int y_min, int x_max,
+              int y_max, void (*fn)(int x, int y, void *data, void *ctx),
+              void *ctx)
+{
+  static const uint64_t sign_bits = UINT64_C(0x8000000080000000);
+  size_t count = 0;
+  bool sorted  = true;
+
+  if (point_set->size == 0)
+    return;
+
+  if (point_set->order_capacity < point_set->size)
+    {
+      struct SORT_ENTRY *order = realloc(point_set->order, point_set->size
+                                         * sizeof(struct SORT_ENTRY));
+      if (!order)
+        {
+          visit_unsorted(point_set, x_min, y_min, x_max, y_max, fn, ctx);
+          return;
+        }
+      point_set->order          = order;
+      point_set->order_capacity = point_set->size;
+    }
+
+  for (size_t slot = 0; slot < point_set->capacity; slot++)
+    {
+      uint64_t key = point_set->keys[slot];
+      if ((point_set->control[slot] & 0x80)
+          || !in_rect(key, x_min, y_min, x_max, y_max))
+        continue;
+      point_set->order[count].key  = key ^ sign_bits;
+      point_set->order[count].slot = slot;
+      if (count > 0
+          && point_set->order[count - 1].key > point_set->order[count].key)
+        sorted = false;
+      ++count;
+    }
+  if (!sorted)
+    qsort(point_set->order, count, sizeof(struct SORT_ENTRY),
+          compare_entries);
+
+  for (size_t i = 0; i < count; i++)
+    {
+      size_t slot = point_set->order[i].slot;
+      fn(key_x(point_set->keys[slot]), key_y(point_set->keys[slot]),
+         slot_value(point_set, slot), ctx);
+    }
+}
+
+/*
+ * Definitions for the interface functions found in the header
+ */
+
+Point_Set *
+point_set_create (size_t data_size, void (*free_fn)(void *))
+{
+  assert(data_size > 0);
+
+  Point_Set *new_point_set = calloc(1, sizeof(Point_Set));
+  if (!new_point_set)
+    goto done;
+
+  new_point_set->data_size = data_size;
+  new_point_set->free_fn   = free_fn;
+  if (!allocate_table(new_point_set, INIT_CAPACITY))
+    {
+      free(new_point_set);
+      new_point_set = NULL;
+    }
+
+ done:
+  return new_point_set;
+}
+
+void
+point_set_destroy (Point_Set *point_set)
+{
+  if (point_set->free_fn)
+    {
+      for (size_t slot = 0; slot < point_set->capacity; slot++)
+        if (!(point_set->control[slot] & 0x80))
+          point_set->free_fn(slot_value(point_set, slot));
+    }
+
+  free(point_set->control);
+  free(point_set->keys);
+  free(point_set->values);
+  free(point_set->order);
+  free(point_set);
+}
+
+void
+point_set_clear (Point_Set *point_set)
+{
+  assert(point_set);
+
+  if (point_set->free_fn)
+    {
+      for (size_t slot = 0; slot < point_set->capacity; slot++)
+        if (!(point_set->control[slot] & 0x80))
+          point_set->free_fn(slot_value(point_set, slot));
+    }
+
+  // only the control bytes need resetting, keys and data are left behind
+  memset(point_set->control, EMPTY, point_set->capacity);
+  point_set->stats.node_frees += point_set->size;
+  point_set->stats.points = 0;
+  point_set->size         = 0;
+  point_set->deleted      = 0;
+}
+
+bool
+point_set_insert (Point_Set *point_set, int x, int y, const void *data)
+{
+  assert(point_set != NULL);
+  assert(data != NULL);
+
+  bool ret      = false;
+  uint64_t key  = pack_key(x, y);
+  uint64_t hash = hash_key(key);
+
+  if (find_slot(point_set, key, hash) != point_set->capacity)
+    goto done;
+
+  // keep at least an eighth of the slots empty so probes stay short
+  if ((point_set->size + point_set->deleted + 1) * 8 > point_set->capacity * 7)
+    {
+      size_t capacity = point_set->capacity;
+      if ((point_set->size + 1) * 2 > capacity)
+        capacity *= 2;
+      if (!rehash(point_set, capacity))
+        goto done;
+    }
+
+  size_t slot = find_free_slot(point_set, hash);
+  if (point_set->control[slot] == DELETED)
+    --point_set->deleted;
+  point_set->control[slot] = hash & 0x7F;
+  point_set->keys[slot]    = key;
+  memcpy(slot_value(point_set, slot), data, point_set->data_size);
+
+  ++point_set->size;
+  ++point_set->stats.points;
+  ++point_set->stats.node_allocations;
+  ret = true;
+
+ done:
+  return ret;
+}
+
+bool
+point_set_load_sorted (Point_Set *point_set, const Point_Set_Entry *entries,
+                       size_t count)
+{
+  assert(point_set);
+  assert(point_set->size == 0);
+
+  bool success    = true;
+  size_t capacity = point_set->capacity;
+
+  // the table doesn't need the order, but keeps to the same contract
+  for (size_t i = 1; i < count && success; i++)
+    success = entries[i - 1].x < entries[i].x
+      || (entries[i - 1].x == entries[i].x && entries[i - 1].y < entries[i].y);
+  if (!success)
+    goto done;
+
+  // grow the table once up front instead of as it fills
+  while ((count + 1) * 8 > capacity * 7)
+    capacity *= 2;
+  if (capacity != point_set->capacity && !rehash(point_set, capacity))
+    {
+      success = false;
+      goto done;
+    }
+
+  for (size_t i = 0; i < count && success; i++)
+    success = point_set_insert(point_set, entries[i].x, entries[i].y,
+                               entries[i].data);
+  if (!success)
+    point_set_clear(point_set);
+
+ done:
+  return success;
+}
+
+bool
+point_set_delete (Point_Set *point_set, int x, int y)
+{
+  assert(point_set);
+
+  bool success  = false;
+  uint64_t key  = pack_key(x, y);
+  size_t slot   = find_slot(point_set, key, hash_key(key));
+
+  if (slot != point_set->capacity)
+    {
+      if (point_set->free_fn)
+        point_set->free_fn(slot_value(point_set, slot));
+      point_set->control[slot] = DELETED;
+      --point_set->size;
+      ++point_set->deleted;
+      --point_set->stats.points;
+      ++point_set->stats.node_frees;
+      success = true;
+    }
+
+  return success;
+}
+
+void *
+point_set_search (Point_Set *point_set, int x, int y)
+{
+  assert(point_set);
+
+  void *ret    = NULL;
+  uint64_t key = pack_key(x, y);
+  size_t slot  = find_slot(point_set, key, hash_key(key));
+
+  STATS_ADD(searches, 1);
+
+  if (slot != point_set->capacity)
+    ret = slot_value(point_set, slot);
+
+  return ret;
+}
+
+void
+point_set_foreach (Point_Set *point_set,
+                   void (*fn)(int x, int y, void *data, void *ctx), void *ctx)
+{
+  assert(point_set);
+  assert(fn);
+
+  visit_sorted(point_set, INT_MIN, INT_MIN, INT_MAX, INT_MAX, fn, ctx);
+}
+
+void
+point_set_foreach_in_rect (Point_Set *point_set, int x_min, int y_min,
+                           int x_max, int y_max,
+                           void (*fn)(int x, int y, void *data, void *ctx),
+                           void *ctx)
+{
+  assert(point_set);
+  assert(fn);
+
+  if (x_min > x_max || y_min > y_max)
+    return;
+
+  /* probe every coordinate of a rectangle with no more coordinates than the
+     set has points, otherwise filter and sort the whole table.  The sides
+     are compared one at a time since the area of a rectangle spanning every
+     int doesn't fit in 64 bits. */
+  uint64_t width  = (uint64_t) ((int64_t) x_max - x_min) + 1;
+  uint64_t height = (uint64_t) ((int64_t) y_max - y_min) + 1;
+  if (width > point_set->size || height > point_set->size / width)
+    {
+      visit_sorted(point_set, x_min, y_min, x_max, y_max, fn, ctx);
+      return;
+    }
+
+  for (int64_t x = x_min; x <= x_max; x++)
+    {
+      for (int64_t y = y_min; y <= y_max; y++)
+        {
+          void *data = point_set_search(point_set, x, y);
+          if (data)
+            fn(x, y, data, ctx);
+        }
+    }
+}
+
+size_t
+point_set_size (Point_Set *point_set)
+{
+  assert(point_set);
+
+  return point_set->size;
+}
+
+void
+point_set_get_stats (Point_Set *point_set, Point_Set_Stats *stats)
+{
+  assert(point_set);
+  assert(stats);
+
+  *stats = point_set->stats;
+}
+
+int
+point_set_height (Point_Set *point_set)
+{
+  assert(point_set);
+
+  return 0;
+}
+
+unsigned long
+point_set_searches (void)
+{
+  return searches;
+}
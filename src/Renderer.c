@@ -0,0 +1,378 @@
+#include "Renderer.h"
+#include <assert.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+
+/*
+ * Each character of a frame is stored as a glyph: the low byte has a bit
+ * set for every non-dead cell the character shows and the high byte a bit
+ * for every live one, so a character whose cells are all dying can be drawn
+ * dim.  Bit n stands for the cell n / width rows down and n % width columns
+ * across the character.
+ */
+typedef uint16_t Glyph;
+
+#define GLYPH_LIVE_SHIFT 8
+
+/*
+ * Frames may be captured on another thread than the one writing to the
+ * window, so the latest capture is handed over under a lock: captured
+ * frames are built in captured and presenting swaps it with frame.  The
+ * shadow and the window are only touched by the presenting thread.
+ */
+struct RENDERER
+{
+  WINDOW *window;
+  pthread_mutex_t lock;   /* guards the mode, size and captured frame */
+  Render_Mode mode;
+  int rows;               /* size of the window the buffers were made for */
+  int cols;
+  Glyph *captured;        /* the latest captured frame */
+  bool fresh;             /* captured hasn't been presented yet */
+  Glyph *frame;           /* the frame being presented */
+  Glyph *shadow;          /* the frame currently in the window */
+  bool shadow_valid;      /* false until the whole window has been drawn */
+  chtype *run;            /* a run of characters waiting to be written */
+  cchar_t *wide_run;
+};
+
+/* Cells per character of each mode */
+static const int glyph_rows[] = {
+  [render_cells]       = 1,
+  [render_half_blocks] = 2,
+  [render_braille]     = 4
+};
+static const int glyph_cols[] = {
+  [render_cells]       = 1,
+  [render_half_blocks] = 1,
+  [render_braille]     = 2
+};
+
+/* Half blocks indexed by their top and bottom cells */
+static const wchar_t half_blocks[] = { L' ', 0x2580, 0x2584, 0x2588 };
+
+/* The braille dot of each cell of a character, the dots are numbered down
+   the left column, then down the right and then along the bottom row */
+static const uint8_t braille_dots[] = {
+  0x01, 0x08, 0x02, 0x10, 0x04, 0x20, 0x40, 0x80
+};
+
+#define BRAILLE_BLANK 0x2800
+
+/*
+ * BUFFERS
+ */
+
+// Makes the buffers fit the window's current size, called with the lock held
+static bool
+fit_window (Renderer *renderer)
+{
+  bool success = true;
+  int rows, cols;
+
+  getmaxyx(renderer->window, rows, cols);
+  if (rows == renderer->rows && cols == renderer->cols && renderer->frame)
+    goto done;
+
+  size_t cells    = (size_t) rows * cols;
+  Glyph *captured = malloc(sizeof(Glyph) * (cells ? cells : 1));
+  Glyph *frame    = malloc(sizeof(Glyph) * (cells ? cells : 1));
+  Glyph *shadow   = malloc(sizeof(Glyph) * (cells ? cells : 1));
+  chtype *run     = malloc(sizeof(chtype) * (cols ? cols : 1));
+  cchar_t *wide_run = malloc(sizeof(cchar_t) * (cols ? cols : 1));
+  if (!captured || !frame || !shadow || !run || !wide_run)
+    {
+      free(captured);
+      free(frame);
+      free(shadow);
+      free(run);
+      free(wide_run);
+      success = false;
+      goto done;
+    }
+
+  // a frame captured for the old size is useless
+  free(renderer->captured);
+  free(renderer->frame);
+  free(renderer->shadow);
+  free(renderer->run);
+  free(renderer->wide_run);
+  renderer->captured     = captured;
+  renderer->fresh        = false;
+  renderer->frame        = frame;
+  renderer->shadow       = shadow;
+  renderer->run          = run;
+  renderer->wide_run     = wide_run;
+  renderer->rows         = rows;
+  renderer->cols         = cols;
+  renderer->shadow_valid = false;
+
+ done:
+  return success;
+}
+
+// Whether the locale can show characters outside of ASCII
+static bool
+mode_supported (Render_Mode mode)
+{
+  return mode == render_cells || MB_CUR_MAX > 1;
+}
+
+Renderer *
+renderer_create (WINDOW *window, Render_Mode mode)
+{
+  assert(window);
+
+  Renderer *renderer = calloc(1, sizeof(Renderer));
+  if (!renderer)
+    goto done;
+
+  pthread_mutex_init(&renderer->lock, NULL);
+  renderer->window = window;
+  renderer->mode   = mode_supported(mode) ? mode : render_cells;
+  if (!fit_window(renderer))
+    {
+      renderer_destroy(renderer);
+      renderer = NULL;
+    }
+
+ done:
+  return renderer;
+}
+
+void
+renderer_destroy (Renderer *renderer)
+{
+  pthread_mutex_destroy(&renderer->lock);
+  free(renderer->captured);
+  free(renderer->frame);
+  free(renderer->shadow);
+  free(renderer->run);
+  free(renderer->wide_run);
+  free(renderer);
+}
+
+bool
+renderer_set_mode (Renderer *renderer, Render_Mode mode)
+{
+  bool success = mode_supported(mode);
+
+  pthread_mutex_lock(&renderer->lock);
+  if (success && mode != renderer->mode)
+    {
+      renderer->mode         = mode;
+      renderer->fresh        = false;
+      renderer->shadow_valid = false;
+    }
+  pthread_mutex_unlock(&renderer->lock);
+
+  return success;
+}
+
+Render_Mode
+renderer_get_mode (Renderer *renderer)
+{
+  pthread_mutex_lock(&renderer->lock);
+  Render_Mode mode = renderer->mode;
+  pthread_mutex_unlock(&renderer->lock);
+
+  return mode;
+}
+
+void
+renderer_invalidate (Renderer *renderer)
+{
+  renderer->shadow_valid = false;
+  touchwin(renderer->window);
+}
+
+/*
+ * DRAWING
+ */
+
+struct FRAME_BUILD
+{
+  Renderer *renderer;
+  Glyph *glyphs;          /* the frame being built */
+  int top;                /* the cell shown at the top left of the window */
+  int left;
+};
+
+// Adds a non-dead cell to the glyph of the character showing it
+static void
+add_cell (int y, int x, int state, void *ctx)
+{
+  struct FRAME_BUILD *build = ctx;
+  Renderer *renderer = build->renderer;
+  int height = glyph_rows[renderer->mode];
+  int width  = glyph_cols[renderer->mode];
+  int dy     = y - build->top;
+  int dx     = x - build->left;
+  int bit    = dy % height * width + dx % width;
+  Glyph *glyph = &build->glyphs[(size_t) (dy / height) * renderer->cols
+                                 + dx / width];
+
+  *glyph |= 1 << bit;
+  if (state == 1)
+    *glyph |= 1 << (bit + GLYPH_LIVE_SHIFT);
+}
+
+static attr_t
+glyph_attr (Glyph glyph)
+{
+  return glyph >> GLYPH_LIVE_SHIFT ? A_NORMAL : A_DIM;
+}
+
+static wchar_t
+glyph_wchar (Render_Mode mode, Glyph glyph)
+{
+  wchar_t c = BRAILLE_BLANK;
+  uint8_t cells = glyph & 0xff;
+
+  if (mode == render_half_blocks)
+    c = half_blocks[cells & 3];
+  else
+    for (int bit = 0; bit < 8; bit++)
+      if (cells & (1 << bit))
+        c |= braille_dots[bit];
+
+  return c;
+}
+
+// Writes the run of characters from col_begin up to col_end of a row
+static void
+write_run (Renderer *renderer, int row, int col_begin, int col_end)
+{
+  const Glyph *glyphs = &renderer->frame[(size_t) row * renderer->cols];
+  int length = col_end - col_begin;
+
+  if (renderer->mode == render_cells)
+    {
+      for (int i = 0; i < length; i++)
+        {
+          Glyph glyph = glyphs[col_begin + i];
+          renderer->run[i] = glyph ? '#' | glyph_attr(glyph) : ' ';
+        }
+      mvwaddchnstr(renderer->window, row, col_begin, renderer->run, length);
+    }
+  else
+    {
+      for (int i = 0; i < length; i++)
+        {
+          Glyph glyph = glyphs[col_begin + i];
+          wchar_t c[2] = { glyph_wchar(renderer->mode, glyph), L'\0' };
+          setcchar(&renderer->wide_run[i], c, glyph ? glyph_attr(glyph) : 0,
+                   0, NULL);
+        }
+      mvwadd_wchnstr(renderer->window, row, col_begin, renderer->wide_run,
+                     length);
+    }
+}
+
+void
+renderer_capture (Renderer *renderer, Automaton *automaton)
+{
+  pthread_mutex_lock(&renderer->lock);
+
+  int rows   = renderer->rows;
+  int cols   = renderer->cols;
+  int height = rows * glyph_rows[renderer->mode];
+  int width  = cols * glyph_cols[renderer->mode];
+  struct FRAME_BUILD build = {
+    renderer, renderer->captured, -height / 2, -width / 2
+  };
+
+  // only the non-dead cells on screen are visited
+  memset(renderer->captured, 0, sizeof(Glyph) * rows * cols);
+  automaton_foreach_in_rect(automaton, build.top, build.left,
+                            build.top + height - 1, build.left + width - 1,
+                            add_cell, &build);
+  renderer->fresh = true;
+
+  pthread_mutex_unlock(&renderer->lock);
+}
+
+bool
+renderer_present (Renderer *renderer)
+{
+  bool success = false;
+
+  // a resized window drops the frame captured for the old size
+  pthread_mutex_lock(&renderer->lock);
+  if (fit_window(renderer) && renderer->fresh)
+    {
+      Glyph *captured    = renderer->captured;
+      renderer->captured = renderer->frame;
+      renderer->frame    = captured;
+      renderer->fresh    = false;
+      success = true;
+    }
+  pthread_mutex_unlock(&renderer->lock);
+  if (!success)
+    goto done;
+
+  // write every run of characters that differ from the ones on screen, the
+  // size and mode can only change on this thread
+  int rows = renderer->rows;
+  int cols = renderer->cols;
+  for (int row = 0; row < rows; row++)
+    {
+      const Glyph *frame  = &renderer->frame[(size_t) row * cols];
+      const Glyph *shadow = &renderer->shadow[(size_t) row * cols];
+      int col = 0;
+
+      while (col < cols)
+        {
+          if (renderer->shadow_valid && frame[col] == shadow[col])
+            {
+              col++;
+              continue;
+            }
+
+          int begin = col;
+          while (col < cols
+                 && (!renderer->shadow_valid || frame[col] != shadow[col]))
+            col++;
+          write_run(renderer, row, begin, col);
+        }
+    }
+
+  Glyph *shown           = renderer->frame;
+  renderer->frame        = renderer->shadow;
+  renderer->shadow       = shown;
+  renderer->shadow_valid = true;
+
+ done:
+  return success;
+}
+
+bool
+renderer_draw (Renderer *renderer, Automaton *automaton)
+{
+  bool success;
+
+  pthread_mutex_lock(&renderer->lock);
+  success = fit_window(renderer);
+  pthread_mutex_unlock(&renderer->lock);
+
+  if (success)
+    {
+      renderer_capture(renderer, automaton);
+      success = renderer_present(renderer);
+    }
+
+  return success;
+}
+
+void
+renderer_cell_at (Renderer *renderer, int row, int col, int *y, int *x)
+{
+  int height = glyph_rows[renderer->mode];
+  int width  = glyph_cols[renderer->mode];
+
+  *y = row * height - renderer->rows * height / 2;
+  *x = col * width - renderer->cols * width / 2;
+}
@@ -0,0 +1,837 @@
+#include "Replay.h"
+#include "Codec.h"
+#include "Rule.h"
+#include <assert.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Records are gathered into blocks of about this many bytes before being
+   compressed, which fits the 64KB window of the compressor */
+#define BLOCK_SIZE 65536
+
+static const char magic[8] = { 'L', 'I', 'F', 'E', 'R', 'E', 'P', 'L' };
+
+/* Cells being gathered for a record */
+struct CELLS
+{
+  Automaton_Change *cells;
+  size_t size;
+  size_t capacity;
+  bool failed;              /* a cell didn't fit in memory */
+};
+
+struct RECORDER
+{
+  FILE *fp;
+  int height;
+  int width;
+  bool states;              /* whether records hold the states of cells */
+  long interval;            /* most generations between keyframes */
+  long generation;          /* of the last record */
+  long keyframe;            /* generation of the last keyframe */
+  Codec_Buffer block;       /* records of the block being gathered */
+  long block_generation;    /* generation of the block's first record */
+  long block_records;
+  bool block_keyframe;      /* the block starts with a keyframe */
+  Codec_Buffer header;      /* the header of the block being written */
+  uint8_t *compressed;      /* the block's records compressed */
+  size_t compressed_capacity;
+  struct CELLS cells;
+  uint8_t *bitmap;          /* a record being stored as a bitmap */
+  bool failed;              /* a record was lost */
+};
+
+/* Where a block lies in the log, found when it is opened */
+struct BLOCK
+{
+  long offset;              /* of the block's stored records */
+  long generation;
+  long records;
+  size_t raw_size;
+  size_t size;
+  uint32_t checksum;        /* of the stored records */
+  bool keyframe;
+};
+
+/* The bytes of a header as it is read, which its checksum covers */
+struct HEADER
+{
+  uint8_t bytes[96];
+  size_t size;
+};
+
+struct PLAYER
+{
+  FILE *fp;
+  Automaton *automaton;
+  int height;
+  int width;
+  int num_states;
+  struct BLOCK *blocks;
+  size_t num_blocks;
+  size_t block;             /* the block being played */
+  long record;              /* the number of its records played */
+  uint8_t *raw;             /* the block's records */
+  uint8_t *next_raw;        /* a block being read, swapped with raw */
+  size_t raw_capacity;
+  uint8_t *stored;          /* a block as stored in the log */
+  size_t stored_capacity;
+  Codec_Reader reader;      /* the records not yet played */
+  struct CELLS cells;
+  long generation;
+};
+
+/*
+ * CELLS
+ */
+
+static void
+cells_push (struct CELLS *cells, int y, int x, int state)
+{
+  if (cells->size == cells->capacity)
+    {
+      size_t capacity = cells->capacity ? cells->capacity * 2 : 1024;
+      Automaton_Change *grown = realloc(cells->cells,
+                                        capacity * sizeof(Automaton_Change));
+      if (!grown)
+        {
+          cells->failed = true;
+          return;
+        }
+      cells->cells    = grown;
+      cells->capacity = capacity;
+    }
+
+  cells->cells[cells->size++] = (Automaton_Change) { y, x, state };
+}
+
+static bool
+cells_reserve (struct CELLS *cells, size_t count)
+{
+  if (count > cells->capacity)
+    {
+      Automaton_Change *grown = realloc(cells->cells,
+                                        count * sizeof(Automaton_Change));
+      if (!grown)
+        return false;
+      cells->cells    = grown;
+      cells->capacity = count;
+    }
+
+  return true;
+}
+
+static void
+copy_cell (int y, int x, int state, void *ctx)
+{
+  cells_push(ctx, y, x, state);
+}
+
+/*
+ * RECORDING
+ */
+
+static void
+put_checksum (Codec_Buffer *buffer, uint32_t crc)
+{
+  uint8_t checksum[4] = { crc, crc >> 8, crc >> 16, crc >> 24 };
+  codec_put(buffer, checksum, sizeof(checksum));
+}
+
+// Adds the cells gathered to the block as a list, or as a bitmap if smaller
+static void
+put_cells (Recorder *recorder)
+{
+  Codec_Buffer *block = &recorder->block;
+  struct CELLS *cells = &recorder->cells;
+  size_t size = ((size_t) recorder->height * recorder->width + 7) / 8;
+  bool bitmap = cells->size * 2 > size;
+
+  if (bitmap && !recorder->bitmap)
+    bitmap = (recorder->bitmap = malloc(size)) != NULL;
+
+  codec_sort_cells(cells->cells, cells->size);
+  codec_put_varint(block, (uint64_t) cells->size << 1 | bitmap);
+  if (!bitmap)
+    {
+      codec_put_cells(block, cells->cells, cells->size, recorder->height,
+                      recorder->width, recorder->states);
+      return;
+    }
+
+  memset(recorder->bitmap, 0, size);
+  for (size_t i = 0; i < cells->size; i++)
+    {
+      size_t row   = cells->cells[i].y + recorder->height / 2;
+      size_t col   = cells->cells[i].x + recorder->width / 2;
+      size_t index = row * recorder->width + col;
+      recorder->bitmap[index / 8] |= 1 << index % 8;
+    }
+  codec_put(block, recorder->bitmap, size);
+  if (recorder->states)
+    for (size_t i = 0; i < cells->size; i++)
+      codec_put_varint(block, cells->cells[i].state);
+}
+
+// Compresses and writes the block gathered so far, then starts a new one
+static bool
+write_block (Recorder *recorder)
+{
+  Codec_Buffer *block  = &recorder->block;
+  Codec_Buffer *header = &recorder->header;
+  bool success = !block->failed;
+  size_t bound = codec_compress_bound(block->size);
+
+  if (!recorder->block_records)
+    return success;
+
+  if (success && bound > recorder->compressed_capacity)
+    {
+      uint8_t *compressed = realloc(recorder->compressed, bound);
+      success = compressed;
+      if (compressed)
+        {
+          recorder->compressed          = compressed;
+          recorder->compressed_capacity = bound;
+        }
+    }
+
+  if (success)
+    {
+      // a block that doesn't shrink is stored as it is
+      const uint8_t *data = recorder->compressed;
+      size_t size = codec_compress(block->bytes, block->size,
+                                   recorder->compressed);
+      if (size >= block->size)
+        {
+          data = block->bytes;
+          size = block->size;
+        }
+
+      uint8_t keyframe = recorder->block_keyframe;
+      header->size = 0;
+      codec_put(header, &keyframe, 1);
+      codec_put_varint(header, recorder->block_generation);
+      codec_put_varint(header, recorder->block_records);
+      codec_put_varint(header, block->size);
+      codec_put_varint(header, size);
+      put_checksum(header, codec_crc32(0, data, size));
+      put_checksum(header, codec_crc32(0, header->bytes, header->size));
+
+      success = !header->failed
+        && fwrite(header->bytes, 1, header->size, recorder->fp)
+           == header->size
+        && fwrite(data, 1, size, recorder->fp) == size
+        && fflush(recorder->fp) == 0;
+    }
+
+  block->size   = 0;
+  block->failed = false;
+  recorder->block_records = 0;
+  return success;
+}
+
+// Adds a record to the block, starting a new block for a keyframe
+static bool
+put_record (Recorder *recorder, long generation, bool keyframe)
+{
+  bool success = true;
+
+  if (keyframe || recorder->block.size >= BLOCK_SIZE)
+    success = write_block(recorder);
+
+  if (!recorder->block_records)
+    {
+      recorder->block_generation = generation;
+      recorder->block_keyframe   = keyframe;
+    }
+
+  put_cells(recorder);
+  recorder->block_records++;
+  recorder->generation = generation;
+  if (keyframe)
+    recorder->keyframe = generation;
+
+  return success;
+}
+
+static bool
+record_keyframe (Recorder *recorder, Automaton *automaton)
+{
+  recorder->cells.size   = 0;
+  recorder->cells.failed = false;
+  automaton_foreach_in_rect(automaton, -recorder->height / 2,
+                            -recorder->width / 2,
+                            recorder->height - recorder->height / 2 - 1,
+                            recorder->width - recorder->width / 2 - 1,
+                            copy_cell, &recorder->cells);
+  if (recorder->cells.failed)
+    return false;
+
+  return put_record(recorder, automaton_get_generation(automaton), true);
+}
+
+static bool
+record_changes (Recorder *recorder, Automaton *automaton)
+{
+  size_t count;
+  const Automaton_Change *changes = automaton_get_changes(automaton, &count);
+  int y_min = -recorder->height / 2;
+  int x_min = -recorder->width / 2;
+
+  recorder->cells.size   = 0;
+  recorder->cells.failed = false;
+  if (!cells_reserve(&recorder->cells, count))
+    return false;
+
+  // the hashlife backend lists changes off the board too
+  for (size_t i = 0; i < count; i++)
+    if (changes[i].y >= y_min && changes[i].y < y_min + recorder->height
+        && changes[i].x >= x_min && changes[i].x < x_min + recorder->width)
+      recorder->cells.cells[recorder->cells.size++] = changes[i];
+
+  return put_record(recorder, automaton_get_generation(automaton), false);
+}
+
+/*
+ * PLAYING
+ */
+
+static bool
+read_bytes (FILE *fp, struct HEADER *header, size_t size)
+{
+  if (size > sizeof(header->bytes) - header->size
+      || fread(header->bytes + header->size, 1, size, fp) != size)
+    return false;
+
+  header->size += size;
+  return true;
+}
+
+static bool
+read_varint (FILE *fp, struct HEADER *header, uint64_t max, uint64_t *value)
+{
+  int c;
+
+  *value = 0;
+  for (int shift = 0; shift < 64 && header->size < sizeof(header->bytes)
+         && (c = getc(fp)) != EOF; shift += 7)
+    {
+      header->bytes[header->size++] = c;
+      *value |= (uint64_t) (c & 0x7F) << shift;
+      if (!(c & 0x80))
+        return *value <= max;
+    }
+
+  return false;
+}
+
+static uint32_t
+get_checksum (const uint8_t *bytes)
+{
+  return bytes[0] | bytes[1] << 8 | bytes[2] << 16 | (uint32_t) bytes[3] << 24;
+}
+
+// Reads the checksum ending a header, false if it doesn't match the header
+static bool
+read_checksum (FILE *fp, struct HEADER *header)
+{
+  uint8_t bytes[4];
+
+  return fread(bytes, 1, sizeof(bytes), fp) == sizeof(bytes)
+    && get_checksum(bytes) == codec_crc32(0, header->bytes, header->size);
+}
+
+static bool
+read_header (Player *player)
+{
+  struct HEADER header = { { 0 }, 0 };
+  char rule_string[RULE_STRING_MAX];
+  uint64_t version, height, width, rule_length;
+  Rule rule;
+
+  if (!read_bytes(player->fp, &header, sizeof(magic))
+      || memcmp(header.bytes, magic, sizeof(magic)) != 0
+      || !read_varint(player->fp, &header, REPLAY_VERSION, &version)
+      || version != REPLAY_VERSION
+      || !read_varint(player->fp, &header, INT_MAX, &height) || height == 0
+      || !read_varint(player->fp, &header, INT_MAX, &width) || width == 0
+      || !read_varint(player->fp, &header, RULE_STRING_MAX - 1, &rule_length)
+      || !read_bytes(player->fp, &header, rule_length)
+      || !read_checksum(player->fp, &header))
+    return false;
+
+  memcpy(rule_string, header.bytes + header.size - rule_length, rule_length);
+  rule_string[rule_length] = '\0';
+  if (!rule_parse(rule_string, &rule))
+    return false;
+
+  player->height     = height;
+  player->width      = width;
+  player->num_states = rule.num_states;
+  player->automaton  = automaton_create_backend(game_of_life, height, width,
+                                                dense_grid_backend);
+
+  return player->automaton
+    && automaton_set_rule(player->automaton, rule_string);
+}
+
+/*
+ * Finds every whole block of the log.  The blocks must follow on from each
+ * other, except that a keyframe may skip ahead, and the first must start
+ * with a keyframe.  Anything after the last whole block is ignored.
+ */
+static bool
+index_blocks (Player *player)
+{
+  size_t capacity = 0;
+  long end;
+  long data = ftell(player->fp);
+
+  if (data < 0 || fseek(player->fp, 0, SEEK_END) != 0
+      || (end = ftell(player->fp)) < 0
+      || fseek(player->fp, data, SEEK_SET) != 0)
+    return false;
+
+  for (;;)
+    {
+      struct BLOCK block;
+      struct HEADER header = { { 0 }, 0 };
+      uint64_t generation, records, raw_size, size;
+      struct BLOCK *prev = player->num_blocks
+        ? &player->blocks[player->num_blocks - 1] : NULL;
+
+      // the stored records are only checked once they're played
+      if (!read_bytes(player->fp, &header, 1) || header.bytes[0] > 1
+          || !read_varint(player->fp, &header, LONG_MAX, &generation)
+          || !read_varint(player->fp, &header, LONG_MAX - generation,
+                          &records)
+          || records == 0
+          || !read_varint(player->fp, &header, SIZE_MAX / 2, &raw_size)
+          || !read_varint(player->fp, &header, raw_size, &size)
+          || !read_bytes(player->fp, &header, 4)
+          || !read_checksum(player->fp, &header)
+          || (block.offset = ftell(player->fp)) < 0
+          || (uint64_t) (end - block.offset) < size)
+        break;
+
+      bool keyframe = header.bytes[0];
+
+      if (prev ? (long) generation < prev->generation + prev->records
+                 || (!keyframe
+                     && (long) generation != prev->generation + prev->records)
+               : !keyframe)
+        break;
+
+      if (player->num_blocks == capacity)
+        {
+          capacity = capacity ? capacity * 2 : 64;
+          struct BLOCK *grown = realloc(player->blocks,
+                                        capacity * sizeof(struct BLOCK));
+          if (!grown)
+            return false;
+          player->blocks = grown;
+        }
+
+      block.generation = generation;
+      block.records    = records;
+      block.raw_size   = raw_size;
+      block.size       = size;
+      block.keyframe   = keyframe;
+      block.checksum   = get_checksum(header.bytes + header.size - 4);
+      player->blocks[player->num_blocks++] = block;
+
+      if (fseek(player->fp, block.offset + size, SEEK_SET) != 0)
+        break;
+    }
+
+  return player->num_blocks > 0;
+}
+
+// Reads a block, leaving the player as it was if it is damaged
+static bool
+load_block (Player *player, size_t index)
+{
+  struct BLOCK *block = &player->blocks[index];
+
+  if (block->raw_size > player->raw_capacity)
+    {
+      // the records of the block being played move with their buffer
+      size_t next = player->raw ? player->reader.next - player->raw : 0;
+      size_t end  = player->raw ? player->reader.end - player->raw : 0;
+      uint8_t *raw = realloc(player->raw, block->raw_size);
+      if (!raw)
+        return false;
+      player->raw    = raw;
+      player->reader = (Codec_Reader) { raw + next, raw + end };
+      uint8_t *next_raw = realloc(player->next_raw, block->raw_size);
+      if (!next_raw)
+        return false;
+      player->next_raw     = next_raw;
+      player->raw_capacity = block->raw_size;
+    }
+  if (block->size > player->stored_capacity)
+    {
+      uint8_t *stored = realloc(player->stored, block->size);
+      if (!stored)
+        return false;
+      player->stored          = stored;
+      player->stored_capacity = block->size;
+    }
+
+  // records stored as they are are read straight into place
+  uint8_t *data = block->size == block->raw_size
+    ? player->next_raw : player->stored;
+  if (fseek(player->fp, block->offset, SEEK_SET) != 0
+      || fread(data, 1, block->size, player->fp) != block->size
+      || codec_crc32(0, data, block->size) != block->checksum
+      || (data == player->stored
+          && !codec_decompress(data, block->size, player->next_raw,
+                               block->raw_size)))
+    return false;
+
+  uint8_t *raw     = player->raw;
+  player->raw      = player->next_raw;
+  player->next_raw = raw;
+  player->block    = index;
+  player->record   = 0;
+  player->reader   = (Codec_Reader) {
+    player->raw, player->raw + block->raw_size
+  };
+
+  return true;
+}
+
+// Reads the cells of a record stored as a bitmap
+static bool
+get_bitmap (Player *player, Codec_Reader *reader, size_t count)
+{
+  size_t cells = (size_t) player->height * player->width;
+  size_t size  = (cells + 7) / 8;
+  size_t found = 0;
+  uint64_t state;
+
+  if ((size_t) (reader->end - reader->next) < size)
+    return false;
+
+  for (size_t byte = 0; byte < size; byte++)
+    for (unsigned int bits = reader->next[byte]; bits; bits &= bits - 1)
+      {
+        size_t index = byte * 8 + __builtin_ctz(bits);
+        if (index >= cells || found == count)
+          return false;
+        player->cells.cells[found++] = (Automaton_Change) {
+          index / player->width - player->height / 2,
+          index % player->width - player->width / 2, 1
+        };
+      }
+  reader->next += size;
+
+  if (player->num_states > 2)
+    for (size_t i = 0; i < count; i++)
+      {
+        if (!codec_get_varint(reader, player->num_states - 1, &state))
+          return false;
+        player->cells.cells[i].state = state;
+      }
+
+  return found == count;
+}
+
+// Reads the next record's cells, then applies them to the board
+static bool
+play_record (Player *player)
+{
+  Codec_Reader reader  = player->reader;
+  Automaton *automaton = player->automaton;
+  struct BLOCK *block  = &player->blocks[player->block];
+  uint64_t header, count;
+  bool states   = player->num_states > 2;
+  bool keyframe = block->keyframe && player->record == 0;
+  bool bitmap;
+
+  // a list takes at least two bytes a cell and a bitmap a bit a cell
+  if (!codec_get_varint(&reader, UINT64_MAX, &header))
+    return false;
+  count  = header >> 1;
+  bitmap = header & 1;
+  if (count > (bitmap ? (uint64_t) player->height * player->width
+               : (uint64_t) (reader.end - reader.next) / 2)
+      || !cells_reserve(&player->cells, count))
+    return false;
+
+  if (bitmap ? !get_bitmap(player, &reader, count)
+      : !codec_get_cells(&reader, player->cells.cells, count, player->height,
+                         player->width, states ? player->num_states - 1 : 0))
+    return false;
+
+  // the last record must end the block
+  if (player->record + 1 == block->records && reader.next != reader.end)
+    return false;
+
+  // a cell of a two-state rule that changed can only have flipped
+  if (!keyframe && !states)
+    for (uint64_t i = 0; i < count; i++)
+      player->cells.cells[i].state =
+        !automaton_get_state(automaton, player->cells.cells[i].y,
+                             player->cells.cells[i].x);
+
+  if ((keyframe && !automaton_dead_state(automaton))
+      || !automaton_set_cells(automaton, player->cells.cells, count))
+    return false;
+
+  player->reader = reader;
+  player->generation = block->generation + player->record;
+  player->record++;
+  automaton_set_generation(automaton, player->generation);
+
+  return true;
+}
+
+// The generation player_step moves to, LONG_MAX at the end of the log
+static long
+next_generation (Player *player)
+{
+  struct BLOCK *block = &player->blocks[player->block];
+
+  if (player->record < block->records)
+    return block->generation + player->record;
+  if (player->block + 1 < player->num_blocks)
+    return block[1].generation;
+  return LONG_MAX;
+}
+
+/*
+ * Starts playing a block from its first record.  If the record can't be
+ * played the player goes back to where it was in the block it was on, whose
+ * records are still in the other buffer.  The reader is kept as offsets,
+ * since loading the block may have moved that buffer.
+ */
+static bool
+play_block (Player *player, size_t index)
+{
+  size_t block = player->block;
+  long record  = player->record;
+  size_t next  = player->raw ? player->reader.next - player->raw : 0;
+  size_t end   = player->raw ? player->reader.end - player->raw : 0;
+
+  if (!load_block(player, index))
+    return false;
+  if (play_record(player))
+    return true;
+
+  uint8_t *raw     = player->raw;
+  player->raw      = player->next_raw;
+  player->next_raw = raw;
+  player->block    = block;
+  player->record   = record;
+  player->reader   = (Codec_Reader) { player->raw + next, player->raw + end };
+  return false;
+}
+
+/*
+ * Definitions for the interface functions found in the header
+ */
+
+Recorder *
+recorder_create (Automaton *automaton, const char *path,
+                 long keyframe_interval)
+{
+  assert(automaton);
+  assert(path);
+  assert(keyframe_interval >= 1);
+
+  Recorder *recorder = calloc(1, sizeof(Recorder));
+  char rule_string[RULE_STRING_MAX];
+  Codec_Buffer header = { NULL, 0, 0, false };
+  Rule rule;
+
+  if (!recorder)
+    goto done;
+
+  automaton_get_rule(automaton, rule_string, sizeof(rule_string));
+  rule_parse(rule_string, &rule);
+  recorder->height   = automaton_get_height(automaton);
+  recorder->width    = automaton_get_width(automaton);
+  recorder->states   = rule.num_states > 2;
+  recorder->interval = keyframe_interval;
+  recorder->fp       = fopen(path, "wb");
+  if (!recorder->fp)
+    goto err;
+
+  size_t rule_length = strlen(rule_string);
+  codec_put(&header, magic, sizeof(magic));
+  codec_put_varint(&header, REPLAY_VERSION);
+  codec_put_varint(&header, recorder->height);
+  codec_put_varint(&header, recorder->width);
+  codec_put_varint(&header, rule_length);
+  codec_put(&header, rule_string, rule_length);
+  put_checksum(&header, codec_crc32(0, header.bytes, header.size));
+  if (header.failed
+      || fwrite(header.bytes, 1, header.size, recorder->fp) != header.size)
+    goto err;
+
+  automaton_set_change_tracking(automaton, true);
+  if (!record_keyframe(recorder, automaton))
+    goto err;
+  goto done;
+
+ err:
+  recorder_destroy(recorder);
+  recorder = NULL;
+ done:
+  free(header.bytes);
+  return recorder;
+}
+
+bool
+recorder_destroy (Recorder *recorder)
+{
+  bool success = !recorder->failed;
+
+  if (recorder->fp)
+    {
+      success = write_block(recorder) && success;
+      success = fclose(recorder->fp) == 0 && success;
+    }
+  free(recorder->block.bytes);
+  free(recorder->header.bytes);
+  free(recorder->compressed);
+  free(recorder->cells.cells);
+  free(recorder->bitmap);
+  free(recorder);
+
+  return success;
+}
+
+bool
+recorder_record (Recorder *recorder, Automaton *automaton)
+{
+  assert(automaton);
+
+  long generation = automaton_get_generation(automaton);
+  bool success;
+
+  if (generation <= recorder->generation)
+    return false;
+
+  if (generation != recorder->generation + 1
+      || generation - recorder->keyframe >= recorder->interval)
+    success = record_keyframe(recorder, automaton);
+  else
+    success = record_changes(recorder, automaton);
+
+  if (!success)
+    recorder->failed = true;
+  return success;
+}
+
+Player *
+player_open (const char *path)
+{
+  assert(path);
+
+  Player *player = calloc(1, sizeof(Player));
+  if (!player)
+    goto done;
+
+  player->fp = fopen(path, "rb");
+  if (!player->fp || !read_header(player) || !index_blocks(player)
+      || !play_block(player, 0))
+    goto err;
+  goto done;
+
+ err:
+  player_destroy(player);
+  player = NULL;
+ done:
+  return player;
+}
+
+void
+player_destroy (Player *player)
+{
+  if (player->fp)
+    fclose(player->fp);
+  if (player->automaton)
+    automaton_destroy(player->automaton);
+  free(player->blocks);
+  free(player->raw);
+  free(player->next_raw);
+  free(player->stored);
+  free(player->cells.cells);
+  free(player);
+}
+
+Automaton *
+player_get_automaton (Player *player)
+{
+  return player->automaton;
+}
+
+long
+player_get_generation (Player *player)
+{
+  return player->generation;
+}
+
+long
+player_get_first_generation (Player *player)
+{
+  return player->blocks[0].generation;
+}
+
+long
+player_get_last_generation (Player *player)
+{
+  struct BLOCK *last = &player->blocks[player->num_blocks - 1];
+  return last->generation + last->records - 1;
+}
+
+bool
+player_step (Player *player)
+{
+  if (player->record < player->blocks[player->block].records)
+    return play_record(player);
+
+  size_t next = player->block + 1;
+  if (next == player->num_blocks)
+    return false;
+
+  return play_block(player, next);
+}
+
+bool
+player_seek (Player *player, long generation)
+{
+  size_t target = player->num_blocks;
+
+  if (generation < player_get_first_generation(player)
+      || generation > player_get_last_generation(player))
+    return false;
+
+  // the block holding the generation, or the last before it
+  while (player->blocks[target - 1].generation > generation)
+    target--;
+  target--;
+
+  // playing on from where the player is is cheaper unless a keyframe lies
+  // between, which is where it has to start from otherwise
+  size_t start = target;
+  while (!player->blocks[start].keyframe)
+    start--;
+  if (generation < player->generation || player->block < start)
+    {
+      if (!play_block(player, start))
+        return false;
+    }
+
+  while (next_generation(player) <= generation)
+    if (!player_step(player))
+      return false;
+
+  return true;
+}
@@ -0,0 +1,201 @@
+#include "Rule.h"
+#include <assert.h>
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+
+void
+rule_init (Rule *rule, uint16_t birth, uint16_t survival, int num_states,
+           bool von_neumann)
+{
+  assert(rule);
+  assert(num_states >= 2 && num_states <= RULE_MAX_STATES);
+
+  int max_neighbours = von_neumann ? 4 : RULE_MAX_NEIGHBOURS;
+  uint16_t counts    = (1 << (max_neighbours + 1)) - 1;
+
+  rule->birth       = birth & counts;
+  rule->survival    = survival & counts;
+  rule->num_states  = num_states;
+  rule->von_neumann = von_neumann;
+
+  // a live cell that doesn't survive starts dying, or dies straight away
+  for (int count = 0; count <= RULE_MAX_NEIGHBOURS; count++)
+    {
+      rule->next[0][count] = (rule->birth >> count) & 1;
+      rule->next[1][count] = (rule->survival >> count) & 1
+        ? 1 : num_states > 2 ? 2 : 0;
+    }
+}
+
+/*
+ * PARSING
+ */
+
+// Parses a list of neighbour counts into a mask, stopping at a slash
+static bool
+parse_counts (const char **string, int max_neighbours, uint16_t *mask)
+{
+  const char *c = *string;
+
+  *mask = 0;
+  for (; *c && *c != '/'; c++)
+    {
+      if (*c < '0' || *c > '0' + max_neighbours)
+        return false;
+      *mask |= 1 << (*c - '0');
+    }
+
+  *string = c;
+  return true;
+}
+
+// Parses the number of states of a Generations rule, stopping at a slash
+static bool
+parse_states (const char **string, int *num_states)
+{
+  const char *c = *string;
+  int states    = 0;
+
+  for (; *c && *c != '/'; c++)
+    {
+      if (!isdigit((unsigned char) *c) || states > RULE_MAX_STATES)
+        return false;
+      states = states * 10 + (*c - '0');
+    }
+
+  if (c == *string || states < 2 || states > RULE_MAX_STATES)
+    return false;
+
+  *string     = c;
+  *num_states = states;
+  return true;
+}
+
+bool
+rule_parse (const char *string, Rule *rule)
+{
+  assert(string);
+  assert(rule);
+
+  bool success     = false;
+  bool von_neumann = false;
+  bool prefixed;
+  bool seen[3]     = { false, false, false }; /* birth, survival, states */
+  uint16_t masks[2] = { 0, 0 };
+  int num_states   = 2;
+  int part         = 0;
+  char buffer[RULE_STRING_MAX * 2];
+  const char *c;
+
+  // take the neighbourhood suffix off a private copy of the string
+  size_t length = strlen(string);
+  if (length == 0 || length >= sizeof(buffer))
+    goto done;
+  memcpy(buffer, string, length + 1);
+  if (toupper((unsigned char) buffer[length - 1]) == 'V')
+    {
+      von_neumann = true;
+      buffer[--length] = '\0';
+    }
+
+  c = buffer;
+  prefixed = isalpha((unsigned char) *c);
+  for (;; part++)
+    {
+      // either every part starts with its letter or none of them do
+      int kind;
+      if (prefixed)
+        {
+          switch (toupper((unsigned char) *c))
+            {
+            case 'B':
+              kind = 0;
+              break;
+            case 'S':
+              kind = 1;
+              break;
+            case 'C':
+              kind = 2;
+              break;
+            default:
+              goto done;
+            }
+          c++;
+        }
+      else
+        {
+          // the classic form lists survival, then birth, then states
+          static const int order[] = { 1, 0, 2 };
+          if (part >= 3)
+            goto done;
+          kind = order[part];
+        }
+
+      if (seen[kind])
+        goto done;
+      seen[kind] = true;
+
+      if (kind == 2 ? !parse_states(&c, &num_states)
+          : !parse_counts(&c, von_neumann ? 4 : RULE_MAX_NEIGHBOURS,
+                          &masks[kind]))
+        goto done;
+
+      if (!*c)
+        break;
+      c++;
+    }
+
+  if (!seen[0] || !seen[1])
+    goto done;
+
+  rule_init(rule, masks[0], masks[1], num_states, von_neumann);
+  success = true;
+
+ done:
+  return success;
+}
+
+/*
+ * FORMATTING
+ */
+
+size_t
+rule_format (const Rule *rule, char *buffer, size_t size)
+{
+  assert(rule);
+
+  char string[RULE_STRING_MAX];
+  size_t length = 0;
+  const uint16_t masks[2] = { rule->birth, rule->survival };
+
+  for (int kind = 0; kind < 2; kind++)
+    {
+      if (kind)
+        string[length++] = '/';
+      string[length++] = kind ? 'S' : 'B';
+      for (int count = 0; count <= RULE_MAX_NEIGHBOURS; count++)
+        {
+          if ((masks[kind] >> count) & 1)
+            string[length++] = '0' + count;
+        }
+    }
+
+  if (rule->num_states > 2)
+    length += sprintf(string + length, "/C%d", rule->num_states);
+  if (rule->von_neumann)
+    string[length++] = 'V';
+  string[length] = '\0';
+
+  if (size)
+    snprintf(buffer, size, "%s", string);
+
+  return length;
+}
+
+bool
+rule_equal (const Rule *a, const Rule *b)
+{
+  return a->birth == b->birth && a->survival == b->survival
+    && a->num_states == b->num_states && a->von_neumann == b->von_neumann;
+}
@@ -0,0 +1,236 @@
+#include "Simulation.h"
+#include <assert.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <time.h>
+
+struct SIMULATION
+{
+  Automaton *automaton;
+  void (*frame_fn)(Automaton *automaton, void *ctx);
+  void *ctx;
+  pthread_t thread;
+  pthread_mutex_t lock;       /* guards everything below except frame_wanted */
+  pthread_cond_t changed;     /* signalled when the fields below change */
+  pthread_cond_t idle;        /* signalled when a generation finishes */
+  bool running;
+  bool stepping;              /* a generation is in progress */
+  bool stopping;
+  double rate;                /* generations per second, 0 if unlimited */
+  long generations;
+  struct timespec last_start; /* when the last generation was started */
+  atomic_bool frame_wanted;
+};
+
+static struct timespec
+add_seconds (struct timespec time, double seconds)
+{
+  long nanoseconds = (long) (seconds * 1e9);
+
+  time.tv_sec  += nanoseconds / 1000000000;
+  time.tv_nsec += nanoseconds % 1000000000;
+  if (time.tv_nsec >= 1000000000)
+    {
+      time.tv_sec++;
+      time.tv_nsec -= 1000000000;
+    }
+
+  return time;
+}
+
+static bool
+is_before (const struct timespec *a, const struct timespec *b)
+{
+  return a->tv_sec < b->tv_sec
+    || (a->tv_sec == b->tv_sec && a->tv_nsec < b->tv_nsec);
+}
+
+// Waits until the next generation is due, called with the lock held
+static void
+wait_for_rate (Simulation *simulation)
+{
+  for (;;)
+    {
+      struct timespec now, due;
+
+      if (!simulation->running || simulation->stopping
+          || simulation->rate <= 0)
+        break;
+
+      // the rate may change while waiting so the due time is recomputed
+      clock_gettime(CLOCK_MONOTONIC, &now);
+      due = add_seconds(simulation->last_start, 1 / simulation->rate);
+      if (!is_before(&now, &due))
+        break;
+      pthread_cond_timedwait(&simulation->changed, &simulation->lock, &due);
+    }
+}
+
+static void *
+simulation_main (void *arg)
+{
+  Simulation *simulation = arg;
+
+  pthread_mutex_lock(&simulation->lock);
+  for (;;)
+    {
+      while (!simulation->running && !simulation->stopping)
+        pthread_cond_wait(&simulation->changed, &simulation->lock);
+      if (simulation->stopping)
+        break;
+
+      clock_gettime(CLOCK_MONOTONIC, &simulation->last_start);
+      simulation->stepping = true;
+      pthread_mutex_unlock(&simulation->lock);
+
+      // the automaton is only touched without the lock, so setting the rate
+      // or requesting a frame never waits for a generation
+      bool success = automaton_update_state(simulation->automaton);
+      if (success && simulation->frame_fn
+          && atomic_exchange(&simulation->frame_wanted, false))
+        simulation->frame_fn(simulation->automaton, simulation->ctx);
+
+      pthread_mutex_lock(&simulation->lock);
+      simulation->stepping = false;
+      if (success)
+        simulation->generations++;
+      else
+        simulation->running = false;
+      pthread_cond_broadcast(&simulation->idle);
+
+      wait_for_rate(simulation);
+    }
+  pthread_mutex_unlock(&simulation->lock);
+
+  return NULL;
+}
+
+Simulation *
+simulation_create (Automaton *automaton,
+                   void (*frame_fn)(Automaton *automaton, void *ctx),
+                   void *ctx)
+{
+  assert(automaton);
+
+  pthread_condattr_t attr;
+  Simulation *simulation = malloc(sizeof(Simulation));
+  if (!simulation)
+    goto done;
+
+  simulation->automaton   = automaton;
+  simulation->frame_fn    = frame_fn;
+  simulation->ctx         = ctx;
+  simulation->running     = false;
+  simulation->stepping    = false;
+  simulation->stopping    = false;
+  simulation->rate        = 0;
+  simulation->generations = 0;
+  atomic_init(&simulation->frame_wanted, false);
+  clock_gettime(CLOCK_MONOTONIC, &simulation->last_start);
+
+  // timed waits are against the monotonic clock the rate is measured with
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_mutex_init(&simulation->lock, NULL);
+  pthread_cond_init(&simulation->changed, &attr);
+  pthread_cond_init(&simulation->idle, NULL);
+  pthread_condattr_destroy(&attr);
+
+  if (pthread_create(&simulation->thread, NULL, simulation_main,
+                     simulation) != 0)
+    goto err;
+  goto done;
+
+ err:
+  pthread_mutex_destroy(&simulation->lock);
+  pthread_cond_destroy(&simulation->changed);
+  pthread_cond_destroy(&simulation->idle);
+  free(simulation);
+  simulation = NULL;
+ done:
+  return simulation;
+}
+
+void
+simulation_destroy (Simulation *simulation)
+{
+  pthread_mutex_lock(&simulation->lock);
+  simulation->stopping = true;
+  pthread_cond_broadcast(&simulation->changed);
+  pthread_mutex_unlock(&simulation->lock);
+
+  pthread_join(simulation->thread, NULL);
+
+  pthread_mutex_destroy(&simulation->lock);
+  pthread_cond_destroy(&simulation->changed);
+  pthread_cond_destroy(&simulation->idle);
+  free(simulation);
+}
+
+void
+simulation_run (Simulation *simulation)
+{
+  pthread_mutex_lock(&simulation->lock);
+  simulation->running = true;
+  pthread_cond_broadcast(&simulation->changed);
+  pthread_mutex_unlock(&simulation->lock);
+}
+
+void
+simulation_pause (Simulation *simulation)
+{
+  pthread_mutex_lock(&simulation->lock);
+  simulation->running = false;
+  pthread_cond_broadcast(&simulation->changed);
+  while (simulation->stepping)
+    pthread_cond_wait(&simulation->idle, &simulation->lock);
+  pthread_mutex_unlock(&simulation->lock);
+}
+
+bool
+simulation_is_running (Simulation *simulation)
+{
+  pthread_mutex_lock(&simulation->lock);
+  bool running = simulation->running;
+  pthread_mutex_unlock(&simulation->lock);
+
+  return running;
+}
+
+void
+simulation_set_rate (Simulation *simulation, double rate)
+{
+  assert(rate >= 0);
+
+  pthread_mutex_lock(&simulation->lock);
+  simulation->rate = rate;
+  pthread_cond_broadcast(&simulation->changed);
+  pthread_mutex_unlock(&simulation->lock);
+}
+
+double
+simulation_get_rate (Simulation *simulation)
+{
+  pthread_mutex_lock(&simulation->lock);
+  double rate = simulation->rate;
+  pthread_mutex_unlock(&simulation->lock);
+
+  return rate;
+}
+
+void
+simulation_request_frame (Simulation *simulation)
+{
+  atomic_store(&simulation->frame_wanted, true);
+}
+
+long
+simulation_get_generations (Simulation *simulation)
+{
+  pthread_mutex_lock(&simulation->lock);
+  long generations = simulation->generations;
+  pthread_mutex_unlock(&simulation->lock);
+
+  return generations;
+}
@@ -0,0 +1,159 @@
+#include "ThreadPool.h"
+#include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
+
+struct THREAD_POOL
+{
+  int size;                 /* workers including the calling thread */
+  int started;              /* threads that were successfully started */
+  pthread_t *threads;
+  pthread_mutex_t lock;
+  pthread_cond_t job_posted;
+  pthread_cond_t job_done;
+  unsigned long job;        /* incremented every time a job is posted */
+  int running;              /* threads still running the current job */
+  bool stopping;
+  void (*fn)(int worker, int workers, void *ctx);
+  void *ctx;
+};
+
+struct WORKER
+{
+  Thread_Pool *pool;
+  int index;
+};
+
+static void *
+worker_main (void *arg)
+{
+  struct WORKER *worker = arg;
+  Thread_Pool *pool     = worker->pool;
+  int index             = worker->index;
+  unsigned long seen    = 0;
+
+  free(worker);
+
+  pthread_mutex_lock(&pool->lock);
+  for (;;)
+    {
+      while (pool->job == seen && !pool->stopping)
+        pthread_cond_wait(&pool->job_posted, &pool->lock);
+      if (pool->stopping)
+        break;
+
+      seen = pool->job;
+      pthread_mutex_unlock(&pool->lock);
+
+      pool->fn(index, pool->size, pool->ctx);
+
+      // the last worker to finish wakes up the caller
+      pthread_mutex_lock(&pool->lock);
+      if (--pool->running == 0)
+        pthread_cond_signal(&pool->job_done);
+    }
+  pthread_mutex_unlock(&pool->lock);
+
+  return NULL;
+}
+
+Thread_Pool *
+thread_pool_create (int workers)
+{
+  assert(workers > 0);
+
+  Thread_Pool *pool = malloc(sizeof(Thread_Pool));
+  if (!pool)
+    goto done;
+
+  pool->size     = workers;
+  pool->started  = 0;
+  pool->job      = 0;
+  pool->running  = 0;
+  pool->stopping = false;
+  pool->fn       = NULL;
+  pool->ctx      = NULL;
+  pool->threads  = malloc(sizeof(pthread_t) * workers);
+  if (!pool->threads)
+    {
+      free(pool);
+      pool = NULL;
+      goto done;
+    }
+
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_cond_init(&pool->job_posted, NULL);
+  pthread_cond_init(&pool->job_done, NULL);
+
+  // worker 0 is the calling thread so only the others need starting
+  for (int index = 1; index < workers; index++)
+    {
+      struct WORKER *worker = malloc(sizeof(struct WORKER));
+      if (!worker)
+        goto err;
+
+      worker->pool  = pool;
+      worker->index = index;
+      if (pthread_create(&pool->threads[pool->started], NULL, worker_main,
+                         worker) != 0)
+        {
+          free(worker);
+          goto err;
+        }
+      pool->started++;
+    }
+  goto done;
+
+ err:
+  thread_pool_destroy(pool);
+  pool = NULL;
+ done:
+  return pool;
+}
+
+void
+thread_pool_destroy (Thread_Pool *pool)
+{
+  pthread_mutex_lock(&pool->lock);
+  pool->stopping = true;
+  pthread_cond_broadcast(&pool->job_posted);
+  pthread_mutex_unlock(&pool->lock);
+
+  for (int i = 0; i < pool->started; i++)
+    pthread_join(pool->threads[i], NULL);
+
+  pthread_mutex_destroy(&pool->lock);
+  pthread_cond_destroy(&pool->job_posted);
+  pthread_cond_destroy(&pool->job_done);
+  free(pool->threads);
+  free(pool);
+}
+
+int
+thread_pool_size (Thread_Pool *pool)
+{
+  return pool->size;
+}
+
+void
+thread_pool_run (Thread_Pool *pool,
+                 void (*fn)(int worker, int workers, void *ctx), void *ctx)
+{
+  assert(pool);
+  assert(fn);
+
+  pthread_mutex_lock(&pool->lock);
+  pool->fn      = fn;
+  pool->ctx     = ctx;
+  pool->running = pool->started;
+  pool->job++;
+  pthread_cond_broadcast(&pool->job_posted);
+  pthread_mutex_unlock(&pool->lock);
+
+  fn(0, pool->size, ctx);
+
+  pthread_mutex_lock(&pool->lock);
+  while (pool->running > 0)
+    pthread_cond_wait(&pool->job_done, &pool->lock);
+  pthread_mutex_unlock(&pool->lock);
+}
@@ -0,0 +1,474 @@
+#include "Wavefront.h"
+#include "Stats.h"
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/* A growable array of cell indices */
+struct CELL_LIST
+{
+  size_t *cells;
+  size_t size;
+  size_t capacity;
+};
+
+/*
+ * Every non-dead cell is on exactly one of the live and dying lists, which
+ * the listed flags keep free of duplicates.  Cells set from outside are only
+ * added to a list when they aren't already on one, so between steps a list
+ * can hold cells that have since died or changed state.  Each step looks at
+ * the current state of every listed cell and writes fresh lists.
+ */
+struct WAVEFRONT
+{
+  int height;
+  int width;
+  Rule rule;
+  uint8_t *states;              /* the state of every cell, row by row */
+  uint8_t *counts;              /* live neighbours, only non-zero in a step */
+  uint8_t *listed;              /* whether each cell is on a list */
+  struct CELL_LIST live;        /* cells that were live when listed */
+  struct CELL_LIST dying;       /* cells that were dying when listed */
+  struct CELL_LIST next_live;   /* the lists written by a step */
+  struct CELL_LIST next_dying;
+  struct CELL_LIST touched;     /* cells with a live neighbour this step */
+  struct CELL_LIST born;        /* dead cells born this step */
+  struct CELL_LIST changed;     /* cells whose state the last step changed */
+  uint64_t evaluated;           /* counted with COLLECT_STATS */
+};
+
+/*
+ * CELL LISTS
+ */
+
+// Makes room for at least the given number of cells
+static bool
+list_reserve (struct CELL_LIST *list, size_t capacity)
+{
+  bool success = true;
+
+  if (capacity > list->capacity)
+    {
+      size_t new_capacity = list->capacity ? list->capacity : 64;
+      while (new_capacity < capacity)
+        new_capacity *= 2;
+
+      size_t *cells = realloc(list->cells, sizeof(size_t) * new_capacity);
+      success = cells != NULL;
+      if (success)
+        {
+          list->cells    = cells;
+          list->capacity = new_capacity;
+        }
+    }
+
+  return success;
+}
+
+// Adds a cell to a list that has already been given room for it
+static inline void
+list_push (struct CELL_LIST *list, size_t cell)
+{
+  assert(list->size < list->capacity);
+  list->cells[list->size++] = cell;
+}
+
+static void
+list_swap (struct CELL_LIST *a, struct CELL_LIST *b)
+{
+  struct CELL_LIST temp = *a;
+  *a = *b;
+  *b = temp;
+}
+
+/*
+ * CONSTRUCTION AND DESTRUCTION
+ */
+
+// Allocates the per-cell arrays and lists of an empty board
+static bool
+board_alloc (Wavefront *wavefront, int height, int width)
+{
+  size_t cells = (size_t) height * width;
+
+  *wavefront = (Wavefront) { .height = height, .width = width,
+                             .rule = wavefront->rule };
+  wavefront->states = calloc(cells ? cells : 1, 1);
+  wavefront->counts = calloc(cells ? cells : 1, 1);
+  wavefront->listed = calloc(cells ? cells : 1, 1);
+
+  return wavefront->states && wavefront->counts && wavefront->listed;
+}
+
+static void
+board_free (Wavefront *wavefront)
+{
+  free(wavefront->states);
+  free(wavefront->counts);
+  free(wavefront->listed);
+  free(wavefront->live.cells);
+  free(wavefront->dying.cells);
+  free(wavefront->next_live.cells);
+  free(wavefront->next_dying.cells);
+  free(wavefront->touched.cells);
+  free(wavefront->born.cells);
+  free(wavefront->changed.cells);
+}
+
+Wavefront *
+wavefront_create (int height, int width, const Rule *rule)
+{
+  assert(height >= 0 && width >= 0);
+  assert(!(rule->birth & 1));
+
+  Wavefront *wavefront = malloc(sizeof(Wavefront));
+  if (!wavefront)
+    goto done;
+
+  wavefront->rule = *rule;
+  if (!board_alloc(wavefront, height, width))
+    {
+      board_free(wavefront);
+      free(wavefront);
+      wavefront = NULL;
+    }
+
+ done:
+  return wavefront;
+}
+
+void
+wavefront_destroy (Wavefront *wavefront)
+{
+  board_free(wavefront);
+  free(wavefront);
+}
+
+/*
+ * CELL ACCESS
+ */
+
+// Finds the index of a cell, returning false if it is outside the board
+static inline bool
+cell_index (Wavefront *wavefront, int y, int x, size_t *cell)
+{
+  int row = y + wavefront->height / 2;
+  int col = x + wavefront->width / 2;
+  bool inside = row >= 0 && row < wavefront->height
+    && col >= 0 && col < wavefront->width;
+
+  if (inside)
+    *cell = (size_t) row * wavefront->width + col;
+
+  return inside;
+}
+
+int
+wavefront_get (Wavefront *wavefront, int y, int x)
+{
+  size_t cell;
+
+  return cell_index(wavefront, y, x, &cell) ? wavefront->states[cell] : 0;
+}
+
+bool
+wavefront_set (Wavefront *wavefront, int y, int x, int state)
+{
+  assert(state >= 0 && state < wavefront->rule.num_states);
+
+  bool success = false;
+  size_t cell;
+
+  if (!cell_index(wavefront, y, x, &cell))
+    goto done;
+
+  if (state && !wavefront->listed[cell])
+    {
+      struct CELL_LIST *list = state == 1
+        ? &wavefront->live : &wavefront->dying;
+      if (!list_reserve(list, list->size + 1))
+        goto done;
+      list_push(list, cell);
+      wavefront->listed[cell] = 1;
+    }
+  wavefront->states[cell] = state;
+  success = true;
+
+ done:
+  return success;
+}
+
+void
+wavefront_clear (Wavefront *wavefront)
+{
+  struct CELL_LIST *lists[] = { &wavefront->live, &wavefront->dying };
+
+  // only the listed cells can be non-dead
+  for (int l = 0; l < 2; l++)
+    {
+      for (size_t i = 0; i < lists[l]->size; i++)
+        {
+          wavefront->states[lists[l]->cells[i]] = 0;
+          wavefront->listed[lists[l]->cells[i]] = 0;
+        }
+      lists[l]->size = 0;
+    }
+  wavefront->changed.size = 0;
+}
+
+void
+wavefront_set_rule (Wavefront *wavefront, const Rule *rule)
+{
+  assert(!(rule->birth & 1));
+
+  struct CELL_LIST *lists[] = { &wavefront->live, &wavefront->dying };
+
+  // cells in states past the new rule's last state die
+  for (int l = 0; l < 2; l++)
+    {
+      for (size_t i = 0; i < lists[l]->size; i++)
+        {
+          size_t cell = lists[l]->cells[i];
+          if (wavefront->states[cell] >= rule->num_states)
+            wavefront->states[cell] = 0;
+        }
+    }
+
+  wavefront->rule = *rule;
+}
+
+bool
+wavefront_resize (Wavefront *wavefront, int height, int width)
+{
+  assert(height >= 0 && width >= 0);
+
+  bool success = false;
+  Wavefront resized = { .rule = wavefront->rule };
+  struct CELL_LIST *lists[] = { &wavefront->live, &wavefront->dying };
+
+  if (!board_alloc(&resized, height, width)
+      || !list_reserve(&resized.live, wavefront->live.size)
+      || !list_reserve(&resized.dying, wavefront->dying.size))
+    goto err;
+
+  // move every listed cell that is still inside the borders
+  for (int l = 0; l < 2; l++)
+    {
+      struct CELL_LIST *list = lists[l];
+      struct CELL_LIST *resized_list = l == 0 ? &resized.live : &resized.dying;
+
+      for (size_t i = 0; i < list->size; i++)
+        {
+          size_t cell = list->cells[i];
+          int state   = wavefront->states[cell];
+          int y       = cell / wavefront->width - wavefront->height / 2;
+          int x       = cell % wavefront->width - wavefront->width / 2;
+          size_t resized_cell;
+
+          if (state && cell_index(&resized, y, x, &resized_cell))
+            {
+              resized.states[resized_cell] = state;
+              resized.listed[resized_cell] = 1;
+              list_push(resized_list, resized_cell);
+            }
+        }
+    }
+
+  board_free(wavefront);
+  *wavefront = resized;
+  success = true;
+  goto done;
+
+ err:
+  board_free(&resized);
+ done:
+  return success;
+}
+
+/*
+ * UPDATE
+ */
+
+// Adds one to the live neighbour count of every neighbour of a live cell
+static void
+count_neighbours (Wavefront *wavefront, size_t cell)
+{
+  static const int moore[][2] = {
+    { -1, -1 }, { -1, 0 }, { -1, 1 }, { 0, -1 },
+    { 0, 1 }, { 1, -1 }, { 1, 0 }, { 1, 1 }
+  };
+  static const int von_neumann[][2] = {
+    { -1, 0 }, { 0, -1 }, { 0, 1 }, { 1, 0 }
+  };
+  const int (*offsets)[2] = wavefront->rule.von_neumann ? von_neumann : moore;
+  int num_offsets = wavefront->rule.von_neumann ? 4 : 8;
+  int row = cell / wavefront->width;
+  int col = cell % wavefront->width;
+
+  for (int i = 0; i < num_offsets; i++)
+    {
+      int n_row = row + offsets[i][0];
+      int n_col = col + offsets[i][1];
+
+      if (n_row < 0 || n_row >= wavefront->height
+          || n_col < 0 || n_col >= wavefront->width)
+        continue;
+
+      size_t neighbour = (size_t) n_row * wavefront->width + n_col;
+      if (wavefront->counts[neighbour]++ == 0)
+        list_push(&wavefront->touched, neighbour);
+    }
+}
+
+bool
+wavefront_step (Wavefront *wavefront)
+{
+  bool success = false;
+  const Rule *rule = &wavefront->rule;
+  struct CELL_LIST *lists[] = { &wavefront->live, &wavefront->dying };
+  size_t listed = wavefront->live.size + wavefront->dying.size;
+  size_t cells  = (size_t) wavefront->height * wavefront->width;
+  size_t touched_max = listed * (rule->von_neumann ? 4 : 8);
+
+  if (touched_max > cells)
+    touched_max = cells;
+
+  // make room up front so the step can't fail half way through
+  if (!list_reserve(&wavefront->touched, touched_max)
+      || !list_reserve(&wavefront->born, touched_max)
+      || !list_reserve(&wavefront->next_live, listed + touched_max)
+      || !list_reserve(&wavefront->next_dying, listed)
+      || !list_reserve(&wavefront->changed, listed + touched_max))
+    goto done;
+  wavefront->changed.size = 0;
+
+  // only the neighbours of live cells can have a live neighbour
+  for (int l = 0; l < 2; l++)
+    for (size_t i = 0; i < lists[l]->size; i++)
+      if (wavefront->states[lists[l]->cells[i]] == 1)
+        count_neighbours(wavefront, lists[l]->cells[i]);
+
+  // every listed cell and every cell with a live neighbour is evaluated
+  STATS_ADD(wavefront->evaluated, listed + wavefront->touched.size);
+
+  // births are found before any cell changes so they see the old states
+  for (size_t i = 0; i < wavefront->touched.size; i++)
+    {
+      size_t cell = wavefront->touched.cells[i];
+      if (wavefront->states[cell] == 0
+          && rule_next_state(rule, 0, wavefront->counts[cell]))
+        list_push(&wavefront->born, cell);
+    }
+
+  // every listed cell survives, starts dying, ages or dies
+  for (int l = 0; l < 2; l++)
+    {
+      for (size_t i = 0; i < lists[l]->size; i++)
+        {
+          size_t cell = lists[l]->cells[i];
+          int state   = wavefront->states[cell];
+
+          wavefront->listed[cell] = 0;
+          if (state == 0)
+            continue;
+
+          int next_state = rule_next_state(rule, state,
+                                           wavefront->counts[cell]);
+          if (next_state != state)
+            list_push(&wavefront->changed, cell);
+
+          state = next_state;
+          wavefront->states[cell] = state;
+          if (state)
+            {
+              list_push(state == 1
+                        ? &wavefront->next_live : &wavefront->next_dying,
+                        cell);
+              wavefront->listed[cell] = 1;
+            }
+        }
+      lists[l]->size = 0;
+    }
+
+  for (size_t i = 0; i < wavefront->born.size; i++)
+    {
+      size_t cell = wavefront->born.cells[i];
+      wavefront->states[cell] = 1;
+      wavefront->listed[cell] = 1;
+      list_push(&wavefront->next_live, cell);
+      list_push(&wavefront->changed, cell);
+    }
+
+  // leave the counts zeroed for the next step
+  for (size_t i = 0; i < wavefront->touched.size; i++)
+    wavefront->counts[wavefront->touched.cells[i]] = 0;
+  wavefront->touched.size = 0;
+  wavefront->born.size    = 0;
+
+  list_swap(&wavefront->live, &wavefront->next_live);
+  list_swap(&wavefront->dying, &wavefront->next_dying);
+  success = true;
+
+ done:
+  return success;
+}
+
+/*
+ * GETTERS
+ */
+
+void
+wavefront_foreach_in_rect (Wavefront *wavefront, int y_min, int x_min,
+                           int y_max, int x_max,
+                           void (*fn)(int y, int x, int state, void *ctx),
+                           void *ctx)
+{
+  struct CELL_LIST *lists[] = { &wavefront->live, &wavefront->dying };
+
+  for (int l = 0; l < 2; l++)
+    {
+      for (size_t i = 0; i < lists[l]->size; i++)
+        {
+          size_t cell = lists[l]->cells[i];
+          int state   = wavefront->states[cell];
+          int y       = cell / wavefront->width - wavefront->height / 2;
+          int x       = cell % wavefront->width - wavefront->width / 2;
+
+          if (state && y >= y_min && y <= y_max && x >= x_min && x <= x_max)
+            fn(y, x, state, ctx);
+        }
+    }
+}
+
+void
+wavefront_foreach_change (Wavefront *wavefront,
+                          void (*fn)(int y, int x, int state, void *ctx),
+                          void *ctx)
+{
+  for (size_t i = 0; i < wavefront->changed.size; i++)
+    {
+      size_t cell = wavefront->changed.cells[i];
+      fn(cell / wavefront->width - wavefront->height / 2,
+         cell % wavefront->width - wavefront->width / 2,
+         wavefront->states[cell], ctx);
+    }
+}
+
+long
+wavefront_population (Wavefront *wavefront)
+{
+  struct CELL_LIST *lists[] = { &wavefront->live, &wavefront->dying };
+  long population = 0;
+
+  for (int l = 0; l < 2; l++)
+    for (size_t i = 0; i < lists[l]->size; i++)
+      population += wavefront->states[lists[l]->cells[i]] != 0;
+
+  return population;
+}
+
+uint64_t
+wavefront_evaluated (Wavefront *wavefront)
+{
+  return wavefront->evaluated;
+}
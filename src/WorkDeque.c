@@ -0,0 +1,69 @@
+#include "WorkDeque.h"
+#include <assert.h>
+
+/*
+ * The deque follows Chase and Lev's work-stealing deque without the push
+ * operation.  The owner claims a task by lowering bottom and thieves by
+ * raising top with a compare and swap.  They only race over the last task,
+ * which both settle with a compare and swap on top.
+ */
+
+void
+work_deque_reset (Work_Deque *deque, long begin, long end)
+{
+  assert(begin <= end);
+
+  atomic_store(&deque->top, begin);
+  atomic_store(&deque->bottom, end);
+}
+
+bool
+work_deque_pop (Work_Deque *deque, long *task)
+{
+  bool success = false;
+  long bottom  = atomic_load(&deque->bottom) - 1;
+
+  atomic_store(&deque->bottom, bottom);
+  long top = atomic_load(&deque->top);
+
+  if (top < bottom)
+    {
+      *task   = bottom;
+      success = true;
+    }
+  else if (top == bottom)
+    {
+      // the last task goes to whoever moves top past it first
+      success = atomic_compare_exchange_strong(&deque->top, &top, top + 1);
+      if (success)
+        *task = bottom;
+      atomic_store(&deque->bottom, bottom + 1);
+    }
+  else
+    atomic_store(&deque->bottom, bottom + 1);
+
+  return success;
+}
+
+bool
+work_deque_steal (Work_Deque *deque, long *task)
+{
+  bool success = false;
+  long top     = atomic_load(&deque->top);
+  long bottom  = atomic_load(&deque->bottom);
+
+  if (top < bottom
+      && atomic_compare_exchange_strong(&deque->top, &top, top + 1))
+    {
+      *task   = top;
+      success = true;
+    }
+
+  return success;
+}
+
+bool
+work_deque_empty (Work_Deque *deque)
+{
+  return atomic_load(&deque->top) >= atomic_load(&deque->bottom);
+}
@@ -0,0 +1,24 @@
+#include "TestHelpers.h"
+#include <stdio.h>
+
+int
+report (const char *name, bool success)
+{
+  printf("%s %s\n", success ? "PASSED" : "FAILED", name);
+  return !success;
+}
+
+bool
+boards_match (Automaton *a, Automaton *b)
+{
+  int height   = automaton_get_height(a);
+  int width    = automaton_get_width(a);
+  bool success = height == automaton_get_height(b)
+    && width == automaton_get_width(b);
+
+  for (int y = -height / 2; y < height - height / 2 && success; y++)
+    for (int x = -width / 2; x < width - width / 2 && success; x++)
+      success = automaton_get_state(a, y, x) == automaton_get_state(b, y, x);
+
+  return success;
+}
@@ -0,0 +1,34 @@
+/**
+ * @file TestHelpers.h
+ * @brief Checks shared by the test programs.
+ */
+
+#ifndef TEST_HELPERS_H
+#define TEST_HELPERS_H
+
+#include "CellularAutomaton.h"
+#include <stdbool.h>
+
+/**
+ * @brief Prints whether a test passed
+ *
+ * @param name The name of the test.
+ * @param success Whether the test passed.
+ * @return 1 if the test failed and 0 if it passed, to be added to a count
+ * of failures.
+ */
+int
+report (const char *name, bool success);
+
+/**
+ * @brief Whether two automata have boards of the same size and cells
+ *
+ * @param a The first automaton.
+ * @param b The second automaton.
+ * @return Whether the boards are the same size and every cell on them is in
+ * the same state.
+ */
+bool
+boards_match (Automaton *a, Automaton *b);
+
+#endif
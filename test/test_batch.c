@@ -0,0 +1,271 @@
+#include "Batch.h"
+#include "CellularAutomaton.h"
+#include "Checkpoint.h"
+#include "Pattern.h"
+#include "Replay.h"
+#include "TestHelpers.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+
+/*
+ * Runs batch mode on small boards and checks the boards it writes against
+ * the same automata advanced here.
+ */
+
+#define ARGS(...) (char *[]) { "life", __VA_ARGS__, NULL }
+
+static const char *rule_names[] = {
+  "life", "seeds", "greenberg-hastings", "highlife", "day-and-night",
+  "brians-brain"
+};
+
+static char life_path[]   = "/tmp/test_batch_XXXXXX";
+static char brain_path[]  = "/tmp/test_batch_XXXXXX";
+static char output_path[] = "/tmp/test_batch_XXXXXX";
+
+static int
+run (char **argv)
+{
+  int argc = 0;
+  while (argv[argc])
+    argc++;
+
+  // keep the summaries out of the test's own output
+  fflush(stdout);
+  FILE *saved = stdout;
+  stdout = fopen("/dev/null", "w");
+  int status = batch_main(argc, argv);
+  fclose(stdout);
+  stdout = saved;
+
+  return status;
+}
+
+static bool
+files_match (const char *a, const char *b)
+{
+  FILE *fa = fopen(a, "r");
+  FILE *fb = fopen(b, "r");
+  bool success = fa && fb;
+  int ca, cb;
+
+  while (success)
+    {
+      ca = fgetc(fa);
+      cb = fgetc(fb);
+      success = ca == cb;
+      if (ca == EOF)
+        break;
+    }
+
+  if (fa)
+    fclose(fa);
+  if (fb)
+    fclose(fb);
+  return success;
+}
+
+static bool
+write_pattern (const char *path, const char *text)
+{
+  FILE *fp = fopen(path, "w");
+  if (!fp)
+    return false;
+
+  fputs(text, fp);
+  return fclose(fp) == 0;
+}
+
+static bool
+test_pattern_matches (Automaton_Type type, const char *backend)
+{
+  char reference_path[] = "/tmp/test_batch_XXXXXX";
+  char name[64];
+  char *pattern_path = (type == greenberg_hastings || type == brians_brain
+                        ? brain_path : life_path);
+  Automaton *reference = automaton_create(type, 20, 30);
+  bool success = run(ARGS("--rule", (char *) rule_names[type],
+                          "--size", "20x30", "-p", pattern_path, "-g", "17",
+                          "-o", output_path, "-b", (char *) backend)) == 0;
+
+  close(mkstemp(reference_path));
+  success = success && pattern_load_text(reference, pattern_path)
+    && automaton_step_n(reference, 17)
+    && pattern_save_text(reference, reference_path)
+    && files_match(output_path, reference_path);
+
+  snprintf(name, sizeof(name), "%s on %s", rule_names[type], backend);
+  report(name, success);
+  automaton_destroy(reference);
+  remove(reference_path);
+  return success;
+}
+
+static bool
+test_seed ()
+{
+  char first_path[] = "/tmp/test_batch_XXXXXX";
+  bool success;
+
+  close(mkstemp(first_path));
+  success = run(ARGS("-s", "30x40", "-S", "42", "-o", first_path)) == 0
+    && run(ARGS("-s", "30x40", "-S", "42", "-o", output_path)) == 0
+    && files_match(first_path, output_path);
+
+  report("same seed, same board", success);
+  remove(first_path);
+  return success;
+}
+
+// A run stopped at a checkpoint and restored ends on the same board
+static bool
+test_restore (const char *backend)
+{
+  char checkpoint_path[] = "/tmp/test_batch_XXXXXX";
+  char full_path[]       = "/tmp/test_batch_XXXXXX";
+  char name[64];
+  bool success;
+
+  close(mkstemp(checkpoint_path));
+  close(mkstemp(full_path));
+  success = run(ARGS("-r", "brians-brain", "-s", "30x40", "-S", "9",
+                     "-g", "40", "-b", (char *) backend, "-o",
+                     full_path)) == 0
+    && run(ARGS("-r", "brians-brain", "-s", "30x40", "-S", "9", "-g", "25",
+                "-b", (char *) backend, "-c", checkpoint_path, "-i",
+                "10")) == 0
+    && run(ARGS("-R", checkpoint_path, "-g", "40", "-o", output_path)) == 0
+    && files_match(full_path, output_path);
+
+  snprintf(name, sizeof(name), "restore on %s", backend);
+  report(name, success);
+  remove(checkpoint_path);
+  remove(full_path);
+  return success;
+}
+
+// A recorded run plays back to the board the run wrote
+static bool
+test_record ()
+{
+  char record_path[] = "/tmp/test_batch_XXXXXX";
+  Automaton *played  = automaton_create(brians_brain, 30, 40);
+  Player *player     = NULL;
+  bool success;
+
+  close(mkstemp(record_path));
+  success = run(ARGS("-r", "brians-brain", "-s", "30x40", "-S", "5", "-g",
+                     "30", "-o", output_path, "-l", record_path, "-k",
+                     "7")) == 0
+    && (player = player_open(record_path)) != NULL
+    && player_get_first_generation(player) == 0
+    && player_get_last_generation(player) == 30
+    && player_seek(player, 30)
+    && pattern_load_text(played, output_path);
+
+  for (int y = -15; y < 15 && success; y++)
+    for (int x = -20; x < 20 && success; x++)
+      success = automaton_get_state(played, y, x)
+        == automaton_get_state(player_get_automaton(player), y, x);
+  success = success && run(ARGS("-l", "/nonexistent/x")) != 0
+    && run(ARGS("-k", "0")) != 0;
+
+  report("record", success);
+  if (player)
+    player_destroy(player);
+  automaton_destroy(played);
+  remove(record_path);
+  return success;
+}
+
+// A recorded run still checkpoints, and carries on from its checkpoint
+static bool
+test_record_checkpoint ()
+{
+  char record_path[]     = "/tmp/test_batch_XXXXXX";
+  char checkpoint_path[] = "/tmp/test_batch_XXXXXX";
+  char full_path[]       = "/tmp/test_batch_XXXXXX";
+  Automaton *restored    = NULL;
+  Player *player         = NULL;
+  bool success;
+
+  close(mkstemp(record_path));
+  close(mkstemp(checkpoint_path));
+  close(mkstemp(full_path));
+  success = run(ARGS("-r", "brians-brain", "-s", "30x40", "-S", "5", "-g",
+                     "40", "-o", full_path)) == 0
+    && run(ARGS("-r", "brians-brain", "-s", "30x40", "-S", "5", "-g", "25",
+                "-l", record_path, "-c", checkpoint_path, "-i", "10")) == 0
+    && (player = player_open(record_path)) != NULL
+    && player_get_last_generation(player) == 25
+    && (restored = automaton_load_checkpoint(checkpoint_path)) != NULL
+    && automaton_get_generation(restored) == 25
+    && run(ARGS("-R", checkpoint_path, "-g", "40", "-o", output_path)) == 0
+    && files_match(full_path, output_path);
+
+  report("record with checkpoints", success);
+  if (player)
+    player_destroy(player);
+  if (restored)
+    automaton_destroy(restored);
+  remove(record_path);
+  remove(checkpoint_path);
+  remove(full_path);
+  return success;
+}
+
+static bool
+test_bad_arguments ()
+{
+  bool success = run(ARGS("-r", "rule-110")) != 0
+    && run(ARGS("-s", "20by30")) != 0
+    && run(ARGS("-g", "-5")) != 0
+    && run(ARGS("--frobnicate")) != 0
+    && run(ARGS("-s", "2x2", "-p", life_path)) != 0
+    && run(ARGS("-r", "life", "-s", "20x30", "-p", brain_path)) != 0
+    && run(ARGS("-R", life_path)) != 0
+    && run(ARGS("-i", "0")) != 0
+    && run(ARGS("--help")) == 0;
+
+  report("bad arguments", success);
+  return success;
+}
+
+int
+main ()
+{
+  int failures = 0;
+
+  close(mkstemp(life_path));
+  close(mkstemp(brain_path));
+  close(mkstemp(output_path));
+  if (!write_pattern(life_path, "4 6\n..0...\n00..0.\n.0.00\n.0...0\n")
+      || !write_pattern(brain_path, "4 6\n..0...\n0--.0.\n.--00\n.0..-0\n"))
+    {
+      printf("FAILED writing the pattern\n");
+      return 1;
+    }
+
+  for (Automaton_Type type = game_of_life; type < custom_rule; type++)
+    {
+      failures += !test_pattern_matches(type, "point-set");
+      failures += !test_pattern_matches(type, "dense-grid");
+    }
+  failures += !test_pattern_matches(brians_brain, "wavefront");
+  failures += !test_pattern_matches(game_of_life, "hashlife");
+  failures += !test_seed();
+  failures += !test_restore("point-set");
+  failures += !test_restore("dense-grid");
+  failures += !test_restore("wavefront");
+  failures += !test_record();
+  failures += !test_record_checkpoint();
+  failures += !test_bad_arguments();
+
+  remove(life_path);
+  remove(brain_path);
+  remove(output_path);
+  return failures != 0;
+}
@@ -0,0 +1,225 @@
+#include "CellularAutomaton.h"
+#include "Checkpoint.h"
+#include "TestHelpers.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+
+/*
+ * Saves automata to checkpoints, directly and on the checkpointer's thread,
+ * and checks that what is restored matches what was saved and that damaged
+ * checkpoints are refused.
+ */
+
+static char path[] = "/tmp/test_checkpoint_XXXXXX";
+
+// Saves a soup part way through a run, restores it and runs both on
+static bool
+test_round_trip (Automaton_Type type, Automaton_Backend backend)
+{
+  Automaton *saved = automaton_create_backend(type, 37, 53, backend);
+  Automaton *restored = NULL;
+  char name[64];
+  bool success;
+
+  srand(11);
+  success = automaton_random_state(saved)
+    && automaton_step_n(saved, 9)
+    && automaton_update_state(saved)
+    && automaton_get_generation(saved) == 10
+    && automaton_save_checkpoint(saved, path)
+    && (restored = automaton_load_checkpoint(path)) != NULL
+    && automaton_get_type(restored) == type
+    && automaton_get_backend(restored) == automaton_get_backend(saved)
+    && automaton_get_generation(restored) == 10
+    && boards_match(saved, restored)
+    && automaton_step_n(saved, 5)
+    && automaton_step_n(restored, 5)
+    && automaton_get_generation(restored) == 15
+    && boards_match(saved, restored);
+
+  snprintf(name, sizeof(name), "type %d backend %d round trip", type,
+           backend);
+  report(name, success);
+  automaton_destroy(saved);
+  if (restored)
+    automaton_destroy(restored);
+  return success;
+}
+
+/*
+ * The hashlife backend keeps the cells that leave its board, so a glider
+ * that has flown off it must come back from a checkpoint
+ */
+static bool
+test_off_board ()
+{
+  static const int glider[][2] = { {-1, 0}, {0, 1}, {1, -1}, {1, 0}, {1, 1} };
+  Automaton *saved = automaton_create_backend(game_of_life, 10, 10,
+                                              hashlife_backend);
+  Automaton *restored = NULL;
+  bool success = true;
+
+  for (int i = 0; i < 5; i++)
+    success = success
+      && automaton_set_state(saved, glider[i][0], glider[i][1], 1);
+
+  success = success && automaton_step_n(saved, 40)
+    && automaton_get_population(saved) == 5
+    && automaton_get_state(saved, 10, 10) + automaton_get_state(saved, 11, 11)
+       > 0
+    && automaton_save_checkpoint(saved, path)
+    && (restored = automaton_load_checkpoint(path)) != NULL
+    && automaton_get_backend(restored) == hashlife_backend
+    && automaton_get_generation(restored) == 40
+    && automaton_get_population(restored) == 5
+    && automaton_step_n(saved, 8)
+    && automaton_step_n(restored, 8);
+
+  for (int y = 8; y < 24 && success; y++)
+    for (int x = 8; x < 24 && success; x++)
+      success = automaton_get_state(saved, y, x)
+        == automaton_get_state(restored, y, x);
+
+  report("off board", success);
+  automaton_destroy(saved);
+  if (restored)
+    automaton_destroy(restored);
+  return success;
+}
+
+static bool
+test_custom_rule ()
+{
+  Automaton *saved = automaton_create_rule("B36/S125/C5", 20, 20);
+  Automaton *restored = NULL;
+  char rule[32];
+
+  srand(3);
+  bool success = automaton_random_state(saved)
+    && automaton_save_checkpoint(saved, path)
+    && (restored = automaton_load_checkpoint(path)) != NULL
+    && automaton_get_type(restored) == custom_rule
+    && automaton_get_rule(restored, rule, sizeof(rule)) > 0
+    && strcmp(rule, "B36/S125/C5") == 0
+    && boards_match(saved, restored);
+
+  report("custom rule", success);
+  automaton_destroy(saved);
+  if (restored)
+    automaton_destroy(restored);
+  return success;
+}
+
+// Flipping any byte, or cutting the file short, must be caught
+static bool
+test_damaged ()
+{
+  Automaton *automaton = automaton_create(game_of_life, 16, 16);
+  bool success = true;
+  long size = 0;
+  unsigned char *bytes = NULL;
+  FILE *fp;
+
+  srand(5);
+  automaton_random_state(automaton);
+  success = automaton_save_checkpoint(automaton, path)
+    && (fp = fopen(path, "rb")) != NULL;
+  if (success)
+    {
+      fseek(fp, 0, SEEK_END);
+      size  = ftell(fp);
+      bytes = malloc(size);
+      rewind(fp);
+      success = bytes && fread(bytes, 1, size, fp) == (size_t) size;
+      fclose(fp);
+    }
+
+  for (long i = 0; i <= size && success; i++)
+    {
+      fp = fopen(path, "wb");
+      if (i < size)
+        {
+          bytes[i] ^= 0x10;
+          fwrite(bytes, 1, size, fp);
+          bytes[i] ^= 0x10;
+        }
+      else
+        fwrite(bytes, 1, size - 1, fp);
+      fclose(fp);
+
+      Automaton *restored = automaton_load_checkpoint(path);
+      success = restored == NULL;
+      if (restored)
+        {
+          printf("FAILED on damaged byte %ld\n", i);
+          automaton_destroy(restored);
+        }
+    }
+  success = success && automaton_load_checkpoint("/nonexistent/x") == NULL;
+
+  report("damaged checkpoints", success);
+  free(bytes);
+  automaton_destroy(automaton);
+  return success;
+}
+
+// Checkpoints handed over while the automaton keeps running
+static bool
+test_checkpointer ()
+{
+  Checkpointer *checkpointer = checkpointer_create();
+  Automaton *automaton = automaton_create_backend(brians_brain, 64, 64,
+                                                  dense_grid_backend);
+  Automaton *restored  = NULL;
+  bool success = checkpointer != NULL;
+
+  srand(8);
+  automaton_random_state(automaton);
+  for (int i = 0; i < 20 && success; i++)
+    success = automaton_update_state(automaton)
+      && checkpointer_save(checkpointer, automaton, path);
+
+  success = success && checkpointer_wait(checkpointer)
+    && (restored = automaton_load_checkpoint(path)) != NULL
+    && automaton_get_generation(restored) == 20
+    && boards_match(automaton, restored);
+
+  // a checkpoint that can't be written is reported by the next wait only
+  success = success
+    && checkpointer_save(checkpointer, automaton, "/nonexistent/x")
+    && !checkpointer_wait(checkpointer)
+    && checkpointer_wait(checkpointer);
+
+  report("checkpointer", success);
+  if (checkpointer)
+    checkpointer_destroy(checkpointer);
+  automaton_destroy(automaton);
+  if (restored)
+    automaton_destroy(restored);
+  return success;
+}
+
+int
+main ()
+{
+  int failures = 0;
+
+  close(mkstemp(path));
+
+  for (Automaton_Backend backend = point_set_backend;
+       backend <= wavefront_backend; backend++)
+    {
+      failures += !test_round_trip(game_of_life, backend);
+      failures += !test_round_trip(brians_brain, backend);
+    }
+  failures += !test_off_board();
+  failures += !test_custom_rule();
+  failures += !test_damaged();
+  failures += !test_checkpointer();
+
+  remove(path);
+  return failures != 0;
+}
@@ -0,0 +1,178 @@
+#include "Codec.h"
+#include "TestHelpers.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+/*
+ * Round trips varints, cell lists and compressed blocks through the codec,
+ * and checks that damaged input is refused rather than read past its end.
+ */
+
+static bool
+test_varints ()
+{
+  static const uint64_t values[] = {
+    0, 1, 127, 128, 300, 16383, 16384, UINT32_MAX, UINT64_MAX
+  };
+  Codec_Buffer buffer = { NULL, 0, 0, false };
+  Codec_Reader reader;
+  uint64_t value;
+  size_t count = sizeof(values) / sizeof(values[0]);
+  bool success = true;
+
+  for (size_t i = 0; i < count; i++)
+    codec_put_varint(&buffer, values[i]);
+
+  reader = (Codec_Reader) { buffer.bytes, buffer.bytes + buffer.size };
+  for (size_t i = 0; i < count && success; i++)
+    success = codec_get_varint(&reader, UINT64_MAX, &value)
+      && value == values[i];
+  success = success && reader.next == reader.end
+    && !codec_get_varint(&reader, UINT64_MAX, &value);
+
+  // a value over the limit, and one cut short
+  reader  = (Codec_Reader) { buffer.bytes + 3, buffer.bytes + 5 };
+  success = success && !codec_get_varint(&reader, 127, &value);
+  reader  = (Codec_Reader) { buffer.bytes + 3, buffer.bytes + 4 };
+  success = success && !codec_get_varint(&reader, UINT64_MAX, &value);
+
+  report("varints", success);
+  free(buffer.bytes);
+  return success;
+}
+
+static bool
+test_crc32 ()
+{
+  const uint8_t *digits = (const uint8_t *) "123456789";
+  bool success = codec_crc32(0, digits, 9) == 0xCBF43926u
+    && codec_crc32(codec_crc32(0, digits, 4), digits + 4, 5) == 0xCBF43926u
+    && codec_crc32(0, NULL, 0) == 0;
+
+  report("crc-32", success);
+  return success;
+}
+
+static bool
+test_cells ()
+{
+  Automaton_Change cells[] = {
+    { 3, 4, 2 }, { -5, -6, 1 }, { 3, -6, 1 }, { -5, 5, 3 }, { 0, 0, 1 }
+  };
+  Automaton_Change read[5];
+  Codec_Buffer buffer = { NULL, 0, 0, false };
+  Codec_Reader reader;
+  bool success = true;
+
+  codec_sort_cells(cells, 5);
+  for (int i = 1; i < 5; i++)
+    success = success && (cells[i - 1].y < cells[i].y
+                          || (cells[i - 1].y == cells[i].y
+                              && cells[i - 1].x < cells[i].x));
+
+  codec_put_cells(&buffer, cells, 5, 10, 12, true);
+  reader  = (Codec_Reader) { buffer.bytes, buffer.bytes + buffer.size };
+  success = success && codec_get_cells(&reader, read, 5, 10, 12, 3)
+    && reader.next == reader.end
+    && memcmp(cells, read, sizeof(cells)) == 0;
+
+  // a state over the limit, and a board too small for the cells
+  reader  = (Codec_Reader) { buffer.bytes, buffer.bytes + buffer.size };
+  success = success && !codec_get_cells(&reader, read, 5, 10, 12, 2);
+  reader  = (Codec_Reader) { buffer.bytes, buffer.bytes + buffer.size };
+  success = success && !codec_get_cells(&reader, read, 5, 10, 10, 3);
+
+  // without states every cell is read back as 1
+  buffer.size = 0;
+  codec_put_cells(&buffer, cells, 5, 10, 12, false);
+  reader  = (Codec_Reader) { buffer.bytes, buffer.bytes + buffer.size };
+  success = success && codec_get_cells(&reader, read, 5, 10, 12, 0)
+    && reader.next == reader.end;
+  for (int i = 0; i < 5 && success; i++)
+    success = read[i].y == cells[i].y && read[i].x == cells[i].x
+      && read[i].state == 1;
+
+  report("cells", success);
+  free(buffer.bytes);
+  return success;
+}
+
+// Compresses a block, decompresses it and damages it by cutting it short
+static bool
+round_trip (const uint8_t *bytes, size_t size, size_t *compressed_size)
+{
+  uint8_t *compressed = malloc(codec_compress_bound(size));
+  uint8_t *restored   = malloc(size + 1);
+  bool success        = compressed && restored;
+
+  if (success)
+    {
+      *compressed_size = codec_compress(bytes, size, compressed);
+      success = *compressed_size <= codec_compress_bound(size)
+        && codec_decompress(compressed, *compressed_size, restored, size)
+        && memcmp(bytes, restored, size) == 0
+        && !codec_decompress(compressed, *compressed_size, restored,
+                             size + 1);
+      for (size_t cut = 0; cut < *compressed_size && success; cut++)
+        success = !codec_decompress(compressed, cut, restored, size)
+          || size == 0;
+    }
+
+  free(compressed);
+  free(restored);
+  return success;
+}
+
+static bool
+test_compression ()
+{
+  size_t size = 200000;
+  uint8_t *bytes = malloc(size);
+  size_t compressed;
+  uint64_t seed = 12345;
+  bool success  = bytes != NULL;
+
+  // nothing, too little to match, then a single repeated byte
+  success = success && round_trip(bytes, 0, &compressed)
+    && round_trip((const uint8_t *) "abc", 3, &compressed);
+  if (success)
+    memset(bytes, 7, size);
+  success = success && round_trip(bytes, size, &compressed)
+    && compressed < size / 100;
+
+  // random bytes don't compress, but mustn't grow past the bound
+  for (size_t i = 0; i < size && success; i++)
+    {
+      seed ^= seed << 13;
+      seed ^= seed >> 7;
+      seed ^= seed << 17;
+      bytes[i] = seed;
+    }
+  success = success && round_trip(bytes, 70000, &compressed);
+
+  // repeats both nearer and further than the compressor can reach back
+  for (size_t i = 0; i < size && success; i++)
+    bytes[i] = i % 1000 < 500 ? bytes[i % 997] : bytes[i % 70001];
+  success = success && round_trip(bytes, size, &compressed)
+    && compressed < size;
+
+  report("compression", success);
+  free(bytes);
+  return success;
+}
+
+int
+main ()
+{
+  int failures = 0;
+
+  failures += !test_varints();
+  failures += !test_crc32();
+  failures += !test_cells();
+  failures += !test_compression();
+
+  return failures != 0;
+}
@@ -1,6 +1,10 @@
 #include "CellularAutomaton.h"
+#include "LifeKernel.h"
+#include "Stats.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
 
 int INIT1[3][3] = {
   {0,0,0},
@@ -64,21 +68,33 @@ print_state (int **state)
 }
 
 bool
-test_state (int **init_state, int **expected_state, int height, int width)
+test_state (int **init_state, int **expected_state, int height, int width,
+            Automaton_Backend backend)
 {
   static int test_num = 1;
   bool success        = true;
-  Automaton *init     = automaton_create(game_of_life, height, width, init_state);
+  Automaton *init     = automaton_create_backend(game_of_life, height, width,
+                                                 backend);
+  int actual[height][width];
+  int *actual_state[height];
+
+  for (int y = -height / 2; y < height - height / 2; y++)
+    {
+      for (int x = -width / 2; x < width - width / 2; x++)
+        automaton_set_state(init, y, x, init_state[y+height/2][x+width/2]);
+    }
   
   automaton_update_state(init);
 
   // check whether the states match
-  for (int y = -height / 2; y < height / 2 && success; y++)
+  for (int y = -height / 2; y < height - height / 2; y++)
     {
-      for (int x = -width / 2; x < width / 2 && success; x++)
+      actual_state[y+height/2] = actual[y+height/2];
+      for (int x = -width / 2; x < width - width / 2; x++)
         {
-          init_state[y+height/2][x+width/2] = automaton_get_state(init, y, x);
-          success = init_state[y+height/2][x+width/2] == expected_state[y+height/2][x+width/2];
+          actual[y+height/2][x+width/2] = automaton_get_state(init, y, x);
+          if (actual[y+height/2][x+width/2] != expected_state[y+height/2][x+width/2])
+            success = false;
         }
     }
 
@@ -90,7 +106,7 @@ test_state (int **init_state, int **expected_state, int height, int width)
       printf("Expected:\n");
       print_state(expected_state);
       printf("Actual:\n");
-      print_state(init_state);
+      print_state(actual_state);
     }
 
   automaton_destroy(init);
@@ -99,29 +115,889 @@ test_state (int **init_state, int **expected_state, int height, int width)
   return success;
 }
 
+// Runs every rule test against the given storage backend
 int
-main ()
-{  
+test_backend (Automaton_Backend backend)
+{
+  int failures = 0;
+
   // TEST 1: Dead cells stay dead
   int *init_state1[3] = { INIT1[0], INIT1[1], INIT1[2] };
   int *expected_state1[3] = { EXPECTED1[0], EXPECTED1[1], EXPECTED1[2] };
-  test_state(init_state1, expected_state1, 3, 3);
+  failures += !test_state(init_state1, expected_state1, 3, 3, backend);
 
   // TEST 2: Dead cells with 3 neighbours become alive and live cells with two
   // neighbours stay alive
   int *init_state2[3] = { INIT2[0], INIT2[1], INIT2[2] };
   int *expected_state2[3] = { EXPECTED2[0], EXPECTED2[1], EXPECTED2[2] };
-  test_state(init_state2, expected_state2, 3, 3);
+  failures += !test_state(init_state2, expected_state2, 3, 3, backend);
 
   // TEST 3: Live cells with 0 or 1 live neighbours becomes dead
   int *init_state3[3] = { INIT3[0], INIT3[1], INIT3[2] };
   int *expected_state3[3] = { EXPECTED3[0], EXPECTED3[1], EXPECTED3[2] };
-  test_state(init_state3, expected_state3, 3, 3);  
+  failures += !test_state(init_state3, expected_state3, 3, 3, backend);  
 
   // TEST 4: Live cells with > 3 neighbours die, live cells with 3 neighbours live
   int *init_state4[3] = { INIT4[0], INIT4[1], INIT4[2] };
   int *expected_state4[3] = { EXPECTED4[0], EXPECTED4[1], EXPECTED4[2] };
-  test_state(init_state4, expected_state4, 3, 3);
-  
-  return 0;
+  failures += !test_state(init_state4, expected_state4, 3, 3, backend);
+
+  return failures;
+}
+
+struct VISITED
+{
+  Automaton *automaton;
+  int count;
+  bool matches;
+};
+
+static void
+check_visited (int y, int x, int state, void *ctx)
+{
+  struct VISITED *visited = ctx;
+  ++visited->count;
+  if (automaton_get_state(visited->automaton, y, x) != state || !state)
+    visited->matches = false;
+}
+
+/*
+ * Checks that visiting a rectangle reports exactly the non-dead cells inside
+ * it and that the population counts every non-dead cell on the board.
+ */
+bool
+check_foreach_in_rect (Automaton *automaton, int y_min, int x_min, int y_max,
+                       int x_max)
+{
+  struct VISITED visited = { automaton, 0, true };
+  int expected   = 0;
+  long population = 0;
+
+  for (int y = y_min; y <= y_max; y++)
+    for (int x = x_min; x <= x_max; x++)
+      expected += automaton_get_state(automaton, y, x) != 0;
+
+  for (int y = -automaton_get_height(automaton) / 2;
+       y < automaton_get_height(automaton) - automaton_get_height(automaton) / 2;
+       y++)
+    for (int x = -automaton_get_width(automaton) / 2;
+         x < automaton_get_width(automaton) - automaton_get_width(automaton) / 2;
+         x++)
+      population += automaton_get_state(automaton, y, x) != 0;
+
+  automaton_foreach_in_rect(automaton, y_min, x_min, y_max, x_max,
+                            check_visited, &visited);
+
+  return visited.matches && visited.count == expected
+    && automaton_get_population(automaton) == population;
+}
+
+/*
+ * Runs the same random soup on a reference automaton and another automaton
+ * of the same size and checks that every generation matches cell for cell.
+ */
+bool
+test_soup_matches (Automaton *reference, Automaton *actual, const char *name,
+                   unsigned seed)
+{
+  static const int generations = 30;
+  bool success = true;
+  int height   = automaton_get_height(reference);
+  int width    = automaton_get_width(reference);
+
+  srand(seed);
+  automaton_random_state(reference);
+  srand(seed);
+  automaton_random_state(actual);
+
+  for (int gen = 0; gen <= generations && success; gen++)
+    {
+      for (int y = -height / 2; y < height - height / 2 && success; y++)
+        {
+          for (int x = -width / 2; x < width - width / 2 && success; x++)
+            success = automaton_get_state(reference, y, x)
+              == automaton_get_state(actual, y, x);
+        }
+      if (!success)
+        printf("FAILED %s differs at generation %d\n", name, gen);
+
+      automaton_update_state(reference);
+      automaton_update_state(actual);
+    }
+
+  if (success && !check_foreach_in_rect(actual, -9, -30, 5, 33))
+    {
+      printf("FAILED %s visits the wrong cells\n", name);
+      success = false;
+    }
+
+  if (success)
+    printf("PASSED %s\n", name);
+
+  automaton_destroy(reference);
+  automaton_destroy(actual);
+
+  return success;
+}
+
+// Compares the given backend against the point set backend
+bool
+test_backend_matches (Automaton_Type type, Automaton_Backend backend,
+                      int height, int width)
+{
+  char name[64];
+
+  snprintf(name, sizeof(name), "type %d backend %d", type, backend);
+  return test_soup_matches(automaton_create(type, height, width),
+                           automaton_create_backend(type, height, width,
+                                                    backend),
+                           name, type + 1);
+}
+
+// Compares a backend updated by several threads against the serial update
+bool
+test_threads_match (Automaton_Type type, Automaton_Backend backend,
+                    int threads)
+{
+  char name[64];
+  Automaton *reference = automaton_create_backend(type, 37, 70, backend);
+  Automaton *actual    = automaton_create_backend(type, 37, 70, backend);
+
+  if (!automaton_set_threads(actual, threads)
+      || automaton_get_threads(actual) != threads)
+    {
+      printf("FAILED could not start %d threads\n", threads);
+      return false;
+    }
+
+  snprintf(name, sizeof(name), "type %d backend %d threads %d", type, backend,
+           threads);
+  return test_soup_matches(reference, actual, name, type + 1);
+}
+
+/*
+ * Runs still lifes, blinkers and a glider on the dense grid backend, whose
+ * tiles around the still lifes and blinkers should be skipped, and checks
+ * that it keeps matching the point set backend.  A cell is set half way
+ * through to check that modified tiles are evaluated again.
+ */
+bool
+test_tile_skipping (int threads)
+{
+  static const int height = 150;
+  static const int width  = 260;
+  static const int cells[][2] = {
+    { -60, -100 }, { -60, -99 }, { -59, -100 }, { -59, -99 },  /* block */
+    { 50, 90 }, { 50, 91 }, { 50, 92 },                         /* blinker */
+    { 10, -30 }, { 11, -29 }, { 12, -31 }, { 12, -30 },         /* glider */
+    { 12, -29 }
+  };
+  bool success = true;
+  long evaluated, skipped, total_skipped = 0;
+
+  Automaton *reference = automaton_create(game_of_life, height, width);
+  Automaton *actual    = automaton_create_backend(game_of_life, height, width,
+                                                  dense_grid_backend);
+  automaton_set_threads(actual, threads);
+  for (size_t i = 0; i < sizeof(cells) / sizeof(cells[0]); i++)
+    {
+      automaton_set_state(reference, cells[i][0], cells[i][1], 1);
+      automaton_set_state(actual, cells[i][0], cells[i][1], 1);
+    }
+
+  for (int gen = 1; gen <= 80 && success; gen++)
+    {
+      if (gen == 40)
+        {
+          automaton_set_state(reference, -70, 110, 1);
+          automaton_set_state(actual, -70, 110, 1);
+        }
+
+      automaton_update_state(reference);
+      automaton_update_state(actual);
+      automaton_get_tile_counts(actual, &evaluated, &skipped);
+      total_skipped += skipped;
+      success = evaluated + skipped == 5 * 5;
+
+      for (int y = -height / 2; y < height - height / 2 && success; y++)
+        {
+          for (int x = -width / 2; x < width - width / 2 && success; x++)
+            success = automaton_get_state(reference, y, x)
+              == automaton_get_state(actual, y, x);
+        }
+      if (!success)
+        printf("FAILED tiles differ at generation %d\n", gen);
+    }
+
+  // only the tiles around the glider should be evaluated once settled
+  success = success && evaluated <= 9 && total_skipped > 0;
+  printf("%s tile skipping threads %d\n", success ? "PASSED" : "FAILED",
+         threads);
+
+  automaton_destroy(reference);
+  automaton_destroy(actual);
+
+  return success;
+}
+
+/*
+ * Edits cells between generations and shrinks the borders half way through,
+ * checking that the given backend keeps matching the point set backend.
+ * Edits can revive a cell that died or turn a dying cell live again, which
+ * the wavefront backend has to notice on its lists.
+ */
+bool
+test_edits_match (Automaton_Type type, Automaton_Backend backend)
+{
+  static const int generations = 40;
+  bool success = true;
+  int height   = 37;
+  int width    = 70;
+  Automaton *reference = automaton_create(type, height, width);
+  Automaton *actual    = automaton_create_backend(type, height, width,
+                                                  backend);
+
+  srand(11);
+  automaton_random_state(reference);
+  srand(11);
+  automaton_random_state(actual);
+
+  for (int gen = 0; gen < generations && success; gen++)
+    {
+      if (gen == generations / 2)
+        {
+          int new_height = height - 10;
+          int new_width  = width - 21;
+
+          // the point set keeps cells outside its borders, so drop them first
+          for (int y = -height / 2; y < height - height / 2; y++)
+            for (int x = -width / 2; x < width - width / 2; x++)
+              if (y < -new_height / 2 || y >= new_height - new_height / 2
+                  || x < -new_width / 2 || x >= new_width - new_width / 2)
+                automaton_set_state(reference, y, x, 0);
+
+          height = new_height;
+          width  = new_width;
+          automaton_set_border(reference, height, width);
+          automaton_set_border(actual, height, width);
+        }
+
+      for (int edit = 0; edit < 20; edit++)
+        {
+          int y = rand() % height - height / 2;
+          int x = rand() % width - width / 2;
+
+          automaton_cycle_state(reference, y, x);
+          automaton_cycle_state(actual, y, x);
+          if (edit % 4 == 1)
+            {
+              automaton_set_state(reference, y, x - 1, 1);
+              automaton_set_state(actual, y, x - 1, 1);
+            }
+          else if (edit % 4 == 0)
+            {
+              automaton_set_state(reference, y, x + 1 - width / 2, 0);
+              automaton_set_state(actual, y, x + 1 - width / 2, 0);
+            }
+        }
+
+      automaton_update_state(reference);
+      automaton_update_state(actual);
+
+      for (int y = -height / 2; y < height - height / 2 && success; y++)
+        for (int x = -width / 2; x < width - width / 2 && success; x++)
+          success = automaton_get_state(reference, y, x)
+            == automaton_get_state(actual, y, x);
+      if (!success)
+        printf("FAILED type %d backend %d edits differ at generation %d\n",
+               type, backend, gen);
+    }
+
+  if (success && !check_foreach_in_rect(actual, -9, -30, 5, 33))
+    {
+      printf("FAILED type %d backend %d edits visit the wrong cells\n", type,
+             backend);
+      success = false;
+    }
+
+  if (success)
+    printf("PASSED type %d backend %d edits\n", type, backend);
+
+  automaton_destroy(reference);
+  automaton_destroy(actual);
+
+  return success;
+}
+
+/*
+ * Compares a rule set from its rulestring on the given backend against the
+ * same rule on the point set backend.  The backend may fall back to another
+ * one if it can't run the rule.
+ */
+bool
+test_rule_matches (const char *rule, Automaton_Backend backend)
+{
+  char name[64];
+  Automaton *reference = automaton_create_rule(rule, 37, 70);
+  Automaton *actual    = automaton_create_backend(game_of_life, 37, 70,
+                                                  backend);
+
+  if (!reference || !automaton_set_rule(actual, rule))
+    {
+      printf("FAILED rule %s could not be set\n", rule);
+      return false;
+    }
+
+  snprintf(name, sizeof(name), "rule %s backend %d", rule, backend);
+  return test_soup_matches(reference, actual, name, 7);
+}
+
+// The presets run the same rules as their rulestrings
+bool
+test_rule_presets ()
+{
+  static const char *rules[] = {
+    "B3/S23", "B2/S", "B1234/S/C3V", "B36/S23", "B3678/S34678", "B2/S/C3"
+  };
+  bool success = true;
+
+  for (Automaton_Type type = game_of_life; type < custom_rule; type++)
+    {
+      char rule[32];
+      Automaton *automaton = automaton_create_rule(rules[type], 10, 10);
+
+      success = success && automaton
+        && automaton_get_type(automaton) == type;
+      if (automaton)
+        automaton_destroy(automaton);
+
+      automaton = automaton_create(type, 10, 10);
+      automaton_get_rule(automaton, rule, sizeof(rule));
+      automaton_destroy(automaton);
+      if (strcmp(rule, rules[type]) != 0)
+        success = false;
+    }
+
+  printf("%s rule presets\n", success ? "PASSED" : "FAILED");
+  return success;
+}
+
+/*
+ * Switching a Brian's Brain board to a two-state rule drops its dying cells
+ * on every backend that can hold the board, before any update is run.
+ */
+bool
+test_rule_shrinks_states ()
+{
+  bool success = true;
+
+  for (Automaton_Backend backend = point_set_backend;
+       backend <= wavefront_backend; backend++)
+    {
+      if (backend == hashlife_backend)
+        continue;
+
+      Automaton *automaton = automaton_create_backend(brians_brain, 10, 10,
+                                                      backend);
+      automaton_set_state(automaton, 0, 0, 2);
+      automaton_set_state(automaton, 0, 1, 1);
+
+      if (!automaton_set_rule(automaton, "B3/S23")
+          || automaton_get_state(automaton, 0, 0) != 0
+          || automaton_get_state(automaton, 0, 1) != 1
+          || automaton_get_population(automaton) != 1)
+        {
+          printf("FAILED rule shrinks states backend %d\n", backend);
+          success = false;
+        }
+      automaton_destroy(automaton);
+    }
+
+  if (success)
+    printf("PASSED rule shrinks states\n");
+  return success;
+}
+
+/*
+ * The hashlife backend treats the board as unbounded, so it is compared
+ * against the point set backend on a soup that stays well clear of the
+ * borders.  Generations are taken in uneven chunks to exercise
+ * automaton_step_n.
+ */
+bool
+test_unbounded_matches (Automaton_Type type, Automaton_Backend backend)
+{
+  static const int size   = 200;
+  static const int soup   = 20;
+  static const int chunks[] = { 1, 1, 2, 5, 8, 13 };
+  bool success = true;
+  int gen      = 0;
+
+  Automaton *reference = automaton_create(type, size, size);
+  Automaton *actual    = automaton_create_backend(type, size, size, backend);
+
+  srand(type + 1);
+  for (int y = -soup / 2; y < soup / 2; y++)
+    {
+      for (int x = -soup / 2; x < soup / 2; x++)
+        {
+          int state = rand() % 2;
+          automaton_set_state(reference, y, x, state);
+          automaton_set_state(actual, y, x, state);
+        }
+    }
+
+  for (size_t i = 0; i < sizeof(chunks) / sizeof(chunks[0]) && success; i++)
+    {
+      for (int step = 0; step < chunks[i]; step++)
+        automaton_update_state(reference);
+      automaton_step_n(actual, chunks[i]);
+      gen += chunks[i];
+
+      for (int y = -size / 2; y < size / 2 && success; y++)
+        {
+          for (int x = -size / 2; x < size / 2 && success; x++)
+            success = automaton_get_state(reference, y, x)
+              == automaton_get_state(actual, y, x);
+        }
+      if (!success)
+        printf("FAILED type %d backend %d differs at generation %d\n", type,
+               backend, gen);
+    }
+
+  if (success && !check_foreach_in_rect(actual, -40, -25, 12, 70))
+    {
+      printf("FAILED type %d backend %d visits the wrong cells\n", type,
+             backend);
+      success = false;
+    }
+
+  if (success)
+    printf("PASSED type %d backend %d unbounded\n", type, backend);
+
+  automaton_destroy(reference);
+  automaton_destroy(actual);
+
+  return success;
+}
+
+// A glider travels one cell diagonally every four generations, forever
+bool
+test_hashlife_glider ()
+{
+  static const long generations = 1L << 30;
+  static const int glider[5][2] = { {-1, 0}, {0, 1}, {1, -1}, {1, 0}, {1, 1} };
+  bool success = true;
+
+  Automaton *automaton = automaton_create_backend(game_of_life, 10, 10,
+                                                  hashlife_backend);
+  for (int i = 0; i < 5; i++)
+    automaton_set_state(automaton, glider[i][0], glider[i][1], 1);
+
+  success = automaton_step_n(automaton, generations);
+  for (int i = 0; i < 5 && success; i++)
+    success = automaton_get_state(automaton,
+                                  glider[i][0] + (int) (generations / 4),
+                                  glider[i][1] + (int) (generations / 4));
+
+  printf("%s hashlife glider\n", success ? "PASSED" : "FAILED");
+  automaton_destroy(automaton);
+
+  return success;
+}
+
+/*
+ * A glider stepped 2^34 generations lands 2^32 cells away, past what an int
+ * can hold, so only the deaths of its old cells can be listed.  Narrowed,
+ * its births would land right back on those cells.
+ */
+bool
+test_hashlife_far_changes ()
+{
+  static const int glider[5][2] = { {-1, 0}, {0, 1}, {1, -1}, {1, 0}, {1, 1} };
+  const Automaton_Change *changes;
+  size_t count = 0;
+  bool success;
+
+  Automaton *automaton = automaton_create_backend(game_of_life, 10, 10,
+                                                  hashlife_backend);
+  for (int i = 0; i < 5; i++)
+    automaton_set_state(automaton, glider[i][0], glider[i][1], 1);
+  automaton_set_change_tracking(automaton, true);
+
+  success = automaton_step_n(automaton, 1L << 34)
+    && (changes = automaton_get_changes(automaton, &count)) && count == 5;
+  for (size_t i = 0; i < count && success; i++)
+    success = changes[i].state == 0
+      && automaton_get_state(automaton, changes[i].y, changes[i].x) == 0;
+
+  printf("%s hashlife far changes\n", success ? "PASSED" : "FAILED");
+  automaton_destroy(automaton);
+
+  return success;
+}
+
+/*
+ * Advances the dense grid backend in uneven chunks of generations, which
+ * are run as blocks of several generations at once, and checks it against
+ * single updates of the same backend, which the other tests check against
+ * the point set backend.  The board is neither a whole number of blocks high
+ * nor wide so partial blocks along the edges are run.
+ */
+bool
+test_step_n_matches (Automaton_Type type, int threads)
+{
+  static const long chunks[] = { 1, 2, 31, 32, 33, 5 };
+  bool success = true;
+  int height   = 150;
+  int width    = 2150;
+  long gen     = 0;
+  Automaton *reference = automaton_create_backend(type, height, width,
+                                                  dense_grid_backend);
+  Automaton *actual    = automaton_create_backend(type, height, width,
+                                                  dense_grid_backend);
+
+  automaton_set_threads(actual, threads);
+  srand(type + 5);
+  automaton_random_state(reference);
+  srand(type + 5);
+  automaton_random_state(actual);
+
+  for (size_t i = 0; i < sizeof(chunks) / sizeof(chunks[0]) && success; i++)
+    {
+      for (long step = 0; step < chunks[i]; step++)
+        automaton_update_state(reference);
+      success = automaton_step_n(actual, chunks[i]);
+      gen += chunks[i];
+
+      for (int y = -height / 2; y < height - height / 2 && success; y++)
+        for (int x = -width / 2; x < width - width / 2 && success; x++)
+          success = automaton_get_state(reference, y, x)
+            == automaton_get_state(actual, y, x);
+    }
+
+  printf("%s type %d threads %d step_n to generation %ld\n",
+         success ? "PASSED" : "FAILED", type, threads, gen);
+  automaton_destroy(reference);
+  automaton_destroy(actual);
+
+  return success;
+}
+
+/*
+ * Checks that the change list of an automaton holds exactly the cells inside
+ * the borders whose state differs from the given copy of the board, which is
+ * then brought up to date.  Changes outside the borders are ignored.
+ */
+static bool
+check_changes (Automaton *automaton, int *before)
+{
+  bool success = true;
+  int height   = automaton_get_height(automaton);
+  int width    = automaton_get_width(automaton);
+  size_t count;
+  const Automaton_Change *changes = automaton_get_changes(automaton, &count);
+
+  for (size_t i = 0; i < count && success; i++)
+    {
+      int row = changes[i].y + height / 2;
+      int col = changes[i].x + width / 2;
+
+      if (row < 0 || row >= height || col < 0 || col >= width)
+        continue;
+
+      // a cell listed twice no longer differs the second time
+      success = before[row * width + col] != changes[i].state
+        && automaton_get_state(automaton, changes[i].y, changes[i].x)
+           == changes[i].state;
+      before[row * width + col] = changes[i].state;
+    }
+
+  for (int row = 0; row < height && success; row++)
+    for (int col = 0; col < width && success; col++)
+      success = before[row * width + col]
+        == automaton_get_state(automaton, row - height / 2, col - width / 2);
+
+  return success;
+}
+
+static void
+copy_board (Automaton *automaton, int *board)
+{
+  int height = automaton_get_height(automaton);
+  int width  = automaton_get_width(automaton);
+
+  for (int row = 0; row < height; row++)
+    for (int col = 0; col < width; col++)
+      board[row * width + col] = automaton_get_state(automaton,
+                                                     row - height / 2,
+                                                     col - width / 2);
+}
+
+/*
+ * Runs a soup with change tracking on and checks every generation's change
+ * list, then checks the list left by automaton_step_n against a copy of the
+ * board taken one generation before it finished.  With several threads the
+ * changes of every worker must be listed.
+ */
+bool
+test_changes_match (Automaton_Type type, Automaton_Backend backend,
+                    int threads)
+{
+  static const int height = 37;
+  static const int width  = 140;
+  bool success = true;
+  int *before  = malloc(sizeof(int) * height * width);
+  Automaton *automaton = automaton_create_backend(type, height, width,
+                                                  backend);
+  Automaton *shadow    = automaton_create_backend(type, height, width,
+                                                  backend);
+
+  srand(type + 3);
+  automaton_random_state(automaton);
+  srand(type + 3);
+  automaton_random_state(shadow);
+  automaton_set_threads(automaton, threads);
+  automaton_set_change_tracking(automaton, true);
+
+  for (int gen = 0; gen < 20 && success; gen++)
+    {
+      if (gen == 10)
+        automaton_set_state(automaton, 0, 0, 1);
+      copy_board(automaton, before);
+      success = automaton_update_state(automaton)
+        && check_changes(automaton, before);
+      if (gen == 10)
+        automaton_set_state(shadow, 0, 0, 1);
+      automaton_update_state(shadow);
+    }
+
+  // the blocked dense grid only lists the last generation of the step
+  automaton_step_n(shadow, 40);
+  copy_board(shadow, before);
+  automaton_update_state(shadow);
+  success = success && automaton_step_n(automaton, 41)
+    && check_changes(automaton, before);
+
+  printf("%s type %d backend %d threads %d changes\n",
+         success ? "PASSED" : "FAILED", type, backend, threads);
+  automaton_destroy(automaton);
+  automaton_destroy(shadow);
+  free(before);
+
+  return success;
+}
+
+/*
+ * A blinker alone on a large board settles into tiles that are skipped by
+ * the dense grid, which must still list its changes every generation.
+ */
+bool
+test_changes_oscillator (Automaton_Backend backend)
+{
+  static const int height = 100;
+  static const int width  = 200;
+  bool success = true;
+  int *before  = malloc(sizeof(int) * height * width);
+  Automaton *automaton = automaton_create_backend(game_of_life, height,
+                                                  width, backend);
+
+  automaton_set_state(automaton, 30, 70, 1);
+  automaton_set_state(automaton, 30, 71, 1);
+  automaton_set_state(automaton, 30, 72, 1);
+  automaton_set_change_tracking(automaton, true);
+
+  for (int gen = 0; gen < 8 && success; gen++)
+    {
+      size_t count;
+      copy_board(automaton, before);
+      success = automaton_update_state(automaton)
+        && check_changes(automaton, before)
+        && automaton_get_changes(automaton, &count) && count == 4;
+    }
+
+  printf("%s backend %d oscillator changes\n",
+         success ? "PASSED" : "FAILED", backend);
+  automaton_destroy(automaton);
+  free(before);
+
+  return success;
+}
+
+/*
+ * Runs a glider and checks the stats of a single update and of a step.  The
+ * counters are only checked to be kept when they are compiled in, and to be
+ * zero when they aren't.
+ */
+bool
+test_stats (Automaton_Backend backend)
+{
+  static const int glider[][2] = {
+    { 0, 1 }, { 1, 2 }, { 2, 0 }, { 2, 1 }, { 2, 2 }
+  };
+  bool success = true;
+  bool tree    = backend == point_set_backend || backend == sparse_backend
+    || backend == hashlife_backend;
+  Automaton_Stats stats;
+  Automaton *automaton = automaton_create_backend(game_of_life, 40, 50,
+                                                  backend);
+
+  for (size_t i = 0; i < sizeof(glider) / sizeof(glider[0]); i++)
+    automaton_set_state(automaton, glider[i][0], glider[i][1], 1);
+
+  automaton_update_state(automaton);
+  success = automaton_get_stats(automaton, &stats) == STATS_ENABLED
+    && stats.population == 5 && (tree || stats.tree_height == 0)
+    && (backend != hashlife_backend || stats.tree_height > 0);
+  if (STATS_ENABLED)
+    success = success && stats.generations == 1 && stats.seconds >= 0
+      && stats.cells_evaluated > 0
+      && stats.cells_evaluated <= 40 * 50
+      && (backend != point_set_backend
+          || (stats.cells_evaluated == 40 * 50
+              && stats.searches >= 40 * 50
+              && stats.node_allocations == 5));
+  else
+    success = success && stats.generations == 0 && stats.seconds == 0
+      && stats.cells_evaluated == 0 && stats.searches == 0
+      && stats.node_allocations == 0;
+
+  success = success && automaton_step_n(automaton, 8)
+    && automaton_get_stats(automaton, &stats) == STATS_ENABLED
+    && stats.population == 5
+    && (!STATS_ENABLED
+        || (stats.generations == 8 && stats.cells_evaluated > 0));
+
+  // the point set's height is kept between calls, but not once it changes
+  if (backend == point_set_backend || backend == sparse_backend)
+    {
+      success = success && automaton_dead_state(automaton);
+      automaton_get_stats(automaton, &stats);
+      success = success && stats.population == 0 && stats.tree_height == 0
+        && automaton_set_state(automaton, 0, 0, 1);
+      automaton_get_stats(automaton, &stats);
+      success = success && stats.population == 1 && stats.tree_height <= 1;
+    }
+
+  printf("%s stats backend %d\n", success ? "PASSED" : "FAILED", backend);
+  automaton_destroy(automaton);
+
+  return success;
+}
+
+/*
+ * Searches made by the workers of a parallel update are counted on their own
+ * threads, so check they add up to the searches of the serial update.
+ */
+bool
+test_stats_threads ()
+{
+  Automaton *serial   = automaton_create(game_of_life, 37, 70);
+  Automaton *parallel = automaton_create(game_of_life, 37, 70);
+  Automaton_Stats serial_stats, parallel_stats;
+
+  automaton_set_threads(parallel, 3);
+  srand(17);
+  automaton_random_state(serial);
+  srand(17);
+  automaton_random_state(parallel);
+  automaton_update_state(serial);
+  automaton_update_state(parallel);
+  automaton_get_stats(serial, &serial_stats);
+  automaton_get_stats(parallel, &parallel_stats);
+
+  bool success = serial_stats.searches == parallel_stats.searches
+    && serial_stats.cells_evaluated == parallel_stats.cells_evaluated
+    && serial_stats.population == parallel_stats.population;
+  printf("%s stats threads\n", success ? "PASSED" : "FAILED");
+  automaton_destroy(serial);
+  automaton_destroy(parallel);
+
+  return success;
+}
+
+int
+main ()
+{
+  int failures = 0;
+
+  failures += test_backend(point_set_backend);
+  failures += test_backend(dense_grid_backend);
+  failures += test_backend(sparse_backend);
+  failures += test_backend(hashlife_backend);
+  failures += test_backend(wavefront_backend);
+
+  for (Automaton_Type type = game_of_life; type <= brians_brain; type++)
+    {
+      failures += !test_backend_matches(type, dense_grid_backend, 37, 70);
+      failures += !test_backend_matches(type, sparse_backend, 37, 70);
+      failures += !test_backend_matches(type, wavefront_backend, 37, 70);
+      failures += !test_edits_match(type, wavefront_backend);
+      failures += !test_edits_match(type, dense_grid_backend);
+      if (type != greenberg_hastings && type != brians_brain)
+        failures += !test_unbounded_matches(type, hashlife_backend);
+    }
+  failures += !test_hashlife_glider();
+  failures += !test_hashlife_far_changes();
+
+  for (Automaton_Type type = game_of_life; type <= brians_brain; type++)
+    failures += !test_step_n_matches(type, 1);
+  failures += !test_step_n_matches(game_of_life, 3);
+
+  for (Automaton_Backend backend = point_set_backend;
+       backend <= wavefront_backend; backend++)
+    {
+      failures += !test_changes_match(game_of_life, backend, 1);
+      failures += !test_changes_match(brians_brain, backend, 1);
+      failures += !test_changes_oscillator(backend);
+    }
+  failures += !test_changes_match(game_of_life, point_set_backend, 3);
+  failures += !test_changes_match(game_of_life, dense_grid_backend, 3);
+
+  for (Automaton_Type type = game_of_life; type <= brians_brain; type++)
+    {
+      failures += !test_threads_match(type, point_set_backend, 3);
+      failures += !test_threads_match(type, dense_grid_backend, 3);
+      failures += !test_threads_match(type, dense_grid_backend, 64);
+    }
+
+  failures += !test_tile_skipping(1);
+  failures += !test_tile_skipping(2);
+
+  for (Automaton_Backend backend = point_set_backend;
+       backend <= wavefront_backend; backend++)
+    failures += !test_stats(backend);
+  failures += !test_stats_threads();
+
+  failures += !test_rule_presets();
+  failures += !test_rule_shrinks_states();
+  for (Automaton_Backend backend = point_set_backend;
+       backend <= wavefront_backend; backend++)
+    {
+      if (backend == hashlife_backend)
+        continue;
+
+      failures += !test_rule_matches("B2/S345/C4", backend);
+      failures += !test_rule_matches("B13/S012V", backend);
+      failures += !test_rule_matches("B0/S8", backend);
+      failures += !test_rule_matches("B36/S125", backend);
+    }
+
+  // every kernel must agree with the per-cell rules, including on the words
+  // left over after the last whole vector of a row
+  for (Life_Kernel_Isa isa = life_kernel_scalar; isa <= life_kernel_avx2; isa++)
+    {
+      if (!life_kernel_select(isa))
+        continue;
+
+      printf("kernel %s\n", life_kernel_isa_name(isa));
+      for (Automaton_Type type = game_of_life; type <= brians_brain; type++)
+        {
+          if (type != greenberg_hastings && type != brians_brain)
+            failures += !test_backend_matches(type, dense_grid_backend, 29,
+                                              401);
+        }
+    }
+
+  return failures != 0;
 }
@@ -0,0 +1,322 @@
+#include "CellularAutomaton.h"
+#include "Pattern.h"
+#include "TestHelpers.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+
+/*
+ * Loads RLE, Macrocell and text patterns into automata and checks the cells
+ * they set against the same patterns set by hand or loaded in another
+ * format.
+ */
+
+static char text_path[] = "/tmp/test_pattern_XXXXXX";
+static char rle_path[]  = "/tmp/test_pattern_XXXXXX.rle";
+static char mc_path[]   = "/tmp/test_pattern_XXXXXX.mc";
+
+static bool
+write_file (const char *path, const char *text)
+{
+  FILE *fp = fopen(path, "w");
+  if (!fp)
+    return false;
+
+  fputs(text, fp);
+  return fclose(fp) == 0;
+}
+
+// Loads the same pattern in both formats on a backend and compares them
+static bool
+test_formats_match (Automaton_Type type, Automaton_Backend backend,
+                    const char *text, const char *rle)
+{
+  char name[64];
+  Automaton *from_text = automaton_create_backend(type, 12, 17, backend);
+  Automaton *from_rle  = automaton_create_backend(type, 12, 17, backend);
+  bool success = write_file(text_path, text) && write_file(rle_path, rle)
+    && pattern_load_text(from_text, text_path)
+    && pattern_load(from_rle, rle_path)
+    && automaton_get_population(from_rle) > 0
+    && boards_match(from_text, from_rle);
+
+  snprintf(name, sizeof(name), "type %d backend %d rle matches text", type,
+           backend);
+  report(name, success);
+  automaton_destroy(from_text);
+  automaton_destroy(from_rle);
+  return success;
+}
+
+/*
+ * Checks comments, blank lines, counts of more than one digit, runs of empty
+ * rows, whitespace inside the runs and multi-state tags with a prefix.
+ */
+static bool
+test_rle_syntax ()
+{
+  Automaton *automaton = automaton_create_rule("B2/S/C40", 20, 30);
+  bool success = write_file(rle_path,
+                            "#N syntax\n#C a comment\n\n"
+                            "x = 14, y = 5, rule = B2/S/C40\n"
+                            "12.B$\n3$ 13.pA!\n")
+    && pattern_load_rle(automaton, rle_path)
+    && automaton_get_population(automaton) == 2
+    && automaton_get_state(automaton, -2, 12 - 7) == 2
+    && automaton_get_state(automaton, 2, 13 - 7) == 25;
+
+  report("rle syntax", success);
+  automaton_destroy(automaton);
+  return success;
+}
+
+// Every bad file must fail and leave the board as it was
+static bool
+test_rle_errors ()
+{
+  static const char *bad[] = {
+    "bo$obo!\n",                          /* no header */
+    "x = 3, y = 3\nbo$2bB$3o!\n",         /* state 2 in a two-state rule */
+    "x = 3, y = 3\nbo$4o$3o!\n",          /* a row wider than the header */
+    "x = 3, y = 2\nbo$2bo$3o!\n",         /* more rows than the header */
+    "x = 3, y = 3\nbo$2bz$3o!\n",         /* not a tag */
+    "x = 3, y = 3\nbo$2bpo$3o!\n",        /* a prefix on a two-state tag */
+    "x = 40, y = 3\nbo$2bo$3o!\n",        /* wider than the board */
+    "x = 3, y = 3\n99999999999o!\n"       /* a count that overflows */
+  };
+  bool success = true;
+
+  for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]) && success; i++)
+    {
+      Automaton *automaton = automaton_create(game_of_life, 10, 20);
+      automaton_set_state(automaton, 4, 9, 1);
+
+      success = write_file(rle_path, bad[i])
+        && !pattern_load_rle(automaton, rle_path)
+        && automaton_get_population(automaton) == 1
+        && automaton_get_state(automaton, 4, 9) == 1;
+      if (!success)
+        printf("FAILED on bad file %zu\n", i);
+      automaton_destroy(automaton);
+    }
+
+  report("rle errors", success);
+  return success;
+}
+
+/*
+ * Loads a large pattern whose rows alternate between long runs and single
+ * cells, on each backend that runs Life, onto an empty board and onto one
+ * that already has cells.
+ */
+static bool
+test_large_pattern (Automaton_Backend backend)
+{
+  static const int side = 300;
+  size_t size = (size_t) side * 8 + 64;
+  char *rle   = malloc(size);
+  int length  = snprintf(rle, size, "x = %d, y = %d\n", side, side);
+  long population = 0;
+  char name[64];
+  bool success;
+
+  for (int row = 0; row < side; row++)
+    {
+      if (row % 2)
+        length += snprintf(rle + length, size - length, "%dbo$", row);
+      else
+        length += snprintf(rle + length, size - length, "%do$", side);
+      population += row % 2 ? 1 : side;
+    }
+  rle[length - 1] = '!';
+
+  Automaton *automaton = automaton_create_backend(game_of_life, side + 2,
+                                                  side + 2, backend);
+  automaton_set_state(automaton, -(side + 2) / 2, -(side + 2) / 2, 1);
+  success = write_file(rle_path, rle) && pattern_load_rle(automaton, rle_path)
+    && automaton_get_population(automaton) == population + 1
+    && automaton_get_state(automaton, 1 - side / 2, 0 - side / 2) == 0
+    && automaton_get_state(automaton, 1 - side / 2, 1 - side / 2) == 1
+    && automaton_get_state(automaton, 0 - side / 2, side - 1 - side / 2) == 1;
+
+  Automaton *empty = automaton_create_backend(game_of_life, side + 2,
+                                              side + 2, backend);
+  success = success && pattern_load_rle(empty, rle_path)
+    && automaton_get_population(empty) == population;
+
+  snprintf(name, sizeof(name), "large pattern backend %d", backend);
+  report(name, success);
+  automaton_destroy(automaton);
+  automaton_destroy(empty);
+  free(rle);
+  return success;
+}
+
+// Saves a pattern as Macrocell on a backend and loads it back on another
+static bool
+test_macrocell_round_trip (Automaton_Backend from, Automaton_Backend to)
+{
+  char name[64];
+  Automaton *saved  = automaton_create_backend(game_of_life, 40, 50, from);
+  Automaton *loaded = automaton_create_backend(game_of_life, 40, 50, to);
+  bool success = pattern_load(saved, "patterns/life/gosper-glider-gun.rle")
+    && automaton_step_n(saved, 5)
+    && pattern_save(saved, mc_path)
+    && pattern_load(loaded, mc_path)
+    && automaton_get_backend(loaded) == to
+    && automaton_get_population(loaded) == automaton_get_population(saved)
+    && boards_match(saved, loaded);
+
+  snprintf(name, sizeof(name), "macrocell backend %d to backend %d", from,
+           to);
+  report(name, success);
+  automaton_destroy(saved);
+  automaton_destroy(loaded);
+  return success;
+}
+
+/*
+ * A pattern whose every level is four copies of the one below has far more
+ * cells than could ever be set one at a time.  It stays a quadtree on the
+ * hashlife backend, and moves a board too small for it to that backend,
+ * keeping the cells already on the board.
+ */
+static bool
+test_macrocell_huge ()
+{
+  static const int levels = 30;
+  FILE *fp = fopen(mc_path, "w");
+  bool success = fp != NULL;
+
+  if (fp)
+    {
+      fputs("[M2] (test)\n#R B3/S23\n**$**$\n", fp);
+      for (int level = 4; level <= levels; level++)
+        fprintf(fp, "%d %d %d %d %d\n", level, level - 3, level - 3,
+                level - 3, level - 3);
+      success = fclose(fp) == 0;
+    }
+
+  long population = 4L << (2 * (levels - 3));
+  Automaton *hashlife = automaton_create_backend(game_of_life, 10, 10,
+                                                 hashlife_backend);
+  Automaton *dense    = automaton_create(game_of_life, 10, 10);
+  automaton_set_state(dense, 2, 2, 1);
+  success = success && pattern_load(hashlife, mc_path)
+    && automaton_get_population(hashlife) == population
+    && automaton_get_state(hashlife, 0, 0) == 1
+    && automaton_get_state(hashlife, 2, 2) == 0
+    && automaton_update_state(hashlife)
+    && automaton_get_population(hashlife) == population
+    && pattern_load(dense, mc_path)
+    && automaton_get_backend(dense) == hashlife_backend
+    && automaton_get_population(dense) == population + 1
+    && automaton_get_state(dense, 2, 2) == 1;
+
+  report("macrocell huge", success);
+  automaton_destroy(hashlife);
+  automaton_destroy(dense);
+  return success;
+}
+
+// Every bad file must fail and leave the board as it was on every backend
+static bool
+test_macrocell_errors ()
+{
+  static const char *bad[] = {
+    "**$**$\n",                          /* no header */
+    "[M2]\n4 1 0 0 0\n",                 /* a node that isn't there yet */
+    "[M2]\n**$\n5 1 0 0 0\n",           /* a quadrant of the wrong level */
+    "[M2]\n1 0 2 0 1\n",                 /* a state the file can't have */
+    "[M2]\n.........*$\n",               /* a leaf row that is too long */
+    "[M2]\n$$$$$$$$*$\n",                /* a leaf with too many rows */
+    "[M2]\n**$\n4 1 0 0\n",             /* a missing quadrant */
+    "[M2]\n**$\n4 1 0 0 0 x\n",         /* junk after the quadrants */
+    "[M2]\n64 0 0 0 0\n"                 /* a tree too tall */
+  };
+  bool success = true;
+
+  for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]) && success; i++)
+    for (Automaton_Backend backend = point_set_backend;
+         backend <= wavefront_backend && success; backend++)
+      {
+        Automaton *automaton = automaton_create_backend(game_of_life, 10, 20,
+                                                        backend);
+        automaton_set_state(automaton, 4, 9, 1);
+
+        success = write_file(mc_path, bad[i])
+          && !pattern_load(automaton, mc_path)
+          && automaton_get_backend(automaton) == backend
+          && automaton_get_population(automaton) == 1
+          && automaton_get_state(automaton, 4, 9) == 1;
+        if (!success)
+          printf("FAILED on bad file %zu backend %d\n", i, backend);
+        automaton_destroy(automaton);
+      }
+
+  // only two states fit in a Macrocell file
+  Automaton *brain = automaton_create(brians_brain, 10, 10);
+  automaton_set_state(brain, 0, 0, 2);
+  success = success && !pattern_save(brain, mc_path);
+  automaton_destroy(brain);
+
+  report("macrocell errors", success);
+  return success;
+}
+
+// Characters past a text pattern's width are skipped, not read as a row
+static bool
+test_text_long_rows ()
+{
+  Automaton *automaton = automaton_create(game_of_life, 10, 10);
+  bool success = write_file(text_path, "2 2\n0000\n0.\n")
+    && pattern_load_text(automaton, text_path)
+    && automaton_get_population(automaton) == 3
+    && automaton_get_state(automaton, -1, -1) == 1
+    && automaton_get_state(automaton, -1, 0) == 1
+    && automaton_get_state(automaton, 0, -1) == 1;
+
+  report("text long rows", success);
+  automaton_destroy(automaton);
+  return success;
+}
+
+int
+main ()
+{
+  static const char *glider_text = "3 5\n.0...\n..0..\n000..\n";
+  static const char *glider_rle  = "x = 5, y = 3, rule = B3/S23\nbo$2bo$3o!\n";
+  static const char *brain_text  = "4 4\n..0.\n0--.\n.--0\n.0..\n";
+  static const char *brain_rle   = "x = 4, y = 4, rule = /2/3\n"
+    "2.A$A2B$.2BA$.A!\n";
+  int failures = 0;
+
+  close(mkstemp(text_path));
+  close(mkstemps(rle_path, 4));
+  close(mkstemps(mc_path, 3));
+
+  for (Automaton_Backend backend = point_set_backend;
+       backend <= wavefront_backend; backend++)
+    {
+      failures += !test_formats_match(game_of_life, backend, glider_text,
+                                      glider_rle);
+      if (backend != hashlife_backend)
+        failures += !test_formats_match(brians_brain, backend, brain_text,
+                                        brain_rle);
+      failures += !test_large_pattern(backend);
+      failures += !test_macrocell_round_trip(backend, hashlife_backend);
+      failures += !test_macrocell_round_trip(hashlife_backend, backend);
+    }
+  failures += !test_rle_syntax();
+  failures += !test_rle_errors();
+  failures += !test_text_long_rows();
+  failures += !test_macrocell_huge();
+  failures += !test_macrocell_errors();
+
+  remove(text_path);
+  remove(rle_path);
+  remove(mc_path);
+  return failures != 0;
+}
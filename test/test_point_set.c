@@ -0,0 +1,271 @@
+#include "PointSet.h"
+#include "TestHelpers.h"
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+/*
+ * Inserts, searches and deletes a square of points, checking the set's
+ * contents and allocation counters after each pass.
+ */
+
+static bool
+test_insert (Point_Set *points)
+{
+  bool success = true;
+  int num      = 53;
+
+  for (int x = -50; x < 50 && success; x++)
+    {
+      for (int y = -50; y < 50 && success; y++)
+        success = !point_set_search(points, x, y);
+    }
+
+  for (int x = -50; x < 50 && success; x++)
+    {
+      for (int y = -50; y < 50 && success; y++)
+        {
+          int *num_ptr;
+          success = point_set_insert(points, x, y, &num)
+            && (num_ptr = point_set_search(points, x, y)) && *num_ptr == 53;
+        }
+    }
+
+  return success;
+}
+
+// Turning a duplicate away shouldn't touch the allocation counters
+static bool
+test_duplicates (Point_Set *points)
+{
+  Point_Set_Stats before, after;
+  bool success = true;
+  int num      = 7;
+
+  point_set_get_stats(points, &before);
+
+  for (int x = -50; x < 50 && success; x++)
+    {
+      for (int y = -50; y < 50 && success; y++)
+        {
+          int *num_ptr;
+          success = !point_set_insert(points, x, y, &num)
+            && (num_ptr = point_set_search(points, x, y)) && *num_ptr == 53;
+        }
+    }
+  point_set_get_stats(points, &after);
+
+  return success && after.points == before.points
+    && after.node_allocations == before.node_allocations
+    && after.node_frees == before.node_frees;
+}
+
+static bool
+test_delete (Point_Set *points)
+{
+  bool success = true;
+
+  for (int x = -50; x < 0 && success; x++)
+    {
+      for (int y = 0; y < 50 && success; y++)
+        success = point_set_delete(points, x, y)
+          && !point_set_search(points, x, y);
+    }
+
+  for (int x = -50; x < 0 && success; x++)
+    {
+      for (int y = 0; y < 50 && success; y++)
+        success = !point_set_delete(points, x, y)
+          && !point_set_search(points, x, y);
+    }
+
+  return success;
+}
+
+// Deleted slots should be reused before any new block is allocated
+static bool
+test_slot_reuse (Point_Set *points)
+{
+  Point_Set_Stats before, after;
+  int num = 1;
+  bool success = true;
+
+  point_set_get_stats(points, &before);
+  for (int x = -50; x < 0 && success; x++)
+    {
+      for (int y = 0; y < 50 && success; y++)
+        success = point_set_insert(points, x, y, &num);
+    }
+  point_set_get_stats(points, &after);
+
+  return success && after.points == 10000
+    && after.block_allocations == before.block_allocations
+    && after.node_allocations - after.node_frees == after.points;
+}
+
+static void
+count_point (int x, int y, void *data, void *ctx)
+{
+  static int last_x = -1000, last_y = -1000;
+  int *count = ctx;
+  (void) data;
+
+  // points must come out ordered by x and then y
+  if (x < last_x || (x == last_x && y <= last_y))
+    *count = -1;
+  else if (*count >= 0)
+    ++(*count);
+  last_x = x;
+  last_y = y;
+}
+
+static bool
+test_foreach (Point_Set *points)
+{
+  int count = 0;
+  point_set_foreach(points, count_point, &count);
+  return count == 10000;
+}
+
+struct RECT_COUNT
+{
+  int x_min, y_min, x_max, y_max;
+  int count;
+  bool in_order;
+  int last_x, last_y;
+};
+
+static void
+count_rect_point (int x, int y, void *data, void *ctx)
+{
+  struct RECT_COUNT *rect = ctx;
+  (void) data;
+
+  if (x < rect->x_min || x > rect->x_max || y < rect->y_min || y > rect->y_max
+      || (rect->count && (x < rect->last_x
+                          || (x == rect->last_x && y <= rect->last_y))))
+    rect->in_order = false;
+  rect->last_x = x;
+  rect->last_y = y;
+  ++rect->count;
+}
+
+// Half the square was deleted and then refilled so every point is present
+static bool
+test_foreach_in_rect (Point_Set *points)
+{
+  struct RECT_COUNT rect = { -7, -60, 12, 3, 0, true, 0, 0 };
+  point_set_foreach_in_rect(points, rect.x_min, rect.y_min, rect.x_max,
+                            rect.y_max, count_rect_point, &rect);
+
+  // a band in the middle of every column skips points on both sides of it
+  struct RECT_COUNT band = { -7, 40, 12, 45, 0, true, 0, 0 };
+  point_set_foreach_in_rect(points, band.x_min, band.y_min, band.x_max,
+                            band.y_max, count_rect_point, &band);
+
+  // a rectangle spanning every coordinate visits the whole set
+  struct RECT_COUNT all = { INT_MIN, INT_MIN, INT_MAX, INT_MAX, 0, true, 0,
+                            0 };
+  point_set_foreach_in_rect(points, all.x_min, all.y_min, all.x_max,
+                            all.y_max, count_rect_point, &all);
+
+  return rect.in_order && rect.count == 20 * 54 && band.in_order
+    && band.count == 20 * 6 && all.in_order
+    && all.count == 10000 && point_set_size(points) == 10000;
+}
+
+static bool
+test_clear (Point_Set *points)
+{
+  Point_Set_Stats before, after;
+  int num = 1;
+  bool success = true;
+
+  point_set_get_stats(points, &before);
+  point_set_clear(points);
+  success = point_set_size(points) == 0 && !point_set_search(points, -1, 0);
+
+  // refilling a cleared set reuses the memory it already holds
+  for (int x = -50; x < 50 && success; x++)
+    {
+      for (int y = 0; y < 100 && success; y++)
+        success = point_set_insert(points, x, y, &num);
+    }
+  point_set_get_stats(points, &after);
+
+  return success && after.points == 10000
+    && after.block_allocations == before.block_allocations
+    && after.table_allocations == before.table_allocations;
+}
+
+/*
+ * Loads a square of points in order into the cleared set, then checks that
+ * the set they were built into can still be searched, deleted from and
+ * inserted into.  Points given out of order must be refused.
+ */
+static bool
+test_load_sorted (Point_Set *points)
+{
+  static Point_Set_Entry entries[10000];
+  static int values[10000];
+  bool success = true;
+  int num      = 9;
+
+  point_set_clear(points);
+  for (int i = 0; i < 10000; i++)
+    {
+      values[i]  = i;
+      entries[i] = (Point_Set_Entry) { i / 100 - 50, i % 100, &values[i] };
+    }
+  success = point_set_load_sorted(points, entries, 10000)
+    && point_set_size(points) == 10000
+    && point_set_height(points) <= 2 * 14;
+
+  for (int i = 0; i < 10000 && success; i++)
+    {
+      int *num_ptr = point_set_search(points, entries[i].x, entries[i].y);
+      success = num_ptr && *num_ptr == i;
+    }
+
+  // the built tree has to stay balanced through later edits
+  for (int x = -50; x < 0 && success; x++)
+    {
+      for (int y = 0; y < 100 && success; y++)
+        success = point_set_delete(points, x, y)
+          && point_set_insert(points, x, y + 100, &num);
+    }
+  for (int x = -50; x < 50 && success; x++)
+    {
+      for (int y = 0; y < 200 && success; y++)
+        success = (point_set_search(points, x, y) != NULL)
+          == (x < 0 ? y >= 100 : y < 100);
+    }
+
+  point_set_clear(points);
+  entries[5000] = entries[4000];
+  success = success && !point_set_load_sorted(points, entries, 10000)
+    && point_set_size(points) == 0 && point_set_load_sorted(points, entries, 0);
+
+  return success;
+}
+
+int
+main ()
+{
+  int failures = 0;
+  Point_Set *points = point_set_create(sizeof(int), NULL);
+
+  failures += report("insert", test_insert(points));
+  failures += report("duplicates", test_duplicates(points));
+  failures += report("delete", test_delete(points));
+  failures += report("slot reuse", test_slot_reuse(points));
+  failures += report("foreach", test_foreach(points));
+  failures += report("foreach in rect", test_foreach_in_rect(points));
+  failures += report("clear", test_clear(points));
+  failures += report("load sorted", test_load_sorted(points));
+
+  point_set_destroy(points);
+
+  return failures != 0;
+}
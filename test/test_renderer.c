@@ -0,0 +1,241 @@
+#include "Renderer.h"
+#include "TestHelpers.h"
+#include <locale.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+/*
+ * Draws a few cells of Brian's Brain into a window of a terminal writing to
+ * /dev/null and reads the characters back out of the window.
+ */
+
+#define ROWS 6
+#define COLS 8
+
+static WINDOW *window;
+
+// Reads the wide character and attributes at a position of the window
+static wchar_t
+wide_at (int row, int col, attr_t *attr)
+{
+  cchar_t cell;
+  wchar_t c[CCHARW_MAX + 1];
+  short pair;
+
+  mvwin_wch(window, row, col, &cell);
+  getcchar(&cell, c, attr, &pair, NULL);
+  return c[0];
+}
+
+static bool
+test_cells ()
+{
+  Automaton *automaton = automaton_create_backend(brians_brain, 24, 16,
+                                                  point_set_backend);
+  Renderer *renderer   = renderer_create(window, render_cells);
+  bool success = true;
+
+  // the window is centred on the origin, so cell (0, 0) is at row 3, col 4
+  automaton_set_state(automaton, 0, 0, 1);
+  automaton_set_state(automaton, 0, 1, 2);
+  automaton_set_state(automaton, -3, -4, 1);
+  success = renderer_draw(renderer, automaton);
+
+  chtype live  = mvwinch(window, 3, 4);
+  chtype dying = mvwinch(window, 3, 5);
+  success = success && (live & A_CHARTEXT) == '#' && !(live & A_DIM)
+    && (dying & A_CHARTEXT) == '#' && (dying & A_DIM)
+    && (mvwinch(window, 0, 0) & A_CHARTEXT) == '#'
+    && (mvwinch(window, 3, 3) & A_CHARTEXT) == ' ';
+
+  int y, x;
+  renderer_cell_at(renderer, 3, 5, &y, &x);
+  success = success && y == 0 && x == 1;
+
+  renderer_destroy(renderer);
+  automaton_destroy(automaton);
+  return success;
+}
+
+static bool
+test_incremental ()
+{
+  Automaton *automaton = automaton_create_backend(brians_brain, 24, 16,
+                                                  point_set_backend);
+  Renderer *renderer   = renderer_create(window, render_cells);
+  bool success;
+
+  automaton_set_state(automaton, 0, 0, 1);
+  renderer_draw(renderer, automaton);
+  wrefresh(window);
+
+  // an unchanged frame writes nothing
+  success = renderer_draw(renderer, automaton) && !is_wintouched(window);
+
+  // a changed cell only writes its own row
+  automaton_set_state(automaton, 1, 2, 1);
+  success = success && renderer_draw(renderer, automaton);
+  for (int row = 0; row < ROWS; row++)
+    success = success && is_linetouched(window, row) == (row == 4);
+  success = success && (mvwinch(window, 4, 6) & A_CHARTEXT) == '#';
+  wrefresh(window);
+
+  // after an invalidation everything is written again
+  renderer_invalidate(renderer);
+  wrefresh(window);
+  success = success && renderer_draw(renderer, automaton);
+  for (int row = 0; row < ROWS; row++)
+    success = success && is_linetouched(window, row);
+
+  renderer_destroy(renderer);
+  automaton_destroy(automaton);
+  return success;
+}
+
+static bool
+test_capture ()
+{
+  Automaton *automaton = automaton_create_backend(brians_brain, 24, 16,
+                                                  point_set_backend);
+  Renderer *renderer   = renderer_create(window, render_cells);
+  bool success = !renderer_present(renderer);
+
+  automaton_set_state(automaton, 0, 0, 1);
+  renderer_capture(renderer, automaton);
+
+  // only the latest capture is presented, and only once
+  automaton_set_state(automaton, 0, 0, 0);
+  automaton_set_state(automaton, 1, 1, 1);
+  renderer_capture(renderer, automaton);
+  success = success && renderer_present(renderer)
+    && (mvwinch(window, 3, 4) & A_CHARTEXT) == ' '
+    && (mvwinch(window, 4, 5) & A_CHARTEXT) == '#'
+    && !renderer_present(renderer);
+
+  // a capture for another mode is dropped
+  renderer_capture(renderer, automaton);
+  success = success && renderer_set_mode(renderer, render_half_blocks)
+    && !renderer_present(renderer);
+
+  renderer_destroy(renderer);
+  automaton_destroy(automaton);
+  return success;
+}
+
+static bool
+test_half_blocks ()
+{
+  Automaton *automaton = automaton_create_backend(brians_brain, 24, 16,
+                                                  point_set_backend);
+  Renderer *renderer   = renderer_create(window, render_half_blocks);
+  bool success = renderer_get_mode(renderer) == render_half_blocks;
+  attr_t attr;
+
+  // twelve rows of cells fit in the window, so cell (0, 0) is at row 3
+  automaton_set_state(automaton, 0, 0, 1);
+  automaton_set_state(automaton, 1, 0, 1);
+  automaton_set_state(automaton, 0, 1, 1);
+  automaton_set_state(automaton, 3, 0, 2);
+  success = success && renderer_draw(renderer, automaton);
+
+  success = success && wide_at(3, 4, &attr) == 0x2588 && !(attr & A_DIM)
+    && wide_at(3, 5, &attr) == 0x2580
+    && wide_at(4, 4, &attr) == 0x2584 && (attr & A_DIM)
+    && wide_at(4, 5, &attr) == L' ';
+
+  int y, x;
+  renderer_cell_at(renderer, 4, 4, &y, &x);
+  success = success && y == 2 && x == 0;
+
+  renderer_destroy(renderer);
+  automaton_destroy(automaton);
+  return success;
+}
+
+static bool
+test_braille ()
+{
+  Automaton *automaton = automaton_create_backend(brians_brain, 24, 16,
+                                                  point_set_backend);
+  Renderer *renderer   = renderer_create(window, render_cells);
+  bool success = renderer_set_mode(renderer, render_braille);
+  attr_t attr;
+
+  // the character at row 3, col 4 holds cells (0, 0) to (3, 1)
+  automaton_set_state(automaton, 0, 0, 1);
+  automaton_set_state(automaton, 0, 1, 1);
+  automaton_set_state(automaton, 3, 1, 2);
+  automaton_set_state(automaton, -12, -8, 1);
+  success = success && renderer_draw(renderer, automaton);
+
+  success = success && wide_at(3, 4, &attr) == 0x2889
+    && wide_at(0, 0, &attr) == 0x2801
+    && wide_at(3, 5, &attr) == 0x2800;
+
+  // switching modes redraws the whole window, leaving no braille behind
+  success = success && renderer_set_mode(renderer, render_cells)
+    && renderer_draw(renderer, automaton)
+    && (mvwinch(window, 3, 4) & A_CHARTEXT) == '#'
+    && (mvwinch(window, 3, 5) & A_CHARTEXT) == '#'
+    && (mvwinch(window, 0, 0) & A_CHARTEXT) == ' '
+    && (mvwinch(window, 5, 7) & A_CHARTEXT) == ' ';
+
+  renderer_destroy(renderer);
+  automaton_destroy(automaton);
+  return success;
+}
+
+static bool
+test_plain_locale ()
+{
+  Renderer *renderer;
+  bool success;
+
+  setlocale(LC_CTYPE, "C");
+  renderer = renderer_create(window, render_braille);
+  success  = renderer_get_mode(renderer) == render_cells
+    && !renderer_set_mode(renderer, render_half_blocks)
+    && renderer_get_mode(renderer) == render_cells;
+  setlocale(LC_CTYPE, "C.UTF-8");
+
+  renderer_destroy(renderer);
+  return success;
+}
+
+int
+main ()
+{
+  int failures = 0;
+
+  if (!setlocale(LC_ALL, "C.UTF-8"))
+    {
+      printf("SKIPPED renderer, no UTF-8 locale\n");
+      return 0;
+    }
+
+  FILE *out = fopen("/dev/null", "w");
+  FILE *in  = fopen("/dev/null", "r");
+  SCREEN *screen = newterm("xterm", out, in);
+  if (!screen)
+    {
+      printf("SKIPPED renderer, no terminal description\n");
+      return 0;
+    }
+  window = newwin(ROWS, COLS, 0, 0);
+
+  failures += report("cells", test_cells());
+  failures += report("incremental redraw", test_incremental());
+  failures += report("capture and present", test_capture());
+  failures += report("half blocks", test_half_blocks());
+  failures += report("braille", test_braille());
+  failures += report("plain locale", test_plain_locale());
+
+  delwin(window);
+  endwin();
+  delscreen(screen);
+  fclose(out);
+  fclose(in);
+
+  return failures != 0;
+}
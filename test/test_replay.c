@@ -0,0 +1,368 @@
+#include "CellularAutomaton.h"
+#include "Codec.h"
+#include "Replay.h"
+#include "TestHelpers.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <unistd.h>
+
+/*
+ * Records runs and plays them back, checking every generation played and
+ * every generation sought against the run recomputed from the same soup, and
+ * that logs cut short or damaged are played only as far as they are whole.
+ */
+
+static char path[] = "/tmp/test_replay_XXXXXX";
+
+static Automaton *
+create_soup (Automaton_Type type, Automaton_Backend backend, int size,
+             unsigned int seed)
+{
+  Automaton *automaton = automaton_create_backend(type, size, size, backend);
+
+  srand(seed);
+  automaton_random_state(automaton);
+  return automaton;
+}
+
+// Runs a soup for some generations, recording each one
+static bool
+record_soup (Automaton_Type type, Automaton_Backend backend, int size,
+             long generations, long interval)
+{
+  Automaton *automaton = create_soup(type, backend, size, 17);
+  Recorder *recorder   = recorder_create(automaton, path, interval);
+  bool success         = recorder != NULL;
+
+  for (long i = 0; i < generations && success; i++)
+    success = automaton_update_state(automaton)
+      && recorder_record(recorder, automaton);
+
+  // a generation can't be recorded twice
+  success = success && !recorder_record(recorder, automaton);
+  if (recorder)
+    success = recorder_destroy(recorder) && success;
+  automaton_destroy(automaton);
+  return success;
+}
+
+// Recomputes a soup's run up to a generation
+static Automaton *
+run_soup (Automaton_Type type, Automaton_Backend backend, int size,
+          long generation)
+{
+  Automaton *automaton = create_soup(type, backend, size, 17);
+
+  automaton_step_n(automaton, generation);
+  return automaton;
+}
+
+static bool
+test_play (Automaton_Type type, Automaton_Backend backend)
+{
+  char name[64];
+  Automaton *expected = create_soup(type, backend, 41, 17);
+  Player *player      = NULL;
+  bool success = record_soup(type, backend, 41, 60, 16)
+    && (player = player_open(path)) != NULL
+    && player_get_first_generation(player) == 0
+    && player_get_last_generation(player) == 60
+    && player_get_generation(player) == 0
+    && boards_match(expected, player_get_automaton(player));
+
+  for (long generation = 1; generation <= 60 && success; generation++)
+    success = automaton_update_state(expected)
+      && player_step(player)
+      && player_get_generation(player) == generation
+      && boards_match(expected, player_get_automaton(player));
+  success = success && !player_step(player)
+    && player_get_generation(player) == 60;
+
+  snprintf(name, sizeof(name), "type %d backend %d play", type, backend);
+  report(name, success);
+  automaton_destroy(expected);
+  if (player)
+    player_destroy(player);
+  return success;
+}
+
+static bool
+test_seek ()
+{
+  static const long targets[] = { 45, 3, 47, 48, 16, 15, 0, 80, 32, 31, 79 };
+  Player *player = NULL;
+  bool success   = record_soup(brians_brain, dense_grid_backend, 64, 80, 16)
+    && (player = player_open(path)) != NULL;
+
+  for (size_t i = 0; i < sizeof(targets) / sizeof(targets[0]) && success;
+       i++)
+    {
+      Automaton *expected = run_soup(brians_brain, dense_grid_backend, 64,
+                                     targets[i]);
+      success = player_seek(player, targets[i])
+        && player_get_generation(player) == targets[i]
+        && boards_match(expected, player_get_automaton(player));
+      automaton_destroy(expected);
+    }
+  success = success && !player_seek(player, -1) && !player_seek(player, 81)
+    && player_get_generation(player) == 79;
+
+  report("seek", success);
+  if (player)
+    player_destroy(player);
+  return success;
+}
+
+// A step of several generations is recorded as a jump to a keyframe
+static bool
+test_gaps ()
+{
+  Automaton *automaton = create_soup(game_of_life, point_set_backend, 32, 4);
+  Automaton *expected  = create_soup(game_of_life, point_set_backend, 32, 4);
+  Recorder *recorder   = recorder_create(automaton, path, 100);
+  Player *player       = NULL;
+  bool success = recorder != NULL
+    && automaton_update_state(automaton)
+    && recorder_record(recorder, automaton)
+    && automaton_step_n(automaton, 5)
+    && recorder_record(recorder, automaton)
+    && automaton_update_state(automaton)
+    && recorder_record(recorder, automaton);
+
+  if (recorder)
+    success = recorder_destroy(recorder) && success;
+  success = success && (player = player_open(path)) != NULL
+    && player_get_last_generation(player) == 7
+    && player_step(player) && player_get_generation(player) == 1
+    && player_step(player) && player_get_generation(player) == 6
+    && automaton_step_n(expected, 6)
+    && boards_match(expected, player_get_automaton(player))
+    && player_seek(player, 4) && player_get_generation(player) == 1
+    && player_seek(player, 7)
+    && automaton_update_state(expected)
+    && boards_match(expected, player_get_automaton(player));
+
+  report("gaps", success);
+  automaton_destroy(automaton);
+  automaton_destroy(expected);
+  if (player)
+    player_destroy(player);
+  return success;
+}
+
+// A board big enough that blocks fill up between keyframes
+static bool
+test_large ()
+{
+  Automaton *expected = NULL;
+  Player *player      = NULL;
+  long size           = 0;
+  FILE *fp;
+  bool success = record_soup(game_of_life, dense_grid_backend, 400, 150, 100)
+    && (fp = fopen(path, "rb")) != NULL;
+
+  if (success)
+    {
+      fseek(fp, 0, SEEK_END);
+      size = ftell(fp);
+      fclose(fp);
+    }
+
+  // a soup hardly compresses, but its changes must still take less than a
+  // bit for every cell of every generation
+  success = success && size < 150 * 400 * 400 / 8
+    && (player = player_open(path)) != NULL
+    && player_get_last_generation(player) == 150
+    && player_seek(player, 140)
+    && (expected = run_soup(game_of_life, dense_grid_backend, 400, 140))
+    && boards_match(expected, player_get_automaton(player));
+
+  report("large board", success);
+  if (expected)
+    automaton_destroy(expected);
+  if (player)
+    player_destroy(player);
+  return success;
+}
+
+static void
+put_checksum (Codec_Buffer *buffer, uint32_t crc)
+{
+  uint8_t checksum[4] = { crc, crc >> 8, crc >> 16, crc >> 24 };
+  codec_put(buffer, checksum, sizeof(checksum));
+}
+
+/*
+ * Appends a keyframe block to the log whose checksums match but whose one
+ * record runs on past its cells, and which is larger than the blocks before
+ * it so that loading it grows the player's buffers
+ */
+static bool
+append_bad_block (long generation)
+{
+  Codec_Buffer data   = { NULL, 0, 0, false };
+  Codec_Buffer header = { NULL, 0, 0, false };
+  uint8_t keyframe    = 1;
+  uint8_t padding[300] = { 0 };
+  FILE *fp            = NULL;
+  bool success;
+
+  codec_put_varint(&data, 0);
+  codec_put(&data, padding, sizeof(padding));
+
+  codec_put(&header, &keyframe, 1);
+  codec_put_varint(&header, generation);
+  codec_put_varint(&header, 1);
+  codec_put_varint(&header, data.size);
+  codec_put_varint(&header, data.size);
+  put_checksum(&header, codec_crc32(0, data.bytes, data.size));
+  put_checksum(&header, codec_crc32(0, header.bytes, header.size));
+
+  success = !data.failed && !header.failed
+    && (fp = fopen(path, "ab")) != NULL
+    && fwrite(header.bytes, 1, header.size, fp) == header.size
+    && fwrite(data.bytes, 1, data.size, fp) == data.size;
+  if (fp)
+    success = fclose(fp) == 0 && success;
+
+  free(data.bytes);
+  free(header.bytes);
+  return success;
+}
+
+// A block that can't be played leaves the player where it was
+static bool
+test_bad_block ()
+{
+  Automaton *automaton = automaton_create(game_of_life, 8, 8);
+  Automaton *expected  = automaton_create(game_of_life, 8, 8);
+  Recorder *recorder   = NULL;
+  Player *player       = NULL;
+  bool success         = true;
+
+  for (int x = -1; x <= 1; x++)
+    success = success && automaton_set_state(automaton, 0, x, 1)
+      && automaton_set_state(expected, 0, x, 1);
+
+  success = success
+    && (recorder = recorder_create(automaton, path, 100)) != NULL
+    && automaton_update_state(automaton)
+    && recorder_record(recorder, automaton)
+    && automaton_update_state(automaton)
+    && recorder_record(recorder, automaton);
+  if (recorder)
+    success = recorder_destroy(recorder) && success;
+
+  // a seek into the block goes back to the middle of the block before,
+  // which is then stepped through up to the bad block
+  success = success && append_bad_block(3)
+    && (player = player_open(path)) != NULL
+    && player_get_last_generation(player) == 3
+    && !player_seek(player, 3)
+    && player_get_generation(player) == 0
+    && boards_match(expected, player_get_automaton(player))
+    && player_step(player) && player_get_generation(player) == 1
+    && automaton_update_state(expected)
+    && boards_match(expected, player_get_automaton(player))
+    && player_step(player) && player_get_generation(player) == 2
+    && automaton_update_state(expected)
+    && boards_match(expected, player_get_automaton(player))
+    && !player_step(player) && !player_step(player)
+    && player_get_generation(player) == 2
+    && boards_match(expected, player_get_automaton(player))
+    && player_seek(player, 1) && player_get_generation(player) == 1;
+
+  report("bad block", success);
+  automaton_destroy(automaton);
+  automaton_destroy(expected);
+  if (player)
+    player_destroy(player);
+  return success;
+}
+
+// Cutting a log short loses its last blocks, and damage is never read
+static bool
+test_damaged ()
+{
+  unsigned char *bytes = NULL;
+  long size = 0;
+  FILE *fp;
+  bool success = record_soup(game_of_life, dense_grid_backend, 24, 40, 8)
+    && (fp = fopen(path, "rb")) != NULL;
+
+  if (success)
+    {
+      fseek(fp, 0, SEEK_END);
+      size  = ftell(fp);
+      bytes = malloc(size);
+      rewind(fp);
+      success = bytes && fread(bytes, 1, size, fp) == (size_t) size;
+      fclose(fp);
+    }
+
+  for (long i = 0; i < 2 * size && success; i++)
+    {
+      // the first pass flips a byte, the second cuts the log there
+      long cut = i < size ? size : i - size;
+      fp = fopen(path, "wb");
+      if (i < size)
+        bytes[i] ^= 0x10;
+      fwrite(bytes, 1, cut, fp);
+      if (i < size)
+        bytes[i] ^= 0x10;
+      fclose(fp);
+
+      Player *player = player_open(path);
+      if (!player)
+        continue;
+
+      Automaton *expected = run_soup(game_of_life, dense_grid_backend, 24,
+                                     player_get_generation(player));
+      long last = player_get_last_generation(player);
+      success = last <= 40
+        && boards_match(expected, player_get_automaton(player));
+      while (success && player_step(player))
+        success = automaton_update_state(expected)
+          && boards_match(expected, player_get_automaton(player));
+
+      // a cut log must still play to its end
+      success = success && (i < size || player_get_generation(player) == last);
+      if (!success)
+        printf("FAILED on %s at byte %ld\n", i < size ? "flip" : "cut",
+               i % size);
+      automaton_destroy(expected);
+      player_destroy(player);
+    }
+  Automaton *automaton = automaton_create(seeds, 8, 8);
+  success = success && player_open("/nonexistent/x") == NULL
+    && recorder_create(automaton, "/nonexistent/x", 1) == NULL;
+  automaton_destroy(automaton);
+
+  report("damaged logs", success);
+  free(bytes);
+  return success;
+}
+
+int
+main ()
+{
+  int failures = 0;
+
+  close(mkstemp(path));
+
+  for (Automaton_Backend backend = point_set_backend;
+       backend <= wavefront_backend; backend++)
+    {
+      failures += !test_play(game_of_life, backend);
+      failures += !test_play(brians_brain, backend);
+    }
+  failures += !test_seek();
+  failures += !test_gaps();
+  failures += !test_large();
+  failures += !test_damaged();
+  failures += !test_bad_block();
+
+  remove(path);
+  return failures != 0;
+}
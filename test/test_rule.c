@@ -0,0 +1,93 @@
+#include "Rule.h"
+#include "TestHelpers.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+/*
+ * Parses rulestrings in each accepted form and checks the rules they give,
+ * the canonical rulestrings they are written back as and the lookup tables
+ * built from them.
+ */
+
+// Parses a rulestring and checks that it is written back as expected
+static bool
+check_parse (const char *string, const char *expected)
+{
+  Rule rule;
+  char written[RULE_STRING_MAX];
+
+  if (!rule_parse(string, &rule))
+    return false;
+
+  rule_format(&rule, written, sizeof(written));
+  return strcmp(written, expected) == 0;
+}
+
+static bool
+test_forms ()
+{
+  return check_parse("B3/S23", "B3/S23")
+    && check_parse("b36/s23", "B36/S23")
+    && check_parse("S23/B3", "B3/S23")
+    && check_parse("23/3", "B3/S23")
+    && check_parse("B2/S", "B2/S")
+    && check_parse("/2/3", "B2/S/C3")
+    && check_parse("B2/S/C3", "B2/S/C3")
+    && check_parse("B1234/S/C3V", "B1234/S/C3V")
+    && check_parse("B0123478/S01234678", "B0123478/S01234678")
+    && check_parse("B3/S23/C256", "B3/S23/C256");
+}
+
+static bool
+test_invalid ()
+{
+  static const char *invalid[] = {
+    "", "B3", "S23", "B9/S23", "B3/S23/C1", "B3/S23/C257", "B3/S23/C",
+    "B3/S23/X4", "B3/B3/S23", "B5/S23V", "B3/23", "23/3/3/3", "B3x/S23"
+  };
+  bool success = true;
+  Rule rule;
+
+  for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++)
+    {
+      if (rule_parse(invalid[i], &rule))
+        {
+          printf("accepted %s\n", invalid[i]);
+          success = false;
+        }
+    }
+
+  return success;
+}
+
+static bool
+test_table ()
+{
+  Rule life, brain;
+  bool success = rule_parse("B3/S23", &life) && rule_parse("B2/S/C3", &brain);
+
+  for (int count = 0; count <= RULE_MAX_NEIGHBOURS && success; count++)
+    {
+      success = rule_next_state(&life, 0, count) == (count == 3)
+        && rule_next_state(&life, 1, count) == (count == 2 || count == 3)
+        && rule_next_state(&brain, 0, count) == (count == 2)
+        && rule_next_state(&brain, 1, count) == 2
+        && rule_next_state(&brain, 2, count) == 0;
+    }
+
+  return success;
+}
+
+int
+main ()
+{
+  int failures = 0;
+
+  failures += report("rulestring forms", test_forms());
+  failures += report("invalid rulestrings", test_invalid());
+  failures += report("lookup table", test_table());
+
+  return failures != 0;
+}
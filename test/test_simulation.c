@@ -0,0 +1,157 @@
+#include "Simulation.h"
+#include "TestHelpers.h"
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <time.h>
+
+/*
+ * Runs a soup on a simulation's thread and checks the generations it
+ * completed against the same soup advanced on this thread.
+ */
+
+#define HEIGHT 40
+#define WIDTH 60
+
+static atomic_int frames;
+static atomic_long frame_population;
+
+static void
+count_frame (Automaton *automaton, void *ctx)
+{
+  (void) ctx;
+  atomic_store(&frame_population, automaton_get_population(automaton));
+  atomic_fetch_add(&frames, 1);
+}
+
+static void
+sleep_ms (long ms)
+{
+  struct timespec time = { ms / 1000, ms % 1000 * 1000000 };
+  nanosleep(&time, NULL);
+}
+
+static Automaton *
+soup (Automaton_Type type)
+{
+  Automaton *automaton = automaton_create_backend(type, HEIGHT, WIDTH,
+                                                  point_set_backend);
+  srand(type + 11);
+  automaton_random_state(automaton);
+  return automaton;
+}
+
+static bool
+test_matches_reference (Automaton_Type type)
+{
+  Automaton *automaton = soup(type);
+  Automaton *reference = soup(type);
+  Simulation *simulation = simulation_create(automaton, NULL, NULL);
+  bool success = !simulation_is_running(simulation);
+
+  // run as fast as possible a few times over, pausing in between
+  for (int run = 0; run < 3; run++)
+    {
+      simulation_run(simulation);
+      sleep_ms(20);
+      simulation_pause(simulation);
+    }
+  success = success && !simulation_is_running(simulation);
+
+  long generations = simulation_get_generations(simulation);
+  for (long gen = 0; gen < generations; gen++)
+    automaton_update_state(reference);
+  success = success && generations > 0 && boards_match(automaton, reference);
+
+  // nothing happens while paused
+  sleep_ms(10);
+  success = success && simulation_get_generations(simulation) == generations;
+
+  simulation_destroy(simulation);
+  automaton_destroy(automaton);
+  automaton_destroy(reference);
+  return success;
+}
+
+static bool
+test_rate ()
+{
+  Automaton *automaton = soup(game_of_life);
+  Simulation *simulation = simulation_create(automaton, NULL, NULL);
+  bool success;
+
+  simulation_set_rate(simulation, 50);
+  success = simulation_get_rate(simulation) == 50;
+  simulation_run(simulation);
+  sleep_ms(300);
+  long limited = simulation_get_generations(simulation);
+
+  // a rate of 50 can't finish more than about 15 generations in 300ms
+  success = success && limited >= 3 && limited <= 20;
+
+  // a slow rate is left at once when the rate is lifted
+  simulation_set_rate(simulation, 0.1);
+  sleep_ms(50);
+  long slow = simulation_get_generations(simulation);
+  simulation_set_rate(simulation, 0);
+  sleep_ms(200);
+  simulation_pause(simulation);
+  success = success && simulation_get_generations(simulation) > slow + 1;
+
+  simulation_destroy(simulation);
+  automaton_destroy(automaton);
+  return success;
+}
+
+static bool
+test_frames ()
+{
+  Automaton *automaton = soup(brians_brain);
+  Simulation *simulation = simulation_create(automaton, count_frame, NULL);
+  bool success;
+
+  atomic_store(&frames, 0);
+  simulation_run(simulation);
+  sleep_ms(30);
+  success = atomic_load(&frames) == 0;
+
+  // requests are merged until a frame is taken
+  simulation_request_frame(simulation);
+  simulation_request_frame(simulation);
+  sleep_ms(30);
+  success = success && atomic_load(&frames) == 1;
+
+  simulation_destroy(simulation);
+
+  // a frame is taken of a completed generation, the slow rate makes the
+  // simulation wait long after its first one
+  simulation = simulation_create(automaton, count_frame, NULL);
+  simulation_set_rate(simulation, 0.1);
+  simulation_request_frame(simulation);
+  simulation_run(simulation);
+  while (atomic_load(&frames) < 2)
+    sleep_ms(1);
+  simulation_pause(simulation);
+  success = success && simulation_get_generations(simulation) == 1
+    && atomic_load(&frame_population) == automaton_get_population(automaton);
+
+  simulation_destroy(simulation);
+  automaton_destroy(automaton);
+  return success;
+}
+
+int
+main ()
+{
+  int failures = 0;
+
+  failures += report("game of life matches",
+                     test_matches_reference(game_of_life));
+  failures += report("brian's brain matches",
+                     test_matches_reference(brians_brain));
+  failures += report("target rate", test_rate());
+  failures += report("frames", test_frames());
+
+  return failures != 0;
+}
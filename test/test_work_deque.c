@@ -0,0 +1,81 @@
+#include "WorkDeque.h"
+#include "TestHelpers.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+/*
+ * One owner pops tasks from its deque while several thieves steal from it
+ * at the same time, checking that every task is taken exactly once.
+ */
+
+#define TASKS 200000
+#define THIEVES 3
+
+static Work_Deque deque;
+static atomic_int taken[TASKS];
+
+static void *
+thief (void *arg)
+{
+  long task;
+  (void) arg;
+
+  while (!work_deque_empty(&deque))
+    {
+      if (work_deque_steal(&deque, &task))
+        atomic_fetch_add(&taken[task], 1);
+    }
+
+  return NULL;
+}
+
+static bool
+test_pop_and_steal ()
+{
+  pthread_t thieves[THIEVES];
+  bool success = true;
+  long task;
+
+  work_deque_reset(&deque, 0, TASKS);
+  for (int i = 0; i < THIEVES; i++)
+    pthread_create(&thieves[i], NULL, thief, NULL);
+
+  while (work_deque_pop(&deque, &task))
+    atomic_fetch_add(&taken[task], 1);
+
+  for (int i = 0; i < THIEVES; i++)
+    pthread_join(thieves[i], NULL);
+
+  for (int i = 0; i < TASKS; i++)
+    success = success && atomic_load(&taken[i]) == 1;
+
+  return success && work_deque_empty(&deque) && !work_deque_pop(&deque, &task)
+    && !work_deque_steal(&deque, &task);
+}
+
+static bool
+test_empty ()
+{
+  long task;
+
+  work_deque_reset(&deque, 5, 6);
+  if (work_deque_empty(&deque))
+    return false;
+
+  work_deque_reset(&deque, 5, 5);
+  return work_deque_empty(&deque) && !work_deque_pop(&deque, &task)
+    && !work_deque_steal(&deque, &task);
+}
+
+int
+main ()
+{
+  int failures = 0;
+
+  failures += report("empty deque", test_empty());
+  failures += report("pop and steal", test_pop_and_steal());
+
+  return failures != 0;
+}